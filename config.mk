@@ -22,7 +22,6 @@ DOXY_OUTPUT := doxygen
 DOXY_SOURCES := src
 
 # Dependencies.
-JANSSON_DIR ?=
 CATCH2_DIR ?=
 
 # Test options.
@@ -40,9 +39,9 @@ CXXSTANDARD ?= c++11
 EXTRA_CPPFLAGS ?=
 EXTRA_CFLAGS ?=
 EXTRA_CXXFLAGS ?=
-EXTRA_LDFLAGS ?= $(if $(JANSSON_DIR),-L$(JANSSON_DIR)/lib)
-EXTRA_INCS ?= $(if $(JANSSON_DIR),-I$(JANSSON_DIR)/include)
-EXTRA_LDLIBS ?= -ljansson -lutil
+EXTRA_LDFLAGS ?=
+EXTRA_INCS ?=
+EXTRA_LDLIBS ?= -lutil -lpthread
 
 # Verbose options.
 V ?= 0
@@ -8,36 +8,61 @@
  *  This code is licensed under the MIT License.
  */
 #ifndef _GNU_SOURCE
-#define _GNU_SOURCE /* for strdup, getopt */
+#define _GNU_SOURCE /* for strdup, getopt_long, unshare, setns, pipe2, MSG_NOSIGNAL */
 #endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdarg.h>
 #include <inttypes.h>
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
 #include <fcntl.h>
 #include <signal.h>
-#include <pwd.h>
 #include <grp.h>
 #include <pty.h>
 #include <errno.h>
+#include <getopt.h>
+#include <sched.h>
+#include <sys/file.h>
 #include <sys/mount.h>
 #include <sys/prctl.h>
 #include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/statfs.h>
 #include <sys/syscall.h>
+#include <sys/sysmacros.h>
 #include <sys/wait.h>
 #include <sys/epoll.h>
-#include <linux/capability.h>
 #include <linux/securebits.h>
 
-#include <jansson.h>
-
 #include "debug.h"
-#include "collections.h"
+#include "hash.h"
+#include "pool.h"
+#include "template.h"
+#include "image.h"
+#include "bindtree.h"
+#include "dirtree.h"
+#include "plan.h"
+#include "teardown.h"
+#include "pipeline.h"
+#include "elfdeps.h"
+#include "profile.h"
+#include "prewarm.h"
+#include "ldcache.h"
+#include "archive.h"
+#include "landlock.h"
+#include "sysops.h"
+#include "nsscache.h"
+#include "capability.h"
+#include "zygote.h"
+#include "fsutil.h"
+#include "timeutil.h"
+#include "config.h"
 
 /**
  *  バージョン情報.
@@ -46,6 +71,46 @@
 #define MODULE_VERSION "unknown"
 #endif
 
+/**
+ *  jail を作成するディレクトリ.
+ */
+#define JAIL_BASE_DIR "/tmp/alctrz"
+
+/**
+ *  jail を作成するパスの接頭辞.
+ */
+#define JAIL_PREFIX JAIL_BASE_DIR "/chroot-"
+
+/**
+ *  放棄された jail を回収する間隔 (秒).
+ */
+#define REAP_INTERVAL (60)
+
+/**
+ *  jail の tmpfs の標準のサイズ (MiB).
+ */
+#define JAIL_SIZE_DEF (96)
+
+/**
+ *  起動結果で通知する, 読み飛ばした構成の最大数.
+ */
+#define SKIPPED_MAX (8)
+
+/**
+ *  コストの計測で, 操作の種別毎に発行する回数.
+ */
+#define CALIBRATE_ITERATIONS (256)
+
+/**
+ *  rootfs の構築段階: ディレクトリ, デバイスファイル, バインド先の作成.
+ */
+#define ROOTFS_STAGE_PATHS (1 << 0)
+
+/**
+ *  rootfs の構築段階: kernel 関連の filesystem とバインドのマウント.
+ */
+#define ROOTFS_STAGE_MOUNTS (1 << 1)
+
 /**
  *  標準のディレクトリアクセス権限.
  */
@@ -73,6 +138,8 @@ struct alctrz {
             char name[LOGIN_NAME_MAX]; /**< ユーザ名. */
         } user;
 
+        const char *user_name;     /**< 指定されたユーザ名. */
+        const char *group_name;    /**< 指定されたグループ名. */
         char home_path[PATH_MAX];  /**< ホームディレクトリのパス. */
         char term[PATH_MAX];       /**< ターミナル名. */
         char shell_path[PATH_MAX]; /**< シェルのパス. */
@@ -87,21 +154,68 @@ struct alctrz {
         int argc;           /**< コマンドライン引数の数. */
         char * const *argv; /**< コマンドライン引数の文字列配列. */
         pid_t pid;          /**< プロセス ID. */
+
+        struct capability_plan capability; /**< 適用する capability のプラン. */
+        bool capability_planned;           /**< capability のプランを作成済みか. */
     } prisoner;
 
     /**
      *  jail の情報.
      */
     struct jail {
-        json_t *env;                /**< jail の rootfs 構成情報. */
-        char mount_point[PATH_MAX]; /**< jail を作成するパス. */
+        PLAN plan;                     /**< jail の構成 (プラン). */
+        char mount_point[PATH_MAX];    /**< jail を作成するパス. */
+        char template_lower[PATH_MAX]; /**< rootfs の雛形のパス. */
+        char image_lower[PATH_MAX];    /**< rootfs のイメージのマウントポイント. */
+        unsigned int stages;           /**< rootfs の構築段階. */
+        BIND_TREE binds;               /**< 用意したバインド. */
+        DIR_TREE dirs;                 /**< rootfs のパスを作成するディレクトリツリー. */
+        JAIL_MANIFEST manifest;        /**< 破棄に使用する jail のマニフェスト. */
+        ELF_DEPS elf;                  /**< バインドする ELF の依存ファイル. */
+        struct archive_stats archive;  /**< rootfs に展開したアーカイブの統計情報. */
+        bool archive_extracted;        /**< アーカイブを展開したか. */
+        bool binds_prepared;           /**< バインドを用意済みか. */
+        bool landlock;                 /**< rootfs を構築せず, Landlock で制限するか. */
+        bool keep_binds;               /**< 用意したバインドを他の jail でも使用するか. */
+
+        /**
+         *  構築に失敗して読み飛ばした構成.
+         */
+        struct skipped {
+            const char *kind; /**< 構成の種別. */
+            size_t index;     /**< 構成の番号. (1 起算) */
+            int error;        /**< 失敗時の errno. */
+        } skipped[SKIPPED_MAX];
+        size_t num_skipped;            /**< 読み飛ばした構成の数. */
     } jail;
 
     bool do_attach;
+    bool show_stats;   /**< 統計情報を表示する. */
     bool show_help;    /**< ヘルプを表示する. */
     bool show_version; /**< バージョンを表示する. */
-
-    LIST bind_entries; /**< バインド登録情報. */
+    bool do_reap;      /**< 放棄された jail を回収する. */
+    bool do_profile;   /**< jail 内のファイルアクセスを記録する. */
+    bool show_profile_binds; /**< アクセスプロファイルからバインドの一覧を表示する. */
+    bool show_plan;          /**< rootfs の構築の操作を記録して表示する. */
+    bool do_calibrate;       /**< rootfs の構築の操作のコストを計測する. */
+
+    char profile_path[PATH_MAX]; /**< アクセスプロファイルのパス. */
+    ACCESS_PROFILE profile;      /**< 先読みに使用するアクセスプロファイル. */
+    PREWARM prewarm;             /**< ページキャッシュのプリウォーム. */
+
+    const char *compile_source; /**< プランに変換する設定ファイル. */
+    const char *plan_output;    /**< 出力するプランファイル. */
+
+    const char *zygote_path; /**< zygote として起動要求を待ち受けるソケット. */
+    int zygote_fd;           /**< 起動要求を待ち受けるソケット. */
+    bool zygote_listening;   /**< 起動要求のソケットを作成したか. */
+    uid_t zygote_owner;      /**< zygote に起動を要求できるユーザ. */
+    const char *run_path;    /**< 起動を要求する zygote のソケット. */
+    const char *enter_name;  /**< プログラムを追加で実行する, 使用中の jail の名前. */
+
+    int report_fd; /**< jail の名前を親プロセスに渡すパイプ. */
+    int notify_fd; /**< 起動結果を親プロセスに渡すパイプ. */
+    int ready_fd;  /**< 起動結果を転送する, `--ready-fd` で指定された記述子. */
 };
 
 /**
@@ -115,6 +229,8 @@ struct alctrz {
                 .uid = getuid(),                 \
                 .name = {0},                     \
             },                                   \
+            .user_name = NULL,                   \
+            .group_name = NULL,                  \
             .home_path = "/",                    \
             .term = {0},                         \
             .shell_path = "/bin/sh",             \
@@ -123,22 +239,50 @@ struct alctrz {
             },                                   \
             .argc = 0,                           \
             .argv = NULL,                        \
+            .capability_planned = false,         \
         },                                       \
         .jail = {                                \
-            .env = NULL,                         \
-            .mount_point = "/tmp/chroot-XXXXXX", \
+            .plan = NULL,                        \
+            .mount_point = JAIL_PREFIX "XXXXXX", \
+            .template_lower = {0},               \
+            .image_lower = {0},                  \
+            .stages = ROOTFS_STAGE_PATHS         \
+                    | ROOTFS_STAGE_MOUNTS,       \
+            .binds = NULL,                       \
+            .dirs = NULL,                        \
+            .manifest = NULL,                    \
+            .elf = NULL,                         \
+            .archive_extracted = false,          \
+            .binds_prepared = false,             \
+            .landlock = false,                   \
+            .keep_binds = false,                 \
+            .num_skipped = 0,                    \
         },                                       \
         .do_attach = false,                      \
+        .show_stats = false,                     \
         .show_help = false,                      \
         .show_version = false,                   \
-        .bind_entries = NULL,                    \
+        .do_reap = false,                        \
+        .do_profile = false,                     \
+        .show_profile_binds = false,             \
+        .show_plan = false,                      \
+        .do_calibrate = false,                   \
+        .profile_path = {0},                     \
+        .profile = NULL,                         \
+        .prewarm = NULL,                         \
+        .compile_source = NULL,                  \
+        .plan_output = NULL,                     \
+        .zygote_path = NULL,                     \
+        .zygote_fd = -1,                         \
+        .zygote_listening = false,               \
+        .zygote_owner = getuid(),                \
+        .run_path = NULL,                        \
+        .enter_name = NULL,                      \
+        .report_fd = -1,                         \
+        .notify_fd = -1,                         \
+        .ready_fd = -1,                          \
     }
 
-/**
- *  配列の長さを返す.
- */
-#define lengthof(array) (sizeof(array)/sizeof(array[0]))
-
 /**
  *  小さい方を返す.
  */
@@ -154,6 +298,11 @@ static struct termios saved_term;
  */
 static struct winsize winsz;
 
+/**
+ *  ユーザとグループの名前解決のキャッシュ. (プロセス内の全ての起動で共有する)
+ */
+static NSS_CACHE nss_cache = NULL;
+
 /**
  *  ラムダ式マクロ.
  */
@@ -171,14 +320,44 @@ static struct winsize winsz;
  */
 static void print_usage(const char *name)
 {
-    printf("usage: %s [-hv] -c <conf-file> -u <user> [-g <group>] -- <program-path> [<program-args>]\n"
-           "  -c    Specify the json format setting file.\n"
+    printf("usage: %s [-hv] [--ready-fd <fd>] [--profile] [--zygote <socket>] -c <conf-file> -u <user> [-g <group>] -- <program-path> [<program-args>]\n"
+           "       %s [--ready-fd <fd>] --run <socket> [-- <program-path> [<program-args>]]\n"
+           "       %s [--ready-fd <fd>] -e <jail> -- <program-path> [<program-args>]\n"
+           "       %s -s -c <conf-file> -u <user> [-g <group>]\n"
+           "       %s --profile-binds -c <conf-file>\n"
+           "       %s --plan -c <conf-file>\n"
+           "       %s --calibrate\n"
+           "       %s --compile <json-file> -o <plan-file>\n"
+           "       %s --reap [-c <conf-file>]\n"
+           "  -c    Specify the json format setting file or the compiled plan file.\n"
            "  -u    Specify the user-id for <program> execution.\n"
            "  -g    Specify the group-id for <program> execution.\n"
+           "  -e    Run <program> with this stdio in the running <jail>, as its prisoner.\n"
+           "  -s    Only show statistics of the jail pool and the teardown queue.\n"
            "  -h    Only show help.\n"
            "  -v    Only show version.\n"
+           "  --compile\n"
+           "        Compile the json format setting file into a plan file.\n"
+           "  -o    Specify the output plan file for --compile.\n"
+           "  --reap\n"
+           "        Reclaim the mounts and fifos of jails left behind by crashed launches,\n"
+           "        including the jail pool of <conf-file> (default: " POOL_DIR_DEF ").\n"
+           "  --ready-fd\n"
+           "        Write the launch result to <fd> once <program> is executed or the launch fails.\n"
+           "  --profile\n"
+           "        Record the files opened in the jail to <conf-file>.profile.\n"
+           "  --profile-binds\n"
+           "        Print the bind list which covers only the files in <conf-file>.profile.\n"
+           "  --plan\n"
+           "        Only print the operations to build the rootfs and their estimated cost.\n"
+           "  --calibrate\n"
+           "        Measure the cost of each operation for --plan.\n"
+           "  --zygote\n"
+           "        Keep the prepared jail and run <program> for each request on <socket>.\n"
+           "  --run\n"
+           "        Run <program> with this stdio through the zygote on <socket> and wait for it.\n"
            "  <program-path> must be absolute path.\n",
-           name);
+           name, name, name, name, name, name, name, name, name);
 }
 
 /**
@@ -214,68 +393,6 @@ static int fdprintf(int fd, const char *format, ...)
     return length;
 }
 
-/**
- *  capability を文字列から数値に変換する.
- *
- *  @param  [in]    name    capability 名称.
- *  @return 変換出来る場合は capability の数値が返り,
- *          失敗の場合は -1 が返る.
- */
-static int capability_to_int(const char *name)
-{
-    static const struct {
-        const char *name;
-        int value;
-    } conv_table[] = {
-#define CAP_CONV_TABLE_SETTER(name) {#name, name}
-        CAP_CONV_TABLE_SETTER(CAP_CHOWN),
-        CAP_CONV_TABLE_SETTER(CAP_DAC_OVERRIDE),
-        CAP_CONV_TABLE_SETTER(CAP_DAC_READ_SEARCH),
-        CAP_CONV_TABLE_SETTER(CAP_FOWNER),
-        CAP_CONV_TABLE_SETTER(CAP_FSETID),
-        CAP_CONV_TABLE_SETTER(CAP_KILL),
-        CAP_CONV_TABLE_SETTER(CAP_SETGID),
-        CAP_CONV_TABLE_SETTER(CAP_SETUID),
-        CAP_CONV_TABLE_SETTER(CAP_SETPCAP),
-        CAP_CONV_TABLE_SETTER(CAP_LINUX_IMMUTABLE),
-        CAP_CONV_TABLE_SETTER(CAP_NET_BIND_SERVICE),
-        CAP_CONV_TABLE_SETTER(CAP_NET_BROADCAST),
-        CAP_CONV_TABLE_SETTER(CAP_NET_ADMIN),
-        CAP_CONV_TABLE_SETTER(CAP_NET_RAW),
-        CAP_CONV_TABLE_SETTER(CAP_IPC_LOCK),
-        CAP_CONV_TABLE_SETTER(CAP_IPC_OWNER),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_MODULE),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_RAWIO),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_CHROOT),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_PTRACE),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_PACCT),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_ADMIN),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_BOOT),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_NICE),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_RESOURCE),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_TIME),
-        CAP_CONV_TABLE_SETTER(CAP_SYS_TTY_CONFIG),
-        CAP_CONV_TABLE_SETTER(CAP_MKNOD),
-        CAP_CONV_TABLE_SETTER(CAP_LEASE),
-        CAP_CONV_TABLE_SETTER(CAP_AUDIT_WRITE),
-        CAP_CONV_TABLE_SETTER(CAP_AUDIT_CONTROL),
-        CAP_CONV_TABLE_SETTER(CAP_SETFCAP),
-        CAP_CONV_TABLE_SETTER(CAP_MAC_OVERRIDE),
-        CAP_CONV_TABLE_SETTER(CAP_MAC_ADMIN),
-        CAP_CONV_TABLE_SETTER(CAP_SYSLOG),
-        CAP_CONV_TABLE_SETTER(CAP_WAKE_ALARM)
-#undef CAP_CONV_TABLE_SETTER
-    };
-
-    for (size_t i = 0; i < lengthof(conv_table); ++i) {
-        if (strcmp(conv_table[i].name, name) == 0) {
-            return conv_table[i].value;
-        }
-    }
-
-    return -1;
-}
-
 /**
  *  ファイル記述子のブロッキングを設定する.
  *
@@ -410,61 +527,76 @@ static int wait_for_event(int fds[],
 }
 
 /**
- *  所有者を指定してディレクトリを作成する.
+ *  jail の rootfs に, 指定のバインドを行う内部処理.
+ *
+ *  マウント段階ではバインドを用意するのみで, jail への取り付けは
+ *  全てのバインドを用意した後に行う.
  */
-static int mkdir_with_owner(const char *pathname,
-                            mode_t mode,
-                            uid_t owner,
-                            gid_t group)
+static int create_rootfs_bind_inner(struct alctrz *self,
+                                    const char *source,
+                                    const char *target,
+                                    unsigned int attrs)
 {
-    if (mkdir(pathname, mode) != 0) {
-        return -1;
+    struct stat status;
+    int ret;
+
+    if (self->jail.stages & ROOTFS_STAGE_PATHS) {
+        ret = lstat(source, &status);
+        if (ret != 0) {
+            DEBUG("lstat: %s", strerror(errno));
+            return -1;
+        }
+        if (S_ISDIR(status.st_mode)) {
+            ret = dir_tree_mkdir(self->jail.dirs, target, DIR_PERM_DEF);
+        } else {
+            ret = dir_tree_touch(self->jail.dirs, target, FILE_PERM_DEF);
+        }
+        if (ret != 0) {
+            return -1;
+        }
     }
 
-    if (chown(pathname, owner, group) != 0) {
-        return -1;
+    if ((self->jail.stages & ROOTFS_STAGE_MOUNTS) && !self->jail.binds_prepared) {
+        ret = bind_tree_add(self->jail.binds, source, target, attrs);
+        if (ret != 0) {
+            return -1;
+        }
     }
 
     return 0;
 }
 
 /**
- *  再帰的にディレクトリを作成する.
- *
- *  @c path_only が指定された場合は, ベースディレクトリの作成まで行う.
+ *  jail の rootfs に, kernel 関連の filesystem を作成する.
  */
-static int recursive_mkdir(const char *pathname,
-                           mode_t mode,
-                           uid_t owner,
-                           gid_t group,
-                           bool path_only)
+static int build_rootfs_kernelfs(struct alctrz *self)
 {
-    const size_t length = strlen(pathname);
-    char path[PATH_MAX] = {0};
+    static const struct {
+        uint32_t flag;
+        const char *pathname;
+        const char *type;
+    } kernelfs[] = {
+        {PLAN_KERNELFS_DEVTMPFS, "/dev", "devtmpfs"},
+        {PLAN_KERNELFS_PROCFS, "/proc", "proc"},
+        {PLAN_KERNELFS_SYSFS, "/sys", "sysfs"},
+    };
+    uint32_t flags = plan_flags(self->jail.plan);
+    char path[PATH_MAX];
 
-    if (length > sizeof(path) - 1) {
-        errno = ENAMETOOLONG;
-        return -1;
-    }
-    strncpy(path, pathname, sizeof(path) - 1);
+    for (size_t i = 0; i < lengthof(kernelfs); ++i) {
+        if ((flags & kernelfs[i].flag) == 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, kernelfs[i].pathname);
+        if ((self->jail.stages & ROOTFS_STAGE_PATHS)
+            && (dir_tree_mkdir(self->jail.dirs, kernelfs[i].pathname, DIR_PERM_DEF) != 0)) {
 
-    for (char *sep = path + 1; *sep != '\0'; ++sep) {
-        if (*sep == '/') {
-            if (*(sep + 1) == '\0') {
-                break;
-            }
-            *sep = '\0';
-            if (mkdir_with_owner(path, DIR_PERM_DEF, owner, group) != 0) {
-                if (errno != EEXIST) {
-                    return -1;
-                }
-            }
-            *sep = '/';
+            return -1;
         }
-    }
+        if ((self->jail.stages & ROOTFS_STAGE_MOUNTS)
+            && (sysops_mount("none", path, kernelfs[i].type, 0, NULL) != 0)) {
 
-    if (!path_only && (mkdir_with_owner(path, mode, owner, group) != 0)) {
-        if (errno != EEXIST) {
+            DEBUG("mount: %s (%s)", strerror(errno), path);
             return -1;
         }
     }
@@ -473,480 +605,680 @@ static int recursive_mkdir(const char *pathname,
 }
 
 /**
- *  パスを生成した上で空ファイルを作成する.
+ *  構築に失敗して読み飛ばした構成を, 起動結果の通知用に記録する.
  */
-static int touch_with_mkpath(const char *pathname, uid_t owner, gid_t group)
+static void skip_entry(struct alctrz *self, const char *kind, size_t index)
 {
-    recursive_mkdir(pathname, DIR_PERM_DEF, owner, group, true);
-
-    int fd = open(pathname, O_WRONLY | O_CREAT, FILE_PERM_DEF);
-    if (fd < 0) {
-        DEBUG("open: %s (%s)", strerror(errno), pathname);
-        return -1;
+    int error = errno;
+
+    DEBUG("plan: failed to '%s' %zu", kind, index);
+    if (self->jail.num_skipped < lengthof(self->jail.skipped)) {
+        struct skipped *skipped = &self->jail.skipped[self->jail.num_skipped++];
+        skipped->kind = kind;
+        skipped->index = index;
+        skipped->error = error;
     }
-    close(fd);
+}
 
-    if (chown(pathname, owner, group) != 0) {
-        DEBUG("chown: %s (%s)", strerror(errno), pathname);
-        return -1;
+static int build_rootfs_directory(struct alctrz *self)
+{
+    size_t count;
+    const uint32_t *dirs = plan_directories(self->jail.plan, &count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const char *pathname = plan_string(self->jail.plan, dirs[i]);
+
+        if (dir_tree_mkdir(self->jail.dirs, pathname, DIR_PERM_DEF) != 0) {
+            skip_entry(self, "directory", i + 1);
+        }
     }
 
     return 0;
 }
 
-/**
- *  jail の rootfs に, 指定のデバイスファイルを作成する内部処理.
- */
-static int create_rootfs_device_inner(struct alctrz *self,
-                                      const char *pathname,
-                                      const char *type,
-                                      int major,
-                                      int minor,
-                                      const char *perm)
+static int build_rootfs_device(struct alctrz *self)
 {
-    if ((pathname == NULL) || (type == NULL) || (major == 0)) {
-        errno = EINVAL;
-        return -1;
-    }
+    size_t count;
+    const struct plan_device *devs = plan_devices(self->jail.plan, &count);
 
-    mode_t mode = (perm != NULL) ? strtol(perm, NULL, 8) : 0666;
-    if (strncmp(type, "char", 5) == 0) {
-        mode |= S_IFCHR;
-    } else {
-        mode |= S_IFREG;
-    }
+    for (size_t i = 0; i < count; ++i) {
+        const char *pathname = plan_string(self->jail.plan, devs[i].pathname);
 
-    char path[PATH_MAX];
-    snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, pathname);
-    recursive_mkdir(path,
-                    DIR_PERM_DEF,
-                    self->prisoner.user.uid,
-                    self->prisoner.user.gid,
-                    true);
+        if (dir_tree_mknod(self->jail.dirs,
+                           pathname,
+                           devs[i].mode,
+                           makedev(devs[i].major, devs[i].minor)) != 0) {
 
-    int ret;
-    ret = mknod(path, mode, makedev(major, minor));
-    if (ret != 0) {
-        DEBUG("mknod: %s (%s)", strerror(errno), path);
-        return -1;
-    }
-    ret = chown(path, self->prisoner.user.uid, self->prisoner.user.gid);
-    if (ret != 0) {
-        DEBUG("chown: %s (%s)", strerror(errno), path);
-        return -1;
+            skip_entry(self, "device", i + 1);
+        }
     }
 
     return 0;
 }
 
 /**
- *  jail の rootfs に文字列で指定したデバイスファイルを作成する.
+ *  jail に取り付けたバインドをマニフェストに記録する.
  */
-static int create_rootfs_device_by_string(struct alctrz *self, const char *data)
+static void add_bind_entry(void *arg, const char *path)
 {
-    char *options = strdup(data);
-    char *pathname = options;
+    struct alctrz *self = (struct alctrz *)arg;
 
-    char *perm = strrchr(options, ',');
-    if (perm != NULL) {
-        *perm = '\0';
-        ++perm;
+    if (self->jail.manifest != NULL) {
+        jail_manifest_add_bind(self->jail.manifest, path);
     }
+}
 
-    char *minor = strrchr(options, ',');
-    if (minor != NULL) {
-        *minor = '\0';
-        ++minor;
-    }
+static int build_rootfs_bind(struct alctrz *self)
+{
+    size_t count;
+    const struct plan_bind *binds = plan_binds(self->jail.plan, &count);
 
-    char *major = strrchr(options, ',');
-    if (major != NULL) {
-        *major = '\0';
-        ++major;
+    if ((self->jail.stages & ROOTFS_STAGE_MOUNTS) && (self->jail.binds == NULL)) {
+        self->jail.binds = bind_tree_init();
+        if (self->jail.binds == NULL) {
+            DEBUG("bind_tree_init: %s", strerror(errno));
+            return -1;
+        }
     }
 
-    char *type = strrchr(options, ',');
-    if (type != NULL) {
-        *type = '\0';
-        ++type;
+    for (size_t i = 0; i < count; ++i) {
+        if (create_rootfs_bind_inner(self,
+                                     plan_string(self->jail.plan, binds[i].source),
+                                     plan_string(self->jail.plan, binds[i].target),
+                                     binds[i].attrs) != 0) {
+
+            skip_entry(self, "bind", i + 1);
+        }
     }
 
-    if (create_rootfs_device_inner(self,
-                                   pathname,
-                                   type,
-                                   (major != NULL) ? atoi(major) : 0,
-                                   (minor != NULL) ? atoi(minor) : 0,
-                                   perm) != 0) {
+    if (self->jail.stages & ROOTFS_STAGE_MOUNTS) {
+        self->jail.binds_prepared = true;
+        if (bind_tree_attach(self->jail.binds,
+                             self->jail.mount_point,
+                             self->jail.keep_binds,
+                             add_bind_entry,
+                             self) != 0) {
 
-        free(options);
-        return -1;
+            DEBUG("bind_tree_attach: %s (%s)", strerror(errno), self->jail.mount_point);
+            return -1;
+        }
+        DEBUG("bind: %zu entries, %zu syscalls",
+              bind_tree_count(self->jail.binds),
+              bind_tree_syscalls(self->jail.binds));
     }
 
-    free(options);
-
     return 0;
 }
 
 /**
- *  jail の rootfs にオブジェクトで指定したデバイスファイルを作成する.
+ *  設定したアーカイブを jail の rootfs に展開する.
+ *
+ *  展開したファイルの所有者は, 閉じ込めるプログラムのユーザとする.
+ *  rootfs の構築の操作を記録している場合は, 展開しない.
  */
-static int create_rootfs_device_by_object(struct alctrz *self, json_t *data)
+static int build_rootfs_archive(struct alctrz *self)
 {
-    json_t *pathname = json_object_get(data, "pathname"),
-           *type = json_object_get(data, "type"),
-           *major = json_object_get(data, "major"),
-           *minor = json_object_get(data, "minor"),
-           *perm = json_object_get(data, "perm");
-
-    if (!json_is_string(pathname)) {
-        DEBUG("json: %s is not a string", "pathname");
-        return -1;
-    }
-    if (!json_is_string(type)) {
-        DEBUG("json: %s is not a string", "type");
-        return -1;
-    }
-    if (!json_is_integer(major)) {
-        DEBUG("json: %s is not a string", "major");
-        return -1;
-    }
-    if (!json_is_integer(minor)) {
-        DEBUG("json: %s is not a string", "minor");
-        return -1;
-    }
-    if (!json_is_string(perm)) {
-        DEBUG("json: %s is not a string", "perm");
-        return -1;
+    const struct plan_archive *archive = plan_archive(self->jail.plan);
+    if ((archive == NULL) || sysops_recording()) {
+        return 0;
     }
 
-    if (create_rootfs_device_inner(self,
-                                   json_string_value(pathname),
-                                   json_string_value(type),
-                                   json_integer_value(major),
-                                   json_integer_value(minor),
-                                   json_string_value(perm)) != 0) {
+    const char *source = plan_string(self->jail.plan, archive->source);
+    struct archive_stats *stats = &self->jail.archive;
+    if (archive_extract(source,
+                        self->jail.mount_point,
+                        self->prisoner.user.uid,
+                        self->prisoner.user.gid,
+                        archive->workers,
+                        stats) != 0) {
 
+        DEBUG("archive_extract: %s (%s)", strerror(errno), source);
         return -1;
     }
+    self->jail.archive_extracted = true;
+
+    uint64_t us = (stats->elapsed_us > 0) ? stats->elapsed_us : 1;
+    DEBUG("archive: %zu files, %zu directories, %zu links, %zu skipped, %" PRIu64 " bytes in %" PRIu64 " us"
+          " (%.1f MB/s, %.0f files/s)",
+          stats->files, stats->directories, stats->links, stats->skipped, stats->bytes, stats->elapsed_us,
+          (double)stats->bytes / (double)us, (double)stats->files * 1e6 / (double)us);
 
     return 0;
 }
 
 /**
- *  jail の rootfs に, 指定のバインドを行う内部処理.
+ *  指定の設定で, jail 向けの rootfs を作成する.
  */
-static int create_rootfs_bind_inner(struct alctrz *self,
-                                    const char *source,
-                                    const char *target,
-                                    const char *mode)
+static int build_rootfs_inner(struct alctrz *self)
 {
-    char path[PATH_MAX] = {0};
-    const char *target_ = (target) ?: source;
-    const char *mode_ = (mode) ?: "ro";
-    u_long mountflags = MS_BIND;
-    struct stat status;
-    int ret;
-
-    if (strncmp(mode_, "ro", 3) == 0) {
-        mountflags |= MS_RDONLY;
-    }
-
-    snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, target_);
-    DEBUG("mount: %s to %s (%s)", source, path, mode_);
-
-    ret = lstat(source, &status);
-    if (ret != 0) {
-        DEBUG("lstat: %s", strerror(errno));
+    if (build_rootfs_kernelfs(self) != 0) {
         return -1;
     }
-    if (S_ISDIR(status.st_mode)) {
-        recursive_mkdir(path,
-                        DIR_PERM_DEF,
-                        self->prisoner.user.uid,
-                        self->prisoner.user.gid,
-                        false);
-    } else {
-        ret = touch_with_mkpath(path, self->prisoner.user.uid, self->prisoner.user.gid);
-        if (ret != 0) {
+    /*
+     *  アーカイブ, ディレクトリとデバイスファイルは, 雛形を使用する場合は構築済み.
+     *  ディレクトリツリーのキャッシュと食い違わないよう, アーカイブを先に展開する.
+     */
+    if (self->jail.stages & ROOTFS_STAGE_PATHS) {
+        if (build_rootfs_archive(self) != 0) {
+            return -1;
+        }
+        if (build_rootfs_directory(self) != 0) {
+            return -1;
+        }
+        if (build_rootfs_device(self) != 0) {
             return -1;
         }
     }
-
-    ret = mount(source, path, NULL, mountflags, NULL);
-    if (ret != 0) {
-        DEBUG("mount: %s", strerror(errno));
+    if (build_rootfs_bind(self) != 0) {
         return -1;
     }
-    list_add(self->bind_entries, path);
 
     return 0;
 }
 
 /**
- *  jail の rootfs に文字列で指定したバインドを行う.
+ *  jail の rootfs を構築する.
+ *
+ *  パスの作成は, jail のディレクトリ fd を起点として行う.
  */
-static int create_rootfs_bind_by_string(struct alctrz *self, const char *data)
+static int build_rootfs(struct alctrz *self)
 {
-    char *options = strdup(data);
-
-    char *mode = strrchr(options, ',');
-    if (mode != NULL) {
-        *mode = '\0';
-        ++mode;
+    if (self->jail.stages & ROOTFS_STAGE_PATHS) {
+        self->jail.dirs = dir_tree_open(self->jail.mount_point,
+                                        self->prisoner.user.uid,
+                                        self->prisoner.user.gid,
+                                        DIR_PERM_DEF);
+        if (self->jail.dirs == NULL) {
+            return -1;
+        }
     }
 
-    char *target = strchr(options, ':');
-    if (target != NULL) {
-        *target = '\0';
-        ++target;
-    }
+    int ret = build_rootfs_inner(self);
 
-    char *source = options;
-    if (create_rootfs_bind_inner(self, source, target, mode) != 0) {
-        free(options);
-        return -1;
+    if (self->jail.dirs != NULL) {
+        struct dir_tree_stats stats;
+        if (dir_tree_get_stats(self->jail.dirs, &stats) == 0) {
+            DEBUG("rootfs paths: %zu directories, %" PRIu64 " syscalls (%" PRIu64 " saved, %" PRIu64 " cache hits)",
+                  stats.cached, stats.syscalls, stats.saved, stats.hits);
+        }
+        dir_tree_close(self->jail.dirs);
+        self->jail.dirs = NULL;
     }
 
-    free(options);
-
-    return 0;
+    return ret;
 }
 
 /**
- *  jail の rootfs にオブジェクトで指定したバインドを行う.
+ *  閉じ込めるプログラムと設定したプログラムの, ELF の依存ファイルを解決する.
+ *
+ *  設定したプログラムの解決に失敗した場合は, そのプログラムのみ読み飛ばす.
  */
-static int create_rootfs_bind_by_object(struct alctrz *self, json_t *data)
+static int resolve_elf_deps(struct alctrz *self)
 {
-    json_t *source = json_object_get(data, "source"),
-           *target = json_object_get(data, "target"),
-           *mode = json_object_get(data, "mode");
+    const char *cache = plan_elf_cache(self->jail.plan);
+    if (cache == NULL) {
+        return 0;
+    }
 
-    if (!json_is_string(source)) {
-        DEBUG("json: %s is not a string", "source");
+    ELF_DEPS elf = elf_deps_init(cache);
+    if (elf == NULL) {
+        DEBUG("elf_deps_init: %s", strerror(errno));
         return -1;
     }
-    if (!json_is_string(target)) {
-        DEBUG("json: %s is not a string", "target");
+    if (elf_deps_add(elf, self->prisoner.argv[0]) != 0) {
+        DEBUG("elf_deps_add: %s (%s)", strerror(errno), self->prisoner.argv[0]);
+        int error = errno;
+        elf_deps_release(elf);
+        errno = error;
         return -1;
     }
-    if (!json_is_string(mode)) {
-        DEBUG("json: %s is not a string", "mode");
-        return -1;
+    size_t count;
+    const uint32_t *binaries = plan_binaries(self->jail.plan, &count);
+    for (size_t i = 0; i < count; ++i) {
+        const char *pathname = plan_string(self->jail.plan, binaries[i]);
+        if (elf_deps_add(elf, pathname) != 0) {
+            DEBUG("elf_deps_add: %s (%s)", strerror(errno), pathname);
+        }
     }
 
-    if (create_rootfs_bind_inner(self,
-                                 json_string_value(source),
-                                 json_string_value(target),
-                                 json_string_value(mode)) != 0) {
-
-        return -1;
+    struct elf_deps_stats stats;
+    if (elf_deps_get_stats(elf, &stats) == 0) {
+        DEBUG("elf: %zu binaries (%zu cached), %zu files, %" PRIu64 " us",
+              stats.binaries, stats.cache_hits, stats.files, stats.elapsed_us);
     }
+    self->jail.elf = elf;
 
     return 0;
 }
 
 /**
- *  jail の rootfs に, 指定のパスを作成する.
+ *  ホストのファイルが, jail 内の同じパスで既に見えているかを判定する.
+ *
+ *  jail 内の絶対パスのシンボリックリンクは, jail の root を起点に解決する.
  */
-static int create_rootfs_path(struct alctrz *self, json_t *data)
+static bool is_visible_in_jail(int root_fd, const char *path, const struct stat *status)
 {
-    if (!json_is_string(data)) {
-        return -1;
-    }
-
-    char path[PATH_MAX];
-    const char *pathname = json_string_value(data);
-    uid_t uid = self->prisoner.user.uid;
-    gid_t gid = self->prisoner.user.gid;
-    snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, pathname);
-    recursive_mkdir(path, DIR_PERM_DEF, uid, gid, false);
-
-    return 0;
-}
+    struct stat jailed;
 
-static int create_rootfs_device(struct alctrz *self, json_t *data)
-{
-    if (json_is_string(data)) {
-        if (create_rootfs_device_by_string(self, json_string_value(data)) != 0) {
-            return -1;
-        }
-    } else if (json_is_object(data)) {
-        if (create_rootfs_device_by_object(self, data) != 0) {
-            return -1;
-        }
-    } else {
-        return -1;
+    int fd = open_in_root(root_fd, path, O_PATH | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
     }
+    int ret = fstat(fd, &jailed);
+    close(fd);
 
-    return 0;
+    return (ret == 0) && (jailed.st_dev == status->st_dev) && (jailed.st_ino == status->st_ino);
 }
 
-static int create_rootfs_bind(struct alctrz *self, json_t *data)
+/**
+ *  ELF の依存ファイルを jail にバインドする.
+ *
+ *  依存ファイルはプログラム毎に異なるため, プールや雛形を使用する場合も
+ *  jail 毎にバインドする. 設定したバインドで既に見えているファイルは
+ *  バインドしない.
+ */
+static int build_rootfs_elf(struct alctrz *self)
 {
-    if (json_is_string(data)) {
-        if (create_rootfs_bind_by_string(self, json_string_value(data)) != 0) {
-            return -1;
-        }
-    } else if (json_is_object(data)) {
-        if (create_rootfs_bind_by_object(self, data) != 0) {
-            return -1;
-        }
-    } else {
-        return -1;
+    size_t count = elf_deps_count(self->jail.elf);
+    if (count == 0) {
+        return 0;
     }
 
-    return 0;
-}
-
-static int try_json_object(struct alctrz *self,
-                           json_t *data,
-                           const char *name,
-                           int (*func)(struct alctrz *self, json_t *))
-{
-    json_t *obj = json_object_get(data, name);
-    if (!json_is_object(obj)) {
-        DEBUG("json: '%s' is not an object", name);
+    int root_fd = open(self->jail.mount_point, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), self->jail.mount_point);
         return -1;
     }
-    if (func(self, obj) != 0) {
-        DEBUG("json: failed to '%s'", name);
+    DIR_TREE dirs = dir_tree_open(self->jail.mount_point,
+                                  self->prisoner.user.uid,
+                                  self->prisoner.user.gid,
+                                  DIR_PERM_DEF);
+    BIND_TREE binds = bind_tree_init();
+    if ((dirs == NULL) || (binds == NULL)) {
+        bind_tree_release(binds);
+        dir_tree_close(dirs);
+        close(root_fd);
         return -1;
     }
-    return 0;
-}
 
-static int try_json_array(struct alctrz *self,
-                          json_t *data,
-                          const char *name,
-                          int (*func)(struct alctrz *self, json_t *))
-{
-    json_t *obj = json_object_get(data, name);
-    if (obj != NULL) {
-        if (!json_is_array(obj)) {
-            DEBUG("json: '%s' is not an array", name);
-            return -1;
+    for (size_t i = 0; i < count; ++i) {
+        const char *path = elf_deps_get(self->jail.elf, i);
+        struct stat status;
+
+        if (stat(path, &status) != 0) {
+            skip_entry(self, "elf", i + 1);
+            continue;
         }
-        if (func(self, obj) != 0) {
-            DEBUG("json: failed to '%s'", name);
-            return -1;
+        if (is_visible_in_jail(root_fd, path, &status)) {
+            continue;
         }
-    }
-    return 0;
-}
+        if ((dir_tree_touch(dirs, path, FILE_PERM_DEF) != 0)
+            || (bind_tree_add(binds, path, path, BIND_ATTR_RDONLY) != 0)) {
 
-static bool try_json_boolean(struct alctrz *self,
-                             json_t *data,
-                             const char *name)
-{
-    json_t *obj = json_object_get(data, name);
-    if (!json_is_boolean(obj)) {
-        DEBUG("json: %s is not a boolean", name);
-        return false;
+            skip_entry(self, "elf", i + 1);
+        }
     }
-    return json_boolean_value(obj) == 1;
+    bind_tree_attach(binds, self->jail.mount_point, false, add_bind_entry, self);
+    DEBUG("elf: %zu binds, %zu syscalls", bind_tree_count(binds), bind_tree_syscalls(binds));
+
+    bind_tree_release(binds);
+    dir_tree_close(dirs);
+    close(root_fd);
+
+    return 0;
 }
 
 /**
- *  jail の rootfs に, kernel 関連の filesystem を作成する.
+ *  jail 内のパスを, それを見せているバインド元のホスト上のパスに変換する.
+ *
+ *  バインド先が入れ子の場合は, 最も深いバインドを使用する.
+ *  ELF の依存ファイルは同じパスにバインドしている.
+ *  jail の tmpfs や雛形にのみ存在するファイルは変換できない.
  */
-static int build_rootfs_kernelfs(struct alctrz *self, json_t *data)
+static int jail_to_host_path(void *arg, const char *target, char *source, size_t length)
 {
-    bool devfs_enable = try_json_boolean(self, data, "devtmpfs"),
-         procfs_enable = try_json_boolean(self, data, "procfs"),
-         sysfs_enable = try_json_boolean(self, data, "sysfs");
-    uid_t uid = self->prisoner.user.uid;
-    gid_t gid = self->prisoner.user.gid;
-    char path[PATH_MAX];
+    struct alctrz *self = (struct alctrz *)arg;
+    size_t count;
+    const struct plan_bind *binds = plan_binds(self->jail.plan, &count);
+    const char *matched = NULL;
+    size_t matched_length = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        const char *bind_target = plan_string(self->jail.plan, binds[i].target);
+        size_t bind_length = strlen(bind_target);
+        while ((bind_length > 0) && (bind_target[bind_length - 1] == '/')) {
+            --bind_length;
+        }
+        if ((strncmp(target, bind_target, bind_length) == 0)
+            && ((target[bind_length] == '/') || (target[bind_length] == '\0'))
+            && ((matched == NULL) || (bind_length > matched_length))) {
 
-    if (devfs_enable) {
-        snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, "/dev");
-        recursive_mkdir(path, DIR_PERM_DEF, uid, gid, false);
-        if (mount("none", path, "devtmpfs", 0, NULL) != 0) {
-            DEBUG("mount: %s (%s)", strerror(errno), path);
-            return -1;
+            matched = plan_string(self->jail.plan, binds[i].source);
+            matched_length = bind_length;
         }
     }
-    if (procfs_enable) {
-        snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, "/proc");
-        recursive_mkdir(path, DIR_PERM_DEF, uid, gid, false);
-        if (mount("none", path, "proc", 0, NULL) != 0) {
-            DEBUG("mount: %s (%s)", strerror(errno), path);
+    if (matched != NULL) {
+        if (snprintf(source, length, "%s%s", matched, &target[matched_length]) >= (int)length) {
+            errno = ENAMETOOLONG;
             return -1;
         }
+        return 0;
     }
-    if (sysfs_enable) {
-        snprintf(path, sizeof(path), "%s%s", self->jail.mount_point, "/sys");
-        recursive_mkdir(path, DIR_PERM_DEF, uid, gid, false);
-        if (mount("none", path, "sysfs", 0, NULL) != 0) {
-            DEBUG("mount: %s (%s)", strerror(errno), path);
-            return -1;
+
+    for (size_t i = 0; i < elf_deps_count(self->jail.elf); ++i) {
+        if (strcmp(target, elf_deps_get(self->jail.elf, i)) == 0) {
+            snprintf(source, length, "%s", target);
+            return 0;
         }
     }
 
-    return 0;
+    errno = ENOENT;
+    return -1;
 }
 
-static int build_rootfs_directory(struct alctrz *self, json_t *data)
+/**
+ *  プログラムとその実行に必要なファイルをページキャッシュに読み込む.
+ *
+ *  アクセスプロファイルのファイルを最初に開かれた順に読み込み, 続けて
+ *  閉じ込めるプログラム, ELF の依存ファイル, 設定したパスを読み込む.
+ *  mlock したファイルは, このプロセスが終了するまで常駐する.
+ */
+static int prewarm_jail(struct alctrz *self)
 {
-    for (size_t i = 0, length = json_array_size(data); i < length; ++i) {
-        json_t *item = json_array_get(data, i);
+    uint32_t flags = plan_flags(self->jail.plan);
+    unsigned int method = PREWARM_READAHEAD;
+    if (flags & PLAN_PREWARM_FADVISE) {
+        method = PREWARM_FADVISE;
+    } else if (flags & PLAN_PREWARM_POPULATE) {
+        method = PREWARM_POPULATE;
+    }
+    if (flags & PLAN_PREWARM_LOCK) {
+        method |= PREWARM_LOCK;
+    }
 
-        if (create_rootfs_path(self, item) != 0) {
-            DEBUG("json: failed to 'directory' %zu", i + 1);
+    self->prewarm = prewarm_init(method, (uint64_t)plan_prewarm_lock_limit(self->jail.plan) << 20);
+    if (self->prewarm == NULL) {
+        DEBUG("prewarm_init: %s", strerror(errno));
+        return -1;
+    }
+    for (size_t i = 0; i < profile_count(self->profile); ++i) {
+        struct profile_entry entry;
+        if (profile_get(self->profile, i, &entry) == 0) {
+            prewarm_add(self->prewarm, entry.source);
         }
     }
+    prewarm_add(self->prewarm, self->prisoner.argv[0]);
+    for (size_t i = 0; i < elf_deps_count(self->jail.elf); ++i) {
+        prewarm_add(self->prewarm, elf_deps_get(self->jail.elf, i));
+    }
+    size_t count;
+    const uint32_t *paths = plan_prewarm(self->jail.plan, &count);
+    for (size_t i = 0; i < count; ++i) {
+        prewarm_add(self->prewarm, plan_string(self->jail.plan, paths[i]));
+    }
 
-    return 0;
-}
+    int ret = prewarm_run(self->prewarm);
 
-static int build_rootfs_device(struct alctrz *self, json_t *data)
+    struct prewarm_stats stats;
+    if (prewarm_get_stats(self->prewarm, &stats) == 0) {
+        DEBUG("prewarm: %zu files, %" PRIu64 " bytes, %" PRIu64 " locked, %" PRIu64 " us",
+              stats.files, stats.bytes, stats.locked, stats.elapsed_us);
+    }
+
+    return ret;
+}
+
+/**
+ *  jail のライブラリディレクトリから ld.so.cache を生成する.
+ *
+ *  jail 内で既に ld.so.cache が見えている場合や, /etc がホストから
+ *  バインドしたディレクトリの場合は生成しない. 生成できなくても,
+ *  動的リンカはディレクトリを検索するため起動は続ける.
+ */
+static int install_ld_cache(struct alctrz *self)
 {
-    for (size_t i = 0, length = json_array_size(data); i < length; ++i) {
-        json_t *item = json_array_get(data, i);
+    struct stat root_status;
+    struct stat etc_status;
+
+    int root_fd = open(self->jail.mount_point, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if ((root_fd < 0) || (fstat(root_fd, &root_status) != 0)) {
+        DEBUG("open: %s (%s)", strerror(errno), self->jail.mount_point);
+        if (root_fd >= 0) {
+            close(root_fd);
+        }
+        return 0;
+    }
+    int fd = open_in_root(root_fd, "/etc/ld.so.cache", O_PATH | O_CLOEXEC, 0);
+    if (fd >= 0) {
+        DEBUG("ldcache: /etc/ld.so.cache is already in the jail");
+        close(fd);
+        close(root_fd);
+        return 0;
+    }
+    DIR_TREE dirs = dir_tree_open(self->jail.mount_point,
+                                  self->prisoner.user.uid,
+                                  self->prisoner.user.gid,
+                                  DIR_PERM_DEF);
+    if ((dirs == NULL) || (dir_tree_mkdir(dirs, "/etc", DIR_PERM_DEF) != 0)) {
+        DEBUG("ldcache: failed to create /etc (%s)", strerror(errno));
+        dir_tree_close(dirs);
+        close(root_fd);
+        return 0;
+    }
+    dir_tree_close(dirs);
+    fd = open_in_root(root_fd, "/etc", O_PATH | O_DIRECTORY | O_CLOEXEC, 0);
+    bool bound = (fd < 0) || (fstat(fd, &etc_status) != 0) || (etc_status.st_dev != root_status.st_dev);
+    if (fd >= 0) {
+        close(fd);
+    }
+    close(root_fd);
+    if (bound) {
+        /* ホストのディレクトリに書き込まないよう, 生成しない. */
+        DEBUG("ldcache: /etc is not on the jail tmpfs");
+        return 0;
+    }
 
-        if (create_rootfs_device(self, item) != 0) {
-            DEBUG("json: failed to 'device' %zu", i + 1);
+    LD_CACHE cache = ld_cache_init(self->jail.mount_point, LD_CACHE_DIR_DEF);
+    if (cache == NULL) {
+        DEBUG("ld_cache_init: %s", strerror(errno));
+        return 0;
+    }
+    ld_cache_add_config(cache, "/etc/ld.so.conf");
+    ld_cache_add_defaults(cache);
+    if (ld_cache_install(cache, "/etc/ld.so.cache", plan_key(self->jail.plan)) != 0) {
+        DEBUG("ld_cache_install: %s", strerror(errno));
+    } else {
+        struct ld_cache_stats stats;
+        if (ld_cache_get_stats(cache, &stats) == 0) {
+            DEBUG("ldcache: %zu directories, %zu entries, %s, %" PRIu64 " us",
+                  stats.directories, stats.entries, stats.memoized ? "memoized" : "generated",
+                  stats.elapsed_us);
         }
     }
+    ld_cache_release(cache);
 
     return 0;
 }
 
-static int build_rootfs_bind(struct alctrz *self, json_t *data)
+/**
+ *  設定に従って rootfs のイメージをマウントし, @c holder からの参照を追加する.
+ *
+ *  設定に 'image' が無い場合は, イメージを使用しない.
+ *  @c holder が NULL の場合は, マウントのみを行う.
+ */
+static int attach_image(struct alctrz *self, const char *holder)
+{
+    const struct plan_image *image = plan_image(self->jail.plan);
+    if (image == NULL) {
+        return 0;
+    }
+
+    int ret = image_attach(plan_string(self->jail.plan, image->path),
+                           plan_string(self->jail.plan, image->source),
+                           plan_string(self->jail.plan, image->fstype),
+                           holder,
+                           self->jail.image_lower,
+                           sizeof(self->jail.image_lower));
+    if (ret != 0) {
+        DEBUG("image_attach: %s (%s)", strerror(errno), plan_string(self->jail.plan, image->source));
+    }
+
+    return ret;
+}
+
+/**
+ *  jail からのイメージの参照を削除する.
+ *
+ *  他の jail が参照していなければ, イメージを切り離す.
+ */
+static void detach_image(struct alctrz *self)
+{
+    if (self->jail.image_lower[0] == '\0') {
+        return;
+    }
+    if (image_detach(self->jail.image_lower, self->jail.mount_point) != 0) {
+        DEBUG("image_detach: %s (%s)", strerror(errno), self->jail.image_lower);
+    }
+    self->jail.image_lower[0] = '\0';
+}
+
+/**
+ *  jail の root の伝播の種別を取得する.
+ *
+ *  @return 変更しない場合は 0 が返る.
+ */
+static unsigned long jail_propagation(struct alctrz *self)
+{
+    uint32_t flags = plan_flags(self->jail.plan);
+
+    if (flags & PLAN_JAIL_SHARED) {
+        return 0;
+    }
+    return (flags & PLAN_JAIL_SLAVE) ? MS_SLAVE : MS_PRIVATE;
+}
+
+/**
+ *  jail の root の伝播の種別の名称を取得する.
+ */
+static const char *jail_propagation_name(struct alctrz *self)
+{
+    switch (jail_propagation(self)) {
+    case MS_PRIVATE:
+        return "private";
+    case MS_SLAVE:
+        return "slave";
+    default:
+        return "shared";
+    }
+}
+
+/**
+ *  jail を作成するディレクトリを用意する.
+ *
+ *  jail の root の伝播の種別を変更するのは tmpfs をマウントした後のため,
+ *  共有された /tmp にマウントすると, その時点でピアグループに複製される.
+ *  そこで, @c dir 自身をバインドして伝播の種別を変更し, 配下の jail の
+ *  マウントを複製させない. 変更は最初の jail を作成する時に一度だけ行う.
+ */
+static int prepare_jail_base(struct alctrz *self, const char *dir)
 {
-    for (size_t i = 0, length = json_array_size(data); i < length; ++i) {
-        json_t *item = json_array_get(data, i);
+    if (make_directories(dir, DIR_PERM_DEF) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), dir);
+        return -1;
+    }
+    unsigned long propagation = jail_propagation(self);
+    if (propagation == 0) {
+        return 0;
+    }
 
-        if (create_rootfs_bind(self, item) != 0) {
-            DEBUG("json: failed to 'bind' %zu", i + 1);
+    /* 同時に起動した jail が, 重ねてバインドしないようにする. */
+    int lock_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (lock_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), dir);
+        return -1;
+    }
+    if (flock(lock_fd, LOCK_EX) != 0) {
+        DEBUG("flock: %s (%s)", strerror(errno), dir);
+        close(lock_fd);
+        return -1;
+    }
+    int ret = 0;
+    if (!is_mount_point(dir)) {
+        /* 既に作成済みの jail も, バインドした先から見えるようにする. */
+        ret = mount(dir, dir, NULL, MS_BIND | MS_REC, NULL);
+        if (ret != 0) {
+            DEBUG("mount: %s (bind %s)", strerror(errno), dir);
+        } else {
+            ret = mount(NULL, dir, NULL, propagation, NULL);
+            if (ret != 0) {
+                DEBUG("mount: %s (propagation %s)", strerror(errno), dir);
+                umount2(dir, MNT_DETACH);
+            }
         }
     }
+    close(lock_fd);
 
-    return 0;
+    return ret;
 }
 
 /**
- *  指定の設定で, jail 向けの rootfs を作成する.
+ *  マウントオプションを追記する.
+ *
+ *  収まらない場合は, 切り詰めたオプションでマウントしないよう失敗とする.
  */
-static int build_rootfs(struct alctrz *self)
+__attribute__((format (printf, 4, 5)))
+static int append_option(char *buf, size_t size, size_t *length, const char *format, ...)
 {
-    json_t *root = self->jail.env;
+    va_list ap;
 
-    if (!json_is_object(root)) {
-        DEBUG("json: root is not an object");
+    va_start(ap, format);
+    int ret = vsnprintf(buf + *length, size - *length, format, ap);
+    va_end(ap);
+    if (ret < 0) {
+        errno = EINVAL;
         return -1;
     }
+    if ((size_t)ret >= size - *length) {
+        buf[*length] = '\0';
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    *length += ret;
+
+    return 0;
+}
+
+/**
+ *  プランの tmpfs の構成から, マウントオプションを生成する.
+ *
+ *  生成したオプションは, 空でなければ ',' で終わる.
+ */
+static int jail_tmpfs_options(struct alctrz *self, char *buf, size_t size, size_t *length)
+{
+    static const char *huge_names[] = {
+        [PLAN_TMPFS_HUGE_WITHIN_SIZE] = "within_size",
+        [PLAN_TMPFS_HUGE_ALWAYS] = "always",
+    };
+    const struct plan_tmpfs *tmpfs = plan_tmpfs(self->jail.plan);
 
-    if (try_json_object(self, root, "filesystem", build_rootfs_kernelfs) != 0) {
+    *length = 0;
+    if (append_option(buf, size, length, "size=%" PRIu32 "m,",
+                      (tmpfs->size > 0) ? tmpfs->size : JAIL_SIZE_DEF) != 0) {
         return -1;
     }
-    if (try_json_array(self, root, "directory", build_rootfs_directory) != 0) {
+    if ((tmpfs->nr_inodes > 0)
+        && (append_option(buf, size, length, "nr_inodes=%" PRIu32 ",", tmpfs->nr_inodes) != 0)) {
+
         return -1;
     }
-    if (try_json_array(self, root, "device", build_rootfs_device) != 0) {
+    if ((tmpfs->huge > 0) && (tmpfs->huge < lengthof(huge_names))
+        && (append_option(buf, size, length, "huge=%s,", huge_names[tmpfs->huge]) != 0)) {
+
         return -1;
     }
-    if (try_json_array(self, root, "bind", build_rootfs_bind) != 0) {
+    if ((tmpfs->mpol != 0)
+        && (append_option(buf, size, length, "mpol=%s,", plan_string(self->jail.plan, tmpfs->mpol)) != 0)) {
+
         return -1;
     }
 
@@ -954,387 +1286,2327 @@ static int build_rootfs(struct alctrz *self)
 }
 
 /**
- *  指定の json ファイルを読み込む.
+ *  jail の設置場所に tmpfs をマウントする.
+ *
+ *  設置場所の親ディレクトリは, @ref prepare_jail_base で用意しておく.
+ *  jail の root の伝播の種別も変更してから rootfs を構築する.
+ *  雛形やイメージを使用する場合は, それらを下位層とした
+ *  overlayfs を重ねる. tmpfs のサイズ, inode 数, ヒュージページ, NUMA
+ *  メモリポリシーはプランに従い, カーネルが受け付けない場合は失敗とする.
  */
-static json_t *json_load_from_file(const char *pathname)
+static int mount_jail(struct alctrz *self, uid_t uid, gid_t gid)
 {
-    char buf[BUFSIZ] = {0};
-    int fd;
-    struct stat file_stat;
-    json_t *root;
-    json_error_t err;
-    ssize_t read_bytes;
     int ret;
+    char options[256];
+    size_t length;
+    if ((jail_tmpfs_options(self, options, sizeof(options), &length) != 0)
+        || (append_option(options, sizeof(options), &length, "uid=%d,gid=%d,mode=700", uid, gid) != 0)) {
 
-    fd = open(pathname, O_RDONLY);
-    if (fd < 0) {
-        DEBUG("open: %s", strerror(errno));
-        return NULL;
+        DEBUG("mount: %s (tmpfs options)", strerror(errno));
+        return -1;
     }
-    ret = fstat(fd, &file_stat);
+    ret = mount("none", self->jail.mount_point, "tmpfs", 0, options);
     if (ret != 0) {
-        DEBUG("fstat: %s", strerror(errno));
-        close(fd);
-        return NULL;
+        DEBUG("mount: %s (tmpfs %s)", strerror(errno), options);
+        return -1;
     }
-    if (file_stat.st_size > sizeof(buf) - 1) {
-        errno = EFBIG;
-        DEBUG("%s: %s", __func__, strerror(errno));
-        close(fd);
-        return NULL;
+
+    unsigned long propagation = jail_propagation(self);
+    if (propagation != 0) {
+        ret = mount(NULL, self->jail.mount_point, NULL, propagation, NULL);
+        if (ret != 0) {
+            DEBUG("mount: %s (propagation %s)", strerror(errno), self->jail.mount_point);
+            umount2(self->jail.mount_point, MNT_DETACH);
+            return -1;
+        }
     }
-    read_bytes = read(fd, buf, sizeof(buf) - 1);
-    if (read_bytes < 0) {
-        DEBUG("read: %s", strerror(errno));
-        close(fd);
-        return NULL;
+
+    if (attach_image(self, self->jail.mount_point) != 0) {
+        umount2(self->jail.mount_point, MNT_DETACH);
+        return -1;
     }
-    close(fd);
 
-    root = json_loads(buf, 0, &err);
-    if (root == NULL) {
-        DEBUG("json error on line: %d: %s", err.line, err.text);
+    /* 雛形とイメージを両方使用する場合は, 雛形を上に重ねる. */
+    char lower[PATH_MAX * 2];
+    size_t lower_length = 0;
+    if ((self->jail.template_lower[0] != '\0') && (self->jail.image_lower[0] != '\0')) {
+        ret = append_option(lower, sizeof(lower), &lower_length, "%s:%s",
+                            self->jail.template_lower, self->jail.image_lower);
+    } else {
+        ret = append_option(lower, sizeof(lower), &lower_length, "%s%s",
+                            self->jail.template_lower, self->jail.image_lower);
+    }
+    if (ret != 0) {
+        DEBUG("mount: %s (overlay lower)", strerror(errno));
+        detach_image(self);
+        umount2(self->jail.mount_point, MNT_DETACH);
+        return -1;
+    }
+    if (lower[0] != '\0') {
+        ret = template_mount(lower, self->jail.mount_point, uid, gid);
+        if (ret != 0) {
+            detach_image(self);
+            umount2(self->jail.mount_point, MNT_DETACH);
+            return -1;
+        }
     }
 
-    return root;
+    return 0;
 }
 
 /**
- *  jail の設置場所を生成する.
+ *  専用のマウント名前空間に移る.
+ *
+ *  以降のマウントはホストのマウントテーブルに現れず, 名前空間内の
+ *  最後のプロセスが終了した時点でまとめて破棄される.
  */
-static int create_jail(struct alctrz *self)
+static int unshare_mount_namespace(void)
 {
-    if (mkdtemp(self->jail.mount_point) == NULL) {
-        DEBUG("mkdtemp: %s", strerror(errno));
+    if (unshare(CLONE_NEWNS) != 0) {
+        DEBUG("unshare: %s", strerror(errno));
+        return -1;
+    }
+    /* 名前空間内のマウントがホストに伝播しないようにする. */
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) {
+        DEBUG("mount: %s (/)", strerror(errno));
         return -1;
     }
 
-    int ret;
-    char options[64];
-    snprintf(options, sizeof(options),
-             "size=96m,uid=%d,gid=%d,mode=700",
-             self->prisoner.user.uid, self->prisoner.user.gid);
-    ret = mount("none", self->jail.mount_point, "tmpfs", 0, options);
-    if (ret != 0) {
-        DEBUG("mount: %s", strerror(errno));
+    return 0;
+}
+
+/**
+ *  専用のマウント名前空間に構築した jail を破棄する.
+ *
+ *  バインドは全て jail の tmpfs の配下にあるため, tmpfs を切り離すだけで良い.
+ */
+static int destroy_private_jail(struct alctrz *self)
+{
+    if (umount2(self->jail.mount_point, MNT_DETACH) != 0) {
+        DEBUG("umount2: %s (%s)", strerror(errno), self->jail.mount_point);
+        return -1;
+    }
+    if (rmdir(self->jail.mount_point) != 0) {
+        DEBUG("rmdir: %s (%s)", strerror(errno), self->jail.mount_point);
         return -1;
     }
 
     return 0;
 }
 
-static int create_stdio_for_prisoner(struct alctrz *self)
+/**
+ *  jail の設置場所を生成する.
+ */
+static int create_jail(struct alctrz *self, uid_t uid, gid_t gid)
 {
-    json_t *value = json_object_get(self->jail.env, "stdio");
-    if (!json_is_string(value)) {
-        DEBUG("json: 'stdio' is not an string");
+    if (prepare_jail_base(self, JAIL_BASE_DIR) != 0) {
+        return -1;
+    }
+    if (mkdtemp(self->jail.mount_point) == NULL) {
+        DEBUG("mkdtemp: %s", strerror(errno));
         return -1;
     }
 
-    char *uri = strdup(json_string_value(value));
-    char *proto = uri;
-    char *format = strstr(uri, "://");
-    if (format == NULL) {
-        DEBUG("json: 'stdio' is wrong format");
-        free(uri);
+    return mount_jail(self, uid, gid);
+}
+
+/**
+ *  jail プールの補充用に, 指定のパスへ jail を構築する.
+ */
+static int build_pooled_jail(void *arg, const char *mount_point)
+{
+    struct alctrz *self = (struct alctrz *)arg;
+
+    /* 補充する jail は, 自身の jail のマニフェストに記録しない. */
+    jail_manifest_close(self->jail.manifest);
+    self->jail.manifest = NULL;
+
+    /* 用意したバインドは, 補充する全ての jail で使用する. */
+    if (!self->jail.keep_binds) {
+        bind_tree_release(self->jail.binds);
+        self->jail.binds = NULL;
+        self->jail.binds_prepared = false;
+        self->jail.keep_binds = true;
+    }
+
+    strncpy(self->jail.mount_point, mount_point, sizeof(self->jail.mount_point) - 1);
+
+    /* プールの jail も, 親ディレクトリの伝播の種別を変更してからマウントする. */
+    char base[PATH_MAX];
+    strncpy(base, mount_point, sizeof(base) - 1);
+    base[sizeof(base) - 1] = '\0';
+    char *sep = strrchr(base, '/');
+    if ((sep == NULL) || (sep == base)) {
+        errno = EINVAL;
         return -1;
     }
-    *format = '\0';
-    format += 3;
-    if (strcmp(proto, "fifo") == 0) {
-        strncpy(self->prisoner.stdio.path, format, sizeof(self->prisoner.stdio.path));
-        char path[PATH_MAX];
-        snprintf(path, sizeof(path), self->prisoner.stdio.path, STDIN_FILENO);
-        int ret;
-        ret = mkfifo(path, S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH);
-        if ((ret != 0) && (errno != EEXIST)) {
-            DEBUG("mkfifo: %s (%s)", strerror(errno), path);
-            free(uri);
-            return -1;
-        }
-        if (chown(path, self->prisoner.user.uid, self->prisoner.user.gid) != 0) {
-            DEBUG("chown: %s (%s)", strerror(errno), path);
-            free(uri);
-            return -1;
-        }
-        snprintf(path, sizeof(path), self->prisoner.stdio.path, STDOUT_FILENO);
-        ret = mkfifo(path, S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH);
-        if ((ret != 0) && (errno != EEXIST)) {
-            DEBUG("mkfifo: %s (%s)", strerror(errno), path);
-            free(uri);
-            return -1;
-        }
-        if (chown(path, self->prisoner.user.uid, self->prisoner.user.gid) != 0) {
-            DEBUG("chown: %s (%s)", strerror(errno), path);
-            free(uri);
-            return -1;
-        }
-    } else {
-        DEBUG("json: 'stdio' is unknown protocol");
-        free(uri);
+    *sep = '\0';
+    if ((prepare_jail_base(self, base) != 0)
+        || (mount_jail(self, self->prisoner.user.uid, self->prisoner.user.gid) != 0)) {
+
         return -1;
     }
-    free(uri);
 
-    return 0;
+    return build_rootfs(self);
 }
 
 /**
- *  指定の capability を残し, その他を落とす.
+ *  jail のマニフェストを作成し, 標準入出力の FIFO を記録する.
+ *
+ *  バインドは, rootfs の構築時に記録する.
  */
-static int drop_capabilities(struct alctrz *self)
+static int record_jail(struct alctrz *self)
 {
-    json_t *caps = json_object_get(self->jail.env, "keep_capability");
-    if (!json_is_array(caps)) {
-        DEBUG("json: keep_capability is not an array");
+    TEARDOWN teardown = teardown_open(TEARDOWN_DIR_DEF);
+    if (teardown == NULL) {
+        DEBUG("teardown_open: %s", strerror(errno));
+        return -1;
+    }
+    self->jail.manifest = jail_manifest_create(teardown, self->jail.mount_point);
+    teardown_close(teardown);
+    if (self->jail.manifest == NULL) {
+        DEBUG("jail_manifest_create: %s (%s)", strerror(errno), self->jail.mount_point);
         return -1;
     }
 
-    uint64_t keep_caps_bits = 0;
-    for (size_t i = 0, length = json_array_size(caps); i < length; ++i) {
-        json_t *name = json_array_get(caps, i);
-        if (!json_is_string(name)) {
-            DEBUG("json: keep_capability %zu is not a string", i + 1);
-            return -1;
-        }
+    const int fds[] = {
+        STDIN_FILENO,
+        STDOUT_FILENO,
+    };
+    char path[PATH_MAX];
+    for (size_t i = 0; i < lengthof(fds); ++i) {
+        snprintf(path, sizeof(path), self->prisoner.stdio.path, fds[i]);
+        jail_manifest_add_fifo(self->jail.manifest, path);
+    }
 
-        int capability = capability_to_int(json_string_value(name));
-        if (capability < 0) {
-            DEBUG("json: %s is not a capability name", json_string_value(name));
-            return -1;
+    return 0;
+}
+
+/**
+ *  jail のマニフェストの名前を親プロセスに通知する.
+ *
+ *  通知は一度のみで, 以降はパイプを閉じる.
+ */
+static void report_jail(struct alctrz *self)
+{
+    if (self->report_fd < 0) {
+        return;
+    }
+    if (self->jail.manifest != NULL) {
+        const char *name = jail_manifest_name(self->jail.manifest);
+        if (write(self->report_fd, name, strlen(name)) < 0) {
+            DEBUG("write: %s", strerror(errno));
         }
-        keep_caps_bits |= 1 << capability;
     }
+    close(self->report_fd);
+    self->report_fd = -1;
+}
 
-    struct __user_cap_header_struct hdr = {
-        .version = _LINUX_CAPABILITY_VERSION_3,
-        .pid = 0
-    };
-    struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3] = {{0}};
-    int ret;
+/**
+ *  jail の構成と実行ユーザから, jail プールや雛形のキーを生成する.
+ *
+ *  構成が同じでも所有者が異なる jail は共用できないため,
+ *  ユーザ ID とグループ ID もキーに含める.
+ */
+static uint64_t jail_config_key(struct alctrz *self)
+{
+    uint64_t key = plan_key(self->jail.plan);
+    key = fnv1a64_update(key, &self->prisoner.user.uid, sizeof(self->prisoner.user.uid));
+    key = fnv1a64_update(key, &self->prisoner.user.gid, sizeof(self->prisoner.user.gid));
+
+    /* アーカイブを置き換えた場合は, 展開済みの雛形やプールを使用しない. */
+    const struct plan_archive *archive = plan_archive(self->jail.plan);
+    struct stat status;
+    if ((archive != NULL) && (stat(plan_string(self->jail.plan, archive->source), &status) == 0)) {
+        key = fnv1a64_update(key, &status.st_ino, sizeof(status.st_ino));
+        key = fnv1a64_update(key, &status.st_size, sizeof(status.st_size));
+        key = fnv1a64_update(key, &status.st_mtim, sizeof(status.st_mtim));
+    }
+
+    return key;
+}
+
+/**
+ *  設定に従って jail プールを開く.
+ *
+ *  設定に 'pool' が無い場合は, プールを使用しない.
+ *
+ *  @return プールを使用する場合はプールオブジェクトが返り,
+ *          使用しない場合およびエラーの場合は NULL が返る.
+ */
+static POOL open_jail_pool(struct alctrz *self)
+{
+    const struct plan_pool *pool = plan_pool(self->jail.plan);
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    POOL handle = pool_open(plan_string(self->jail.plan, pool->path),
+                            jail_config_key(self),
+                            pool->size,
+                            pool->low_water);
+    if (handle == NULL) {
+        DEBUG("pool_open: %s", strerror(errno));
+    }
+
+    return handle;
+}
 
-    /* 継承のベースにするために root の capability を取得する. */
-    ret = syscall(SYS_capget, &hdr, data);
+/**
+ *  雛形の下位層に, rootfs の静的な部分を構築する.
+ */
+static int build_template_lower(void *arg, const char *lower)
+{
+    struct alctrz *self = (struct alctrz *)arg;
+    char mount_point[PATH_MAX];
+    unsigned int stages = self->jail.stages;
+
+    strncpy(mount_point, self->jail.mount_point, sizeof(mount_point));
+    strncpy(self->jail.mount_point, lower, sizeof(self->jail.mount_point) - 1);
+    self->jail.stages = ROOTFS_STAGE_PATHS;
+
+    int ret = build_rootfs(self);
+
+    strncpy(self->jail.mount_point, mount_point, sizeof(self->jail.mount_point));
+    self->jail.stages = stages;
+
+    return ret;
+}
+
+/**
+ *  設定に従って rootfs の雛形を用意する.
+ *
+ *  設定に 'template' が無い場合は, 雛形を使用しない.
+ *  雛形を使用する場合, 以降の rootfs の構築はマウントのみとなる.
+ */
+static int prepare_template(struct alctrz *self)
+{
+    const char *path = plan_template(self->jail.plan);
+    if (path == NULL) {
+        return 0;
+    }
+
+    int ret = template_prepare(path,
+                               jail_config_key(self),
+                               build_template_lower,
+                               self,
+                               self->jail.template_lower,
+                               sizeof(self->jail.template_lower));
     if (ret != 0) {
-        DEBUG("capget: %s", strerror(errno));
+        DEBUG("template_prepare: %s", strerror(errno));
         return -1;
     }
-    DEBUG("effective: %08x %08x", data[1].effective, data[0].effective);
-    DEBUG("permitted: %08x %08x", data[1].permitted, data[0].permitted);
-    DEBUG("inheritable: %08x %08x", data[1].inheritable, data[0].inheritable);
+    self->jail.stages = ROOTFS_STAGE_MOUNTS;
 
-    /* capability bounding set から不要な権限を落とす. */
-    for (int i = 0; ; ++i) {
-        if ((keep_caps_bits & (1 << i)) == 0) {
-            /* CAP_LAST_CAP は 35 だが, 実際には 37 まで設定されているため,
-             * prctl の結果で有効な capability を判断する.
-             */
-            ret = prctl(PR_CAPBSET_READ, i);
-            if (ret < 0) {
-                break;
-            }
-            ret = prctl(PR_CAPBSET_DROP, i);
-            if (ret != 0) {
-                DEBUG("prctl: %s (%d)", strerror(errno), i);
-            }
+    return 0;
+}
 
-            /* ついでに file capability からも落とす. */
-            data[CAP_TO_INDEX(i)].permitted &= ~CAP_TO_MASK(i);
-        } else {
-            ret = prctl(PR_CAP_AMBIENT, PR_CAP_AMBIENT_RAISE, i, 0, 0);
-            if (ret != 0) {
-                DEBUG("prctl: %s (%d)", strerror(errno), i);
-            }
-        }
-        data[CAP_TO_INDEX(i)].inheritable |= CAP_TO_MASK(i);
+/**
+ *  設定ファイルをプランに変換して保存する.
+ */
+static int compile_plan(struct alctrz *self)
+{
+    PLAN plan = config_compile(self->compile_source);
+    if (plan == NULL) {
+        fprintf(stderr, "%s: invalid setting file\n", self->compile_source);
+        return -1;
     }
 
-    /* setuid で capability を継承させる. */
+    int ret = plan_save(plan, self->plan_output);
+    if (ret != 0) {
+        fprintf(stderr, "%s: %s\n", self->plan_output, strerror(errno));
+    }
+    plan_release(plan);
+
+    return ret;
+}
+
+/**
+ *  回収の対象とする jail プールのディレクトリを返す.
+ *
+ *  設定にプールが無い場合は, 既定のディレクトリとする.
+ */
+static const char *reap_pool_root(struct alctrz *self)
+{
+    const struct plan_pool *pool = (self->jail.plan != NULL) ? plan_pool(self->jail.plan) : NULL;
+
+    return (pool != NULL) ? plan_string(self->jail.plan, pool->path) : POOL_DIR_DEF;
+}
+
+/**
+ *  放棄された jail を回収し, 結果を表示する.
+ */
+static int reap_jails(struct alctrz *self)
+{
+    TEARDOWN teardown = teardown_open(TEARDOWN_DIR_DEF);
+    if (teardown == NULL) {
+        fprintf(stderr, "%s: %s\n", TEARDOWN_DIR_DEF, strerror(errno));
+        return -1;
+    }
+
+    struct teardown_reap_stats stats;
+    int ret = teardown_reap(teardown, JAIL_PREFIX, reap_pool_root(self), &stats);
+    if (ret == 0) {
+        printf("reap.mounts %zu\n"
+               "reap.manifests %zu\n"
+               "reap.directories %zu\n"
+               "reap.elapsed_us %" PRIu64 "\n",
+               stats.mounts, stats.manifests, stats.directories, stats.elapsed_us);
+    }
+    teardown_close(teardown);
+
+    /* 回収した jail だけが参照していたイメージを切り離す. */
+    struct image_reap_stats images;
+    if (image_reap(IMAGE_DIR_DEF, &images) == 0) {
+        printf("reap.image_refs %zu\n"
+               "reap.images_detached %zu\n",
+               images.refs, images.detached);
+    }
+
+    return ret;
+}
+
+/**
+ *  jail プールと破棄キューの統計情報を表示する.
+ */
+static int print_stats(struct alctrz *self)
+{
+    POOL pool = open_jail_pool(self);
+    if (pool != NULL) {
+        struct pool_stats stats;
+        if (pool_get_stats(pool, &stats) != 0) {
+            pool_close(pool);
+            return -1;
+        }
+        printf("pool.ready %zu\n"
+               "pool.hits %" PRIu64 "\n"
+               "pool.misses %" PRIu64 "\n",
+               stats.ready, stats.hits, stats.misses);
+        pool_close(pool);
+    }
+
+    TEARDOWN teardown = teardown_open(TEARDOWN_DIR_DEF);
+    if (teardown == NULL) {
+        return -1;
+    }
+    struct teardown_stats stats;
+    if (teardown_get_stats(teardown, &stats) != 0) {
+        teardown_close(teardown);
+        return -1;
+    }
+    printf("teardown.pending %zu\n"
+           "teardown.workers %zu\n"
+           "teardown.done %" PRIu64 "\n"
+           "teardown.elapsed_us %" PRIu64 "\n",
+           stats.pending, stats.workers, stats.done, stats.elapsed_us);
+    teardown_close(teardown);
+
+    return 0;
+}
+
+/**
+ *  JSON の文字列として出力する.
+ */
+static void print_json_string(const char *string)
+{
+    putchar('"');
+    for (; *string != '\0'; ++string) {
+        if ((*string == '"') || (*string == '\\')) {
+            putchar('\\');
+        }
+        putchar(*string);
+    }
+    putchar('"');
+}
+
+/**
+ *  アクセスプロファイルに記録したファイルのみをバインドする, 設定ファイルの
+ *  `bind` を表示する.
+ *
+ *  ディレクトリを丸ごとバインドしないよう, 通常のファイル以外は除く.
+ */
+static int print_profile_binds(struct alctrz *self)
+{
+    ACCESS_PROFILE profile = profile_load(self->profile_path);
+    if (profile == NULL) {
+        fprintf(stderr, "%s: %s\n", self->profile_path, strerror(errno));
+        return -1;
+    }
+
+    bool first = true;
+    printf("\"bind\": [");
+    for (size_t i = 0; i < profile_count(profile); ++i) {
+        struct profile_entry entry;
+        struct stat status;
+        if ((profile_get(profile, i, &entry) != 0)
+            || (stat(entry.source, &status) != 0)
+            || !S_ISREG(status.st_mode)) {
+
+            continue;
+        }
+
+        char bind[PATH_MAX * 2];
+        if (strcmp(entry.source, entry.target) == 0) {
+            snprintf(bind, sizeof(bind), "%s", entry.source);
+        } else {
+            snprintf(bind, sizeof(bind), "%s:%s", entry.source, entry.target);
+        }
+        printf(first ? "\n    " : ",\n    ");
+        print_json_string(bind);
+        first = false;
+    }
+    printf(first ? "]\n" : "\n]\n");
+    if (profile_truncated(profile)) {
+        fprintf(stderr, "%s: the profile is truncated\n", self->profile_path);
+    }
+    profile_release(profile);
+
+    return 0;
+}
+
+/**
+ *  記録した操作のパスを, jail 内のパスに変換する.
+ *
+ *  jail の外のパス (バインドのマウント元など) は, そのまま返す.
+ */
+static const char *plan_jail_path(struct alctrz *self, const char *path)
+{
+    size_t length = strlen(self->jail.mount_point);
+
+    if ((path == NULL) || (strncmp(path, self->jail.mount_point, length) != 0)
+        || ((path[length] != '/') && (path[length] != '\0'))) {
+
+        return path;
+    }
+
+    return (path[length] == '\0') ? "/" : path + length;
+}
+
+/**
+ *  取り付けの操作かどうかを判定する.
+ */
+static bool is_attach_op(const struct sysops_op *op)
+{
+    return (op->error == 0)
+        && (((op->kind == SYSOPS_MOUNT) && (op->source != NULL)) || (op->kind == SYSOPS_MOVE_MOUNT));
+}
+
+/**
+ *  @c path を取り付け先とする, @c after 以降の取り付けの操作があるかを判定する.
+ */
+static bool is_attached_after(const struct sysops_op *ops, size_t count, size_t after, const char *path)
+{
+    for (size_t i = after + 1; i < count; ++i) {
+        if (is_attach_op(&ops[i]) && (strcmp(ops[i].path, path) == 0)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ *  記録した操作から, 重複した作成と取り付け, 取り付けによる重なりを表示する.
+ *
+ *  取り付け先の配下に先に作成したパスや取り付けたマウントは, 取り付けで
+ *  隠れる (hidden). 後から取り付けたマウントは, 取り付け先の中に入れ子になる
+ *  (nested). 後から自身も取り付けるパスは, 入れ子の取り付けとして表示する.
+ */
+static void print_plan_conflicts(struct alctrz *self, const struct sysops_op *ops, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (ops[i].create && (ops[i].error == EEXIST)) {
+            printf("plan.duplicate %s\n", plan_jail_path(self, ops[i].path));
+        }
+        if (!is_attach_op(&ops[i])) {
+            continue;
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (is_attach_op(&ops[j]) && (strcmp(ops[j].path, ops[i].path) == 0)) {
+                printf("plan.duplicate %s\n", plan_jail_path(self, ops[i].path));
+                break;
+            }
+        }
+    }
+
+    for (size_t t = 0; t < count; ++t) {
+        if (!is_attach_op(&ops[t])) {
+            continue;
+        }
+        const char *target = ops[t].path;
+        for (size_t i = 0; i < count; ++i) {
+            bool attach = is_attach_op(&ops[i]);
+            if ((!attach && !(ops[i].create && (ops[i].error == 0)))
+                || !is_path_under(ops[i].path, target)) {
+
+                continue;
+            }
+            if (!attach && (i > t)) {
+                continue;
+            }
+            if (!attach && is_attached_after(ops, count, i, ops[i].path)) {
+                continue;
+            }
+            printf("plan.overlap %s under %s %s\n",
+                   plan_jail_path(self, ops[i].path),
+                   plan_jail_path(self, target),
+                   (i < t) ? "hidden" : "nested");
+        }
+    }
+}
+
+/**
+ *  rootfs の構築の操作を, システムコールを発行せずに記録して表示する.
+ *
+ *  操作の列に加えて, 種別毎の操作の数, 読み飛ばす構成, 重複と重なり,
+ *  および計測したコスト (未計測の場合は既定値) による所要時間の見積もりを
+ *  表示する. ELF の依存ファイル, アーカイブ, 雛形とイメージは起動時に
+ *  用意するため, 記録しない.
+ */
+static int print_plan(struct alctrz *self)
+{
+    uint32_t flags = plan_flags(self->jail.plan);
+    if (flags & PLAN_LANDLOCK) {
+        printf("plan.note landlock mode builds no rootfs when Landlock is available\n");
+    }
+    if (plan_elf_cache(self->jail.plan) != NULL) {
+        printf("plan.note ELF dependencies are resolved at launch and not recorded\n");
+    }
+    if (plan_archive(self->jail.plan) != NULL) {
+        printf("plan.note the archive is extracted at launch and not recorded\n");
+    }
+    if ((plan_template(self->jail.plan) != NULL) || (plan_image(self->jail.plan) != NULL)) {
+        printf("plan.note the template and image lower layers are not recorded\n");
+    }
+
+    SYSOPS_RECORDER recorder = sysops_record_start();
+    if (recorder == NULL) {
+        fprintf(stderr, "plan: %s\n", strerror(errno));
+        return -1;
+    }
+    uint64_t start = monotonic_ns();
+    int ret = build_rootfs(self);
+    uint64_t builder_us = elapsed_us(start);
+    /* バインドの解放で閉じる記述子も, 記録した記述子として扱う. */
+    bind_tree_release(self->jail.binds);
+    self->jail.binds = NULL;
+    sysops_record_stop(recorder);
+    if (ret != 0) {
+        fprintf(stderr, "plan: %s\n", strerror(errno));
+        sysops_recorder_release(recorder);
+        return -1;
+    }
+
+    struct sysops_costs costs;
+    const char *calibration = CALIBRATION_PATH_DEF;
+    if (sysops_load_costs(calibration, &costs) != 0) {
+        sysops_default_costs(&costs);
+        calibration = "default";
+    }
+
+    size_t count;
+    const struct sysops_op *ops = sysops_recorded(recorder, &count);
+    size_t kinds[SYSOPS_KINDS] = {0};
+    uint64_t estimate_ns = 0;
+    for (size_t i = 0; i < count; ++i) {
+        printf("op %s %s", sysops_kind_name(ops[i].kind), plan_jail_path(self, ops[i].path));
+        if (ops[i].source != NULL) {
+            printf(" <- %s", ops[i].source);
+        }
+        if (ops[i].error != 0) {
+            printf(" %s", strerror(ops[i].error));
+        }
+        putchar('\n');
+        kinds[ops[i].kind]++;
+        estimate_ns += costs.ns[ops[i].kind];
+    }
+
+    printf("plan.ops %zu\n", count);
+    for (unsigned int kind = 0; kind < SYSOPS_KINDS; ++kind) {
+        if (kinds[kind] > 0) {
+            printf("plan.ops.%s %zu\n", sysops_kind_name(kind), kinds[kind]);
+        }
+    }
+    for (size_t i = 0; i < self->jail.num_skipped; ++i) {
+        printf("plan.skipped %s %zu %s\n",
+               self->jail.skipped[i].kind,
+               self->jail.skipped[i].index,
+               strerror(self->jail.skipped[i].error));
+    }
+    print_plan_conflicts(self, ops, count);
+    printf("plan.estimate_us %" PRIu64 "\n"
+           "plan.calibration %s\n"
+           "plan.builder_us %" PRIu64 "\n",
+           estimate_ns / 1000, calibration, builder_us);
+    sysops_recorder_release(recorder);
+
+    return 0;
+}
+
+/**
+ *  rootfs の構築の操作のコストを計測して保存する.
+ *
+ *  マウントの計測は, 専用のマウント名前空間に移り, 一時ディレクトリに
+ *  マウントした tmpfs の配下で行う. 名前空間に移れない場合は, マウント以外の
+ *  種別のみ計測する.
+ */
+static int calibrate(void)
+{
+    char dir[] = "/tmp/alctrz-calibrate-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "calibrate: %s\n", strerror(errno));
+        return -1;
+    }
+    bool mounted = (unshare_mount_namespace() == 0)
+                && (mount("none", dir, "tmpfs", 0, "mode=700") == 0);
+
+    struct sysops_costs costs;
+    int ret = sysops_calibrate(dir, CALIBRATE_ITERATIONS, &costs);
+    int error = errno;
+    if (mounted) {
+        umount2(dir, MNT_DETACH);
+    }
+    rmdir(dir);
+    if (ret != 0) {
+        fprintf(stderr, "calibrate: %s\n", strerror(error));
+        return -1;
+    }
+
+    for (unsigned int kind = 0; kind < SYSOPS_KINDS; ++kind) {
+        printf("calibrate.%s %" PRIu64 " %s\n",
+               sysops_kind_name(kind),
+               costs.ns[kind],
+               (costs.measured & (1U << kind)) ? "measured" : "default");
+    }
+    if ((make_directories(ALCTRZ_RUN_DIR, DIR_PERM_DEF) != 0)
+        || (sysops_save_costs(CALIBRATION_PATH_DEF, &costs) != 0)) {
+
+        fprintf(stderr, "%s: %s\n", CALIBRATION_PATH_DEF, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  標準入出力の FIFO を作成する.
+ *
+ *  所有者は, 実行ユーザの解決後に own_stdio_for_prisoner() で設定する.
+ */
+static int create_stdio_for_prisoner(struct alctrz *self)
+{
+    const mode_t mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IWGRP | S_IXGRP | S_IROTH | S_IWOTH | S_IXOTH;
+    const int fds[] = {
+        STDIN_FILENO,
+        STDOUT_FILENO,
+    };
+    char path[PATH_MAX];
+    int ret;
+
+    /* プランには fifo:// を取り除いたパスの書式が格納されている. */
+    strncpy(self->prisoner.stdio.path,
+            plan_stdio(self->jail.plan),
+            sizeof(self->prisoner.stdio.path) - 1);
+    for (size_t i = 0; i < lengthof(fds); ++i) {
+        snprintf(path, sizeof(path), self->prisoner.stdio.path, fds[i]);
+        ret = mkfifo(path, mode);
+        if ((ret != 0) && (errno != EEXIST)) {
+            DEBUG("mkfifo: %s (%s)", strerror(errno), path);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  標準入出力の FIFO の所有者を実行ユーザに設定する.
+ */
+static int own_stdio_for_prisoner(struct alctrz *self)
+{
+    const int fds[] = {
+        STDIN_FILENO,
+        STDOUT_FILENO,
+    };
+    char path[PATH_MAX];
+
+    for (size_t i = 0; i < lengthof(fds); ++i) {
+        snprintf(path, sizeof(path), self->prisoner.stdio.path, fds[i]);
+        if (chown(path, self->prisoner.user.uid, self->prisoner.user.gid) != 0) {
+            DEBUG("chown: %s (%s)", strerror(errno), path);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  指定の capability を残し, その他を落とす.
+ *
+ *  残す capability は ambient set に加え, 実行ユーザでの execvp(3) の後も
+ *  保持させる. 操作は fork(2) の前に作成したプランに従う.
+ */
+static int drop_capabilities(struct alctrz *self)
+{
+    if (!self->prisoner.capability_planned) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* setuid で capability を継承させる. */
     u_long secbits = SECBIT_KEEP_CAPS | SECBIT_KEEP_CAPS_LOCKED
                    | SECBIT_NO_SETUID_FIXUP | SECBIT_NO_SETUID_FIXUP_LOCKED;
-    ret = prctl(PR_SET_SECUREBITS, secbits);
+
+    return capability_plan_apply(&self->prisoner.capability, secbits);
+}
+
+/**
+ *  環境変数をリセットする.
+ */
+static int reset_environment(struct alctrz *self)
+{
+    /* 全ての環境変数を削除する. */
+    clearenv();
+
+    /* 標準として HOME, SHELL, USER, TERM を環境変数に設定する. */
+    setenv("HOME", self->prisoner.home_path, 0);
+    setenv("SHELL", self->prisoner.shell_path, 0);
+    setenv("USER", self->prisoner.user.name, 0);
+    setenv("TERM", self->prisoner.term, 0);
+
+    /* 指定された環境変数を設定する. (存在する場合は上書き) */
+    size_t count;
+    const struct plan_env *envs = plan_environment(self->jail.plan, &count);
+    for (size_t i = 0; i < count; ++i) {
+        setenv(plan_string(self->jail.plan, envs[i].name),
+               plan_string(self->jail.plan, envs[i].value),
+               1);
+    }
+
+    /* 上書きされた可能性があるため, 標準環境変数を読み出す. */
+    strncpy(self->prisoner.home_path, getenv("HOME"), sizeof(self->prisoner.home_path));
+    strncpy(self->prisoner.shell_path, getenv("SHELL"), sizeof(self->prisoner.shell_path));
+    strncpy(self->prisoner.user.name, getenv("USER"), sizeof(self->prisoner.user.name));
+    strncpy(self->prisoner.term, getenv("TERM"), sizeof(self->prisoner.term));
+
+    return 0;
+}
+
+/**
+ *  名前解決のキャッシュを取得する.
+ *
+ *  最初の名前解決の時点で開き, プロセスの終了まで使用する.
+ */
+static NSS_CACHE get_nss_cache(void)
+{
+    if (nss_cache == NULL) {
+        nss_cache = nss_cache_open(NSS_CACHE_DIR_DEF, NSS_CACHE_TTL_DEF, NSS_CACHE_NEGATIVE_TTL_DEF);
+        if (nss_cache == NULL) {
+            DEBUG("nss_cache_open: %s", strerror(errno));
+        }
+    }
+
+    return nss_cache;
+}
+
+/**
+ *  指定名称のユーザ情報を取得する.
+ *
+ *  @todo エラーチェックの方法など, 今一度精査する. (セキュアコーディング観点)
+ */
+static int get_user_info(struct alctrz *self, const char *name)
+{
+    struct nss_user user;
+    if (nss_cache_get_user(get_nss_cache(), name, &user) != 0) {
+        DEBUG("user: failed to get user information for user %s: %s",
+              name, strerror(errno));
+        return -1;
+    }
+
+    self->prisoner.user.uid = user.uid;
+    self->prisoner.user.gid = user.gid;
+    strncpy(self->prisoner.user.name, user.name, sizeof(self->prisoner.user.name));
+    strncpy(self->prisoner.home_path, user.dir, sizeof(self->prisoner.home_path));
+    strncpy(self->prisoner.shell_path, user.shell, sizeof(self->prisoner.shell_path));
+    strncpy(self->prisoner.term, getenv("TERM"), sizeof(self->prisoner.term));
+
+    return 0;
+}
+
+/**
+ *  指定名称のグループ ID を取得する.
+ *
+ *  @todo エラーチェックの方法など, 今一度精査する. (セキュアコーディング観点)
+ */
+static gid_t get_group_id(const char *name)
+{
+    gid_t gid;
+    if (nss_cache_get_group(get_nss_cache(), name, &gid) != 0) {
+        DEBUG("group: failed to get group information for group %s: %s",
+              name, strerror(errno));
+        return (gid_t)-1;
+    }
+
+    return gid;
+}
+
+/**
+ *  指定されたユーザとグループの情報を取得する.
+ *
+ *  名前の解決 (NSS) には時間を要する場合があるため, 引数の解析とは分けて
+ *  jail の構築と並行して行う.
+ *
+ *  @remarks    `-g` が指定された場合は, 指定ユーザの所属するグループ ID に
+ *              上書きする.
+ */
+static int resolve_prisoner(struct alctrz *self)
+{
+    if (self->prisoner.user_name != NULL) {
+        if (get_user_info(self, self->prisoner.user_name) != 0) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    if (self->prisoner.group_name != NULL) {
+        gid_t group = get_group_id(self->prisoner.group_name);
+        if (group == (gid_t)-1) {
+            errno = EINVAL;
+            return -1;
+        }
+        self->prisoner.user.gid = group;
+    }
+
+    return 0;
+}
+
+/**
+ *  引数を解析してコンテキストに設定する.
+ *
+ *  @remarks    ユーザとグループの名前は, resolve_prisoner() で解決する.
+ */
+static int parse_arguments(struct alctrz *self, int argc, char * const *argv)
+{
+    static const struct option long_options[] = {
+        {"compile", required_argument, NULL, 'C'},
+        {"output", required_argument, NULL, 'o'},
+        {"reap", no_argument, NULL, 'R'},
+        {"ready-fd", required_argument, NULL, 'r'},
+        {"profile", no_argument, NULL, 'P'},
+        {"profile-binds", no_argument, NULL, 'B'},
+        {"plan", no_argument, NULL, 'D'},
+        {"calibrate", no_argument, NULL, 'K'},
+        {"zygote", required_argument, NULL, 'Z'},
+        {"run", required_argument, NULL, 'X'},
+        {"help", no_argument, NULL, 'h'},
+        {"version", no_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "c:u:g:e:o:ashv", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'c':
+            /** @todo パスは正規化したほうが良い. (セキュアコーディング観点) */
+            self->jail.plan = config_load(optarg);
+            if (self->jail.plan == NULL) {
+                errno = EINVAL;
+                return -1;
+            }
+            /* プロファイルは設定ファイルと並べて置く. */
+            if (snprintf(self->profile_path, sizeof(self->profile_path),
+                         "%s.profile", optarg) >= (int)sizeof(self->profile_path)) {
+
+                errno = ENAMETOOLONG;
+                return -1;
+            }
+            break;
+        case 'C':
+            self->compile_source = optarg;
+            break;
+        case 'o':
+            self->plan_output = optarg;
+            break;
+        case 'R':
+            self->do_reap = true;
+            break;
+        case 'r': {
+            char *end;
+            errno = 0;
+            long fd = strtol(optarg, &end, 10);
+            if ((errno != 0) || (*end != '\0') || (fd <= STDERR_FILENO) || (fd > INT_MAX)
+                || (fcntl((int)fd, F_GETFD) < 0)) {
+
+                errno = EINVAL;
+                return -1;
+            }
+            /* jail で実行するプログラムには引き継がない. */
+            if (fcntl((int)fd, F_SETFD, FD_CLOEXEC) != 0) {
+                return -1;
+            }
+            self->ready_fd = (int)fd;
+            break;
+        }
+        case 'P':
+            self->do_profile = true;
+            break;
+        case 'B':
+            self->show_profile_binds = true;
+            break;
+        case 'D':
+            self->show_plan = true;
+            break;
+        case 'K':
+            self->do_calibrate = true;
+            break;
+        case 'Z':
+            self->zygote_path = optarg;
+            break;
+        case 'X':
+            self->run_path = optarg;
+            break;
+        case 'u':
+            self->prisoner.user_name = optarg;
+            break;
+        case 'g':
+            self->prisoner.group_name = optarg;
+            break;
+        case 'e':
+            self->enter_name = optarg;
+            break;
+        case 'a':
+            self->do_attach = true;
+            break;
+        case 's':
+            self->show_stats = true;
+            break;
+        case 'h':
+            self->show_help = true;
+            return 0;
+        case 'v':
+            self->show_version = true;
+            return 0;
+        default:
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    if (self->do_reap || self->do_calibrate) {
+        return 0;
+    }
+
+    if (self->enter_name != NULL) {
+        if (argc == optind) {
+            errno = EINVAL;
+            return -1;
+        }
+        self->prisoner.argc = argc - optind;
+        self->prisoner.argv = &argv[optind];
+        if (self->prisoner.argv[0][0] != '/') {
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (self->run_path != NULL) {
+        /* プログラムを省略した場合は, zygote の起動時のプログラムを実行する. */
+        self->prisoner.argc = argc - optind;
+        self->prisoner.argv = (argc > optind) ? &argv[optind] : NULL;
+        if ((self->prisoner.argv != NULL) && (self->prisoner.argv[0][0] != '/')) {
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    if ((self->zygote_path != NULL) && self->do_attach) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (self->compile_source != NULL) {
+        if (self->plan_output == NULL) {
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (self->show_stats || self->show_profile_binds || self->show_plan) {
+        if (self->jail.plan == NULL) {
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (self->do_profile && (self->jail.plan == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!self->do_attach) {
+        if (argc == optind) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        self->prisoner.argc = argc - optind;
+        self->prisoner.argv = &argv[optind];
+        if (self->prisoner.argv[0][0] != '/') {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  閉じ込めるプログラムに渡す実行ユーザの情報.
+ */
+struct credential {
+    struct user user;          /**< 実行ユーザ / グループの情報. */
+    char home_path[PATH_MAX];  /**< ホームディレクトリのパス. */
+    char shell_path[PATH_MAX]; /**< シェルのパス. */
+    char term[PATH_MAX];       /**< ターミナル名. */
+};
+
+/**
+ *  jail の起動処理の状態.
+ */
+struct launch {
+    struct alctrz *self; /**< コンテキスト. */
+    POOL pool;           /**< 使用する jail プール. */
+    bool use_pool;       /**< jail プールを使用するか. */
+    bool claimed;        /**< プールから jail を取得したか. */
+    bool chown_root;     /**< jail の root の所有者を rootfs の構築時に設定するか. */
+    int start_fd;        /**< 閉じ込めるプログラムに起動を指示するソケット. */
+    PIPELINE pipeline;   /**< 起動処理のパイプライン. */
+    char failed[32];     /**< 失敗したフェーズ. */
+    int error;           /**< 失敗時の errno. */
+};
+
+/**
+ *  指定の長さを全て送信する.
+ *
+ *  相手が終了していても SIGPIPE は発生させない.
+ */
+static int send_full(int fd, const void *buf, size_t length)
+{
+    const char *p = (const char *)buf;
+
+    while (length > 0) {
+        ssize_t sent = send(fd, p, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += sent;
+        length -= sent;
+    }
+
+    return 0;
+}
+
+/**
+ *  指定の長さを全て受信する.
+ *
+ *  途中で相手が終了した場合は, EPIPE で失敗する.
+ */
+static int recv_full(int fd, void *buf, size_t length)
+{
+    char *p = (char *)buf;
+
+    while (length > 0) {
+        ssize_t received = read(fd, p, length);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (received == 0) {
+            errno = EPIPE;
+            return -1;
+        }
+        p += received;
+        length -= received;
+    }
+
+    return 0;
+}
+
+/**
+ *  起動フェーズ: 実行ユーザとグループを解決する.
+ */
+static int launch_resolve_user(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    return resolve_prisoner(launch->self);
+}
+
+/**
+ *  起動フェーズ: 実行ユーザの情報を閉じ込めるプログラムに渡す.
+ */
+static int launch_send_credential(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+    struct prisoner *prisoner = &launch->self->prisoner;
+    struct credential cred;
+
+    cred.user = prisoner->user;
+    memcpy(cred.home_path, prisoner->home_path, sizeof(cred.home_path));
+    memcpy(cred.shell_path, prisoner->shell_path, sizeof(cred.shell_path));
+    memcpy(cred.term, prisoner->term, sizeof(cred.term));
+    if (send_full(launch->start_fd, &cred, sizeof(cred)) != 0) {
+        DEBUG("send: %s (credential)", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  起動フェーズ: 標準入出力の FIFO の所有者を設定する.
+ */
+static int launch_own_stdio(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    return own_stdio_for_prisoner(launch->self);
+}
+
+/**
+ *  起動フェーズ: rootfs の雛形を用意する.
+ */
+static int launch_prepare_template(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    return prepare_template(launch->self);
+}
+
+/**
+ *  起動フェーズ: jail をプールから取得するか, 新たに tmpfs をマウントする.
+ *
+ *  実行ユーザの解決を待たない場合, root の所有者は rootfs の構築時に設定する.
+ */
+static int launch_create_jail(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+    struct alctrz *self = launch->self;
+
+    if (launch->use_pool) {
+        launch->pool = open_jail_pool(self);
+        launch->claimed = (launch->pool != NULL)
+                       && (pool_claim(launch->pool,
+                                      self->jail.mount_point,
+                                      sizeof(self->jail.mount_point)) == 0);
+        if (launch->claimed) {
+            /* プールの jail が追加した参照を, 自身の参照として引き継ぐ. */
+            return attach_image(self, self->jail.mount_point);
+        }
+    }
+    if (launch->chown_root) {
+        return create_jail(self, 0, 0);
+    }
+
+    return create_jail(self, self->prisoner.user.uid, self->prisoner.user.gid);
+}
+
+/**
+ *  起動フェーズ: 構築に失敗した場合も破棄できるよう, マニフェストを作成する.
+ */
+static int launch_record_jail(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    /* マニフェストの無い jail は, 使用中でも孤立した jail として回収されてしまう. */
+    return record_jail(launch->self);
+}
+
+/**
+ *  起動フェーズ: ELF の依存ファイルを解決する.
+ */
+static int launch_resolve_elf(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    return resolve_elf_deps(launch->self);
+}
+
+/**
+ *  起動フェーズ: exec の前に, プログラムとライブラリをページキャッシュに読み込む.
+ */
+static int launch_prewarm(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    return prewarm_jail(launch->self);
+}
+
+/**
+ *  起動フェーズ: jail の ld.so.cache を生成する.
+ */
+static int launch_install_ld_cache(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+
+    return install_ld_cache(launch->self);
+}
+
+/**
+ *  起動フェーズ: rootfs を構築する.
+ */
+static int launch_build_rootfs(void *arg)
+{
+    struct launch *launch = (struct launch *)arg;
+    struct alctrz *self = launch->self;
+
+    if (launch->chown_root) {
+        if (chown(self->jail.mount_point, self->prisoner.user.uid, self->prisoner.user.gid) != 0) {
+            DEBUG("chown: %s (%s)", strerror(errno), self->jail.mount_point);
+            return -1;
+        }
+    }
+    if (!launch->claimed && (build_rootfs(self) != 0)) {
+        return -1;
+    }
+
+    return build_rootfs_elf(self);
+}
+
+/**
+ *  起動処理のフェーズを登録する.
+ *
+ *  登録に失敗した場合は @c launch に記録し, 以降のフェーズは登録しない.
+ *
+ *  @return 登録したフェーズの依存関係のビットが返る. 失敗時は 0 が返る.
+ */
+static uint32_t add_launch_phase(struct launch *launch, const char *name, pipeline_phase phase, uint32_t deps)
+{
+    if (launch->failed[0] != '\0') {
+        return 0;
+    }
+
+    int id = pipeline_add(launch->pipeline, name, phase, launch, deps);
+    if (id < 0) {
+        DEBUG("pipeline_add: %s (%s)", strerror(errno), name);
+        snprintf(launch->failed, sizeof(launch->failed), "pipeline");
+        launch->error = errno;
+        return 0;
+    }
+
+    return PIPELINE_DEP(id);
+}
+
+/**
+ *  jail の起動処理をパイプラインで実行する.
+ *
+ *  各フェーズが完了を待つフェーズは次の通りで, 依存関係の無いフェーズは並行に動作する.
+ *  - credential, stdio, template: user
+ *  - mount: プールを使用する場合は user, 雛形を使用する場合は template
+ *  - elf: なし
+ *  - prewarm: elf
+ *  - record: mount
+ *  - rootfs: user, mount, record, elf
+ *  - ldcache: rootfs
+ *
+ *  Landlock で制限する場合, mount, record, rootfs, ldcache は実行しない.
+ *
+ *  各フェーズの所要時間を通知するため, パイプラインは呼び出し元で解放する.
+ *
+ *  @param  [in,out]    launch      起動処理の状態.
+ *  @param  [in]        resolved    実行ユーザを解決済みか.
+ *  @param  [in]        prepare     雛形を用意するか.
+ *  @return 全てのフェーズが成功した場合は 0 が返り, それ以外は -1 が返る.
+ */
+static int run_launch(struct launch *launch, bool resolved, bool prepare)
+{
+    PIPELINE pipeline = pipeline_init();
+    if (pipeline == NULL) {
+        DEBUG("pipeline_init: %s", strerror(errno));
+        snprintf(launch->failed, sizeof(launch->failed), "pipeline");
+        launch->error = errno;
+        return -1;
+    }
+    launch->pipeline = pipeline;
+
+    uint32_t user = 0;
+    if (!resolved) {
+        user = add_launch_phase(launch, "user", launch_resolve_user, 0);
+    }
+    add_launch_phase(launch, "credential", launch_send_credential, user);
+    add_launch_phase(launch, "stdio", launch_own_stdio, user);
+
+    uint32_t mount_deps = launch->use_pool ? user : 0;
+    if (prepare) {
+        mount_deps = add_launch_phase(launch, "template", launch_prepare_template, user);
+    }
+    uint32_t elf = 0;
+    if (plan_elf_cache(launch->self->jail.plan) != NULL) {
+        elf = add_launch_phase(launch, "elf", launch_resolve_elf, 0);
+    }
+    /* Landlock で制限する場合は, jail を作成しない. */
+    if (!launch->self->jail.landlock) {
+        /* tmpfs のマウントが実行ユーザの解決を待つのは, プールや雛形を使用する場合のみ. */
+        launch->chown_root = !resolved && (mount_deps == 0);
+        uint32_t mount = add_launch_phase(launch, "mount", launch_create_jail, mount_deps);
+        uint32_t record = add_launch_phase(launch, "record", launch_record_jail, mount);
+        uint32_t rootfs = add_launch_phase(launch, "rootfs", launch_build_rootfs,
+                                           user | mount | record | elf);
+        if (plan_flags(launch->self->jail.plan) & PLAN_LD_CACHE) {
+            add_launch_phase(launch, "ldcache", launch_install_ld_cache, rootfs);
+        }
+    }
+    if ((plan_flags(launch->self->jail.plan) & PLAN_PREWARM) || (launch->self->profile != NULL)) {
+        add_launch_phase(launch, "prewarm", launch_prewarm, elf);
+    }
+    if (launch->failed[0] != '\0') {
+        /* 依存関係が欠けたまま実行しない. */
+        return -1;
+    }
+
+    int ret = pipeline_run(pipeline);
+    if (ret != 0) {
+        launch->error = errno;
+        DEBUG("pipeline_run: %s", strerror(errno));
+        for (size_t i = 0; i < pipeline_count(pipeline); ++i) {
+            struct pipeline_stats stats;
+            if ((pipeline_get_stats(pipeline, i, &stats) == 0)
+                && (stats.state == PIPELINE_PHASE_FAILED)) {
+
+                snprintf(launch->failed, sizeof(launch->failed), "%s", stats.name);
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ *  閉じ込めるプログラムの起動に失敗したフェーズを, jail 側に通知する.
+ *
+ *  errno は保存される.
+ */
+static void report_prisoner_failure(int start_fd, const char *phase)
+{
+    int error = errno;
+    char reason[64];
+
+    int length = snprintf(reason, sizeof(reason), "%s %d", phase, error);
+    send_full(start_fd, reason, length);
+    errno = error;
+}
+
+/**
+ *  閉じ込めるプログラムの exec を待つ.
+ *
+ *  ソケットは close-on-exec のため, exec に成功すると終端に達する.
+ *  失敗した場合は, 失敗したフェーズと errno を受け取る.
+ *
+ *  @return exec に成功した場合は 0 が返り, 失敗した場合は -1 が返る.
+ */
+static int wait_prisoner_exec(struct launch *launch)
+{
+    char reason[64];
+    ssize_t length;
+
+    do {
+        length = read(launch->start_fd, reason, sizeof(reason) - 1);
+    } while ((length < 0) && (errno == EINTR));
+    if (length <= 0) {
+        return 0;
+    }
+    reason[length] = '\0';
+
+    char phase[sizeof(launch->failed)];
+    int error;
+    if (sscanf(reason, "%31s %d", phase, &error) != 2) {
+        snprintf(phase, sizeof(phase), "exec");
+        error = EPROTO;
+    }
+    /* jail 側の失敗はプログラムの終了による二次的なものであるため, 上書きする. */
+    memcpy(launch->failed, phase, sizeof(launch->failed));
+    launch->error = error;
+
+    return -1;
+}
+
+/**
+ *  行を追記する.
+ *
+ *  @return 追記後の長さが返る. 収まらない場合は追記しない.
+ */
+__attribute__((format (printf, 4, 5)))
+static size_t append_line(char *buf, size_t size, size_t length, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    int ret = vsnprintf(buf + length, size - length, format, ap);
+    va_end(ap);
+    if ((ret < 0) || ((size_t)ret >= size - length)) {
+        buf[length] = '\0';
+        return length;
+    }
+
+    return length + ret;
+}
+
+/**
+ *  起動結果を親プロセスに通知する.
+ *
+ *  通知は次の行からなるテキストで, 一度の write で書き込む.
+ *  最後の行が起動結果となる.
+ *  - phase <フェーズ> <開始までの時間 (us)> <所要時間 (us)>
+ *  - skip <構成の種別> <構成の番号> <errno>
+ *  - prewarm <ファイル数> <バイト数> <mlock したバイト数>
+ *  - archive <ファイル数> <バイト数> <展開に要した時間 (us)>
+ *  - ready <jail の名前> <起動に要した時間 (us)>
+ *  - error <フェーズ> <errno> <エラーメッセージ>
+ *
+ *  @param  [in,out]    self        コンテキスト.
+ *  @param  [in]        pipeline    起動処理のパイプライン. (NULL 可)
+ *  @param  [in]        phase       失敗したフェーズ. 成功時は NULL.
+ *  @param  [in]        error       失敗時の errno.
+ *  @param  [in]        launch_us   起動に要した時間 (マイクロ秒).
+ */
+static void notify_launch(struct alctrz *self,
+                          PIPELINE pipeline,
+                          const char *phase,
+                          int error,
+                          uint64_t launch_us)
+{
+    char buf[PIPE_BUF];
+    /* 起動結果の行は必ず収まるよう, 途中経過の行は半分までとする. */
+    const size_t limit = sizeof(buf) / 2;
+    size_t length = 0;
+
+    if (self->notify_fd < 0) {
+        return;
+    }
+
+    buf[0] = '\0';
+    for (size_t i = 0; i < pipeline_count(pipeline); ++i) {
+        struct pipeline_stats stats;
+        if ((pipeline_get_stats(pipeline, i, &stats) == 0)
+            && ((stats.state == PIPELINE_PHASE_DONE) || (stats.state == PIPELINE_PHASE_FAILED))) {
+
+            length = append_line(buf, limit, length, "phase %s %" PRIu64 " %" PRIu64 "\n",
+                                 stats.name, stats.start_us, stats.elapsed_us);
+        }
+    }
+    for (size_t i = 0; i < self->jail.num_skipped; ++i) {
+        const struct skipped *skipped = &self->jail.skipped[i];
+        length = append_line(buf, limit, length, "skip %s %zu %d\n",
+                             skipped->kind, skipped->index, skipped->error);
+    }
+    struct prewarm_stats prewarm;
+    if (prewarm_get_stats(self->prewarm, &prewarm) == 0) {
+        length = append_line(buf, limit, length, "prewarm %zu %" PRIu64 " %" PRIu64 "\n",
+                             prewarm.files, prewarm.bytes, prewarm.locked);
+    }
+    if (self->jail.archive_extracted) {
+        const struct archive_stats *archive = &self->jail.archive;
+        length = append_line(buf, limit, length, "archive %zu %" PRIu64 " %" PRIu64 "\n",
+                             archive->files, archive->bytes, archive->elapsed_us);
+    }
+    if (self->prisoner.capability_planned) {
+        const struct capability_plan *capability = &self->prisoner.capability;
+        length = append_line(buf, limit, length, "capability %u %u %d %d\n",
+                             capability->prepared,
+                             capability_plan_syscalls(capability),
+                             __builtin_popcountll(capability->drops),
+                             __builtin_popcountll(capability->raises));
+    }
+    struct nss_cache_stats nss;
+    if ((nss_cache_get_stats(nss_cache, &nss) == 0) && ((nss.hits + nss.misses) > 0)) {
+        length = append_line(buf, limit, length, "nss %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                             nss.hits, nss.misses, nss.lookup_ns / 1000);
+    }
+    if (phase == NULL) {
+        const char *name = (self->jail.manifest != NULL)
+                         ? jail_manifest_name(self->jail.manifest)
+                         : "-";
+        length = append_line(buf, sizeof(buf), length, "ready %s %" PRIu64 "\n", name, launch_us);
+    } else {
+        length = append_line(buf, sizeof(buf), length, "error %s %d %s\n",
+                             phase, error, strerror(error));
+    }
+
+    if (write(self->notify_fd, buf, length) < 0) {
+        DEBUG("write: %s", strerror(errno));
+    }
+    close(self->notify_fd);
+    self->notify_fd = -1;
+}
+
+/**
+ *  jail の構成から, 閉じ込めるプログラムの Landlock ルールセットを作成する.
+ *
+ *  バインドはバインド元のパスを, ディレクトリとデバイスファイルは
+ *  同じパスのホスト上のファイルを許可する. 読み込み専用のバインドは
+ *  書き込みを許可しない. ホスト上に無いパスは読み飛ばす.
+ */
+static LANDLOCK build_landlock(struct alctrz *self)
+{
+    static const struct {
+        uint32_t flag;
+        const char *pathname;
+        unsigned int access;
+    } kernelfs[] = {
+        {PLAN_KERNELFS_DEVTMPFS, "/dev", LANDLOCK_ALLOW_READ | LANDLOCK_ALLOW_WRITE},
+        {PLAN_KERNELFS_PROCFS, "/proc", LANDLOCK_ALLOW_READ | LANDLOCK_ALLOW_WRITE},
+        {PLAN_KERNELFS_SYSFS, "/sys", LANDLOCK_ALLOW_READ},
+    };
+    PLAN plan = self->jail.plan;
+    size_t count;
+
+    LANDLOCK ruleset = landlock_init();
+    if (ruleset == NULL) {
+        DEBUG("landlock_init: %s", strerror(errno));
+        return NULL;
+    }
+
+    for (size_t i = 0; i < lengthof(kernelfs); ++i) {
+        if (plan_flags(plan) & kernelfs[i].flag) {
+            landlock_allow(ruleset, kernelfs[i].pathname, kernelfs[i].access);
+        }
+    }
+
+    /*
+     * directory は jail では空の専用ディレクトリであり, ホストの同じパスとは
+     * 別物のため, 許可しない. (ホストの /etc などへの書き込みを許すことになる)
+     */
+
+    /* デバイスファイルは, 作成する場合のアクセス権限に従う. */
+    const struct plan_device *devs = plan_devices(plan, &count);
+    for (size_t i = 0; i < count; ++i) {
+        unsigned int access = 0;
+        if (devs[i].mode & (S_IRUSR | S_IRGRP | S_IROTH)) {
+            access |= LANDLOCK_ALLOW_READ;
+        }
+        if (devs[i].mode & (S_IWUSR | S_IWGRP | S_IWOTH)) {
+            access |= LANDLOCK_ALLOW_WRITE;
+        }
+        if (landlock_allow(ruleset, plan_string(plan, devs[i].pathname), access) != 0) {
+            skip_entry(self, "device", i + 1);
+        }
+    }
+
+    const struct plan_bind *binds = plan_binds(plan, &count);
+    for (size_t i = 0; i < count; ++i) {
+        unsigned int access = LANDLOCK_ALLOW_READ;
+        if (!(binds[i].attrs & BIND_ATTR_RDONLY)) {
+            access |= LANDLOCK_ALLOW_WRITE;
+        }
+        if (!(binds[i].attrs & BIND_ATTR_NOEXEC)) {
+            access |= LANDLOCK_ALLOW_EXEC;
+        }
+        if (landlock_allow(ruleset, plan_string(plan, binds[i].source), access) != 0) {
+            skip_entry(self, "bind", i + 1);
+        }
+    }
+
+    if (resolve_elf_deps(self) != 0) {
+        landlock_release(ruleset);
+        return NULL;
+    }
+    for (size_t i = 0; i < elf_deps_count(self->jail.elf); ++i) {
+        if (landlock_allow(ruleset,
+                           elf_deps_get(self->jail.elf, i),
+                           LANDLOCK_ALLOW_READ | LANDLOCK_ALLOW_EXEC) != 0) {
+
+            skip_entry(self, "elf", i + 1);
+        }
+    }
+
+    struct landlock_stats stats;
+    if (landlock_get_stats(ruleset, &stats) == 0) {
+        DEBUG("landlock: abi %d, %zu rules", stats.abi, stats.rules);
+    }
+
+    return ruleset;
+}
+
+/**
+ *  閉じ込めるプログラムを起動する.
+ *
+ *  capability の整理, 環境変数とグループの設定は jail の構築と並行して行い,
+ *  jail の完成を待つのは chroot のみとする.
+ *
+ *  失敗した場合は, 失敗したフェーズを jail 側に通知する. jail 側の指示で
+ *  中断した場合は通知しない. ソケットは exec の成功により閉じられる.
+ *
+ *  @param  [in,out]    self        コンテキスト.
+ *  @param  [in]        start_fd    起動の指示を受け取るソケット.
+ *  @return 戻った場合は, エラーが発生している.
+ */
+static int start_prisoner(struct alctrz *self, int start_fd)
+{
+    int ret;
+
+    ret = drop_capabilities(self);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "capability");
+        return -1;
+    }
+
+    struct credential cred;
+    ret = recv_full(start_fd, &cred, sizeof(cred));
+    if (ret != 0) {
+        DEBUG("recv: %s (credential)", strerror(errno));
+        return -1;
+    }
+    self->prisoner.user = cred.user;
+    memcpy(self->prisoner.home_path, cred.home_path, sizeof(self->prisoner.home_path));
+    memcpy(self->prisoner.shell_path, cred.shell_path, sizeof(self->prisoner.shell_path));
+    memcpy(self->prisoner.term, cred.term, sizeof(self->prisoner.term));
+    ret = reset_environment(self);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "environment");
+        return -1;
+    }
+
+    gid_t gid = self->prisoner.user.gid;
+    uid_t uid = self->prisoner.user.uid;
+    const gid_t aux_gids[] = {
+        gid,
+    };
+    ret = setgid(gid);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "group");
+        DEBUG("setgid: %s", strerror(errno));
+        return -1;
+    }
+    ret = setgroups(lengthof(aux_gids), aux_gids);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "group");
+        DEBUG("setgroups: %s", strerror(errno));
+        return -1;
+    }
+
+    /* Landlock で制限する場合は, 起動の指示を待つ間にルールセットを作成する. */
+    LANDLOCK ruleset = NULL;
+    if (self->jail.landlock) {
+        ruleset = build_landlock(self);
+        if (ruleset == NULL) {
+            report_prisoner_failure(start_fd, "landlock");
+            return -1;
+        }
+    }
+
+    /* jail の完成を待つ. 構築に失敗した場合は, 指示が無いまま閉じられる. */
+    ret = recv_full(start_fd, self->jail.mount_point, sizeof(self->jail.mount_point));
+    if (ret != 0) {
+        DEBUG("recv: %s (mount point)", strerror(errno));
+        landlock_release(ruleset);
+        return -1;
+    }
+
+    if (ruleset != NULL) {
+        ret = landlock_enforce(ruleset);
+        landlock_release(ruleset);
+        if (ret != 0) {
+            report_prisoner_failure(start_fd, "landlock");
+            return -1;
+        }
+    } else {
+        ret = chroot(self->jail.mount_point);
+        if (ret != 0) {
+            report_prisoner_failure(start_fd, "chroot");
+            DEBUG("chroot: %s (%s)", strerror(errno), self->jail.mount_point);
+            return -1;
+        }
+        ret = chdir("/");
+        if (ret != 0) {
+            report_prisoner_failure(start_fd, "chroot");
+            DEBUG("chdir: %s, (/)", strerror(errno));
+            return -1;
+        }
+        DIR_TREE home = dir_tree_open("/", uid, gid, DIR_PERM_DEF);
+        dir_tree_mkdir(home, self->prisoner.home_path, DIR_PERM_DEF);
+        dir_tree_close(home);
+    }
+
+    ret = setuid(uid);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "user");
+        DEBUG("setuid: %s", strerror(errno));
+        return -1;
+    }
+    ret = chdir(self->prisoner.home_path);
+    if ((ret != 0) && self->jail.landlock) {
+        /* ホストのホームディレクトリは作成しない. */
+        DEBUG("chdir: %s (%s)", strerror(errno), self->prisoner.home_path);
+        ret = chdir("/");
+    }
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "home");
+        DEBUG("chdir: %s (%s)", strerror(errno), self->prisoner.home_path);
+        return -1;
+    }
+    plan_release(self->jail.plan);
+    if (self->zygote_fd >= 0) {
+        /* zygote 自身も, 起動するプログラムと同じ capability のみを持つ. */
+        ret = capability_plan_confine(&self->prisoner.capability);
+        if (ret != 0) {
+            report_prisoner_failure(start_fd, "capability");
+            return -1;
+        }
+        /* exec と同様に, ソケットを閉じて起動の完了を伝える. */
+        close(start_fd);
+        zygote_serve(self->zygote_fd, self->zygote_owner, self->prisoner.argv);
+        DEBUG("zygote_serve: %s", strerror(errno));
+        return -1;
+    }
+    execvp(self->prisoner.argv[0], self->prisoner.argv);
+    report_prisoner_failure(start_fd, "exec");
+    DEBUG("%s: %s", self->prisoner.argv[0], strerror(errno));
+
+    return -1;
+}
+
+/**
+ *  zygote で起動したプログラムを `--ready-fd` に通知する.
+ */
+static void notify_zygote_start(void *arg, const struct zygote_result *result)
+{
+    struct alctrz *self = (struct alctrz *)arg;
+
+    if (self->ready_fd >= 0) {
+        fdprintf(self->ready_fd, "ready %d %" PRIu64 "\n", (int)result->pid, result->launch_us);
+    }
+}
+
+/**
+ *  zygote にプログラムの起動を要求し, 終了を待つ.
+ *
+ *  プログラムは自身の標準入出力で実行する. 終了状態とリソース使用量は
+ *  `--ready-fd` に通知する.
+ *
+ *  @param  [in]    self    コンテキスト.
+ *  @return プログラムの終了コードが返る. (シグナルで終了した場合は 128 + シグナル番号)
+ *          起動に失敗した場合は, 1 が返る.
+ */
+static int run_in_zygote(struct alctrz *self)
+{
+    struct zygote_result result;
+
+    int ret = zygote_run(self->run_path, self->prisoner.argv, &result, notify_zygote_start, self);
+    if (ret != 0) {
+        int error = errno;
+        if (self->ready_fd >= 0) {
+            fdprintf(self->ready_fd, "error zygote %d %s\n", error, strerror(error));
+        }
+        /* 起動の失敗はプログラムの, それ以外は zygote との通信の問題. */
+        const char *target = self->run_path;
+        if ((result.error != 0) && (self->prisoner.argv != NULL)) {
+            target = self->prisoner.argv[0];
+        }
+        ERROR("run failed: %s (%s)", strerror(error), target);
+        return 1;
+    }
+
+    int code = WIFSIGNALED(result.status)
+             ? 128 + WTERMSIG(result.status)
+             : WEXITSTATUS(result.status);
+    if (self->ready_fd >= 0) {
+        fdprintf(self->ready_fd, "exit %d %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
+                 code, result.utime_us, result.stime_us, result.maxrss_kb, result.elapsed_us);
+        close(self->ready_fd);
+    }
+
+    return code;
+}
+
+/**
+ *  使用中の jail で追加で実行するプログラムの情報.
+ */
+struct cellmate {
+    struct alctrz *self;            /**< コンテキスト. */
+    pid_t pid;                      /**< jail に閉じ込めたプログラムのプロセス ID. */
+    unsigned long long start_time;  /**< jail に閉じ込めたプログラムの起動時刻 (clock tick). */
+    unsigned int loaded;            /**< マニフェストから読み出した必須の属性. */
+    int pid_fd;                     /**< jail に閉じ込めたプログラムの pidfd. */
+    int root_fd;                    /**< jail の root. */
+    int ns_fd;                      /**< jail のマウント名前空間. (移らない場合は -1) */
+    bool private_ns;                /**< jail が専用のマウント名前空間を持つか. */
+    uint64_t keep;                  /**< 残す capability. */
+    char *environ;                  /**< 設定ファイルの環境変数. (終端文字で区切って連結したもの) */
+    size_t environ_length;          /**< 環境変数の長さ. */
+};
+
+/**
+ *  マニフェストの必須の属性: プロセス ID.
+ */
+#define CELLMATE_PID (1 << 0)
+
+/**
+ *  マニフェストの必須の属性: 起動時刻.
+ */
+#define CELLMATE_START (1 << 1)
+
+/**
+ *  マニフェストの必須の属性: ユーザ ID.
+ */
+#define CELLMATE_UID (1 << 2)
+
+/**
+ *  マニフェストの必須の属性: グループ ID.
+ */
+#define CELLMATE_GID (1 << 3)
+
+/**
+ *  マニフェストの必須の属性: 全て.
+ */
+#define CELLMATE_REQUIRED (CELLMATE_PID | CELLMATE_START | CELLMATE_UID | CELLMATE_GID)
+
+/**
+ *  プロセスの起動時刻 (/proc/<pid>/stat の starttime) を読み出す.
+ */
+static int read_start_time(pid_t pid, unsigned long long *start_time)
+{
+    char path[PATH_MAX];
+    char buf[1024];
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t length = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (length <= 0) {
+        errno = (length == 0) ? ESRCH : errno;
+        return -1;
+    }
+    buf[length] = '\0';
+
+    /* コマンド名は空白や ')' を含み得るため, 最後の ')' の後から数える. */
+    char *p = strrchr(buf, ')');
+    if (p == NULL) {
+        errno = EPROTO;
+        return -1;
+    }
+    ++p;
+    for (int field = 3; field < 22; ++field) {
+        p = strchr(p + 1, ' ');
+        if (p == NULL) {
+            errno = EPROTO;
+            return -1;
+        }
+    }
+    *start_time = strtoull(p + 1, NULL, 10);
+
+    return 0;
+}
+
+/**
+ *  `-e` で jail に入るための実行ユーザ, capability, 環境変数をマニフェストに記録する.
+ *
+ *  jail の中のプロセスが変更できる /proc の情報は, jail に入る際に使用しない.
+ *  プロセス ID は, 他の属性を記録した後に記録する.
+ */
+static void record_prisoner(struct alctrz *self)
+{
+    JAIL_MANIFEST manifest = self->jail.manifest;
+    unsigned long long start_time;
+    char value[PATH_MAX];
+
+    if ((manifest == NULL) || (read_start_time(self->prisoner.pid, &start_time) != 0)) {
+        return;
+    }
+
+    snprintf(value, sizeof(value), "%llu", start_time);
+    jail_manifest_set(manifest, "start", value);
+    snprintf(value, sizeof(value), "%u", (unsigned int)self->prisoner.user.uid);
+    jail_manifest_set(manifest, "uid", value);
+    snprintf(value, sizeof(value), "%u", (unsigned int)self->prisoner.user.gid);
+    jail_manifest_set(manifest, "gid", value);
+    snprintf(value, sizeof(value), "%" PRIx64, plan_capabilities(self->jail.plan));
+    jail_manifest_set(manifest, "capability", value);
+    jail_manifest_set(manifest, "user", self->prisoner.user.name);
+    jail_manifest_set(manifest, "home", self->prisoner.home_path);
+    jail_manifest_set(manifest, "shell", self->prisoner.shell_path);
+    jail_manifest_set(manifest, "term", self->prisoner.term);
+
+    size_t count;
+    const struct plan_env *envs = plan_environment(self->jail.plan, &count);
+    for (size_t i = 0; i < count; ++i) {
+        if (snprintf(value, sizeof(value), "%s=%s",
+                     plan_string(self->jail.plan, envs[i].name),
+                     plan_string(self->jail.plan, envs[i].value)) < (int)sizeof(value)) {
+
+            jail_manifest_set(manifest, "env", value);
+        }
+    }
+
+    snprintf(value, sizeof(value), "%d", (int)self->prisoner.pid);
+    jail_manifest_set(manifest, "pid", value);
+}
+
+/**
+ *  マニフェストの属性を読み出す.
+ */
+static int load_cellmate_attr(void *arg, const char *key, const char *value)
+{
+    struct cellmate *mate = (struct cellmate *)arg;
+    struct prisoner *prisoner = &mate->self->prisoner;
+
+    if (strcmp(key, "pid") == 0) {
+        mate->pid = (pid_t)strtol(value, NULL, 10);
+        mate->loaded |= (mate->pid > 0) ? CELLMATE_PID : 0;
+    } else if (strcmp(key, "start") == 0) {
+        mate->start_time = strtoull(value, NULL, 10);
+        mate->loaded |= CELLMATE_START;
+    } else if (strcmp(key, "uid") == 0) {
+        prisoner->user.uid = (uid_t)strtoul(value, NULL, 10);
+        mate->loaded |= CELLMATE_UID;
+    } else if (strcmp(key, "gid") == 0) {
+        prisoner->user.gid = (gid_t)strtoul(value, NULL, 10);
+        mate->loaded |= CELLMATE_GID;
+    } else if (strcmp(key, "capability") == 0) {
+        mate->keep = strtoull(value, NULL, 16);
+    } else if (strcmp(key, "user") == 0) {
+        snprintf(prisoner->user.name, sizeof(prisoner->user.name), "%s", value);
+    } else if (strcmp(key, "home") == 0) {
+        snprintf(prisoner->home_path, sizeof(prisoner->home_path), "%s", value);
+    } else if (strcmp(key, "shell") == 0) {
+        snprintf(prisoner->shell_path, sizeof(prisoner->shell_path), "%s", value);
+    } else if (strcmp(key, "term") == 0) {
+        snprintf(prisoner->term, sizeof(prisoner->term), "%s", value);
+    } else if (strcmp(key, "env") == 0) {
+        size_t length = strlen(value) + 1;
+        char *grown = realloc(mate->environ, mate->environ_length + length);
+        if (grown == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        memcpy(grown + mate->environ_length, value, length);
+        mate->environ = grown;
+        mate->environ_length += length;
+    }
+
+    return 0;
+}
+
+/**
+ *  jail に閉じ込めたプログラムから, jail の root とマウント名前空間を開く.
+ *
+ *  pidfd を取得した後に起動時刻がマニフェストと一致することを確かめるため,
+ *  pidfd はプロセス ID が再利用された別のプロセスを指さない. 最後に
+ *  プロセスが終了していないことを確かめるため, /proc から開いたものも
+ *  同じプロセスのものである.
+ */
+static int open_prisoner_jail(struct cellmate *mate)
+{
+    char path[PATH_MAX];
+    struct stat jail_ns;
+    struct stat host_ns;
+    struct stat jail_root;
+    struct stat host_root;
+    unsigned long long start_time;
+
+    mate->pid_fd = (int)syscall(SYS_pidfd_open, mate->pid, 0);
+    if ((mate->pid_fd < 0) && (errno != ENOSYS)) {
+        return -1;
+    }
+    if (read_start_time(mate->pid, &start_time) != 0) {
+        return -1;
+    }
+    if (start_time != mate->start_time) {
+        errno = ESRCH;
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/root", (int)mate->pid);
+    mate->root_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mate->root_fd < 0) {
+        return -1;
+    }
+    /* Landlock で制限した jail や, jail の外のプロセスには入れない. */
+    if ((fstat(mate->root_fd, &jail_root) != 0) || (stat("/", &host_root) != 0)) {
+        return -1;
+    }
+    if ((jail_root.st_dev == host_root.st_dev) && (jail_root.st_ino == host_root.st_ino)) {
+        errno = ESRCH;
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/ns/mnt", (int)mate->pid);
+    if ((stat(path, &jail_ns) != 0) || (stat("/proc/self/ns/mnt", &host_ns) != 0)) {
+        return -1;
+    }
+    mate->private_ns = (jail_ns.st_ino != host_ns.st_ino);
+    if (mate->private_ns && (mate->pid_fd < 0)) {
+        mate->ns_fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (mate->ns_fd < 0) {
+            return -1;
+        }
+    }
+
+    /* pidfd が使用できない場合は, 起動時刻を再度確かめる. */
+    int ret = (mate->pid_fd >= 0)
+            ? (int)syscall(SYS_pidfd_send_signal, mate->pid_fd, 0, NULL, 0)
+            : read_start_time(mate->pid, &start_time);
+    if ((ret != 0) || (start_time != mate->start_time)) {
+        errno = ESRCH;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  使用中の jail に入り, プログラムを起動する.
+ *
+ *  閉じ込めたプログラムと同じ順に, capability を落としてから
+ *  実行ユーザになる. 失敗した場合は, 失敗したフェーズと errno を
+ *  @c start_fd に送る.
+ */
+static int start_cellmate(struct alctrz *self, struct cellmate *mate, int start_fd)
+{
+    int ret;
+
+    if (mate->private_ns) {
+        ret = setns((mate->pid_fd >= 0) ? mate->pid_fd : mate->ns_fd, CLONE_NEWNS);
+        if (ret != 0) {
+            report_prisoner_failure(start_fd, "namespace");
+            DEBUG("setns: %s", strerror(errno));
+            return -1;
+        }
+    }
+    if ((fchdir(mate->root_fd) != 0) || (chroot(".") != 0) || (chdir("/") != 0)) {
+        report_prisoner_failure(start_fd, "chroot");
+        DEBUG("chroot: %s", strerror(errno));
+        return -1;
+    }
+
+    ret = drop_capabilities(self);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "capability");
+        return -1;
+    }
+
+    gid_t gid = self->prisoner.user.gid;
+    const gid_t aux_gids[] = {
+        gid,
+    };
+    ret = setgid(gid);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "group");
+        DEBUG("setgid: %s", strerror(errno));
+        return -1;
+    }
+    ret = setgroups(lengthof(aux_gids), aux_gids);
+    if (ret != 0) {
+        report_prisoner_failure(start_fd, "group");
+        DEBUG("setgroups: %s", strerror(errno));
+        return -1;
+    }
+    ret = setuid(self->prisoner.user.uid);
     if (ret != 0) {
-        DEBUG("prctl: %s", strerror(errno));
+        report_prisoner_failure(start_fd, "user");
+        DEBUG("setuid: %s", strerror(errno));
         return -1;
     }
 
-    return 0;
-}
-
-/**
- *  環境変数をリセットする.
- */
-static int reset_environment(struct alctrz *self)
-{
-    /* 全ての環境変数を削除する. */
+    /* 閉じ込めたプログラムの起動時と同じく, 標準と設定ファイルの環境変数のみとする. */
     clearenv();
-
-    /* 標準として HOME, SHELL, USER, TERM を環境変数に設定する. */
     setenv("HOME", self->prisoner.home_path, 0);
     setenv("SHELL", self->prisoner.shell_path, 0);
     setenv("USER", self->prisoner.user.name, 0);
     setenv("TERM", self->prisoner.term, 0);
-
-    json_t *envs = json_object_get(self->jail.env, "environment");
-    if (envs == NULL) {
-        return 0;
-    } else if (!json_is_object(envs)) {
-        DEBUG("json: environment is not an object");
-        return -1;
+    for (size_t offset = 0; offset < mate->environ_length; ) {
+        char *env = mate->environ + offset;
+        offset += strlen(env) + 1;
+        char *eq = strchr(env, '=');
+        if (eq != NULL) {
+            *eq = '\0';
+            ret = setenv(env, eq + 1, 1);
+            if (ret != 0) {
+                report_prisoner_failure(start_fd, "environment");
+                return -1;
+            }
+        }
     }
-
-    /* 指定された環境変数を設定する. (存在する場合は上書き) */
-    const char *name;
-    json_t *value;
-    json_object_foreach(envs, name, value) {
-        if (!json_is_string(value)) {
-            DEBUG("json: environment %s is not an string", name);
+    const char *home = getenv("HOME");
+    if ((home == NULL) || (chdir(home) != 0)) {
+        ret = chdir("/");
+        if (ret != 0) {
+            report_prisoner_failure(start_fd, "chroot");
+            DEBUG("chdir: %s, (/)", strerror(errno));
             return -1;
         }
-        setenv(name, json_string_value(value), 1);
     }
 
-    /* 上書きされた可能性があるため, 標準環境変数を読み出す. */
-    strncpy(self->prisoner.home_path, getenv("HOME"), sizeof(self->prisoner.home_path));
-    strncpy(self->prisoner.shell_path, getenv("SHELL"), sizeof(self->prisoner.shell_path));
-    strncpy(self->prisoner.user.name, getenv("USER"), sizeof(self->prisoner.user.name));
-    strncpy(self->prisoner.term, getenv("TERM"), sizeof(self->prisoner.term));
+    execvp(self->prisoner.argv[0], self->prisoner.argv);
+    report_prisoner_failure(start_fd, "exec");
+    DEBUG("%s: %s", self->prisoner.argv[0], strerror(errno));
 
-    return 0;
+    return -1;
 }
 
 /**
- *  指定名称のユーザ情報を取得する.
+ *  使用中の jail でプログラムを追加で実行し, 終了を待つ.
  *
- *  @todo エラーチェックの方法など, 今一度精査する. (セキュアコーディング観点)
+ *  jail の root (専用のマウント名前空間を持つ場合は名前空間も) と,
+ *  実行ユーザ, 補助グループ, 残す capability, 環境変数は, jail に閉じ込めた
+ *  プログラムのものを使用する. 起動は fork(2) と execvp(3) を 1 回ずつ
+ *  行うのみで, プログラムは自身の標準入出力で実行する.
+ *
+ *  @param  [in]    self    コンテキスト.
+ *  @return プログラムの終了コードが返る. (シグナルで終了した場合は 128 + シグナル番号)
+ *          起動に失敗した場合は, 1 が返る.
  */
-static int get_user_info(struct alctrz *self, const char *name)
+static int enter_jail(struct alctrz *self)
 {
-    struct passwd *pw = getpwnam(name);
-    if (pw == NULL) {
-        DEBUG("user: failed to get user information for user %s: %s",
-              name, strerror(errno));
-        return -1;
+    uint64_t launch_start = monotonic_ns();
+    struct cellmate mate = {
+        .pid = -1,
+        .pid_fd = -1,
+        .root_fd = -1,
+        .ns_fd = -1,
+        .private_ns = false,
+        .self = self,
+        .loaded = 0,
+        .keep = 0,
+        .environ = NULL,
+        .environ_length = 0,
+    };
+    const char *phase = "credential";
+    int ret = -1;
+
+    TEARDOWN teardown = teardown_open(TEARDOWN_DIR_DEF);
+    if (teardown != NULL) {
+        ret = teardown_visit_jail(teardown, self->enter_name, load_cellmate_attr, &mate);
+        teardown_close(teardown);
     }
-    if ((pw->pw_name == NULL) || (pw->pw_name[0] == '\0')) {
-        DEBUG("user: got an empty username for user %s", name);
-        return -1;
+    if ((ret == 0) && ((mate.loaded & CELLMATE_REQUIRED) != CELLMATE_REQUIRED)) {
+        /* 起動中または属性を記録していない jail. */
+        errno = ESRCH;
+        ret = -1;
     }
-    if (strncmp(pw->pw_name, name, LOGIN_NAME_MAX) != 0) {
-        DEBUG("user: asked for user %s, got user info for %s", name, pw->pw_name);
-        return -1;
+    if (ret == 0) {
+        phase = "jail";
+        ret = open_prisoner_jail(&mate);
+    }
+    if (ret == 0) {
+        phase = "capability";
+        ret = capability_plan_init(&self->prisoner.capability, mate.keep);
     }
 
-    self->prisoner.user.uid = pw->pw_uid;
-    self->prisoner.user.gid = pw->pw_gid;
-    strncpy(self->prisoner.user.name, pw->pw_name, sizeof(self->prisoner.user.name));
-    strncpy(self->prisoner.home_path, pw->pw_dir, sizeof(self->prisoner.home_path));
-    strncpy(self->prisoner.shell_path, pw->pw_shell, sizeof(self->prisoner.shell_path));
-    strncpy(self->prisoner.term, getenv("TERM"), sizeof(self->prisoner.term));
-
-    return 0;
-}
-
-/**
- *  指定名称のグループ ID を取得する.
- *
- *  @todo エラーチェックの方法など, 今一度精査する. (セキュアコーディング観点)
- */
-static gid_t get_group_id(const char *name)
-{
-    struct group *gr = getgrnam(name);
-    if (gr == NULL) {
-        DEBUG("group: failed to get group information for group %s: %s",
-              name, strerror(errno));
-        return (gid_t)-1;
+    int start_fds[2] = {-1, -1};
+    pid_t pid = -1;
+    if (ret == 0) {
+        self->prisoner.capability_planned = true;
+        phase = "fork";
+        ret = socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, start_fds);
     }
-    if ((gr->gr_name == NULL) || (gr->gr_name[0] == '\0')) {
-        DEBUG("group: got an empty groupname for group %s", name);
-        return (gid_t)-1;
+    if (ret == 0) {
+        pid = fork();
+        if (pid == 0) {
+            close(start_fds[1]);
+            start_cellmate(self, &mate, start_fds[0]);
+            _exit(2);
+        }
+        ret = (pid < 0) ? -1 : 0;
     }
-    if (strncmp(gr->gr_name, name, LOGIN_NAME_MAX) != 0) {
-        DEBUG("group: asked for user %s, got group info for %s", name, gr->gr_name);
-        return (gid_t)-1;
+    int error = errno;
+    if (start_fds[0] >= 0) {
+        close(start_fds[0]);
     }
+    if (mate.pid_fd >= 0) {
+        close(mate.pid_fd);
+    }
+    if (mate.root_fd >= 0) {
+        close(mate.root_fd);
+    }
+    if (mate.ns_fd >= 0) {
+        close(mate.ns_fd);
+    }
+    free(mate.environ);
+    errno = error;
 
-    return gr->gr_gid;
-}
-
-/**
- *  引数を解析してコンテキストに設定する.
- *
- *  @remarks    `-g` が指定された場合は, 指定ユーザの所属するグループ ID に
- *              上書きする.
- */
-static int parse_arguments(struct alctrz *self, int argc, char * const *argv)
-{
-    int opt;
-    gid_t group = (gid_t)-1;
-    int ret;
-
-    while ((opt = getopt(argc, argv, "c:u:g:ahv")) != -1) {
-        switch (opt) {
-        case 'c':
-            /** @todo パスは正規化したほうが良い. (セキュアコーディング観点) */
-            self->jail.env= json_load_from_file(optarg);
-            if (self->jail.env == NULL) {
-                errno = EINVAL;
-                return -1;
-            }
-            break;
-        case 'u':
-            ret = get_user_info(self, optarg);
-            if (ret != 0) {
-                errno = EINVAL;
-                return -1;
-            }
-            break;
-        case 'g':
-            group = get_group_id(optarg);
-            if (group == (gid_t)-1) {
-                errno = EINVAL;
-                return -1;
-            }
-            break;
-        case 'a':
-            self->do_attach = true;
-            break;
-        case 'h':
-            self->show_help = true;
-            return 0;
-        case 'v':
-            self->show_version = true;
-            return 0;
-        default:
-            errno = EINVAL;
-            return -1;
-        }
+    /* 端末からのシグナルは, プログラムのみが受け取る. */
+    struct sigaction ignore = {
+        .sa_handler = SIG_IGN,
+    };
+    struct sigaction saved_int;
+    struct sigaction saved_quit;
+    sigaction(SIGINT, &ignore, &saved_int);
+    sigaction(SIGQUIT, &ignore, &saved_quit);
+
+    if (ret == 0) {
+        struct launch launch = {
+            .self = self,
+            .start_fd = start_fds[1],
+            .failed = {0},
+            .error = 0,
+        };
+        ret = wait_prisoner_exec(&launch);
+        phase = launch.failed;
+        errno = launch.error;
+    }
+    if (start_fds[1] >= 0) {
+        close(start_fds[1]);
     }
 
-    if (!self->do_attach) {
-        if (argc == optind) {
-            errno = EINVAL;
-            return -1;
+    int status = 0;
+    struct rusage usage = {0};
+    if (ret != 0) {
+        error = errno;
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
         }
-
-        self->prisoner.argc = argc - optind;
-        self->prisoner.argv = &argv[optind];
-        if (self->prisoner.argv[0][0] != '/') {
-            errno = EINVAL;
-            return -1;
+        if (self->ready_fd >= 0) {
+            fdprintf(self->ready_fd, "error %s %d %s\n", phase, error, strerror(error));
+            close(self->ready_fd);
         }
-
-        if (group != (gid_t)-1) {
-            self->prisoner.user.gid = group;
+        ERROR("enter failed at %s: %s (%s)", phase, strerror(error), self->enter_name);
+    } else {
+        if (self->ready_fd >= 0) {
+            fdprintf(self->ready_fd, "ready %s %" PRIu64 "\n",
+                     self->enter_name, elapsed_us(launch_start));
         }
+        while ((wait4(pid, &status, 0, &usage) < 0) && (errno == EINTR)) {
+            continue;
+        }
+    }
+    sigaction(SIGINT, &saved_int, NULL);
+    sigaction(SIGQUIT, &saved_quit, NULL);
+    if (ret != 0) {
+        return 1;
     }
 
-    return 0;
+    int code = WIFSIGNALED(status)
+             ? 128 + WTERMSIG(status)
+             : WEXITSTATUS(status);
+    if (self->ready_fd >= 0) {
+        uint64_t utime_us = (uint64_t)usage.ru_utime.tv_sec * UINT64_C(1000000) + usage.ru_utime.tv_usec;
+        uint64_t stime_us = (uint64_t)usage.ru_stime.tv_sec * UINT64_C(1000000) + usage.ru_stime.tv_usec;
+        fdprintf(self->ready_fd, "exit %d %" PRIu64 " %" PRIu64 " %ld %" PRIu64 "\n",
+                 code, utime_us, stime_us, usage.ru_maxrss, elapsed_us(launch_start));
+        close(self->ready_fd);
+    }
+
+    return code;
 }
 
 /**
  *  Alcatraz コア機能.
  *
+ *  閉じ込めるプログラムを先に起動し, jail の構築と並行して準備させる.
+ *
  *  @param  [in]    self    コンテキスト.
  *  @return 正常終了の場合は, 0 が返る.
  *          エラーが発生した場合は, -1 が返る.
@@ -1345,75 +3617,149 @@ static int alctrz(struct alctrz *self)
 
     setsid();
 
-    ret = create_jail(self);
-    if (ret != 0) {
-        return -1;
+    uint64_t launch_start = monotonic_ns();
+    /* Landlock が使用できないカーネルでは, chroot による jail で閉じ込める. */
+    if ((plan_flags(self->jail.plan) & PLAN_LANDLOCK) && (landlock_abi() > 0)) {
+        self->jail.landlock = true;
+    }
+    bool private_ns = !self->jail.landlock && ((plan_flags(self->jail.plan) & PLAN_MOUNT_NAMESPACE) != 0);
+    bool use_template = !self->jail.landlock && (plan_template(self->jail.plan) != NULL);
+    bool resolved = false;
+    if (private_ns) {
+        /* 雛形はホストで共用するため, 名前空間に移るのは雛形の用意の後. */
+        if (use_template) {
+            if (resolve_prisoner(self) != 0) {
+                notify_launch(self, NULL, "user", errno, 0);
+                return -1;
+            }
+            if (prepare_template(self) != 0) {
+                notify_launch(self, NULL, "template", errno, 0);
+                return -1;
+            }
+            resolved = true;
+        }
+        /* イメージもホストで共用するため, 名前空間に移る前にマウントする. */
+        if (attach_image(self, NULL) != 0) {
+            notify_launch(self, NULL, "image", errno, 0);
+            return -1;
+        }
+        ret = unshare_mount_namespace();
+        if (ret != 0) {
+            notify_launch(self, NULL, "namespace", errno, 0);
+            return -1;
+        }
     }
 
-    ret = build_rootfs(self);
-    if (ret != 0) {
+    /* capability の現在の状態は, 閉じ込めるプログラムと同じため起動前に調べる. */
+    if (capability_plan_init(&self->prisoner.capability, plan_capabilities(self->jail.plan)) != 0) {
+        notify_launch(self, NULL, "capability", errno, 0);
         return -1;
     }
+    self->prisoner.capability_planned = true;
+
+    /* 起動要求のソケットはホストに作成するため, jail に入る前に用意する. */
+    if (self->zygote_path != NULL) {
+        self->zygote_fd = zygote_listen(self->zygote_path, self->zygote_owner);
+        if (self->zygote_fd < 0) {
+            notify_launch(self, NULL, "zygote", errno, 0);
+            return -1;
+        }
+        self->zygote_listening = true;
+    }
 
+    /* 閉じ込めるプログラムは, スレッドを生成する前に起動しておく. */
+    int start_fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, start_fds) != 0) {
+        DEBUG("socketpair: %s", strerror(errno));
+        notify_launch(self, NULL, "fork", errno, 0);
+        return -1;
+    }
     int master_fd;
     self->prisoner.pid = forkpty(&master_fd, NULL, &saved_term, &winsz);
     if (self->prisoner.pid < 0) {
+        notify_launch(self, NULL, "fork", errno, 0);
+        close(start_fds[0]);
+        close(start_fds[1]);
         return -1;
     } else if (self->prisoner.pid == 0) {
-        ret = chroot(self->jail.mount_point);
-        if (ret != 0) {
-            DEBUG("chroot: %s (%s)", strerror(errno), self->jail.mount_point);
-            exit(2);
-        }
-        ret = reset_environment(self);
-        if (ret != 0) {
-            exit(2);
-        }
-        ret = chdir("/");
-        if (ret != 0) {
-            DEBUG("chdir: %s, (/)", strerror(errno));
-            exit(2);
-        }
-        recursive_mkdir(self->prisoner.home_path,
-                        DIR_PERM_DEF,
-                        self->prisoner.user.uid,
-                        self->prisoner.user.gid,
-                        false);
+        close(start_fds[1]);
+        close(self->report_fd);
+        self->report_fd = -1;
+        close(self->notify_fd);
+        self->notify_fd = -1;
+        start_prisoner(self, start_fds[0]);
+        exit(2);
+    }
+    close(start_fds[0]);
+    if (self->zygote_fd >= 0) {
+        close(self->zygote_fd);
+        self->zygote_fd = -1;
+    }
 
-        ret = drop_capabilities(self);
-        if (ret != 0) {
-            exit(2);
-        }
+    /* 記録し直す場合は, 古いプロファイルで先読みしない. */
+    if (!self->do_profile && (self->profile_path[0] != '\0')) {
+        self->profile = profile_load(self->profile_path);
+    }
 
-        gid_t gid = self->prisoner.user.gid;
-        uid_t uid = self->prisoner.user.uid;
-        const gid_t aux_gids[] = {
-            gid,
-        };
-        ret = setgid(gid);
-        if (ret != 0) {
-            DEBUG("setgid: %s", strerror(errno));
-            exit(2);
-        }
-        ret = setgroups(lengthof(aux_gids), aux_gids);
-        if (ret != 0) {
-            DEBUG("setgroups: %s", strerror(errno));
-            exit(2);
-        }
-        ret = setuid(uid);
-        if (ret != 0) {
-            DEBUG("setuid: %s", strerror(errno));
-            exit(2);
+    /* プールの jail はホストに構築されているため, 専用の名前空間では使用しない. */
+    struct launch launch = {
+        .self = self,
+        .pool = NULL,
+        .use_pool = !private_ns && !self->jail.landlock && (plan_pool(self->jail.plan) != NULL),
+        .claimed = false,
+        .chown_root = false,
+        .start_fd = start_fds[1],
+        .pipeline = NULL,
+        .failed = {0},
+        .error = 0,
+    };
+    ret = run_launch(&launch, resolved, use_template && !private_ns);
+    report_jail(self);
+    ACCESS_PROFILE recording = NULL;
+    int recording_error = 0;
+    if ((ret == 0) && self->do_profile) {
+        /* プログラムが jail に入る前に記録を開始する. Landlock の場合は jail が無い. */
+        recording = self->jail.landlock ? NULL : profile_record(self->jail.mount_point);
+        if (recording == NULL) {
+            recording_error = self->jail.landlock ? ENOTSUP : errno;
+            DEBUG("profile_record: %s (%s)", strerror(recording_error), self->jail.mount_point);
         }
-        ret = chdir(self->prisoner.home_path);
+    }
+    if (ret == 0) {
+        /* chroot の待ち合わせを解除する. */
+        ret = send_full(launch.start_fd, self->jail.mount_point, sizeof(self->jail.mount_point));
         if (ret != 0) {
-            DEBUG("chdir: %s (%s)", strerror(errno), self->prisoner.home_path);
-            exit(2);
+            DEBUG("send: %s (mount point)", strerror(errno));
+            snprintf(launch.failed, sizeof(launch.failed), "exec");
+            launch.error = errno;
         }
-        json_decref(self->jail.env);
-        execvp(self->prisoner.argv[0], self->prisoner.argv);
-        DEBUG("%s: %s", self->prisoner.argv[0], strerror(errno));
     }
+    /* 構築に失敗した場合は, 指示をしないまま閉じる. */
+    shutdown(launch.start_fd, SHUT_WR);
+    if (wait_prisoner_exec(&launch) != 0) {
+        ret = -1;
+    }
+    close(launch.start_fd);
+    if (ret == 0) {
+        record_prisoner(self);
+    }
+    uint64_t exec_ns = monotonic_ns();
+    uint64_t launch_us = elapsed_us(launch_start);
+    notify_launch(self, launch.pipeline, (ret == 0) ? NULL : launch.failed, launch.error, launch_us);
+    pipeline_release(launch.pipeline);
+    if (ret != 0) {
+        waitpid(self->prisoner.pid, NULL, 0);
+        close(master_fd);
+        profile_release(recording);
+        pool_close(launch.pool);
+        return -1;
+    }
+    if (launch.pool != NULL) {
+        /* 補充は孫プロセスで行うため, 自身の jail の情報は上書きされない. */
+        pool_refill_async(launch.pool, build_pooled_jail, self);
+        pool_close(launch.pool);
+    }
+    ssize_t host_mounts = count_mounts(getppid());
 
     char path[PATH_MAX];
     snprintf(path, sizeof(path), self->prisoner.stdio.path, STDOUT_FILENO);
@@ -1421,11 +3767,17 @@ static int alctrz(struct alctrz *self)
     if (stdout_fd < 0) {
         kill(self->prisoner.pid, SIGTERM);
         close(master_fd);
+        profile_release(recording);
         return -1;
     }
+    fdprintf(stdout_fd, "jail launch %" PRIu64 " us (%s), propagation %s, host mounts %zd\r\n",
+             launch_us, self->jail.landlock ? "landlock" : launch.claimed ? "pooled" : "built",
+             jail_propagation_name(self), host_mounts);
 
     set_blocking(master_fd, false);
 
+    /* exec から最初の出力までの時間で, プリウォームの効果を測る. */
+    uint64_t first_output_us = 0;
     ret = -1;
     do {
         snprintf(path, sizeof(path), self->prisoner.stdio.path, STDIN_FILENO);
@@ -1466,6 +3818,9 @@ static int alctrz(struct alctrz *self)
                             fdprintf(stdout_fd, "read: %s\r\n", strerror(errno));
                             return false;
                         }
+                        if ((first_output_us == 0) && (read_len > 0)) {
+                            first_output_us = elapsed_us(exec_ns);
+                        }
                         written_len = write(stdout_fd, buf, read_len);
                         if (written_len < 0) {
                             fdprintf(stdout_fd, "write: %s\r\n", strerror(errno));
@@ -1502,6 +3857,60 @@ static int alctrz(struct alctrz *self)
         }
     }
 
+    struct prewarm_stats prewarm;
+    if (prewarm_get_stats(self->prewarm, &prewarm) == 0) {
+        fdprintf(stdout_fd, "first output %" PRIu64 " us after exec, prewarm %zu files, %"
+                 PRIu64 " bytes (%" PRIu64 " locked) in %" PRIu64 " us\r\n",
+                 first_output_us, prewarm.files, prewarm.bytes, prewarm.locked, prewarm.elapsed_us);
+    } else {
+        fdprintf(stdout_fd, "first output %" PRIu64 " us after exec, no prewarm\r\n",
+                 first_output_us);
+    }
+    if (self->jail.archive_extracted) {
+        const struct archive_stats *archive = &self->jail.archive;
+        uint64_t us = (archive->elapsed_us > 0) ? archive->elapsed_us : 1;
+        fdprintf(stdout_fd, "archive %zu files, %" PRIu64 " bytes in %" PRIu64 " us (%.1f MB/s, %.0f files/s)\r\n",
+                 archive->files, archive->bytes, archive->elapsed_us,
+                 (double)archive->bytes / (double)us, (double)archive->files * 1e6 / (double)us);
+    }
+    if (!self->jail.landlock) {
+        struct statfs usage;
+        if (statfs(self->jail.mount_point, &usage) == 0) {
+            fdprintf(stdout_fd, "jail tmpfs used %" PRIu64 " of %" PRIu64 " bytes, %" PRIu64 " of %" PRIu64 " inodes\r\n",
+                     (uint64_t)(usage.f_blocks - usage.f_bfree) * usage.f_bsize,
+                     (uint64_t)usage.f_blocks * usage.f_bsize,
+                     (uint64_t)(usage.f_files - usage.f_ffree),
+                     (uint64_t)usage.f_files);
+        } else {
+            fdprintf(stdout_fd, "statfs: %s (%s)\r\n", strerror(errno), self->jail.mount_point);
+        }
+    }
+
+    if (self->do_profile) {
+        if (recording == NULL) {
+            fdprintf(stdout_fd, "profile: recording failed: %s\r\n", strerror(recording_error));
+        } else {
+            profile_stop(recording);
+            int saved = profile_save(recording, self->profile_path, jail_to_host_path, self);
+            if (saved < 0) {
+                fdprintf(stdout_fd, "profile: %s (%s)\r\n", strerror(errno), self->profile_path);
+            } else {
+                fdprintf(stdout_fd, "profile: %d files recorded to %s%s\r\n",
+                         saved, self->profile_path,
+                         profile_truncated(recording) ? " (truncated)" : "");
+            }
+            profile_release(recording);
+        }
+    }
+
+    if (private_ns) {
+        uint64_t start = monotonic_ns();
+        destroy_private_jail(self);
+        uint64_t teardown_us = elapsed_us(start);
+        fdprintf(stdout_fd, "jail teardown %" PRIu64 " us, host mounts %zd\r\n",
+                 teardown_us, count_mounts(getppid()));
+    }
+
     close(stdout_fd);
 
     return 0;
@@ -1580,27 +3989,41 @@ static int visitation(struct alctrz *self)
     return ret;
 }
 
+/**
+ *  使用済みの jail を破棄キューに渡す.
+ *
+ *  破棄はバックグラウンドのワーカが行うため, 完了を待たずに戻る.
+ *  jail の情報が無い場合は, 標準入出力の FIFO のみ削除する.
+ */
 static void cleanup(struct alctrz *self)
 {
+    char name[NAME_MAX + 1] = {0};
     int ret;
 
-    for (ITER iter = list_iter(self->bind_entries);
-         iter != NULL;
-         iter = iter_next(iter)) {
-
-        ret = umount2(iter_get_payload(iter), MNT_DETACH);
-        if (ret != 0) {
-            DEBUG("umount2: %s (%s)", strerror(errno), (char *)iter_get_payload(iter));
-        }
+    /* zygote は jail と共に終了するため, 作成した起動要求のソケットを削除する. */
+    if (self->zygote_listening && (unlink(self->zygote_path) != 0)) {
+        DEBUG("unlink: %s (%s)", strerror(errno), self->zygote_path);
     }
-    ret = umount2(self->jail.mount_point, MNT_DETACH);
-    if (ret != 0) {
-        DEBUG("umount2: %s (%s)", strerror(errno), self->jail.mount_point);
+    if (self->report_fd >= 0) {
+        ssize_t length = read(self->report_fd, name, sizeof(name) - 1);
+        name[(length > 0) ? length : 0] = '\0';
+        close(self->report_fd);
+        self->report_fd = -1;
     }
-    ret = rmdir(self->jail.mount_point);
-    if (ret != 0) {
-        DEBUG("rmdir: %s (%s)", strerror(errno), self->jail.mount_point);
+    if (name[0] != '\0') {
+        uint64_t start = monotonic_ns();
+        TEARDOWN teardown = teardown_open(TEARDOWN_DIR_DEF);
+        ret = teardown_submit(teardown, name);
+        teardown_close(teardown);
+        if (ret == 0) {
+            /* 破棄はワーカが行うため, 待つのは破棄キューへの登録のみ. */
+            printf("jail teardown %" PRIu64 " us (queued), host mounts %zd\n",
+                   elapsed_us(start), count_mounts(getpid()));
+            return;
+        }
+        DEBUG("teardown_submit: %s (%s)", strerror(errno), name);
     }
+
     char path[PATH_MAX];
     snprintf(path, sizeof(path), self->prisoner.stdio.path, STDIN_FILENO);
     ret = unlink(path);
@@ -1615,7 +4038,74 @@ static void cleanup(struct alctrz *self)
 }
 
 /**
- *  imprisonment desc.
+ *  jail 側からの起動結果の通知を待つ.
+ *
+ *  `--ready-fd` の指定があれば, 通知をそのまま転送する.
+ *
+ *  @param  [in,out]    self    コンテキスト.
+ *  @param  [in]        fd      通知を受け取るパイプ.
+ *  @return 起動に成功した場合は, 0 が返る.
+ *          失敗した場合は, -1 が返り, errno に失敗の原因が設定される.
+ */
+static int wait_for_launch(struct alctrz *self, int fd)
+{
+    char buf[PIPE_BUF + 1];
+    size_t length = 0;
+
+    while (length < sizeof(buf) - 1) {
+        ssize_t ret = read(fd, &buf[length], sizeof(buf) - 1 - length);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            DEBUG("read: %s", strerror(errno));
+            break;
+        } else if (ret == 0) {
+            break;
+        }
+        length += (size_t)ret;
+    }
+    close(fd);
+    buf[length] = '\0';
+    if (length == 0) {
+        /* 通知の前に jail 側が終了した. */
+        length = snprintf(buf, sizeof(buf), "error launch %d %s\n", EPIPE, strerror(EPIPE));
+    }
+
+    if (self->ready_fd >= 0) {
+        if (write(self->ready_fd, buf, length) < 0) {
+            DEBUG("write: %s (ready fd)", strerror(errno));
+        }
+        close(self->ready_fd);
+        self->ready_fd = -1;
+    }
+
+    /* 最後の行が起動結果. */
+    if ((length > 0) && (buf[length - 1] == '\n')) {
+        buf[--length] = '\0';
+    }
+    const char *result = strrchr(buf, '\n');
+    result = (result != NULL) ? result + 1 : buf;
+    if (strncmp(result, "ready ", strlen("ready ")) == 0) {
+        return 0;
+    }
+
+    char phase[32];
+    int error;
+    if (sscanf(result, "error %31s %d", phase, &error) != 2) {
+        snprintf(phase, sizeof(phase), "launch");
+        error = EPROTO;
+    }
+    ERROR("launch failed at %s: %s", phase, strerror(error));
+    errno = error;
+    return -1;
+}
+
+/**
+ *  jail を構築し, プログラムを閉じ込める.
+ *
+ *  jail の構築は子プロセスで行い, 閉じ込めたプログラムの exec が
+ *  成功するか, 起動処理のいずれかのフェーズが失敗するまで待つ.
  *
  *  @param  [in]    self    Self context.
  *  @return Returns zero on success.
@@ -1623,13 +4113,40 @@ static void cleanup(struct alctrz *self)
  */
 static int imprisonment(struct alctrz *self)
 {
+    int report_fds[2];
+    if (pipe2(report_fds, O_CLOEXEC) != 0) {
+        ERROR("pipe2: %s", strerror(errno));
+        return -1;
+    }
+    int notify_fds[2];
+    if (pipe2(notify_fds, O_CLOEXEC) != 0) {
+        ERROR("pipe2: %s", strerror(errno));
+        close(report_fds[0]);
+        close(report_fds[1]);
+        return -1;
+    }
+
     pid_t pid = fork();
     if (pid < 0) {
         ERROR("fork: %s", strerror(errno));
+        close(report_fds[0]);
+        close(report_fds[1]);
+        close(notify_fds[0]);
+        close(notify_fds[1]);
         return -1;
     } else if (pid > 0) {
-        /* TODO: jail が完成するのを待ったほうが良い. */
-        return 0;
+        close(report_fds[1]);
+        close(notify_fds[1]);
+        self->report_fd = report_fds[0];
+        return wait_for_launch(self, notify_fds[0]);
+    }
+    close(report_fds[0]);
+    close(notify_fds[0]);
+    self->report_fd = report_fds[1];
+    self->notify_fd = notify_fds[1];
+    if (self->ready_fd >= 0) {
+        close(self->ready_fd);
+        self->ready_fd = -1;
     }
 
 #if 1
@@ -1645,7 +4162,14 @@ static int imprisonment(struct alctrz *self)
 
     int status = alctrz(self);
     /* cleanup() の呼び出しは親のみ. */
-    json_decref(self->jail.env);
+    report_jail(self);
+    detach_image(self);
+    jail_manifest_close(self->jail.manifest);
+    bind_tree_release(self->jail.binds);
+    elf_deps_release(self->jail.elf);
+    profile_release(self->profile);
+    prewarm_release(self->prewarm);
+    plan_release(self->jail.plan);
     free(self);
 
     exit(status);
@@ -1683,8 +4207,63 @@ int main(int argc, char **argv)
         print_version();
         exit(0);
     }
+    if (self->do_reap) {
+        ret = reap_jails(self);
+        plan_release(self->jail.plan);
+        free(self);
+        exit((ret == 0) ? 0 : 1);
+    }
+    if (self->compile_source != NULL) {
+        ret = compile_plan(self);
+        plan_release(self->jail.plan);
+        free(self);
+        exit((ret == 0) ? 0 : 1);
+    }
+    if (self->show_profile_binds) {
+        ret = print_profile_binds(self);
+        plan_release(self->jail.plan);
+        free(self);
+        exit((ret == 0) ? 0 : 1);
+    }
+    if (self->show_plan) {
+        ret = print_plan(self);
+        plan_release(self->jail.plan);
+        free(self);
+        exit((ret == 0) ? 0 : 1);
+    }
+    if (self->do_calibrate) {
+        ret = calibrate();
+        free(self);
+        exit((ret == 0) ? 0 : 1);
+    }
+    if (self->run_path != NULL) {
+        ret = run_in_zygote(self);
+        free(self);
+        exit(ret);
+    }
+    if (self->enter_name != NULL) {
+        ret = enter_jail(self);
+        free(self);
+        exit(ret);
+    }
+    if (self->show_stats) {
+        ret = resolve_prisoner(self);
+        if (ret == 0) {
+            ret = print_stats(self);
+        }
+        plan_release(self->jail.plan);
+        free(self);
+        exit((ret == 0) ? 0 : 1);
+    }
 
+    /* 起動時の FIFO の所有者は, jail の構築と並行して設定する. */
     ret = create_stdio_for_prisoner(self);
+    if ((ret == 0) && self->do_attach) {
+        ret = resolve_prisoner(self);
+        if (ret == 0) {
+            ret = own_stdio_for_prisoner(self);
+        }
+    }
     if (ret != 0) {
         /* FIXME: リソース解放漏れ？ */
         exit(1);
@@ -1693,9 +4272,15 @@ int main(int argc, char **argv)
     ioctl(STDIN_FILENO, TIOCGWINSZ, &winsz);
 
     if (!self->do_attach) {
+        /* 異常終了した過去の jail が残っていれば, バックグラウンドで回収する. */
+        TEARDOWN teardown = teardown_open(TEARDOWN_DIR_DEF);
+        teardown_reap_async(teardown, JAIL_PREFIX, reap_pool_root(self), REAP_INTERVAL);
+        teardown_close(teardown);
+
         ret = imprisonment(self);
         if (ret != 0) {
-            /* FIXME: リソース解放漏れ？ */
+            /* 構築途中の jail は, 破棄キューに渡す. */
+            cleanup(self);
             exit(1);
         }
     }
@@ -1714,7 +4299,7 @@ int main(int argc, char **argv)
     set_blocking(STDIN_FILENO, true);
 
     cleanup(self);
-    json_decref(self->jail.env);
+    plan_release(self->jail.plan);
     free(self);
 
     return (ret == 0) ? 0 : 1;
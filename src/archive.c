@@ -0,0 +1,1129 @@
+/** @file       archive.c
+ *  @brief      tar アーカイブからの rootfs の展開を提供する.
+ *
+ *  ustar, GNU (長いパス名) および pax (path, linkpath, size) 形式の
+ *  tar アーカイブを展開する. 圧縮したアーカイブは, 先頭のマジックナンバーで
+ *  形式を判定し, 伸張するコマンド (gzip, zstd, xz, bzip2) をパイプで繋いで
+ *  読み込む. 伸張はそのプロセスで, tar の解析とパスの作成は呼び出し元の
+ *  スレッドで, ファイルの内容の書き込みはスレッドプールで行う.
+ *
+ *  展開先のパスは全て root の中で解決し, ".." を含むエントリと
+ *  デバイスファイルは読み飛ばす. 所有者は全て指定のユーザとグループとする.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for fallocate, pipe2, F_SETPIPE_SZ, strchrnul */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "archive.h"
+#include "collections.h"
+#include "fsutil.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  tar のブロックサイズ.
+ */
+#define ARCHIVE_BLOCK (512)
+
+/**
+ *  入力バッファのサイズ.
+ */
+#define ARCHIVE_BUFFER (1 << 20)
+
+/**
+ *  スレッドプールで書き込むファイルの最大サイズ.
+ *
+ *  これより大きいファイルは, 読み込みながら呼び出し元のスレッドで書き込む.
+ */
+#define ARCHIVE_INLINE_MAX (1 << 20)
+
+/**
+ *  書き込み待ちのファイルの内容の合計サイズの上限.
+ */
+#define ARCHIVE_INFLIGHT_MAX (32 << 20)
+
+/**
+ *  書き込み待ちのファイルの最大数.
+ */
+#define ARCHIVE_QUEUE_MAX (256)
+
+/**
+ *  pax 拡張ヘッダの最大サイズ.
+ */
+#define ARCHIVE_PAX_MAX (64 * 1024)
+
+/**
+ *  展開するアクセス権限. (setuid, setgid は落とす)
+ */
+#define ARCHIVE_MODE_MASK (S_IRWXU | S_IRWXG | S_IRWXO | S_ISVTX)
+
+/**
+ *  親ディレクトリを作成する場合のアクセス権限.
+ */
+#define ARCHIVE_DIR_MODE (S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
+
+extern char **environ;
+
+/**
+ *  圧縮形式と伸張するコマンド.
+ */
+static const struct decompressor {
+    const char *magic;   /**< マジックナンバー. */
+    size_t length;       /**< マジックナンバーの長さ. */
+    const char *command; /**< 伸張するコマンド. */
+} decompressors[] = {
+    {"\x1f\x8b", 2, "gzip"},
+    {"\x28\xb5\x2f\xfd", 4, "zstd"},
+    {"\xfd" "7zXZ" "\0", 6, "xz"},
+    {"BZh", 3, "bzip2"},
+};
+
+/**
+ *  書き込むファイル.
+ */
+struct archive_job {
+    int fd;                /**< 作成したファイルの記述子. */
+    char *data;            /**< ファイルの内容. (呼び出し元のスレッドで書き込む場合は NULL) */
+    size_t size;           /**< ファイルのサイズ. */
+    mode_t mode;           /**< アクセス権限. */
+    struct timespec mtime; /**< 更新時刻. */
+};
+
+/**
+ *  tar のエントリ.
+ */
+struct archive_entry {
+    char type;            /**< エントリの種別. */
+    char path[PATH_MAX];  /**< パス. (root からの相対パス) */
+    char link[PATH_MAX];  /**< リンク先. */
+    uint64_t size;        /**< データのサイズ. */
+    mode_t mode;          /**< アクセス権限. */
+    time_t mtime;         /**< 更新時刻. */
+};
+
+/**
+ *  アーカイブ展開管理構造体.
+ */
+struct archive {
+    int root_fd;  /**< 展開先のディレクトリ. */
+    uid_t owner;  /**< 展開したファイルの所有者. */
+    gid_t group;  /**< 展開したファイルのグループ. */
+
+    int input_fd; /**< tar を読み込む記述子. */
+    pid_t pid;    /**< 伸張するプロセス. (伸張しない場合は -1) */
+    char *buf;    /**< 入力バッファ. */
+    size_t head;  /**< 入力バッファの未読の先頭. */
+    size_t tail;  /**< 入力バッファの末尾. */
+
+    int parent_fd;            /**< 直前に使用した親ディレクトリ. */
+    char parent[PATH_MAX];    /**< @c parent_fd のパス. */
+    char long_path[PATH_MAX]; /**< 次のエントリのパス. (GNU, pax) */
+    char long_link[PATH_MAX]; /**< 次のエントリのリンク先. (GNU, pax) */
+    uint64_t pax_size;        /**< 次のエントリのサイズ. (pax) */
+    bool has_pax_size;        /**< @c pax_size が有効か. */
+
+    QUEUE jobs;                                /**< 書き込み待ちのファイル. */
+    size_t inflight;                           /**< 書き込み待ちの内容の合計サイズ. */
+    bool closing;                              /**< 書き込みスレッドを終了する. */
+    int error;                                 /**< 書き込みスレッドで発生した errno. */
+    pthread_mutex_t lock;                      /**< @c jobs を保護するロック. */
+    pthread_cond_t not_empty;                  /**< ファイルの追加を通知する条件変数. */
+    pthread_cond_t not_full;                   /**< ファイルの取り出しを通知する条件変数. */
+    pthread_t workers[ARCHIVE_WORKERS_MAX];    /**< 書き込みスレッド. */
+    size_t num_workers;                        /**< 書き込みスレッドの数. */
+
+    struct archive_stats stats; /**< 統計情報. */
+};
+
+/**
+ *  入力バッファの未読部分を取得する. 未読部分が無ければ読み込む.
+ *
+ *  @return 未読部分のサイズが返り, 終端では 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static ssize_t input_peek(struct archive *self, const char **data)
+{
+    if (self->head == self->tail) {
+        ssize_t n;
+        do {
+            n = read(self->input_fd, self->buf, ARCHIVE_BUFFER);
+        } while ((n < 0) && (errno == EINTR));
+        if (n < 0) {
+            DEBUG("read: %s", strerror(errno));
+            return -1;
+        }
+        self->head = 0;
+        self->tail = (size_t)n;
+    }
+    *data = self->buf + self->head;
+
+    return (ssize_t)(self->tail - self->head);
+}
+
+/**
+ *  入力から指定のサイズを読み込む.
+ *
+ *  @param  [out]   dst     読み込んだ内容. (NULL の場合は読み飛ばす)
+ */
+static int input_read(struct archive *self, void *dst, uint64_t length)
+{
+    char *p = (char *)dst;
+
+    while (length > 0) {
+        const char *data;
+        ssize_t n = input_peek(self, &data);
+        if (n <= 0) {
+            if (n == 0) {
+                DEBUG("archive: unexpected end of archive");
+                errno = ENODATA;
+            }
+            return -1;
+        }
+        size_t chunk = ((uint64_t)n < length) ? (size_t)n : (size_t)length;
+        if (p != NULL) {
+            memcpy(p, data, chunk);
+            p += chunk;
+        }
+        self->head += chunk;
+        length -= chunk;
+    }
+
+    return 0;
+}
+
+/**
+ *  データに続くブロック境界までの詰め物を読み飛ばす.
+ */
+static int input_skip_padding(struct archive *self, uint64_t size)
+{
+    return input_read(self, NULL, (ARCHIVE_BLOCK - size % ARCHIVE_BLOCK) % ARCHIVE_BLOCK);
+}
+
+/**
+ *  エントリのデータを詰め物を含めて読み飛ばす.
+ */
+static int input_skip_data(struct archive *self, uint64_t size)
+{
+    if (input_read(self, NULL, size) != 0) {
+        return -1;
+    }
+
+    return input_skip_padding(self, size);
+}
+
+/**
+ *  アーカイブを開き, 圧縮されていれば伸張するプロセスを起動する.
+ */
+static int open_input(struct archive *self, const char *source)
+{
+    int fd = open(source, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), source);
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    char magic[8] = {0};
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    const struct decompressor *decompressor = NULL;
+    for (size_t i = 0; i < sizeof(decompressors) / sizeof(decompressors[0]); ++i) {
+        if ((n >= (ssize_t)decompressors[i].length)
+            && (memcmp(magic, decompressors[i].magic, decompressors[i].length) == 0)) {
+
+            decompressor = &decompressors[i];
+            break;
+        }
+    }
+    if (decompressor == NULL) {
+        self->input_fd = fd;
+        return 0;
+    }
+
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0) {
+        DEBUG("pipe2: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    /* 伸張と解析が交互に待たないよう, パイプを大きくする. (失敗しても続行) */
+    fcntl(pipefd[0], F_SETPIPE_SZ, ARCHIVE_BUFFER);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fd, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+    char * const argv[] = {(char *)decompressor->command, "-dc", NULL};
+    int ret = posix_spawnp(&self->pid, decompressor->command, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fd);
+    close(pipefd[1]);
+    if (ret != 0) {
+        DEBUG("posix_spawnp: %s (%s)", strerror(ret), decompressor->command);
+        close(pipefd[0]);
+        self->pid = -1;
+        errno = ret;
+        return -1;
+    }
+    self->input_fd = pipefd[0];
+
+    return 0;
+}
+
+/**
+ *  アーカイブを閉じ, 伸張するプロセスの終了を待つ.
+ *
+ *  展開に成功した場合は, 終端ブロック以降を読み捨ててから終了を待つ.
+ *
+ *  @param  [in]    success 展開に成功したか.
+ */
+static int close_input(struct archive *self, bool success)
+{
+    int ret = 0;
+
+    if ((self->pid > 0) && success) {
+        const char *data;
+        ssize_t n;
+        while ((n = input_peek(self, &data)) > 0) {
+            self->head = self->tail;
+        }
+        if (n < 0) {
+            ret = -1;
+        }
+    }
+    if (self->input_fd >= 0) {
+        close(self->input_fd);
+        self->input_fd = -1;
+    }
+    if (self->pid > 0) {
+        int status;
+        if (!success) {
+            kill(self->pid, SIGTERM);
+        }
+        if (waitpid(self->pid, &status, 0) != self->pid) {
+            DEBUG("waitpid: %s", strerror(errno));
+            ret = -1;
+        } else if (success && (!WIFEXITED(status) || (WEXITSTATUS(status) != 0))) {
+            DEBUG("archive: decompressor exited with %#x", status);
+            errno = EIO;
+            ret = -1;
+        }
+        self->pid = -1;
+    }
+
+    return ret;
+}
+
+/**
+ *  ヘッダの数値フィールドを解析する. (8 進数または base-256)
+ */
+static uint64_t parse_number(const unsigned char *field, size_t length)
+{
+    uint64_t value = 0;
+
+    if (field[0] & 0x80) {
+        value = field[0] & 0x3f;
+        for (size_t i = 1; i < length; ++i) {
+            value = (value << 8) | field[i];
+        }
+        return value;
+    }
+
+    size_t i = 0;
+    while ((i < length) && (field[i] == ' ')) {
+        ++i;
+    }
+    for (; (i < length) && (field[i] >= '0') && (field[i] <= '7'); ++i) {
+        value = (value << 3) | (uint64_t)(field[i] - '0');
+    }
+
+    return value;
+}
+
+/**
+ *  ヘッダのチェックサムを検証する.
+ */
+static bool verify_header(const unsigned char *header)
+{
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < ARCHIVE_BLOCK; ++i) {
+        sum += ((i >= 148) && (i < 156)) ? ' ' : header[i];
+    }
+
+    return sum == parse_number(header + 148, 8);
+}
+
+/**
+ *  アーカイブ内のパスを root からの相対パスに正規化する.
+ *
+ *  空の要素と "." は除き, ".." を含むパスはエラーとする.
+ */
+static int normalize_path(char *dst, const char *src, size_t length)
+{
+    size_t len = 0;
+
+    while (*src != '\0') {
+        while (*src == '/') {
+            ++src;
+        }
+        const char *end = strchrnul(src, '/');
+        size_t n = (size_t)(end - src);
+        if ((n == 0) || ((n == 1) && (src[0] == '.'))) {
+            src = end;
+            continue;
+        }
+        if ((n == 2) && (src[0] == '.') && (src[1] == '.')) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (len + n + 2 > length) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        if (len > 0) {
+            dst[len++] = '/';
+        }
+        memcpy(dst + len, src, n);
+        len += n;
+        src = end;
+    }
+    dst[len] = '\0';
+
+    return 0;
+}
+
+/**
+ *  ヘッダからエントリを取り出す.
+ *
+ *  直前の GNU 長いパス名および pax 拡張ヘッダの指定を優先する.
+ */
+static int parse_entry(struct archive *self, const unsigned char *header, struct archive_entry *entry)
+{
+    char name[PATH_MAX];
+    char link[PATH_MAX];
+
+    if (self->long_path[0] != '\0') {
+        strcpy(name, self->long_path);
+    } else if ((memcmp(header + 257, "ustar\0", 6) == 0) && (header[345] != '\0')) {
+        snprintf(name, sizeof(name), "%.155s/%.100s", (const char *)header + 345, (const char *)header);
+    } else {
+        snprintf(name, sizeof(name), "%.100s", (const char *)header);
+    }
+    if (self->long_link[0] != '\0') {
+        strcpy(link, self->long_link);
+    } else {
+        snprintf(link, sizeof(link), "%.100s", (const char *)header + 157);
+    }
+
+    entry->type = (char)header[156];
+    entry->size = self->has_pax_size ? self->pax_size : parse_number(header + 124, 12);
+    entry->mode = (mode_t)parse_number(header + 100, 8) & ARCHIVE_MODE_MASK;
+    entry->mtime = (time_t)parse_number(header + 136, 12);
+    strcpy(entry->link, link);
+
+    self->long_path[0] = '\0';
+    self->long_link[0] = '\0';
+    self->has_pax_size = false;
+
+    return normalize_path(entry->path, name, sizeof(entry->path));
+}
+
+/**
+ *  GNU の長いパス名 ('L', 'K') を読み込む.
+ */
+static int read_long_name(struct archive *self, char *dst, uint64_t size)
+{
+    if (size >= PATH_MAX) {
+        DEBUG("archive: long name of %" PRIu64 " bytes", size);
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((input_read(self, dst, size) != 0) || (input_skip_padding(self, size) != 0)) {
+        return -1;
+    }
+    dst[size] = '\0';
+
+    return 0;
+}
+
+/**
+ *  pax 拡張ヘッダ ('x') を読み込む.
+ *
+ *  各レコードは "<長さ> <キー>=<値>\n" の形式.
+ */
+static int read_pax_header(struct archive *self, uint64_t size)
+{
+    if (size > ARCHIVE_PAX_MAX) {
+        DEBUG("archive: pax header of %" PRIu64 " bytes", size);
+        errno = EFBIG;
+        return -1;
+    }
+    char *data = malloc(size + 1);
+    if (data == NULL) {
+        return -1;
+    }
+    if ((input_read(self, data, size) != 0) || (input_skip_padding(self, size) != 0)) {
+        free(data);
+        return -1;
+    }
+    data[size] = '\0';
+
+    int ret = 0;
+    for (size_t pos = 0; pos < size;) {
+        char *end;
+        unsigned long length = strtoul(data + pos, &end, 10);
+        if ((length == 0) || (*end != ' ') || (length > size - pos) || (data[pos + length - 1] != '\n')) {
+            DEBUG("archive: malformed pax record");
+            errno = EINVAL;
+            ret = -1;
+            break;
+        }
+        char *key = end + 1;
+        data[pos + length - 1] = '\0';
+        char *value = strchr(key, '=');
+        if (value != NULL) {
+            *value++ = '\0';
+            if (strcmp(key, "path") == 0) {
+                snprintf(self->long_path, sizeof(self->long_path), "%s", value);
+            } else if (strcmp(key, "linkpath") == 0) {
+                snprintf(self->long_link, sizeof(self->long_link), "%s", value);
+            } else if (strcmp(key, "size") == 0) {
+                self->pax_size = strtoull(value, NULL, 10);
+                self->has_pax_size = true;
+            }
+        }
+        pos += length;
+    }
+    free(data);
+
+    return ret;
+}
+
+/**
+ *  ディレクトリを作成し, 所有者を設定する. 既に存在する場合は何もしない.
+ */
+static int make_directory(struct archive *self, int dir_fd, const char *name, mode_t mode)
+{
+    if (mkdirat(dir_fd, name, mode) != 0) {
+        if (errno == EEXIST) {
+            return 0;
+        }
+        DEBUG("mkdirat: %s (%s)", strerror(errno), name);
+        return -1;
+    }
+    if (fchownat(dir_fd, name, self->owner, self->group, AT_SYMLINK_NOFOLLOW) != 0) {
+        DEBUG("fchownat: %s (%s)", strerror(errno), name);
+        return -1;
+    }
+    self->stats.directories++;
+
+    return 0;
+}
+
+/**
+ *  root からのパスのディレクトリを開く. 存在しなければ親ディレクトリを含めて作成する.
+ */
+static int open_directory(struct archive *self, char *dir)
+{
+    int fd = open_in_root(self->root_fd, dir, O_PATH | O_DIRECTORY | O_CLOEXEC, 0);
+    if ((fd >= 0) || (errno != ENOENT) || (strcmp(dir, ".") == 0)) {
+        return fd;
+    }
+
+    char *slash = strrchr(dir, '/');
+    const char *name = dir;
+    int parent_fd;
+    if (slash != NULL) {
+        *slash = '\0';
+        parent_fd = open_directory(self, dir);
+        *slash = '/';
+        name = slash + 1;
+    } else {
+        parent_fd = open_directory(self, ".");
+    }
+    if (parent_fd < 0) {
+        return -1;
+    }
+    if (make_directory(self, parent_fd, name, ARCHIVE_DIR_MODE) == 0) {
+        fd = openat(parent_fd, name, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    close(parent_fd);
+
+    return fd;
+}
+
+/**
+ *  パスの親ディレクトリを開く.
+ *
+ *  アーカイブのエントリは同じディレクトリが続くことが多いため,
+ *  直前の親ディレクトリを再利用する. 返る記述子は閉じてはならない.
+ *
+ *  @param  [out]   name    パスの最後の要素.
+ */
+static int open_parent(struct archive *self, char *path, const char **name)
+{
+    char *slash = strrchr(path, '/');
+    char *dir = ".";
+
+    if (slash != NULL) {
+        *slash = '\0';
+        dir = path;
+        *name = slash + 1;
+    } else {
+        *name = path;
+    }
+
+    int fd = self->parent_fd;
+    if ((fd < 0) || (strcmp(self->parent, dir) != 0)) {
+        fd = open_directory(self, dir);
+        if (fd >= 0) {
+            if (self->parent_fd >= 0) {
+                close(self->parent_fd);
+            }
+            self->parent_fd = fd;
+            snprintf(self->parent, sizeof(self->parent), "%s", dir);
+        }
+    }
+    if (slash != NULL) {
+        *slash = '/';
+    }
+
+    return fd;
+}
+
+/**
+ *  ファイルの内容を書き込み, 所有者, アクセス権限, 更新時刻を設定して閉じる.
+ */
+static int finish_file(struct archive *self, struct archive_job *job)
+{
+    int ret = 0;
+
+    for (size_t offset = 0; (job->data != NULL) && (offset < job->size);) {
+        ssize_t n = pwrite(job->fd, job->data + offset, job->size - offset, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            DEBUG("pwrite: %s", strerror(errno));
+            ret = -1;
+            break;
+        }
+        offset += (size_t)n;
+    }
+    if ((ret == 0) && (fchown(job->fd, self->owner, self->group) != 0)) {
+        DEBUG("fchown: %s", strerror(errno));
+        ret = -1;
+    }
+    if ((ret == 0) && (fchmod(job->fd, job->mode) != 0)) {
+        DEBUG("fchmod: %s", strerror(errno));
+        ret = -1;
+    }
+    if (ret == 0) {
+        const struct timespec times[2] = {job->mtime, job->mtime};
+        futimens(job->fd, times);
+    }
+    int error = errno;
+    close(job->fd);
+    errno = error;
+
+    return ret;
+}
+
+/**
+ *  書き込みスレッド.
+ */
+static void *run_worker(void *arg)
+{
+    struct archive *self = (struct archive *)arg;
+    struct archive_job job;
+
+    pthread_mutex_lock(&self->lock);
+    for (;;) {
+        while ((queue_count(self->jobs) == 0) && !self->closing) {
+            pthread_cond_wait(&self->not_empty, &self->lock);
+        }
+        if (queue_deq(self->jobs, &job) < 0) {
+            break;
+        }
+        self->inflight -= job.size;
+        pthread_cond_signal(&self->not_full);
+        pthread_mutex_unlock(&self->lock);
+
+        int ret = finish_file(self, &job);
+        int error = errno;
+        free(job.data);
+
+        pthread_mutex_lock(&self->lock);
+        if ((ret != 0) && (self->error == 0)) {
+            self->error = error;
+            pthread_cond_broadcast(&self->not_full);
+        }
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return NULL;
+}
+
+/**
+ *  ファイルを書き込みスレッドに渡す.
+ *
+ *  書き込み待ちが上限に達している場合は, 空くまで待つ.
+ *  書き込みスレッドが無い場合は, 呼び出し元のスレッドで書き込む.
+ */
+static int submit_job(struct archive *self, struct archive_job *job)
+{
+    if (self->num_workers == 0) {
+        int ret = finish_file(self, job);
+        free(job->data);
+        return ret;
+    }
+
+    pthread_mutex_lock(&self->lock);
+    while ((self->error == 0)
+           && ((queue_count(self->jobs) >= ARCHIVE_QUEUE_MAX)
+               || ((self->inflight > 0) && (self->inflight + job->size > ARCHIVE_INFLIGHT_MAX)))) {
+
+        pthread_cond_wait(&self->not_full, &self->lock);
+    }
+    int error = self->error;
+    if (error == 0) {
+        if (queue_enq(self->jobs, job) == NULL) {
+            error = errno;
+        } else {
+            self->inflight += job->size;
+            pthread_cond_signal(&self->not_empty);
+        }
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    if (error != 0) {
+        close(job->fd);
+        free(job->data);
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  大きなファイルの内容を, 入力バッファから直接書き込む.
+ */
+static int write_inline(struct archive *self, struct archive_job *job)
+{
+    for (uint64_t remain = job->size; remain > 0;) {
+        const char *data;
+        ssize_t n = input_peek(self, &data);
+        if (n <= 0) {
+            if (n == 0) {
+                DEBUG("archive: unexpected end of archive");
+                errno = ENODATA;
+            }
+            return -1;
+        }
+        size_t chunk = ((uint64_t)n < remain) ? (size_t)n : (size_t)remain;
+        ssize_t written = write(job->fd, data, chunk);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            DEBUG("write: %s", strerror(errno));
+            return -1;
+        }
+        self->head += (size_t)written;
+        remain -= (uint64_t)written;
+    }
+
+    return 0;
+}
+
+/**
+ *  通常のファイルを展開する.
+ *
+ *  ファイルの作成と領域の確保は, 後続のハードリンクが参照できるよう
+ *  呼び出し元のスレッドで行う.
+ */
+static int extract_file(struct archive *self, struct archive_entry *entry, int dir_fd, const char *name)
+{
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC;
+    int fd = openat(dir_fd, name, flags, S_IRUSR | S_IWUSR);
+    if ((fd < 0) && (errno == ELOOP) && (unlinkat(dir_fd, name, 0) == 0)) {
+        fd = openat(dir_fd, name, flags, S_IRUSR | S_IWUSR);
+    }
+    if (fd < 0) {
+        DEBUG("openat: %s (%s)", strerror(errno), entry->path);
+        return -1;
+    }
+    if ((entry->size > 0)
+        && (fallocate(fd, 0, 0, (off_t)entry->size) != 0)
+        && (errno != EOPNOTSUPP)) {
+
+        DEBUG("fallocate: %s (%s)", strerror(errno), entry->path);
+        close(fd);
+        return -1;
+    }
+
+    struct archive_job job = {
+        .fd = fd,
+        .data = NULL,
+        .size = (size_t)entry->size,
+        .mode = entry->mode,
+        .mtime = {.tv_sec = entry->mtime, .tv_nsec = 0},
+    };
+    int ret;
+    if (entry->size > ARCHIVE_INLINE_MAX) {
+        ret = write_inline(self, &job);
+        if (ret == 0) {
+            ret = finish_file(self, &job);
+        } else {
+            close(fd);
+        }
+    } else {
+        job.data = malloc((entry->size > 0) ? (size_t)entry->size : 1);
+        if ((job.data == NULL) || (input_read(self, job.data, entry->size) != 0)) {
+            free(job.data);
+            close(fd);
+            return -1;
+        }
+        ret = submit_job(self, &job);
+    }
+    if ((ret != 0) || (input_skip_padding(self, entry->size) != 0)) {
+        return -1;
+    }
+    self->stats.files++;
+    self->stats.bytes += entry->size;
+
+    return 0;
+}
+
+/**
+ *  シンボリックリンクを作成する. 既に存在する場合は置き換える.
+ */
+static int extract_symlink(struct archive *self, struct archive_entry *entry, int dir_fd, const char *name)
+{
+    if ((symlinkat(entry->link, dir_fd, name) != 0)
+        && ((errno != EEXIST)
+            || (unlinkat(dir_fd, name, 0) != 0)
+            || (symlinkat(entry->link, dir_fd, name) != 0))) {
+
+        DEBUG("symlinkat: %s (%s)", strerror(errno), entry->path);
+        return -1;
+    }
+    if (fchownat(dir_fd, name, self->owner, self->group, AT_SYMLINK_NOFOLLOW) != 0) {
+        DEBUG("fchownat: %s (%s)", strerror(errno), entry->path);
+        return -1;
+    }
+    self->stats.links++;
+
+    return 0;
+}
+
+/**
+ *  ハードリンクを作成する. リンク先が root の外を指す場合は読み飛ばす.
+ */
+static int extract_hardlink(struct archive *self, struct archive_entry *entry, int dir_fd, const char *name)
+{
+    char target[PATH_MAX];
+    if ((normalize_path(target, entry->link, sizeof(target)) != 0) || (target[0] == '\0')) {
+        DEBUG("archive: skip hard link to '%s'", entry->link);
+        self->stats.skipped++;
+        return 0;
+    }
+
+    char *slash = strrchr(target, '/');
+    const char *target_name = target;
+    int target_fd;
+    if (slash != NULL) {
+        *slash = '\0';
+        target_fd = open_in_root(self->root_fd, target, O_PATH | O_DIRECTORY | O_CLOEXEC, 0);
+        target_name = slash + 1;
+    } else {
+        target_fd = open_in_root(self->root_fd, ".", O_PATH | O_DIRECTORY | O_CLOEXEC, 0);
+    }
+    if (target_fd < 0) {
+        DEBUG("open_in_root: %s (%s)", strerror(errno), entry->link);
+        return -1;
+    }
+
+    int ret = 0;
+    if ((linkat(target_fd, target_name, dir_fd, name, 0) != 0)
+        && ((errno != EEXIST)
+            || (unlinkat(dir_fd, name, 0) != 0)
+            || (linkat(target_fd, target_name, dir_fd, name, 0) != 0))) {
+
+        DEBUG("linkat: %s (%s)", strerror(errno), entry->path);
+        ret = -1;
+    } else {
+        self->stats.links++;
+    }
+    close(target_fd);
+
+    return ret;
+}
+
+/**
+ *  FIFO を作成する.
+ */
+static int extract_fifo(struct archive *self, struct archive_entry *entry, int dir_fd, const char *name)
+{
+    if (mknodat(dir_fd, name, S_IFIFO | entry->mode, 0) != 0) {
+        if (errno == EEXIST) {
+            return 0;
+        }
+        DEBUG("mknodat: %s (%s)", strerror(errno), entry->path);
+        return -1;
+    }
+    if (fchownat(dir_fd, name, self->owner, self->group, AT_SYMLINK_NOFOLLOW) != 0) {
+        DEBUG("fchownat: %s (%s)", strerror(errno), entry->path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  エントリを展開する.
+ *
+ *  親ディレクトリがシンボリックリンクなどでディレクトリとして辿れない
+ *  エントリは読み飛ばす.
+ */
+static int extract_entry(struct archive *self, struct archive_entry *entry)
+{
+    const char *name;
+    int dir_fd = open_parent(self, entry->path, &name);
+    if (dir_fd < 0) {
+        if ((errno != ENOTDIR) && (errno != ELOOP)) {
+            return -1;
+        }
+        DEBUG("archive: skip '%s' (%s)", entry->path, strerror(errno));
+        self->stats.skipped++;
+        return input_skip_data(self, entry->size);
+    }
+
+    int ret;
+    switch (entry->type) {
+    case '0':
+    case '\0':
+    case '7':
+        return extract_file(self, entry, dir_fd, name);
+    case '1':
+        ret = extract_hardlink(self, entry, dir_fd, name);
+        break;
+    case '2':
+        ret = extract_symlink(self, entry, dir_fd, name);
+        break;
+    case '5':
+        ret = make_directory(self, dir_fd, name, entry->mode);
+        break;
+    case '6':
+        ret = extract_fifo(self, entry, dir_fd, name);
+        break;
+    default:
+        /* デバイスファイルは 'device' で作成する. */
+        DEBUG("archive: skip '%s' of type '%c'", entry->path, entry->type);
+        self->stats.skipped++;
+        ret = 0;
+        break;
+    }
+    if (ret != 0) {
+        return -1;
+    }
+
+    return input_skip_data(self, entry->size);
+}
+
+/**
+ *  終端ブロックまでアーカイブを展開する.
+ */
+static int extract_all(struct archive *self)
+{
+    unsigned char header[ARCHIVE_BLOCK];
+    static const unsigned char zero[ARCHIVE_BLOCK];
+    struct archive_entry *entry = malloc(sizeof(*entry));
+    if (entry == NULL) {
+        return -1;
+    }
+
+    int ret = 0;
+    for (;;) {
+        const char *data;
+        ssize_t n = input_peek(self, &data);
+        if (n == 0) {
+            /* 終端ブロックを省略したアーカイブ. */
+            break;
+        }
+        if ((n < 0) || (input_read(self, header, sizeof(header)) != 0)) {
+            ret = -1;
+            break;
+        }
+        if (memcmp(header, zero, sizeof(header)) == 0) {
+            break;
+        }
+        if (!verify_header(header)) {
+            DEBUG("archive: invalid header checksum");
+            errno = EINVAL;
+            ret = -1;
+            break;
+        }
+
+        uint64_t size = parse_number(header + 124, 12);
+        if (header[156] == 'L') {
+            ret = read_long_name(self, self->long_path, size);
+        } else if (header[156] == 'K') {
+            ret = read_long_name(self, self->long_link, size);
+        } else if (header[156] == 'x') {
+            ret = read_pax_header(self, size);
+        } else if (header[156] == 'g') {
+            ret = input_skip_data(self, size);
+        } else if (parse_entry(self, header, entry) != 0) {
+            DEBUG("archive: skip unsafe path");
+            self->stats.skipped++;
+            ret = input_skip_data(self, entry->size);
+        } else if (entry->path[0] == '\0') {
+            /* root 自身. */
+            ret = input_skip_data(self, entry->size);
+        } else {
+            ret = extract_entry(self, entry);
+        }
+        if (ret != 0) {
+            break;
+        }
+    }
+    free(entry);
+
+    return ret;
+}
+
+/**
+ *  @details    tar アーカイブを @c root に展開する.
+ *              パスの作成を呼び出し元のスレッドで, ファイルの内容の書き込みを
+ *              @c workers 個のスレッドで行う. 展開したファイルの所有者は
+ *              @c owner と @c group とし, アクセス権限の setuid, setgid は落とす.
+ *
+ *  @param      [in]    source  アーカイブのパス.
+ *  @param      [in]    root    展開先のディレクトリ.
+ *  @param      [in]    owner   展開したファイルの所有者.
+ *  @param      [in]    group   展開したファイルのグループ.
+ *  @param      [in]    workers 書き込みスレッドの数. (0 の場合は ARCHIVE_WORKERS_DEF)
+ *  @param      [out]   stats   展開の統計情報. (NULL 可)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    展開に失敗した場合, 展開済みのファイルは削除しない.
+ */
+int archive_extract(const char *source,
+                    const char *root,
+                    uid_t owner,
+                    gid_t group,
+                    unsigned int workers,
+                    struct archive_stats *stats)
+{
+    if ((source == NULL) || (root == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t start = monotonic_ns();
+    int error = 0;
+    struct archive *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        return -1;
+    }
+    self->owner = owner;
+    self->group = group;
+    self->input_fd = -1;
+    self->pid = -1;
+    self->parent_fd = -1;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->not_empty, NULL);
+    pthread_cond_init(&self->not_full, NULL);
+
+    int ret = -1;
+    self->root_fd = open(root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    self->buf = malloc(ARCHIVE_BUFFER);
+    self->jobs = queue_init(sizeof(struct archive_job), ARCHIVE_QUEUE_MAX);
+    if ((self->root_fd < 0) || (self->buf == NULL) || (self->jobs == NULL)) {
+        DEBUG("archive: %s (%s)", strerror(errno), root);
+        goto cleanup;
+    }
+    if (open_input(self, source) != 0) {
+        goto cleanup;
+    }
+
+    if (workers == 0) {
+        workers = ARCHIVE_WORKERS_DEF;
+    }
+    if (workers > ARCHIVE_WORKERS_MAX) {
+        workers = ARCHIVE_WORKERS_MAX;
+    }
+    while (self->num_workers < workers) {
+        if (pthread_create(&self->workers[self->num_workers], NULL, run_worker, self) != 0) {
+            break;
+        }
+        self->num_workers++;
+    }
+
+    ret = extract_all(self);
+    error = errno;
+
+    pthread_mutex_lock(&self->lock);
+    self->closing = true;
+    pthread_cond_broadcast(&self->not_empty);
+    pthread_mutex_unlock(&self->lock);
+    for (size_t i = 0; i < self->num_workers; ++i) {
+        pthread_join(self->workers[i], NULL);
+    }
+    if ((ret == 0) && (self->error != 0)) {
+        error = self->error;
+        ret = -1;
+    }
+    if ((close_input(self, ret == 0) != 0) && (ret == 0)) {
+        error = errno;
+        ret = -1;
+    }
+    errno = error;
+
+    self->stats.elapsed_us = elapsed_us(start);
+    if (stats != NULL) {
+        *stats = self->stats;
+    }
+
+cleanup:
+    error = errno;
+    close_input(self, false);
+    if (self->parent_fd >= 0) {
+        close(self->parent_fd);
+    }
+    if (self->root_fd >= 0) {
+        close(self->root_fd);
+    }
+    queue_release(self->jobs);
+    free(self->buf);
+    pthread_cond_destroy(&self->not_full);
+    pthread_cond_destroy(&self->not_empty);
+    pthread_mutex_destroy(&self->lock);
+    free(self);
+    errno = error;
+
+    return ret;
+}
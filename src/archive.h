@@ -0,0 +1,66 @@
+/** @file       archive.h
+ *  @brief      tar アーカイブからの rootfs の展開を提供する.
+ *
+ *  tar アーカイブ (gzip, zstd, xz, bzip2 で圧縮したものを含む) を
+ *  jail の rootfs に展開する. アーカイブの読み込みと展開先への書き込みは
+ *  並行して行う.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_ARCHIVE_H__
+#define __ALCATRAZ_ARCHIVE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** @defgroup cat_archive Archive
+ *  tar アーカイブを展開するモジュール.
+ *  @{
+ */
+
+/**
+ *  ファイルを書き込むスレッドの標準の数.
+ */
+#define ARCHIVE_WORKERS_DEF (4)
+
+/**
+ *  ファイルを書き込むスレッドの最大数.
+ */
+#define ARCHIVE_WORKERS_MAX (16)
+
+/**
+ *  アーカイブの展開の統計情報.
+ */
+struct archive_stats {
+    size_t files;        /**< 展開した通常のファイルの数. */
+    size_t directories;  /**< 作成したディレクトリの数. */
+    size_t links;        /**< 作成したシンボリックリンクとハードリンクの数. */
+    size_t skipped;      /**< 読み飛ばしたエントリの数. */
+    uint64_t bytes;      /**< 書き込んだファイルの内容のバイト数. */
+    uint64_t elapsed_us; /**< 展開に要した時間 (マイクロ秒). */
+};
+
+/**
+ *  アーカイブを展開する.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct archive_stats stats;
+ *          archive_extract("/srv/rootfs.tar.gz", "/tmp/chroot-abcdef", uid, gid, 4, &stats);
+ *          @endcode
+ */
+int archive_extract(const char *source,
+                    const char *root,
+                    uid_t owner,
+                    gid_t group,
+                    unsigned int workers,
+                    struct archive_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_ARCHIVE_H__ */
@@ -0,0 +1,663 @@
+/** @file       bindtree.c
+ *  @brief      新しいマウント API によるバインドマウントを提供する.
+ *
+ *  配下にマウントを持つバインド元に属性を適用する場合は,
+ *  open_tree(OPEN_TREE_CLONE | AT_RECURSIVE) で配下のマウントを含めて複製し,
+ *  mount_setattr(AT_RECURSIVE) で属性を一括して適用する.
+ *  jail への取り付けは move_mount で行う.
+ *  伝播の種別も同じ mount_setattr で設定するため, 追加のシステムコールは不要.
+ *
+ *  それ以外のバインドは, システムコールの少ない従来の API で処理する.
+ *  MS_BIND と MS_RDONLY を同時に指定した mount(2) は読み込み専用にならない
+ *  ため, 従来の API を使用する場合は再マウントで属性を適用する.
+ *  再マウントは配下のマウントに及ばないため, 新しいマウント API が使用できない
+ *  kernel では, 配下のマウントもそれぞれ再マウントする.
+ *  システムコールは sysops を経由して発行するため, 記録中は発行しない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for strdup */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mount.h>
+#include <sys/statvfs.h>
+
+#include "bindtree.h"
+#include "fsutil.h"
+#include "sysops.h"
+#include "debug.h"
+
+#ifndef OPEN_TREE_CLONE
+#define OPEN_TREE_CLONE 1
+#endif
+#ifndef OPEN_TREE_CLOEXEC
+#define OPEN_TREE_CLOEXEC O_CLOEXEC
+#endif
+#ifndef MOVE_MOUNT_F_EMPTY_PATH
+#define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#endif
+#ifndef AT_RECURSIVE
+#define AT_RECURSIVE 0x8000
+#endif
+#ifndef MOUNT_ATTR_RDONLY
+#define MOUNT_ATTR_RDONLY 0x00000001
+#define MOUNT_ATTR_NOSUID 0x00000002
+#define MOUNT_ATTR_NODEV 0x00000004
+#define MOUNT_ATTR_NOEXEC 0x00000008
+#define MOUNT_ATTR__ATIME 0x00000070
+#define MOUNT_ATTR_NOATIME 0x00000010
+struct mount_attr {
+    uint64_t attr_set;
+    uint64_t attr_clr;
+    uint64_t propagation;
+    uint64_t userns_fd;
+};
+#endif
+
+/**
+ *  バインドの登録情報.
+ */
+struct bind_entry {
+    char *source;       /**< バインド元のパス. */
+    char *target;       /**< jail 内のバインド先のパス. */
+    char *real;         /**< バインド元の正規化したパス. (解決できない場合は NULL) */
+    unsigned int attrs; /**< バインドの属性. */
+    int fd;             /**< 切り離されたマウントツリー. (従来の API で取り付ける場合は -1) */
+};
+
+/**
+ *  バインドツリー管理構造体.
+ */
+struct bind_tree {
+    struct bind_entry *entries; /**< バインドの登録情報の配列. */
+    size_t count;               /**< 登録済みのバインドの数. */
+    size_t capacity;            /**< 確保したバインドの登録情報の数. */
+    bool legacy;                /**< 新しいマウント API が使用できないか. */
+    size_t syscalls;            /**< 発行したシステムコールの数. */
+    char **mounts;              /**< ホストのマウントポイント. */
+    size_t num_mounts;          /**< ホストのマウントポイントの数. */
+    size_t mounts_capacity;     /**< 確保したマウントポイントの数. */
+    bool mounts_loaded;         /**< ホストのマウントポイントを読み込んだか. */
+};
+
+/**
+ *  バインドツリー管理構造体の初期化子.
+ */
+#define BIND_TREE_INITIALIZER   \
+    (struct bind_tree){         \
+        .entries = NULL,        \
+        .count = 0,             \
+        .capacity = 0,          \
+        .legacy = false,        \
+        .syscalls = 0,          \
+        .mounts = NULL,         \
+        .num_mounts = 0,        \
+        .mounts_capacity = 0,   \
+        .mounts_loaded = false  \
+    }
+
+/**
+ *  バインドの属性を伝播の種別 (MS_PRIVATE 等) に変換する.
+ *
+ *  @param  [in]    attrs   バインドの属性.
+ *  @return 伝播の種別が返る. 指定が無い場合は 0 が返る.
+ */
+static unsigned long to_propagation_flags(unsigned int attrs)
+{
+    switch (attrs & BIND_ATTR_PROPAGATION) {
+    case BIND_ATTR_PRIVATE:
+        return MS_PRIVATE;
+    case BIND_ATTR_SLAVE:
+        return MS_SLAVE;
+    case BIND_ATTR_SHARED:
+        return MS_SHARED;
+    case BIND_ATTR_UNBINDABLE:
+        return MS_UNBINDABLE;
+    default:
+        return 0;
+    }
+}
+
+/**
+ *  バインドの属性を mount_setattr の属性に変換する.
+ *
+ *  @param  [in]    attrs   バインドの属性.
+ *  @return mount_setattr の属性が返る.
+ */
+static struct mount_attr to_mount_attr(unsigned int attrs)
+{
+    struct mount_attr attr = {0};
+
+    if (attrs & BIND_ATTR_RDONLY) {
+        attr.attr_set |= MOUNT_ATTR_RDONLY;
+    }
+    if (attrs & BIND_ATTR_NOSUID) {
+        attr.attr_set |= MOUNT_ATTR_NOSUID;
+    }
+    if (attrs & BIND_ATTR_NODEV) {
+        attr.attr_set |= MOUNT_ATTR_NODEV;
+    }
+    if (attrs & BIND_ATTR_NOEXEC) {
+        attr.attr_set |= MOUNT_ATTR_NOEXEC;
+    }
+    if (attrs & BIND_ATTR_NOATIME) {
+        /* atime の設定は排他的なため, 既存の設定を消去する必要がある. */
+        attr.attr_set |= MOUNT_ATTR_NOATIME;
+        attr.attr_clr |= MOUNT_ATTR__ATIME;
+    }
+
+    attr.propagation = to_propagation_flags(attrs);
+
+    return attr;
+}
+
+/**
+ *  バインドの属性を mount(2) のフラグに変換する.
+ *
+ *  @param  [in]    attrs   バインドの属性.
+ *  @return mount(2) のフラグが返る.
+ */
+static unsigned long to_mount_flags(unsigned int attrs)
+{
+    unsigned long flags = 0;
+
+    if (attrs & BIND_ATTR_RDONLY) {
+        flags |= MS_RDONLY;
+    }
+    if (attrs & BIND_ATTR_NOSUID) {
+        flags |= MS_NOSUID;
+    }
+    if (attrs & BIND_ATTR_NODEV) {
+        flags |= MS_NODEV;
+    }
+    if (attrs & BIND_ATTR_NOEXEC) {
+        flags |= MS_NOEXEC;
+    }
+    if (attrs & BIND_ATTR_NOATIME) {
+        flags |= MS_NOATIME;
+    }
+
+    return flags;
+}
+
+/**
+ *  ホストのマウントポイントを記録する.
+ */
+static int add_mount(void *arg, const char *mount_point, const char *fstype)
+{
+    struct bind_tree *self = (struct bind_tree *)arg;
+
+    (void)fstype;
+    if (self->num_mounts == self->mounts_capacity) {
+        size_t capacity = (self->mounts_capacity == 0) ? 64 : self->mounts_capacity * 2;
+        char **mounts = realloc(self->mounts, sizeof(*mounts) * capacity);
+        if (mounts == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->mounts = mounts;
+        self->mounts_capacity = capacity;
+    }
+    self->mounts[self->num_mounts] = strdup(mount_point);
+    if (self->mounts[self->num_mounts] == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    ++self->num_mounts;
+
+    return 0;
+}
+
+/**
+ *  ホストのマウントポイントを /proc/self/mountinfo から読み込む.
+ *
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int load_mounts(struct bind_tree *self)
+{
+    if (self->mounts_loaded) {
+        return 0;
+    }
+
+    int ret = for_each_mount(add_mount, self);
+    if (ret != 0) {
+        DEBUG("for_each_mount: %s", strerror(errno));
+        /* 読み込み途中のマウントポイントは破棄し, 次回に読み直す. */
+        for (size_t i = 0; i < self->num_mounts; ++i) {
+            free(self->mounts[i]);
+        }
+        self->num_mounts = 0;
+        return -1;
+    }
+    self->mounts_loaded = true;
+
+    return 0;
+}
+
+/**
+ *  バインド元の配下にマウントがあるかどうかを判定する.
+ *
+ *  判定できない場合は, 配下にマウントがあるものとして扱う.
+ */
+static bool has_submounts(struct bind_tree *self, const struct bind_entry *entry)
+{
+    if ((entry->real == NULL) || (load_mounts(self) != 0)) {
+        return true;
+    }
+    for (size_t i = 0; i < self->num_mounts; ++i) {
+        if (is_path_under(self->mounts[i], entry->real)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ *  マウントのフラグを取得する.
+ */
+static unsigned long mount_flags_of(const char *path)
+{
+    static const struct {
+        unsigned long st_flag;
+        unsigned long ms_flag;
+    } table[] = {
+        {ST_RDONLY, MS_RDONLY},
+        {ST_NOSUID, MS_NOSUID},
+        {ST_NODEV, MS_NODEV},
+        {ST_NOEXEC, MS_NOEXEC},
+        {ST_NOATIME, MS_NOATIME},
+        {ST_NODIRATIME, MS_NODIRATIME},
+        {ST_RELATIME, MS_RELATIME},
+    };
+    struct statvfs status;
+    unsigned long flags = 0;
+
+    if (statvfs(path, &status) == 0) {
+        for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i) {
+            flags |= (status.f_flag & table[i].st_flag) ? table[i].ms_flag : 0;
+        }
+    }
+
+    return flags;
+}
+
+/**
+ *  バインドを再マウントし, 属性を適用する.
+ *
+ *  再マウントはマウントのフラグを置き換えるため, @c origin のマウントの
+ *  フラグを引き継ぎ, 制限を緩めないようにする.
+ *
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int remount_entry(struct bind_tree *self, const char *path, const char *origin, unsigned long flags)
+{
+    const unsigned long atime = MS_NOATIME | MS_NODIRATIME | MS_RELATIME;
+    unsigned long inherited = mount_flags_of(origin);
+
+    if (flags & MS_NOATIME) {
+        inherited &= ~atime;
+    }
+    ++self->syscalls;
+    if (sysops_mount(NULL, path, NULL, MS_BIND | MS_REMOUNT | flags | inherited, NULL) != 0) {
+        DEBUG("mount: %s (remount %s)", strerror(errno), path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  切り離されたマウントツリーを用意する.
+ *
+ *  属性が無いバインドや, 配下にマウントが無いバインドは, 従来の API の方が
+ *  システムコールが少ないため用意しない.
+ *
+ *  @param  [in,out]    self    バインドツリーオブジェクト.
+ *  @param  [in,out]    entry   バインドの登録情報.
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int prepare_entry(struct bind_tree *self, struct bind_entry *entry)
+{
+    if ((to_mount_flags(entry->attrs) == 0) || !has_submounts(self, entry)) {
+        return 0;
+    }
+
+    ++self->syscalls;
+    entry->fd = sysops_open_tree(AT_FDCWD, entry->source,
+                              OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | AT_RECURSIVE);
+    if (entry->fd < 0) {
+        if (errno == ENOSYS) {
+            DEBUG("open_tree: %s, fallback to legacy mount API", strerror(errno));
+            self->legacy = true;
+            return 0;
+        }
+        DEBUG("open_tree: %s (%s)", strerror(errno), entry->source);
+        return -1;
+    }
+
+    struct mount_attr attr = to_mount_attr(entry->attrs);
+    if ((attr.attr_set != 0) || (attr.attr_clr != 0) || (attr.propagation != 0)) {
+        ++self->syscalls;
+        if (sysops_mount_setattr(entry->fd, "", AT_EMPTY_PATH | AT_RECURSIVE,
+                              &attr, sizeof(attr)) != 0) {
+            DEBUG("mount_setattr: %s (%s)", strerror(errno), entry->source);
+            sysops_close(entry->fd);
+            entry->fd = -1;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  新しいマウント API で jail にバインドを取り付ける.
+ *
+ *  @param  [in,out]    self    バインドツリーオブジェクト.
+ *  @param  [in,out]    entry   バインドの登録情報.
+ *  @param  [in]        path    バインド先のパス.
+ *  @param  [in]        keep    用意したマウントツリーを残すか.
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int attach_entry(struct bind_tree *self,
+                        struct bind_entry *entry,
+                        const char *path,
+                        bool keep)
+{
+    int fd = entry->fd;
+
+    if (fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    if (keep) {
+        /* 他の jail でも使用するため, 用意したツリーの複製を取り付ける. */
+        ++self->syscalls;
+        fd = sysops_open_tree(entry->fd, "",
+                           OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC | AT_RECURSIVE | AT_EMPTY_PATH);
+        if (fd < 0) {
+            DEBUG("open_tree: %s (%s)", strerror(errno), entry->source);
+            return -1;
+        }
+    }
+
+    ++self->syscalls;
+    int ret = sysops_move_mount(fd, "", AT_FDCWD, path, MOVE_MOUNT_F_EMPTY_PATH);
+    if (ret != 0) {
+        DEBUG("move_mount: %s (%s to %s)", strerror(errno), entry->source, path);
+    }
+    if (keep) {
+        sysops_close(fd);
+    } else {
+        sysops_close(entry->fd);
+        entry->fd = -1;
+    }
+
+    return ret;
+}
+
+/**
+ *  従来の API で jail にバインドを取り付ける.
+ *
+ *  @param  [in,out]    self    バインドツリーオブジェクト.
+ *  @param  [in]        entry   バインドの登録情報.
+ *  @param  [in]        path    バインド先のパス.
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int attach_entry_legacy(struct bind_tree *self,
+                               struct bind_entry *entry,
+                               const char *path)
+{
+    ++self->syscalls;
+    if (sysops_mount(entry->source, path, NULL, MS_BIND | MS_REC, NULL) != 0) {
+        DEBUG("mount: %s (%s to %s)", strerror(errno), entry->source, path);
+        return -1;
+    }
+
+    unsigned long flags = to_mount_flags(entry->attrs);
+    if (flags != 0) {
+        /* バインドマウントの属性は再マウントでのみ変更でき, 配下のマウントには及ばない. */
+        int ret = remount_entry(self, path, entry->source, flags);
+        if ((ret == 0) && (entry->real == NULL)) {
+            /* 配下のマウントを特定できないため, 属性が及ばないバインドは残さない. */
+            errno = ENOENT;
+            ret = -1;
+        } else if ((ret == 0) && has_submounts(self, entry)) {
+            size_t length = strlen(entry->real);
+            for (size_t i = 0; (i < self->num_mounts) && (ret == 0); ++i) {
+                const char *mount = self->mounts[i];
+                char sub[PATH_MAX];
+                if (!is_path_under(mount, entry->real)) {
+                    continue;
+                }
+                if (snprintf(sub, sizeof(sub), "%s%s", path,
+                             (length == 1) ? mount : mount + length) >= (int)sizeof(sub)) {
+
+                    errno = ENAMETOOLONG;
+                    ret = -1;
+                    break;
+                }
+                ret = remount_entry(self, sub, mount, flags);
+            }
+        }
+        if (ret != 0) {
+            sysops_umount2(path, MNT_DETACH);
+            return -1;
+        }
+    }
+
+    unsigned long propagation = to_propagation_flags(entry->attrs);
+    if (propagation != 0) {
+        /* 伝播の種別は, 他のフラグと同時には変更できない. */
+        ++self->syscalls;
+        if (sysops_mount(NULL, path, NULL, MS_REC | propagation, NULL) != 0) {
+            DEBUG("mount: %s (propagation %s)", strerror(errno), path);
+            sysops_umount2(path, MNT_DETACH);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    空の @ref BIND_TREE オブジェクトを確保および初期化する.
+ *
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+BIND_TREE bind_tree_init(void)
+{
+    struct bind_tree *self = malloc(sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    *self = BIND_TREE_INITIALIZER;
+
+    return (BIND_TREE)self;
+}
+
+/**
+ *  @details    @c tree を解放する.
+ *              用意した切り離されたマウントツリーも解放される.
+ *
+ *  @param      [in,out]    tree    バインドツリーオブジェクト.
+ */
+void bind_tree_release(BIND_TREE tree)
+{
+    struct bind_tree *self = (struct bind_tree *)tree;
+
+    if (self != NULL) {
+        for (size_t i = 0; i < self->count; ++i) {
+            if (self->entries[i].fd >= 0) {
+                sysops_close(self->entries[i].fd);
+            }
+            free(self->entries[i].source);
+            free(self->entries[i].target);
+            free(self->entries[i].real);
+        }
+        for (size_t i = 0; i < self->num_mounts; ++i) {
+            free(self->mounts[i]);
+        }
+        free(self->mounts);
+        free(self->entries);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c source のバインドを登録する.
+ *              配下にマウントがあるバインドに属性を適用する場合は,
+ *              配下のマウントを含めて複製し, @c attrs を一括して適用した
+ *              切り離されたマウントツリーを用意する.
+ *
+ *  @param      [in,out]    tree    バインドツリーオブジェクト.
+ *  @param      [in]        source  バインド元のパス.
+ *  @param      [in]        target  jail 内のバインド先のパス.
+ *  @param      [in]        attrs   バインドの属性.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int bind_tree_add(BIND_TREE tree, const char *source, const char *target, unsigned int attrs)
+{
+    struct bind_tree *self = (struct bind_tree *)tree;
+
+    if ((self == NULL) || (source == NULL) || (target == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (self->count == self->capacity) {
+        size_t capacity = (self->capacity == 0) ? 16 : self->capacity * 2;
+        struct bind_entry *entries = realloc(self->entries, sizeof(*entries) * capacity);
+        if (entries == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->entries = entries;
+        self->capacity = capacity;
+    }
+
+    struct bind_entry *entry = &self->entries[self->count];
+    entry->source = strdup(source);
+    entry->target = strdup(target);
+    entry->real = realpath(source, NULL);
+    entry->attrs = attrs;
+    entry->fd = -1;
+    if ((entry->source == NULL) || (entry->target == NULL)) {
+        free(entry->source);
+        free(entry->target);
+        free(entry->real);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if (!self->legacy && (prepare_entry(self, entry) != 0)) {
+        free(entry->source);
+        free(entry->target);
+        free(entry->real);
+        return -1;
+    }
+    ++self->count;
+
+    return 0;
+}
+
+/**
+ *  @details    用意したバインドを, 登録順に @c root 配下へ取り付ける.
+ *              バインド先は作成済みである必要がある.
+ *
+ *  @param      [in,out]    tree        バインドツリーオブジェクト.
+ *  @param      [in]        root        jail のパス.
+ *  @param      [in]        keep        用意したマウントツリーを残すか.
+ *                                      true の場合は, 同じ @c tree を
+ *                                      他の jail にも取り付けられる.
+ *  @param      [in]        callback    取り付けたバインドを通知する関数. (NULL 可)
+ *  @param      [in]        arg         @c callback に渡す引数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    取り付けに失敗した場合は, 以降のバインドを取り付けない.
+ *  @warning    スレッドセーフではない.
+ */
+int bind_tree_attach(BIND_TREE tree,
+                     const char *root,
+                     bool keep,
+                     bind_tree_callback callback,
+                     void *arg)
+{
+    struct bind_tree *self = (struct bind_tree *)tree;
+
+    if ((self == NULL) || (root == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i < self->count; ++i) {
+        struct bind_entry *entry = &self->entries[i];
+        char path[PATH_MAX];
+
+        if (snprintf(path, sizeof(path), "%s%s", root, entry->target) >= (int)sizeof(path)) {
+            DEBUG("bind: %s (%s%s)", strerror(ENAMETOOLONG), root, entry->target);
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        DEBUG("mount: %s to %s (%#x)", entry->source, path, entry->attrs);
+
+        int ret;
+        if (entry->fd < 0) {
+            ret = attach_entry_legacy(self, entry, path);
+        } else {
+            ret = attach_entry(self, entry, path, keep);
+        }
+        if (ret != 0) {
+            return -1;
+        }
+        if (callback != NULL) {
+            callback(arg, path);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c tree に登録されたバインドの数を返す.
+ *
+ *  @param      [in]    tree    バインドツリーオブジェクト.
+ *  @return     登録されたバインドの数が返る.
+ */
+size_t bind_tree_count(BIND_TREE tree)
+{
+    struct bind_tree *self = (struct bind_tree *)tree;
+
+    return (self != NULL) ? self->count : 0;
+}
+
+/**
+ *  @details    @c tree の処理で発行したマウント関連のシステムコールの数を返す.
+ *
+ *  @param      [in]    tree    バインドツリーオブジェクト.
+ *  @return     発行したシステムコールの数が返る.
+ */
+size_t bind_tree_syscalls(BIND_TREE tree)
+{
+    struct bind_tree *self = (struct bind_tree *)tree;
+
+    return (self != NULL) ? self->syscalls : 0;
+}
@@ -0,0 +1,130 @@
+/** @file       bindtree.h
+ *  @brief      新しいマウント API によるバインドマウントを提供する.
+ *
+ *  バインド元を切り離されたマウントツリーとして一度だけ複製し,
+ *  マウント属性を適用した上で, 各 jail に取り付ける.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_BINDTREE_H__
+#define __ALCATRAZ_BINDTREE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** @defgroup cat_bindtree Bind tree
+ *  新しいマウント API によるバインドマウントを提供するモジュール.
+ *  @{
+ */
+
+/**
+ *  バインドの属性: 読み込み専用.
+ */
+#define BIND_ATTR_RDONLY (1 << 0)
+
+/**
+ *  バインドの属性: set-user-ID / set-group-ID を無視する.
+ */
+#define BIND_ATTR_NOSUID (1 << 1)
+
+/**
+ *  バインドの属性: デバイスファイルへのアクセスを禁止する.
+ */
+#define BIND_ATTR_NODEV (1 << 2)
+
+/**
+ *  バインドの属性: プログラムの実行を禁止する.
+ */
+#define BIND_ATTR_NOEXEC (1 << 3)
+
+/**
+ *  バインドの属性: アクセス時刻を更新しない.
+ */
+#define BIND_ATTR_NOATIME (1 << 4)
+
+/**
+ *  バインドの属性: マウントイベントを伝播しない.
+ */
+#define BIND_ATTR_PRIVATE (1 << 5)
+
+/**
+ *  バインドの属性: バインド元からのマウントイベントのみを受け取る.
+ */
+#define BIND_ATTR_SLAVE (1 << 6)
+
+/**
+ *  バインドの属性: マウントイベントを相互に伝播する.
+ */
+#define BIND_ATTR_SHARED (1 << 7)
+
+/**
+ *  バインドの属性: マウントイベントを伝播せず, 更にバインドされることも禁止する.
+ */
+#define BIND_ATTR_UNBINDABLE (1 << 8)
+
+/**
+ *  バインドの属性のうち, 伝播の種別を表すもの.
+ */
+#define BIND_ATTR_PROPAGATION \
+    (BIND_ATTR_PRIVATE | BIND_ATTR_SLAVE | BIND_ATTR_SHARED | BIND_ATTR_UNBINDABLE)
+
+/**
+ *  バインドツリー型.
+ */
+typedef struct {} *BIND_TREE;
+
+/**
+ *  取り付けたバインドを通知する関数の型.
+ */
+typedef void (*bind_tree_callback)(void *arg, const char *path);
+
+/**
+ *  バインドツリーオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          BIND_TREE tree = bind_tree_init();
+ *          bind_tree_add(tree, "/usr/lib", "/usr/lib", BIND_ATTR_RDONLY);
+ *          bind_tree_add(tree, "/tmp", "/tmp", BIND_ATTR_NOSUID | BIND_ATTR_NODEV);
+ *          bind_tree_attach(tree, "/tmp/chroot-XXXXXX", false, NULL, NULL);
+ *          bind_tree_release(tree);
+ *          @endcode
+ */
+BIND_TREE bind_tree_init(void);
+
+/**
+ *  バインドツリーオブジェクトを解放する.
+ */
+void bind_tree_release(BIND_TREE tree);
+
+/**
+ *  バインドを切り離されたマウントツリーとして用意する.
+ */
+int bind_tree_add(BIND_TREE tree, const char *source, const char *target, unsigned int attrs);
+
+/**
+ *  用意したバインドを jail に取り付ける.
+ */
+int bind_tree_attach(BIND_TREE tree,
+                     const char *root,
+                     bool keep,
+                     bind_tree_callback callback,
+                     void *arg);
+
+/**
+ *  用意したバインドの数を取得する.
+ */
+size_t bind_tree_count(BIND_TREE tree);
+
+/**
+ *  発行したシステムコールの数を取得する.
+ */
+size_t bind_tree_syscalls(BIND_TREE tree);
+
+/** @} */
+
+#endif /* __ALCATRAZ_BINDTREE_H__ */
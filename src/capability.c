@@ -0,0 +1,397 @@
+/** @file       capability.c
+ *  @brief      capability の名前解決と適用を提供する.
+ *
+ *  名称は "CAP_" を除いた部分の FNV-1a ハッシュの上位 7 ビットで引く.
+ *  種とテーブルは, CAP_CHOWN から CAP_CHECKPOINT_RESTORE までの名称が
+ *  衝突しないよう事前に求めたもの (完全ハッシュ) で, 名称の比較は
+ *  1 回で済む.
+ *
+ *  プランは, 現在の bounding set と ambient set を /proc/self/status から
+ *  一度に読み, 次の操作のうち必要なもののみを行う.
+ *  1. 残さない capability が ambient set にあれば, 空にする.
+ *  2. bounding set にある, 残さない capability を落とす.
+ *  3. inheritable set を, 残す capability のうち permitted set にあるものにする.
+ *  4. ambient set に無い, 残す capability を加える.
+ *  5. securebits を設定する.
+ *  bounding set と ambient set は 1 つずつしか変更できないため, 2 と 4 は
+ *  capability 毎に prctl(2) を発行する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for syscall */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/capability.h>
+
+#include "capability.h"
+#include "hash.h"
+#include "debug.h"
+
+/**
+ *  名称のハッシュの種.
+ */
+#define CAPABILITY_HASH_SEED UINT64_C(230)
+
+/**
+ *  名称のハッシュのうち, テーブルの添字に使用するビット数.
+ */
+#define CAPABILITY_HASH_BITS (7)
+
+/**
+ *  capability の名称. (番号順)
+ */
+static const char * const capability_names[CAPABILITY_LAST + 1] = {
+    "CAP_CHOWN",
+    "CAP_DAC_OVERRIDE",
+    "CAP_DAC_READ_SEARCH",
+    "CAP_FOWNER",
+    "CAP_FSETID",
+    "CAP_KILL",
+    "CAP_SETGID",
+    "CAP_SETUID",
+    "CAP_SETPCAP",
+    "CAP_LINUX_IMMUTABLE",
+    "CAP_NET_BIND_SERVICE",
+    "CAP_NET_BROADCAST",
+    "CAP_NET_ADMIN",
+    "CAP_NET_RAW",
+    "CAP_IPC_LOCK",
+    "CAP_IPC_OWNER",
+    "CAP_SYS_MODULE",
+    "CAP_SYS_RAWIO",
+    "CAP_SYS_CHROOT",
+    "CAP_SYS_PTRACE",
+    "CAP_SYS_PACCT",
+    "CAP_SYS_ADMIN",
+    "CAP_SYS_BOOT",
+    "CAP_SYS_NICE",
+    "CAP_SYS_RESOURCE",
+    "CAP_SYS_TIME",
+    "CAP_SYS_TTY_CONFIG",
+    "CAP_MKNOD",
+    "CAP_LEASE",
+    "CAP_AUDIT_WRITE",
+    "CAP_AUDIT_CONTROL",
+    "CAP_SETFCAP",
+    "CAP_MAC_OVERRIDE",
+    "CAP_MAC_ADMIN",
+    "CAP_SYSLOG",
+    "CAP_WAKE_ALARM",
+    "CAP_BLOCK_SUSPEND",
+    "CAP_AUDIT_READ",
+    "CAP_PERFMON",
+    "CAP_BPF",
+    "CAP_CHECKPOINT_RESTORE",
+};
+
+/**
+ *  名称のハッシュから capability の番号を引くテーブル. (-1 は該当無し)
+ */
+static const int8_t capability_slots[1 << CAPABILITY_HASH_BITS] = {
+    -1, -1, -1, -1, -1, 31, -1, 26, 32,  4, 33, 25, -1, -1, -1, -1,
+    -1, 20, -1, -1, 16, -1,  5, -1,  2, -1, -1, 36, -1, -1, 30, -1,
+    -1, 40, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 28, -1, -1, -1,
+     6, -1, -1, -1, -1, 19, 34, -1, -1, 27, -1, -1,  1, -1, -1, -1,
+    -1,  0, -1, 11, -1, 18, 39, 24, 22, -1,  9, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1,  8, 35, -1, -1, -1, 17, 10, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, 23, -1, -1, -1, 14, -1, -1, -1, 13, -1,
+    12, -1, -1,  7, -1, 38, -1,  3, 37, -1, -1, 29, 15, -1, 21, -1,
+};
+
+/**
+ *  @details    capability の名称 ("CAP_" で始まる) から番号を取得する.
+ *
+ *  @param      [in]    name    capability の名称.
+ *  @return     成功時は, capability の番号が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int capability_from_name(const char *name)
+{
+    if ((name == NULL) || (strncmp(name, "CAP_", 4) != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t hash = fnv1a64_update(CAPABILITY_HASH_SEED, name + 4, strlen(name + 4));
+    int capability = capability_slots[hash >> (64 - CAPABILITY_HASH_BITS)];
+    if ((capability < 0) || (strcmp(capability_names[capability], name) != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return capability;
+}
+
+/**
+ *  @details    capability の番号から名称を取得する.
+ *
+ *  @param      [in]    capability  capability の番号.
+ *  @return     成功時は, 名称が返る.
+ *              失敗時は, NULL が返る.
+ */
+const char *capability_name(int capability)
+{
+    if ((capability < 0) || (capability > CAPABILITY_LAST)) {
+        return NULL;
+    }
+
+    return capability_names[capability];
+}
+
+/**
+ *  /proc/self/status から bounding set と ambient set を読み込む.
+ *
+ *  @return 成功時は, 発行したシステムコールの数が返る.
+ *          失敗時は, -1 が返る.
+ */
+static int read_capability_sets(uint64_t *bounding, uint64_t *ambient)
+{
+    char buf[4096];
+
+    int fd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (/proc/self/status)", strerror(errno));
+        return -1;
+    }
+    /* 全体が一度で読めるため, 終端は確認しない. */
+    ssize_t length = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (length <= 0) {
+        return -1;
+    }
+    buf[length] = '\0';
+
+    char *bnd = strstr(buf, "\nCapBnd:");
+    char *amb = strstr(buf, "\nCapAmb:");
+    if ((bnd == NULL) || (amb == NULL)
+        || (sscanf(bnd, "\nCapBnd: %" SCNx64, bounding) != 1)
+        || (sscanf(amb, "\nCapAmb: %" SCNx64, ambient) != 1)) {
+
+        return -1;
+    }
+
+    return 3;
+}
+
+/**
+ *  prctl(2) で bounding set と ambient set を 1 つずつ確認する.
+ *
+ *  /proc がマウントされていない場合に使用する.
+ *
+ *  @return 発行したシステムコールの数が返る.
+ */
+static int probe_capability_sets(uint64_t *bounding, uint64_t *ambient)
+{
+    int syscalls = 0;
+
+    *bounding = 0;
+    *ambient = 0;
+    for (int i = 0; i < 64; ++i) {
+        int ret = prctl(PR_CAPBSET_READ, i);
+        ++syscalls;
+        if (ret < 0) {
+            break;
+        }
+        if (ret > 0) {
+            *bounding |= UINT64_C(1) << i;
+        }
+        ++syscalls;
+        if (prctl(PR_CAP_AMBIENT, PR_CAP_AMBIENT_IS_SET, i, 0, 0) > 0) {
+            *ambient |= UINT64_C(1) << i;
+        }
+    }
+
+    return syscalls;
+}
+
+/**
+ *  @details    残す capability と現在の状態から, capability のプランを作成する.
+ *              プランは fork(2) した子プロセスでも使用できる.
+ *
+ *  @param      [out]   plan    capability のプラン.
+ *  @param      [in]    keep    残す capability のビットマスク.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int capability_plan_init(struct capability_plan *plan, uint64_t keep)
+{
+    struct __user_cap_header_struct hdr = {
+        .version = _LINUX_CAPABILITY_VERSION_3,
+        .pid = 0
+    };
+    struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3] = {{0}};
+
+    if (plan == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    memset(plan, 0, sizeof(*plan));
+
+    if (syscall(SYS_capget, &hdr, data) != 0) {
+        DEBUG("capget: %s", strerror(errno));
+        return -1;
+    }
+    plan->prepared = 1;
+    plan->permitted = ((uint64_t)data[1].permitted << 32) | data[0].permitted;
+    plan->effective = ((uint64_t)data[1].effective << 32) | data[0].effective;
+    uint64_t inheritable = ((uint64_t)data[1].inheritable << 32) | data[0].inheritable;
+
+    uint64_t bounding;
+    uint64_t ambient;
+    int syscalls = read_capability_sets(&bounding, &ambient);
+    if (syscalls < 0) {
+        syscalls = probe_capability_sets(&bounding, &ambient);
+    }
+    plan->prepared += syscalls;
+
+    /* ambient set に加えるには, permitted set と inheritable set の両方に必要. */
+    plan->keep = keep;
+    plan->drops = bounding & ~keep;
+    plan->inheritable = keep & plan->permitted;
+    plan->set_inheritable = (plan->inheritable != inheritable);
+    plan->clear_ambient = ((ambient & ~keep) != 0);
+    plan->raises = plan->inheritable & ~(plan->clear_ambient ? 0 : ambient);
+    DEBUG("capability: bounding %016" PRIx64 ", ambient %016" PRIx64 ", keep %016" PRIx64,
+          bounding, ambient, keep);
+
+    return 0;
+}
+
+/**
+ *  @details    capability のプランを呼び出したスレッドに適用する.
+ *              bounding set から落とせない capability と, ambient set に
+ *              加えられない capability は読み飛ばす.
+ *
+ *  @param      [in]    plan        capability のプラン.
+ *  @param      [in]    securebits  設定する securebits.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int capability_plan_apply(const struct capability_plan *plan, unsigned long securebits)
+{
+    if (plan == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan->clear_ambient
+        && (prctl(PR_CAP_AMBIENT, PR_CAP_AMBIENT_CLEAR_ALL, 0, 0, 0) != 0)) {
+
+        DEBUG("prctl: %s (ambient)", strerror(errno));
+        return -1;
+    }
+    for (int i = 0; i < 64; ++i) {
+        if ((plan->drops & (UINT64_C(1) << i)) && (prctl(PR_CAPBSET_DROP, i) != 0)) {
+            DEBUG("prctl: %s (%d)", strerror(errno), i);
+        }
+    }
+    if (plan->set_inheritable) {
+        struct __user_cap_header_struct hdr = {
+            .version = _LINUX_CAPABILITY_VERSION_3,
+            .pid = 0
+        };
+        struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3] = {
+            {
+                .effective = (uint32_t)plan->effective,
+                .permitted = (uint32_t)plan->permitted,
+                .inheritable = (uint32_t)plan->inheritable,
+            },
+            {
+                .effective = (uint32_t)(plan->effective >> 32),
+                .permitted = (uint32_t)(plan->permitted >> 32),
+                .inheritable = (uint32_t)(plan->inheritable >> 32),
+            },
+        };
+        if (syscall(SYS_capset, &hdr, data) != 0) {
+            DEBUG("capset: %s", strerror(errno));
+            return -1;
+        }
+    }
+    for (int i = 0; i < 64; ++i) {
+        if ((plan->raises & (UINT64_C(1) << i))
+            && (prctl(PR_CAP_AMBIENT, PR_CAP_AMBIENT_RAISE, i, 0, 0) != 0)) {
+
+            DEBUG("prctl: %s (%d)", strerror(errno), i);
+        }
+    }
+
+    if (prctl(PR_SET_SECUREBITS, securebits) != 0) {
+        DEBUG("prctl: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    適用済みのプランで残した capability 以外を, 呼び出したスレッドの
+ *              permitted set と effective set からも落とす.
+ *              execve(2) を経ずにプログラムを起動し続けるプロセスが,
+ *              起動するプログラムと同じ capability のみを持つために使用する.
+ *              ambient set は permitted set と inheritable set の両方に
+ *              ある capability のため, 維持される.
+ *
+ *  @param      [in]    plan    capability_plan_apply() で適用したプラン.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int capability_plan_confine(const struct capability_plan *plan)
+{
+    if (plan == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct __user_cap_header_struct hdr = {
+        .version = _LINUX_CAPABILITY_VERSION_3,
+        .pid = 0
+    };
+    struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3] = {
+        {
+            .effective = (uint32_t)plan->inheritable,
+            .permitted = (uint32_t)plan->inheritable,
+            .inheritable = (uint32_t)plan->inheritable,
+        },
+        {
+            .effective = (uint32_t)(plan->inheritable >> 32),
+            .permitted = (uint32_t)(plan->inheritable >> 32),
+            .inheritable = (uint32_t)(plan->inheritable >> 32),
+        },
+    };
+    if (syscall(SYS_capset, &hdr, data) != 0) {
+        DEBUG("capset: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    capability のプランの適用に発行するシステムコールの数を取得する.
+ *              プランの作成に発行したものは含まない.
+ *
+ *  @param      [in]    plan    capability のプラン.
+ *  @return     システムコールの数が返る.
+ */
+unsigned int capability_plan_syscalls(const struct capability_plan *plan)
+{
+    return (plan->clear_ambient ? 1 : 0)
+         + (unsigned int)__builtin_popcountll(plan->drops)
+         + (plan->set_inheritable ? 1 : 0)
+         + (unsigned int)__builtin_popcountll(plan->raises)
+         + 1;
+}
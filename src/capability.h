@@ -0,0 +1,87 @@
+/** @file       capability.h
+ *  @brief      capability の名前解決と適用を提供する.
+ *
+ *  残す capability の集合と現在の状態から, 必要な操作のみを事前に求めた
+ *  プランを作成し, 閉じ込めるプログラムの起動時に適用する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_CAPABILITY_H__
+#define __ALCATRAZ_CAPABILITY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @defgroup cat_capability Capability
+ *  capability を解決し, 適用するモジュール.
+ *  @{
+ */
+
+/**
+ *  名前を解決できる capability の最大値.
+ */
+#define CAPABILITY_LAST (40)
+
+/**
+ *  capability のプラン.
+ */
+struct capability_plan {
+    uint64_t keep;          /**< 残す capability. */
+    uint64_t drops;         /**< bounding set から落とす capability. */
+    uint64_t raises;        /**< ambient set に加える capability. */
+    uint64_t permitted;     /**< 適用前の permitted set. */
+    uint64_t effective;     /**< 適用前の effective set. */
+    uint64_t inheritable;   /**< 適用後の inheritable set. */
+    bool set_inheritable;   /**< inheritable set を変更するか. */
+    bool clear_ambient;     /**< ambient set を空にするか. */
+    unsigned int prepared;  /**< プランの作成に発行したシステムコールの数. */
+};
+
+/**
+ *  capability の名称から番号を取得する.
+ */
+int capability_from_name(const char *name);
+
+/**
+ *  capability の番号から名称を取得する.
+ */
+const char *capability_name(int capability);
+
+/**
+ *  capability のプランを作成する.
+ *
+ *  @par    使用例
+ *          @code
+ *          struct capability_plan plan;
+ *          capability_plan_init(&plan, UINT64_C(1) << CAP_NET_RAW);
+ *          if (fork() == 0) {
+ *              capability_plan_apply(&plan, SECBIT_KEEP_CAPS);
+ *              execvp(argv[0], argv);
+ *          }
+ *          @endcode
+ */
+int capability_plan_init(struct capability_plan *plan, uint64_t keep);
+
+/**
+ *  capability のプランを呼び出したスレッドに適用する.
+ */
+int capability_plan_apply(const struct capability_plan *plan, unsigned long securebits);
+
+/**
+ *  適用済みのプランで残した capability 以外を, 呼び出したスレッドの
+ *  permitted set と effective set からも落とす.
+ */
+int capability_plan_confine(const struct capability_plan *plan);
+
+/**
+ *  capability のプランの適用に発行するシステムコールの数を取得する.
+ */
+unsigned int capability_plan_syscalls(const struct capability_plan *plan);
+
+/** @} */
+
+#endif /* __ALCATRAZ_CAPABILITY_H__ */
@@ -1,7 +1,7 @@
 /** @file       collections.c
  *  @brief      コレクションに関する機能を提供する.
  *
- *  コレクション (リスト, スタック, キュー, ツリー) を提供する.
+ *  コレクション (リスト, スタック, キュー, マップ, ツリー) を提供する.
  *
  *  @author     t-kenji <protect.2501@gmail.com>
  *  @date       2018-03-18 新規作成.
@@ -9,6 +9,9 @@
  *
  *  This code is licensed under the MIT License.
  */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for strdup */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -16,6 +19,7 @@
 #include <errno.h>
 
 #include "collections.h"
+#include "hash.h"
 #include "debug.h"
 
 /**
@@ -851,6 +855,370 @@ ITER set_iter(SET set)
     return list_iter((LIST)set);
 }
 
+/**
+ *  マップのスロット構造体.
+ */
+struct map_slot {
+    char *key;     /**< キー. (NULL の場合は空きスロット) */
+    uint64_t hash; /**< キーのハッシュ値. */
+};
+
+/**
+ *  マップ管理構造体.
+ *
+ *  オープンアドレス法 (線形探索) で管理する.
+ *  スロット数は容量の 2 倍以上の 2 のべき乗とし, 探索が長くならないようにする.
+ */
+struct map {
+    struct map_slot *slots; /**< スロットの配列. */
+    char *payloads;         /**< データ部の配列. (スロットと同じ並び) */
+    size_t mask;            /**< スロット数 - 1. */
+    size_t payload_bytes;   /**< データ部のサイズ. */
+    size_t capacity;        /**< 格納できる要素の数. */
+    size_t count;           /**< 格納している要素の数. */
+};
+
+/**
+ *  スロットのデータ部を取得する.
+ *
+ *  @param  [in]    self    マップオブジェクト.
+ *  @param  [in]    index   スロットの位置.
+ *  @return データ部のポインタが返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static inline void *map_payload(struct map *self, size_t index)
+{
+    return self->payloads + (self->payload_bytes * index);
+}
+
+/**
+ *  キーに対応するスロットを探す.
+ *
+ *  @param  [in]    self    マップオブジェクト.
+ *  @param  [in]    key     キー.
+ *  @param  [in]    hash    キーのハッシュ値.
+ *  @return キーが格納されたスロット, もしくは格納すべき空きスロットの位置が返る.
+ *  @pre    @c self の非 NULL は呼び出し側で保証すること.
+ */
+static size_t map_lookup(struct map *self, const char *key, uint64_t hash)
+{
+    size_t index = hash & self->mask;
+
+    while (self->slots[index].key != NULL) {
+        if ((self->slots[index].hash == hash)
+            && (strcmp(self->slots[index].key, key) == 0)) {
+            break;
+        }
+        index = (index + 1) & self->mask;
+    }
+
+    return index;
+}
+
+/**
+ *  @details    空で, 指定の容量を備えた, @ref MAP オブジェクトを確保
+ *              および初期化する.
+ *
+ *  @param      [in]    payload_bytes   データ部のサイズ.
+ *  @param      [in]    capacity        マップの容量.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+MAP map_init(size_t payload_bytes, size_t capacity)
+{
+    struct map *self;
+    size_t slots;
+
+    if ((payload_bytes == 0) || (capacity == 0)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    for (slots = 2; slots < capacity * 2; slots <<= 1) {
+        continue;
+    }
+
+    self = malloc(sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->slots = calloc(slots, sizeof(*self->slots));
+    self->payloads = calloc(slots, payload_bytes);
+    if ((self->slots == NULL) || (self->payloads == NULL)) {
+        free(self->payloads);
+        free(self->slots);
+        free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->mask = slots - 1;
+    self->payload_bytes = payload_bytes;
+    self->capacity = capacity;
+    self->count = 0;
+
+    return (MAP)self;
+}
+
+/**
+ *  @details    @c map を解放する.
+ *              @c map は @ref map_init の戻り値である必要がある.
+ *
+ *  @param      [in,out]    map マップオブジェクト.
+ *  @warning    スレッドセーフではない.
+ */
+void map_release(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self != NULL) {
+        map_clear(map);
+        free(self->payloads);
+        free(self->slots);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c map を空の状態にする.
+ *
+ *  @param      [in,out]    map マップオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int map_clear(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i <= self->mask; ++i) {
+        free(self->slots[i].key);
+        self->slots[i].key = NULL;
+    }
+    self->count = 0;
+
+    return 0;
+}
+
+/**
+ *  @details    @c map に要素を追加する.
+ *              @c key がすでに追加されている場合はデータ部を上書きする.
+ *
+ *  @param      [in,out]    map     マップオブジェクト.
+ *  @param      [in]        key     キー.
+ *  @param      [in]        payload マップに追加するデータ.
+ *  @return     成功時は, 追加したマップ上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *map_put(MAP map, const char *key, void *payload)
+{
+    struct map *self = (struct map *)map;
+
+    if ((self == NULL) || (key == NULL) || (payload == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint64_t hash = fnv1a64_string(key);
+    size_t index = map_lookup(self, key, hash);
+    if (self->slots[index].key == NULL) {
+        if (self->count >= self->capacity) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        self->slots[index].key = strdup(key);
+        if (self->slots[index].key == NULL) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        self->slots[index].hash = hash;
+        ++self->count;
+    }
+    memcpy(map_payload(self, index), payload, self->payload_bytes);
+
+    return map_payload(self, index);
+}
+
+/**
+ *  @details    @c map から @c key に対応する要素を取得する.
+ *
+ *  @param      [in]    map マップオブジェクト.
+ *  @param      [in]    key キー.
+ *  @return     成功時は, マップ上のデータ部のポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+void *map_get(MAP map, const char *key)
+{
+    struct map *self = (struct map *)map;
+
+    if ((self == NULL) || (key == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    size_t index = map_lookup(self, key, fnv1a64_string(key));
+    if (self->slots[index].key == NULL) {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    return map_payload(self, index);
+}
+
+/**
+ *  @details    @c map から @c key に対応する要素を削除する.
+ *
+ *  @param      [in,out]    map マップオブジェクト.
+ *  @param      [in]        key キー.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int map_remove(MAP map, const char *key)
+{
+    struct map *self = (struct map *)map;
+
+    if ((self == NULL) || (key == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t index = map_lookup(self, key, fnv1a64_string(key));
+    if (self->slots[index].key == NULL) {
+        errno = ENOENT;
+        return -1;
+    }
+    free(self->slots[index].key);
+    self->slots[index].key = NULL;
+    --self->count;
+
+    /* 探索が途切れないように, 後続の要素を詰める. */
+    for (size_t next = (index + 1) & self->mask;
+         self->slots[next].key != NULL;
+         next = (next + 1) & self->mask) {
+
+        size_t home = self->slots[next].hash & self->mask;
+        if (((next - home) & self->mask) >= ((next - index) & self->mask)) {
+            self->slots[index] = self->slots[next];
+            memcpy(map_payload(self, index), map_payload(self, next), self->payload_bytes);
+            self->slots[next].key = NULL;
+            index = next;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c map に追加されている要素の数を返す.
+ *
+ *  @param      [in]    map マップオブジェクト.
+ *  @return     成功時は, @c map に追加されている要素の数を返す.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+ssize_t map_count(MAP map)
+{
+    struct map *self = (struct map *)map;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return self->count;
+}
+
+/**
+ *  @details    @c map の容量を @c capacity に変更し, 要素を再配置する.
+ *              要素のデータ部の位置は変わるため, 取得済みのポインタは無効になる.
+ *
+ *  @param      [in,out]    map         マップオブジェクト.
+ *  @param      [in]        capacity    マップの容量. (要素の数以上)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない.
+ */
+int map_resize(MAP map, size_t capacity)
+{
+    struct map *self = (struct map *)map;
+    size_t slots;
+
+    if ((self == NULL) || (capacity == 0) || (capacity < self->count)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (slots = 2; slots < capacity * 2; slots <<= 1) {
+        continue;
+    }
+
+    struct map resized = {
+        .slots = calloc(slots, sizeof(*self->slots)),
+        .payloads = calloc(slots, self->payload_bytes),
+        .mask = slots - 1,
+        .payload_bytes = self->payload_bytes,
+        .capacity = capacity,
+        .count = self->count,
+    };
+    if ((resized.slots == NULL) || (resized.payloads == NULL)) {
+        free(resized.payloads);
+        free(resized.slots);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    /* キーは複製せずに移し替える. */
+    for (size_t i = 0; i <= self->mask; ++i) {
+        if (self->slots[i].key != NULL) {
+            size_t index = map_lookup(&resized, self->slots[i].key, self->slots[i].hash);
+            resized.slots[index] = self->slots[i];
+            memcpy(map_payload(&resized, index), map_payload(self, i), self->payload_bytes);
+        }
+    }
+    free(self->payloads);
+    free(self->slots);
+    *self = resized;
+
+    return 0;
+}
+
+/**
+ *  @details    @c map の全要素に @c func を適用する.
+ *              適用する順序は不定である.
+ *
+ *  @param      [in,out]    map     マップオブジェクト.
+ *  @param      [in]        func    適用する関数.
+ *  @param      [in]        arg     @c func に渡す引数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    @c func の中で @c map に要素を追加, 削除してはならない.
+ */
+int map_foreach(MAP map, void (*func)(const char *key, void *payload, void *arg), void *arg)
+{
+    struct map *self = (struct map *)map;
+
+    if ((self == NULL) || (func == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (size_t i = 0; i <= self->mask; ++i) {
+        if (self->slots[i].key != NULL) {
+            func(self->slots[i].key, map_payload(self, i), arg);
+        }
+    }
+
+    return 0;
+}
+
 /**
  *  N-ary ツリーノード構造体.
  */
@@ -1,7 +1,7 @@
 /** @file       collections.h
  *  @brief      コレクションに関する機能を提供する.
  *
- *  コレクション (リスト, スタック, キュー, ツリー) を提供する.
+ *  コレクション (リスト, スタック, キュー, マップ, ツリー) を提供する.
  *
  *  @author     t-kenji <protect.2501@gmail.com>
  *  @date       2018-03-18 新規作成.
@@ -300,6 +300,77 @@ ITER set_iter(SET set);
 
 /** @} */
 
+/** @addtogroup cat_map Map 構造
+ *  文字列をキーとする Map 構造を提供するモジュール.
+ *  @ingroup cat_collections
+ *  @{
+ */
+
+/**
+ *  汎用マップ型.
+ */
+typedef struct {} *MAP;
+
+/**
+ *  マップオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          MAP map = map_init(sizeof(int), 100);
+ *          int data;
+ *          data = 1;
+ *          map_put(map, "one", &data);
+ *          data = 2;
+ *          map_put(map, "two", &data);
+ *          int *p = map_get(map, "one");
+ *          // do something.
+ *          map_release(map);
+ *          @endcode
+ */
+MAP map_init(size_t payload_bytes, size_t capacity);
+
+/**
+ *  マップオブジェクトを解放する.
+ */
+void map_release(MAP map);
+
+/**
+ *  マップ要素をすべて消去する.
+ */
+int map_clear(MAP map);
+
+/**
+ *  要素をマップに追加する.
+ */
+void *map_put(MAP map, const char *key, void *payload);
+
+/**
+ *  マップから要素を取得する.
+ */
+void *map_get(MAP map, const char *key);
+
+/**
+ *  要素をマップから削除する.
+ */
+int map_remove(MAP map, const char *key);
+
+/**
+ *  マップの要素の数を取得する.
+ */
+ssize_t map_count(MAP map);
+
+/**
+ *  マップの容量を変更する.
+ */
+int map_resize(MAP map, size_t capacity);
+
+/**
+ *  マップの全要素に関数を適用する.
+ */
+int map_foreach(MAP map, void (*func)(const char *key, void *payload, void *arg), void *arg);
+
+/** @} */
+
 /** @addtogroup cat_tree N-ary Tree 構造
  *  N-ary Tree 構造を提供するモジュール.
  *  @ingroup cat_collections
@@ -0,0 +1,1575 @@
+/** @file       config.c
+ *  @brief      設定ファイルの読み込みを提供する.
+ *
+ *  json 形式の設定ファイルを検証し, 文字列で指定されたデバイスファイルや
+ *  バインド, capability 名称などを解決した上でプランに変換する.
+ *  jail の構築時には設定ファイルを参照せず, プランのみを使用する.
+ *
+ *  設定ファイルは DOM を構築せず, スキーマに従って先頭から走査しながら
+ *  プランに変換する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for strdup, PATH_MAX */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "plan.h"
+#include "bindtree.h"
+#include "archive.h"
+#include "capability.h"
+#include "debug.h"
+
+/**
+ *  バインドの属性を文字列から数値に変換する.
+ *
+ *  @param  [in]    name    属性名称.
+ *  @return 変換出来る場合は属性の数値が返り,
+ *          失敗の場合は 0 が返る.
+ */
+static unsigned int bind_attr_to_int(const char *name)
+{
+    static const struct {
+        const char *name;
+        unsigned int value;
+    } conv_table[] = {
+        {"nosuid", BIND_ATTR_NOSUID},
+        {"nodev", BIND_ATTR_NODEV},
+        {"noexec", BIND_ATTR_NOEXEC},
+        {"noatime", BIND_ATTR_NOATIME},
+    };
+
+    for (size_t i = 0; i < lengthof(conv_table); ++i) {
+        if (strcmp(conv_table[i].name, name) == 0) {
+            return conv_table[i].value;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  バインドの伝播の種別を文字列から数値に変換する.
+ *
+ *  @param  [in]    name    伝播の種別の名称.
+ *  @return 変換出来る場合は属性の数値が返り,
+ *          失敗の場合は 0 が返る.
+ */
+static unsigned int bind_propagation_to_int(const char *name)
+{
+    static const struct {
+        const char *name;
+        unsigned int value;
+    } conv_table[] = {
+        {"private", BIND_ATTR_PRIVATE},
+        {"slave", BIND_ATTR_SLAVE},
+        {"shared", BIND_ATTR_SHARED},
+        {"unbindable", BIND_ATTR_UNBINDABLE},
+    };
+
+    for (size_t i = 0; i < lengthof(conv_table); ++i) {
+        if (strcmp(conv_table[i].name, name) == 0) {
+            return conv_table[i].value;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  デバイスファイルの指定をプランに追加する.
+ */
+static int compile_device_inner(PLAN_BUILDER builder,
+                                const char *pathname,
+                                const char *type,
+                                int major,
+                                int minor,
+                                const char *perm)
+{
+    if ((pathname == NULL) || (type == NULL) || (major == 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    mode_t mode = (perm != NULL) ? strtol(perm, NULL, 8) : 0666;
+    if (strncmp(type, "char", 5) == 0) {
+        mode |= S_IFCHR;
+    } else {
+        mode |= S_IFREG;
+    }
+
+    return plan_builder_add_device(builder, pathname, mode, major, minor);
+}
+
+/**
+ *  文字列で指定したデバイスファイルをプランに追加する.
+ *
+ *  "<pathname>,<type>,<major>,<minor>,<perm>" の形式とする.
+ */
+static int compile_device_by_string(PLAN_BUILDER builder, const char *data)
+{
+    char *options = strdup(data);
+    if (options == NULL) {
+        return -1;
+    }
+    char *pathname = options;
+
+    char *perm = strrchr(options, ',');
+    if (perm != NULL) {
+        *perm = '\0';
+        ++perm;
+    }
+
+    char *minor = strrchr(options, ',');
+    if (minor != NULL) {
+        *minor = '\0';
+        ++minor;
+    }
+
+    char *major = strrchr(options, ',');
+    if (major != NULL) {
+        *major = '\0';
+        ++major;
+    }
+
+    char *type = strrchr(options, ',');
+    if (type != NULL) {
+        *type = '\0';
+        ++type;
+    }
+
+    int ret = compile_device_inner(builder,
+                                   pathname,
+                                   type,
+                                   (major != NULL) ? atoi(major) : 0,
+                                   (minor != NULL) ? atoi(minor) : 0,
+                                   perm);
+    free(options);
+
+    return ret;
+}
+
+/**
+ *  バインドの指定をプランに追加する.
+ */
+static int compile_bind_inner(PLAN_BUILDER builder,
+                              const char *source,
+                              const char *target,
+                              const char *mode,
+                              unsigned int attrs)
+{
+    const char *mode_ = (mode) ?: "ro";
+
+    if (strncmp(mode_, "ro", 3) == 0) {
+        attrs |= BIND_ATTR_RDONLY;
+    }
+
+    return plan_builder_add_bind(builder, source, target, attrs);
+}
+
+/**
+ *  文字列で指定したバインドをプランに追加する.
+ *
+ *  "<source>[:<target>][,<mode>]" の形式とする.
+ */
+static int compile_bind_by_string(PLAN_BUILDER builder, const char *data)
+{
+    char *options = strdup(data);
+    if (options == NULL) {
+        return -1;
+    }
+
+    char *mode = strrchr(options, ',');
+    if (mode != NULL) {
+        *mode = '\0';
+        ++mode;
+    }
+
+    char *target = strchr(options, ':');
+    if (target != NULL) {
+        *target = '\0';
+        ++target;
+    }
+
+    int ret = compile_bind_inner(builder, options, target, mode, 0);
+    free(options);
+
+    return ret;
+}
+
+/**
+ *  入れ子の深さの上限.
+ */
+#define CONFIG_DEPTH_MAX (32)
+
+/**
+ *  必須のセクション: filesystem.
+ */
+#define CONFIG_SEEN_FILESYSTEM (1 << 0)
+
+/**
+ *  必須のセクション: stdio.
+ */
+#define CONFIG_SEEN_STDIO (1 << 1)
+
+/**
+ *  必須のセクション: keep_capability.
+ */
+#define CONFIG_SEEN_CAPABILITY (1 << 2)
+
+/**
+ *  伸長可能な文字列バッファ.
+ */
+struct config_buffer {
+    char *data;      /**< NUL 終端した文字列. */
+    size_t length;   /**< 文字列長. */
+    size_t capacity; /**< 確保したサイズ. */
+};
+
+/**
+ *  設定ファイルの解析器.
+ *
+ *  設定ファイルを mmap したまま先頭から一度だけ走査し, 値はその場で
+ *  プラン構築器に渡す. 文字列は解析中の 1 つ分のみを保持するため,
+ *  使用するメモリは設定ファイルのサイズではなく要素の数に比例する.
+ */
+struct config_parser {
+    const char *begin;          /**< 設定ファイルの先頭. */
+    const char *cur;            /**< 解析中の位置. */
+    const char *end;            /**< 設定ファイルの終端. */
+    int depth;                  /**< 入れ子の深さ. */
+    struct config_buffer key;   /**< 解析中のメンバ名. */
+    struct config_buffer value; /**< 解析中の文字列値. */
+    PLAN_BUILDER builder;       /**< プラン構築器. */
+};
+
+/**
+ *  オブジェクトのメンバを処理する関数の型.
+ *
+ *  メンバの値を読み進めること.
+ */
+typedef int (*config_member)(struct config_parser *self, const char *key, void *arg);
+
+/**
+ *  配列の要素を処理する関数の型.
+ *
+ *  要素の値を読み進めること.
+ */
+typedef int (*config_element)(struct config_parser *self, size_t index, void *arg);
+
+/**
+ *  オブジェクトで指定したデバイスファイル.
+ */
+struct config_device {
+    char pathname[PATH_MAX]; /**< jail 内のパス. */
+    char type[16];           /**< 種別. */
+    char perm[16];           /**< パーミッション. */
+    long long major;         /**< メジャー番号. */
+    long long minor;         /**< マイナー番号. */
+    unsigned int seen;       /**< 指定されたメンバ. */
+};
+
+/**
+ *  オブジェクトで指定したバインド.
+ */
+struct config_bind {
+    char source[PATH_MAX]; /**< バインド元のパス. */
+    char target[PATH_MAX]; /**< jail 内のバインド先のパス. */
+    char mode[16];         /**< モード. */
+    unsigned int attrs;    /**< バインドの属性. */
+    unsigned int seen;     /**< 指定されたメンバ. */
+};
+
+/**
+ *  jail プールの指定.
+ */
+struct config_pool {
+    char path[PATH_MAX]; /**< プールを格納するディレクトリ. */
+    long long size;      /**< 保持する jail の数. */
+    long long low_water; /**< 補充を開始する jail の数. */
+    unsigned int seen;   /**< 指定されたメンバ. */
+};
+
+/**
+ *  rootfs のイメージの指定.
+ */
+struct config_image {
+    char source[PATH_MAX]; /**< イメージファイルのパス. */
+    char type[16];         /**< ファイルシステムの種別. */
+    char path[PATH_MAX];   /**< マウントを管理するディレクトリ. */
+};
+
+/**
+ *  rootfs に展開するアーカイブの指定.
+ */
+struct config_archive {
+    char source[PATH_MAX]; /**< アーカイブのパス. */
+    long long workers;     /**< ファイルを書き込むスレッドの数. */
+};
+
+/**
+ *  jail 自体の指定.
+ */
+struct config_jail {
+    uint32_t flags;       /**< プランの属性. */
+    long long size;       /**< tmpfs のサイズ (MiB). */
+    long long nr_inodes;  /**< tmpfs の inode の最大数. */
+    uint32_t huge;        /**< tmpfs の透過的ヒュージページの割り当て. */
+    char mpol[64];        /**< tmpfs の NUMA メモリポリシー. */
+    unsigned int seen;    /**< 指定された tmpfs のメンバ. */
+};
+
+/**
+ *  プリウォームの指定.
+ */
+struct config_prewarm {
+    uint32_t flags;       /**< プリウォームの方法. */
+    long long lock_limit; /**< mlock する合計サイズの上限 (MiB). */
+};
+
+/**
+ *  解析エラーを記録する.
+ *
+ *  @param  [in]    self    解析器.
+ *  @param  [in]    what    エラーの内容.
+ *  @return 常に -1 が返り, errno に EINVAL が設定される.
+ */
+static int config_error(struct config_parser *self, const char *what)
+{
+    int line = 1;
+
+    for (const char *p = self->begin; p < self->cur; ++p) {
+        if (*p == '\n') {
+            ++line;
+        }
+    }
+    DEBUG("json error on line: %d: %s", line, what);
+    errno = EINVAL;
+
+    return -1;
+}
+
+/**
+ *  文字列バッファに 1 文字追加する.
+ */
+static int config_buffer_push(struct config_buffer *buf, char c)
+{
+    if (buf->length + 1 >= buf->capacity) {
+        size_t capacity = (buf->capacity > 0) ? buf->capacity * 2 : 256;
+        char *p = realloc(buf->data, capacity);
+        if (p == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        buf->data = p;
+        buf->capacity = capacity;
+    }
+    buf->data[buf->length++] = c;
+    buf->data[buf->length] = '\0';
+
+    return 0;
+}
+
+/**
+ *  空白を読み飛ばし, 次の文字を返す.
+ *
+ *  @return 次の文字が返る. 終端に達した場合は '\0' が返る.
+ */
+static char config_peek(struct config_parser *self)
+{
+    while ((self->cur < self->end)
+           && ((*self->cur == ' ') || (*self->cur == '\t')
+               || (*self->cur == '\n') || (*self->cur == '\r'))) {
+        ++self->cur;
+    }
+
+    return (self->cur < self->end) ? *self->cur : '\0';
+}
+
+/**
+ *  指定の文字であれば読み進める.
+ */
+static bool config_accept(struct config_parser *self, char c)
+{
+    if (config_peek(self) == c) {
+        ++self->cur;
+        return true;
+    }
+    return false;
+}
+
+/**
+ *  \\uXXXX の 16 進数 4 桁を読む.
+ */
+static int config_parse_hex4(struct config_parser *self, unsigned int *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (self->cur >= self->end) {
+            return config_error(self, "invalid \\u escape");
+        }
+        char c = *self->cur++;
+        *value <<= 4;
+        if ((c >= '0') && (c <= '9')) {
+            *value |= c - '0';
+        } else if ((c >= 'a') && (c <= 'f')) {
+            *value |= c - 'a' + 10;
+        } else if ((c >= 'A') && (c <= 'F')) {
+            *value |= c - 'A' + 10;
+        } else {
+            return config_error(self, "invalid \\u escape");
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  コードポイントを UTF-8 で文字列バッファに追加する.
+ */
+static int config_buffer_push_utf8(struct config_buffer *buf, unsigned int cp)
+{
+    int ret;
+
+    if (cp < 0x80) {
+        ret = config_buffer_push(buf, cp);
+    } else if (cp < 0x800) {
+        ret = config_buffer_push(buf, 0xc0 | (cp >> 6))
+           || config_buffer_push(buf, 0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        ret = config_buffer_push(buf, 0xe0 | (cp >> 12))
+           || config_buffer_push(buf, 0x80 | ((cp >> 6) & 0x3f))
+           || config_buffer_push(buf, 0x80 | (cp & 0x3f));
+    } else {
+        ret = config_buffer_push(buf, 0xf0 | (cp >> 18))
+           || config_buffer_push(buf, 0x80 | ((cp >> 12) & 0x3f))
+           || config_buffer_push(buf, 0x80 | ((cp >> 6) & 0x3f))
+           || config_buffer_push(buf, 0x80 | (cp & 0x3f));
+    }
+
+    return (ret == 0) ? 0 : -1;
+}
+
+/**
+ *  文字列を読み, エスケープを解除して @c buf に格納する.
+ */
+static int config_parse_string(struct config_parser *self, struct config_buffer *buf)
+{
+    if (config_peek(self) != '"') {
+        return config_error(self, "string expected");
+    }
+    ++self->cur;
+
+    buf->length = 0;
+    if (config_buffer_push(buf, '\0') != 0) {
+        return -1;
+    }
+    buf->length = 0;
+
+    while (self->cur < self->end) {
+        char c = *self->cur++;
+        int ret;
+
+        if (c == '"') {
+            return 0;
+        } else if (c == '\\') {
+            if (self->cur >= self->end) {
+                break;
+            }
+            unsigned int cp;
+            switch (*self->cur++) {
+            case '"':  ret = config_buffer_push(buf, '"');  break;
+            case '\\': ret = config_buffer_push(buf, '\\'); break;
+            case '/':  ret = config_buffer_push(buf, '/');  break;
+            case 'b':  ret = config_buffer_push(buf, '\b'); break;
+            case 'f':  ret = config_buffer_push(buf, '\f'); break;
+            case 'n':  ret = config_buffer_push(buf, '\n'); break;
+            case 'r':  ret = config_buffer_push(buf, '\r'); break;
+            case 't':  ret = config_buffer_push(buf, '\t'); break;
+            case 'u':
+                if (config_parse_hex4(self, &cp) != 0) {
+                    return -1;
+                }
+                if ((cp >= 0xd800) && (cp < 0xdc00)) {
+                    unsigned int low;
+                    if ((self->end - self->cur < 2)
+                        || (self->cur[0] != '\\') || (self->cur[1] != 'u')) {
+                        return config_error(self, "invalid surrogate pair");
+                    }
+                    self->cur += 2;
+                    if (config_parse_hex4(self, &low) != 0) {
+                        return -1;
+                    }
+                    if ((low < 0xdc00) || (low >= 0xe000)) {
+                        return config_error(self, "invalid surrogate pair");
+                    }
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                } else if ((cp >= 0xdc00) && (cp < 0xe000)) {
+                    return config_error(self, "invalid surrogate pair");
+                }
+                if (cp == 0) {
+                    return config_error(self, "\\u0000 is not allowed");
+                }
+                ret = config_buffer_push_utf8(buf, cp);
+                break;
+            default:
+                return config_error(self, "invalid escape");
+            }
+            if (ret != 0) {
+                return -1;
+            }
+        } else if ((unsigned char)c < 0x20) {
+            return config_error(self, "control character in string");
+        } else if (config_buffer_push(buf, c) != 0) {
+            return -1;
+        }
+    }
+
+    return config_error(self, "unterminated string");
+}
+
+/**
+ *  文字列を読み, 固定長の領域に格納する.
+ */
+static int config_parse_string_to(struct config_parser *self, char *dst, size_t size)
+{
+    if (config_parse_string(self, &self->value) != 0) {
+        return -1;
+    }
+    if (self->value.length >= size) {
+        return config_error(self, "string too long");
+    }
+    memcpy(dst, self->value.data, self->value.length + 1);
+
+    return 0;
+}
+
+/**
+ *  整数を読む.
+ */
+static int config_parse_integer(struct config_parser *self, long long *value)
+{
+    bool negative = config_accept(self, '-');
+    long long v = 0;
+    const char *start = self->cur;
+
+    while ((self->cur < self->end) && (*self->cur >= '0') && (*self->cur <= '9')) {
+        if (v > (LLONG_MAX - (*self->cur - '0')) / 10) {
+            return config_error(self, "integer overflow");
+        }
+        v = v * 10 + (*self->cur++ - '0');
+    }
+    if ((self->cur == start)
+        || ((self->cur < self->end)
+            && ((*self->cur == '.') || (*self->cur == 'e') || (*self->cur == 'E')))) {
+
+        return config_error(self, "integer expected");
+    }
+    *value = negative ? -v : v;
+
+    return 0;
+}
+
+/**
+ *  リテラル (true, false, null) を読む.
+ */
+static bool config_accept_literal(struct config_parser *self, const char *literal)
+{
+    size_t length = strlen(literal);
+
+    config_peek(self);
+    if (((size_t)(self->end - self->cur) >= length)
+        && (memcmp(self->cur, literal, length) == 0)) {
+
+        self->cur += length;
+        return true;
+    }
+    return false;
+}
+
+/**
+ *  真偽値を読む.
+ */
+static int config_parse_boolean(struct config_parser *self, bool *value)
+{
+    if (config_accept_literal(self, "true")) {
+        *value = true;
+    } else if (config_accept_literal(self, "false")) {
+        *value = false;
+    } else {
+        return config_error(self, "boolean expected");
+    }
+
+    return 0;
+}
+
+/**
+ *  オブジェクトを読み, メンバ毎に @c member を呼び出す.
+ */
+static int config_parse_object(struct config_parser *self, config_member member, void *arg)
+{
+    if (!config_accept(self, '{')) {
+        return config_error(self, "object expected");
+    }
+    if (++self->depth > CONFIG_DEPTH_MAX) {
+        return config_error(self, "too deep nesting");
+    }
+
+    if (!config_accept(self, '}')) {
+        do {
+            if (config_parse_string(self, &self->key) != 0) {
+                return -1;
+            }
+            if (!config_accept(self, ':')) {
+                return config_error(self, "':' expected");
+            }
+            if (member(self, self->key.data, arg) != 0) {
+                return -1;
+            }
+        } while (config_accept(self, ','));
+        if (!config_accept(self, '}')) {
+            return config_error(self, "',' or '}' expected");
+        }
+    }
+    --self->depth;
+
+    return 0;
+}
+
+/**
+ *  配列を読み, 要素毎に @c element を呼び出す.
+ */
+static int config_parse_array(struct config_parser *self, config_element element, void *arg)
+{
+    if (!config_accept(self, '[')) {
+        return config_error(self, "array expected");
+    }
+    if (++self->depth > CONFIG_DEPTH_MAX) {
+        return config_error(self, "too deep nesting");
+    }
+
+    if (!config_accept(self, ']')) {
+        size_t index = 0;
+        do {
+            if (element(self, index++, arg) != 0) {
+                return -1;
+            }
+        } while (config_accept(self, ','));
+        if (!config_accept(self, ']')) {
+            return config_error(self, "',' or ']' expected");
+        }
+    }
+    --self->depth;
+
+    return 0;
+}
+
+static int config_skip_value(struct config_parser *self);
+
+static int config_skip_member(struct config_parser *self, const char *key, void *arg)
+{
+    (void)key;
+    (void)arg;
+    return config_skip_value(self);
+}
+
+static int config_skip_element(struct config_parser *self, size_t index, void *arg)
+{
+    (void)index;
+    (void)arg;
+    return config_skip_value(self);
+}
+
+/**
+ *  値を読み飛ばす.
+ */
+static int config_skip_value(struct config_parser *self)
+{
+    switch (config_peek(self)) {
+    case '{':
+        return config_parse_object(self, config_skip_member, NULL);
+    case '[':
+        return config_parse_array(self, config_skip_element, NULL);
+    case '"':
+        return config_parse_string(self, &self->value);
+    case 't':
+    case 'f':
+    case 'n':
+        if (config_accept_literal(self, "true")
+            || config_accept_literal(self, "false")
+            || config_accept_literal(self, "null")) {
+            return 0;
+        }
+        break;
+    default:
+        if (self->cur < self->end) {
+            const char *start = self->cur;
+            while ((self->cur < self->end) && (strchr("+-.eE0123456789", *self->cur) != NULL)) {
+                ++self->cur;
+            }
+            if (self->cur > start) {
+                return 0;
+            }
+        }
+        break;
+    }
+
+    return config_error(self, "value expected");
+}
+
+static int compile_kernelfs_member(struct config_parser *self, const char *key, void *arg)
+{
+    static const struct {
+        const char *name;
+        uint32_t flag;
+    } conv_table[] = {
+        {"devtmpfs", PLAN_KERNELFS_DEVTMPFS},
+        {"procfs", PLAN_KERNELFS_PROCFS},
+        {"sysfs", PLAN_KERNELFS_SYSFS},
+    };
+    uint32_t *flags = (uint32_t *)arg;
+
+    for (size_t i = 0; i < lengthof(conv_table); ++i) {
+        if (strcmp(conv_table[i].name, key) == 0) {
+            char c = config_peek(self);
+            if ((c != 't') && (c != 'f')) {
+                DEBUG("json: %s is not a boolean", key);
+                return config_skip_value(self);
+            }
+            bool enable;
+            if (config_parse_boolean(self, &enable) != 0) {
+                return -1;
+            }
+            if (enable) {
+                *flags |= conv_table[i].flag;
+            }
+            return 0;
+        }
+    }
+
+    return config_skip_value(self);
+}
+
+static int compile_kernelfs(struct config_parser *self)
+{
+    uint32_t flags = 0;
+
+    if (config_parse_object(self, compile_kernelfs_member, &flags) != 0) {
+        DEBUG("json: 'filesystem' is not an object");
+        return -1;
+    }
+
+    return plan_builder_set_flags(self->builder, flags);
+}
+
+static int compile_directory_element(struct config_parser *self, size_t index, void *arg)
+{
+    (void)arg;
+
+    if ((config_parse_string(self, &self->value) != 0)
+        || (plan_builder_add_directory(self->builder, self->value.data) != 0)) {
+
+        DEBUG("json: failed to 'directory' %zu", index + 1);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int compile_device_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_device *device = (struct config_device *)arg;
+
+    if (strcmp(key, "pathname") == 0) {
+        device->seen |= 1 << 0;
+        return config_parse_string_to(self, device->pathname, sizeof(device->pathname));
+    } else if (strcmp(key, "type") == 0) {
+        device->seen |= 1 << 1;
+        return config_parse_string_to(self, device->type, sizeof(device->type));
+    } else if (strcmp(key, "major") == 0) {
+        device->seen |= 1 << 2;
+        return config_parse_integer(self, &device->major);
+    } else if (strcmp(key, "minor") == 0) {
+        device->seen |= 1 << 3;
+        return config_parse_integer(self, &device->minor);
+    } else if (strcmp(key, "perm") == 0) {
+        device->seen |= 1 << 4;
+        return config_parse_string_to(self, device->perm, sizeof(device->perm));
+    }
+
+    return config_skip_value(self);
+}
+
+static int compile_device_element(struct config_parser *self, size_t index, void *arg)
+{
+    int ret = -1;
+
+    (void)arg;
+
+    if (config_peek(self) == '"') {
+        if (config_parse_string(self, &self->value) == 0) {
+            ret = compile_device_by_string(self->builder, self->value.data);
+        }
+    } else {
+        struct config_device device = {.seen = 0};
+        if (config_parse_object(self, compile_device_member, &device) == 0) {
+            if (device.seen == 0x1f) {
+                ret = compile_device_inner(self->builder,
+                                           device.pathname,
+                                           device.type,
+                                           device.major,
+                                           device.minor,
+                                           device.perm);
+            } else {
+                DEBUG("json: device needs pathname, type, major, minor and perm");
+            }
+        }
+    }
+    if (ret != 0) {
+        DEBUG("json: failed to 'device' %zu", index + 1);
+    }
+
+    return ret;
+}
+
+static int compile_bind_attr_element(struct config_parser *self, size_t index, void *arg)
+{
+    unsigned int *attrs = (unsigned int *)arg;
+
+    if (config_parse_string(self, &self->value) != 0) {
+        return -1;
+    }
+    unsigned int value = bind_attr_to_int(self->value.data);
+    if (value == 0) {
+        DEBUG("json: attr %zu is not an attribute name", index + 1);
+        errno = EINVAL;
+        return -1;
+    }
+    *attrs |= value;
+
+    return 0;
+}
+
+static int compile_bind_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_bind *bind = (struct config_bind *)arg;
+
+    if (strcmp(key, "source") == 0) {
+        bind->seen |= 1 << 0;
+        return config_parse_string_to(self, bind->source, sizeof(bind->source));
+    } else if (strcmp(key, "target") == 0) {
+        bind->seen |= 1 << 1;
+        return config_parse_string_to(self, bind->target, sizeof(bind->target));
+    } else if (strcmp(key, "mode") == 0) {
+        bind->seen |= 1 << 2;
+        return config_parse_string_to(self, bind->mode, sizeof(bind->mode));
+    } else if (strcmp(key, "attr") == 0) {
+        return config_parse_array(self, compile_bind_attr_element, &bind->attrs);
+    } else if (strcmp(key, "propagation") == 0) {
+        if (config_parse_string(self, &self->value) != 0) {
+            return -1;
+        }
+        unsigned int value = bind_propagation_to_int(self->value.data);
+        if (value == 0) {
+            DEBUG("json: '%s' is not a propagation type", self->value.data);
+            errno = EINVAL;
+            return -1;
+        }
+        bind->attrs = (bind->attrs & ~BIND_ATTR_PROPAGATION) | value;
+        return 0;
+    }
+
+    return config_skip_value(self);
+}
+
+static int compile_bind_element(struct config_parser *self, size_t index, void *arg)
+{
+    int ret = -1;
+
+    (void)arg;
+
+    if (config_peek(self) == '"') {
+        if (config_parse_string(self, &self->value) == 0) {
+            ret = compile_bind_by_string(self->builder, self->value.data);
+        }
+    } else {
+        struct config_bind bind = {.attrs = 0, .seen = 0};
+        if (config_parse_object(self, compile_bind_member, &bind) == 0) {
+            if (bind.seen == 0x7) {
+                ret = compile_bind_inner(self->builder, bind.source, bind.target, bind.mode, bind.attrs);
+            } else {
+                DEBUG("json: bind needs source, target and mode");
+            }
+        }
+    }
+    if (ret != 0) {
+        DEBUG("json: failed to 'bind' %zu", index + 1);
+    }
+
+    return ret;
+}
+
+/**
+ *  標準入出力の指定をプランに追加する.
+ *
+ *  "fifo://<path>" の形式とし, FIFO のパスのみをプランに格納する.
+ */
+static int compile_stdio(struct config_parser *self)
+{
+    static const char fifo[] = "fifo://";
+
+    if (config_parse_string(self, &self->value) != 0) {
+        DEBUG("json: 'stdio' is not an string");
+        return -1;
+    }
+
+    const char *uri = self->value.data;
+    if (strstr(uri, "://") == NULL) {
+        DEBUG("json: 'stdio' is wrong format");
+        return -1;
+    }
+    if (strncmp(uri, fifo, sizeof(fifo) - 1) != 0) {
+        DEBUG("json: 'stdio' is unknown protocol");
+        return -1;
+    }
+
+    return plan_builder_set_stdio(self->builder, uri + sizeof(fifo) - 1);
+}
+
+static int compile_capability_element(struct config_parser *self, size_t index, void *arg)
+{
+    uint64_t *keep_caps_bits = (uint64_t *)arg;
+
+    if (config_parse_string(self, &self->value) != 0) {
+        DEBUG("json: keep_capability %zu is not a string", index + 1);
+        return -1;
+    }
+
+    int capability = capability_from_name(self->value.data);
+    if (capability < 0) {
+        DEBUG("json: %s is not a capability name", self->value.data);
+        errno = EINVAL;
+        return -1;
+    }
+    *keep_caps_bits |= UINT64_C(1) << capability;
+
+    return 0;
+}
+
+static int compile_capability(struct config_parser *self)
+{
+    uint64_t keep_caps_bits = 0;
+
+    if (config_parse_array(self, compile_capability_element, &keep_caps_bits) != 0) {
+        return -1;
+    }
+
+    return plan_builder_set_capabilities(self->builder, keep_caps_bits);
+}
+
+static int compile_environment_member(struct config_parser *self, const char *key, void *arg)
+{
+    (void)arg;
+
+    if (config_parse_string(self, &self->value) != 0) {
+        DEBUG("json: environment %s is not an string", key);
+        return -1;
+    }
+
+    return plan_builder_add_environment(self->builder, key, self->value.data);
+}
+
+static int compile_pool_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_pool *pool = (struct config_pool *)arg;
+
+    if (strcmp(key, "path") == 0) {
+        return config_parse_string_to(self, pool->path, sizeof(pool->path));
+    } else if (strcmp(key, "size") == 0) {
+        pool->seen |= 1 << 0;
+        return config_parse_integer(self, &pool->size);
+    } else if (strcmp(key, "low_water") == 0) {
+        pool->seen |= 1 << 1;
+        return config_parse_integer(self, &pool->low_water);
+    }
+
+    return config_skip_value(self);
+}
+
+static int compile_pool(struct config_parser *self)
+{
+    struct config_pool pool = {
+        .path = POOL_DIR_DEF,
+        .seen = 0,
+    };
+
+    if (config_parse_object(self, compile_pool_member, &pool) != 0) {
+        DEBUG("json: failed to 'pool'");
+        return -1;
+    }
+    if (!(pool.seen & (1 << 0)) || (pool.size <= 0) || (pool.size > UINT32_MAX)) {
+        DEBUG("json: %s is not a positive integer", "size");
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(pool.seen & (1 << 1))) {
+        pool.low_water = pool.size / 2;
+    }
+
+    return plan_builder_set_pool(self->builder, pool.path, pool.size, pool.low_water);
+}
+
+static int compile_template_member(struct config_parser *self, const char *key, void *arg)
+{
+    if (strcmp(key, "path") == 0) {
+        return config_parse_string_to(self, (char *)arg, PATH_MAX);
+    }
+
+    return config_skip_value(self);
+}
+
+static int compile_template(struct config_parser *self)
+{
+    char path[PATH_MAX] = TEMPLATE_DIR_DEF;
+
+    if (config_parse_object(self, compile_template_member, path) != 0) {
+        DEBUG("json: failed to 'template'");
+        return -1;
+    }
+
+    return plan_builder_set_template(self->builder, path);
+}
+
+static int compile_image_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_image *image = (struct config_image *)arg;
+
+    if (strcmp(key, "source") == 0) {
+        return config_parse_string_to(self, image->source, sizeof(image->source));
+    } else if (strcmp(key, "type") == 0) {
+        return config_parse_string_to(self, image->type, sizeof(image->type));
+    } else if (strcmp(key, "path") == 0) {
+        return config_parse_string_to(self, image->path, sizeof(image->path));
+    }
+
+    return config_skip_value(self);
+}
+
+/**
+ *  rootfs のイメージの構成をプランに追加する.
+ *
+ *  種別を省略した場合は, マウント時にイメージの先頭から判定する.
+ */
+static int compile_image(struct config_parser *self)
+{
+    struct config_image image = {
+        .source = {0},
+        .type = {0},
+        .path = IMAGE_DIR_DEF,
+    };
+
+    if (config_parse_object(self, compile_image_member, &image) != 0) {
+        DEBUG("json: failed to 'image'");
+        return -1;
+    }
+    if (image.source[0] != '/') {
+        DEBUG("json: %s is not an absolute path", "source");
+        errno = EINVAL;
+        return -1;
+    }
+    if ((image.type[0] != '\0')
+        && (strcmp(image.type, "squashfs") != 0)
+        && (strcmp(image.type, "erofs") != 0)) {
+
+        DEBUG("json: '%s' is not an image type", image.type);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return plan_builder_set_image(self->builder, image.source, image.type, image.path);
+}
+
+static int compile_archive_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_archive *archive = (struct config_archive *)arg;
+
+    if (strcmp(key, "source") == 0) {
+        return config_parse_string_to(self, archive->source, sizeof(archive->source));
+    } else if (strcmp(key, "workers") == 0) {
+        return config_parse_integer(self, &archive->workers);
+    }
+
+    return config_skip_value(self);
+}
+
+/**
+ *  rootfs に展開するアーカイブの構成をプランに追加する.
+ *
+ *  圧縮形式は, 展開時にアーカイブの先頭から判定する.
+ */
+static int compile_archive(struct config_parser *self)
+{
+    struct config_archive archive = {
+        .source = {0},
+        .workers = 0,
+    };
+
+    if (config_parse_object(self, compile_archive_member, &archive) != 0) {
+        DEBUG("json: failed to 'archive'");
+        return -1;
+    }
+    if (archive.source[0] != '/') {
+        DEBUG("json: %s is not an absolute path", "source");
+        errno = EINVAL;
+        return -1;
+    }
+    if ((archive.workers < 0) || (archive.workers > ARCHIVE_WORKERS_MAX)) {
+        DEBUG("json: %s is out of range", "workers");
+        errno = EINVAL;
+        return -1;
+    }
+
+    return plan_builder_set_archive(self->builder, archive.source, (uint32_t)archive.workers);
+}
+
+static int compile_binary_element(struct config_parser *self, size_t index, void *arg)
+{
+    (void)arg;
+
+    if ((config_parse_string(self, &self->value) != 0)
+        || (self->value.data[0] != '/')
+        || (plan_builder_add_binary(self->builder, self->value.data) != 0)) {
+
+        DEBUG("json: failed to 'binaries' %zu", index + 1);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int compile_elf_member(struct config_parser *self, const char *key, void *arg)
+{
+    if (strcmp(key, "cache") == 0) {
+        return config_parse_string_to(self, (char *)arg, PATH_MAX);
+    } else if (strcmp(key, "binaries") == 0) {
+        return config_parse_array(self, compile_binary_element, NULL);
+    }
+
+    return config_skip_value(self);
+}
+
+/**
+ *  ELF の依存ファイルの解決をプランに追加する.
+ */
+static int compile_elf(struct config_parser *self)
+{
+    char path[PATH_MAX] = ELF_CACHE_DIR_DEF;
+
+    if (config_parse_object(self, compile_elf_member, path) != 0) {
+        DEBUG("json: failed to 'elf'");
+        return -1;
+    }
+
+    return plan_builder_set_elf(self->builder, path);
+}
+
+static int compile_prewarm_element(struct config_parser *self, size_t index, void *arg)
+{
+    (void)arg;
+
+    if ((config_parse_string(self, &self->value) != 0)
+        || (self->value.data[0] != '/')
+        || (plan_builder_add_prewarm(self->builder, self->value.data) != 0)) {
+
+        DEBUG("json: failed to 'paths' %zu", index + 1);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int compile_prewarm_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_prewarm *prewarm = (struct config_prewarm *)arg;
+
+    if (strcmp(key, "paths") == 0) {
+        return config_parse_array(self, compile_prewarm_element, NULL);
+    } else if (strcmp(key, "method") == 0) {
+        if (config_parse_string(self, &self->value) != 0) {
+            return -1;
+        }
+        prewarm->flags &= ~(PLAN_PREWARM_FADVISE | PLAN_PREWARM_POPULATE);
+        if (strcmp(self->value.data, "fadvise") == 0) {
+            prewarm->flags |= PLAN_PREWARM_FADVISE;
+        } else if (strcmp(self->value.data, "populate") == 0) {
+            prewarm->flags |= PLAN_PREWARM_POPULATE;
+        } else if (strcmp(self->value.data, "readahead") != 0) {
+            DEBUG("json: '%s' is not a prewarm method", self->value.data);
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    } else if (strcmp(key, "mlock") == 0) {
+        bool enable;
+        if (config_parse_boolean(self, &enable) != 0) {
+            return -1;
+        }
+        prewarm->flags &= ~PLAN_PREWARM_LOCK;
+        if (enable) {
+            prewarm->flags |= PLAN_PREWARM_LOCK;
+        }
+        return 0;
+    } else if (strcmp(key, "mlock_limit") == 0) {
+        return config_parse_integer(self, &prewarm->lock_limit);
+    }
+
+    return config_skip_value(self);
+}
+
+/**
+ *  ページキャッシュのプリウォームをプランに追加する.
+ */
+static int compile_prewarm(struct config_parser *self)
+{
+    struct config_prewarm prewarm = {
+        .flags = 0,
+        .lock_limit = PREWARM_LOCK_LIMIT_DEF,
+    };
+
+    if (config_parse_object(self, compile_prewarm_member, &prewarm) != 0) {
+        DEBUG("json: failed to 'prewarm'");
+        return -1;
+    }
+    if ((prewarm.lock_limit < 0) || (prewarm.lock_limit > UINT32_MAX)) {
+        DEBUG("json: %s is out of range", "mlock_limit");
+        errno = EINVAL;
+        return -1;
+    }
+
+    return plan_builder_set_prewarm(self->builder, prewarm.flags, (uint32_t)prewarm.lock_limit);
+}
+
+/**
+ *  tmpfs の NUMA メモリポリシーの指定を検証する.
+ *
+ *  bind:<ノード>, interleave[:<ノード>], prefer:<ノード>, local を受け付ける.
+ */
+static bool config_valid_mpol(const char *mpol)
+{
+    const char *nodes = strchr(mpol, ':');
+    size_t length = (nodes != NULL) ? (size_t)(nodes - mpol) : strlen(mpol);
+    const char *charset = "0123456789,-";
+
+    if ((length == 5) && (strncmp(mpol, "local", length) == 0)) {
+        return nodes == NULL;
+    } else if ((length == 10) && (strncmp(mpol, "interleave", length) == 0)) {
+        if (nodes == NULL) {
+            return true;
+        }
+    } else if ((length == 6) && (strncmp(mpol, "prefer", length) == 0)) {
+        charset = "0123456789";
+    } else if ((length != 4) || (strncmp(mpol, "bind", length) != 0)) {
+        return false;
+    }
+
+    return (nodes != NULL) && (nodes[1] != '\0') && (strspn(nodes + 1, charset) == strlen(nodes + 1));
+}
+
+static int compile_jail_member(struct config_parser *self, const char *key, void *arg)
+{
+    struct config_jail *jail = (struct config_jail *)arg;
+
+    if (strcmp(key, "namespace") == 0) {
+        bool enable;
+        if (config_parse_boolean(self, &enable) != 0) {
+            return -1;
+        }
+        if (enable) {
+            jail->flags |= PLAN_MOUNT_NAMESPACE;
+        }
+        return 0;
+    } else if (strcmp(key, "ld_cache") == 0) {
+        bool enable;
+        if (config_parse_boolean(self, &enable) != 0) {
+            return -1;
+        }
+        if (enable) {
+            jail->flags |= PLAN_LD_CACHE;
+        }
+        return 0;
+    } else if (strcmp(key, "landlock") == 0) {
+        bool enable;
+        if (config_parse_boolean(self, &enable) != 0) {
+            return -1;
+        }
+        if (enable) {
+            jail->flags |= PLAN_LANDLOCK;
+        }
+        return 0;
+    } else if (strcmp(key, "propagation") == 0) {
+        if (config_parse_string(self, &self->value) != 0) {
+            return -1;
+        }
+        jail->flags &= ~(PLAN_JAIL_SLAVE | PLAN_JAIL_SHARED);
+        if (strcmp(self->value.data, "slave") == 0) {
+            jail->flags |= PLAN_JAIL_SLAVE;
+        } else if (strcmp(self->value.data, "shared") == 0) {
+            jail->flags |= PLAN_JAIL_SHARED;
+        } else if (strcmp(self->value.data, "private") != 0) {
+            DEBUG("json: '%s' is not a jail propagation type", self->value.data);
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    } else if (strcmp(key, "size") == 0) {
+        jail->seen |= 1 << 0;
+        if (config_parse_integer(self, &jail->size) != 0) {
+            return -1;
+        }
+        if ((jail->size <= 0) || (jail->size > UINT32_MAX)) {
+            DEBUG("json: %s is not a positive integer", key);
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    } else if (strcmp(key, "nr_inodes") == 0) {
+        jail->seen |= 1 << 1;
+        if (config_parse_integer(self, &jail->nr_inodes) != 0) {
+            return -1;
+        }
+        if ((jail->nr_inodes <= 0) || (jail->nr_inodes > UINT32_MAX)) {
+            DEBUG("json: %s is not a positive integer", key);
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    } else if (strcmp(key, "huge") == 0) {
+        jail->seen |= 1 << 2;
+        if (config_parse_string(self, &self->value) != 0) {
+            return -1;
+        }
+        if (strcmp(self->value.data, "within_size") == 0) {
+            jail->huge = PLAN_TMPFS_HUGE_WITHIN_SIZE;
+        } else if (strcmp(self->value.data, "always") == 0) {
+            jail->huge = PLAN_TMPFS_HUGE_ALWAYS;
+        } else if (strcmp(self->value.data, "never") == 0) {
+            jail->huge = 0;
+        } else {
+            DEBUG("json: '%s' is not a huge page policy", self->value.data);
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    } else if (strcmp(key, "mpol") == 0) {
+        jail->seen |= 1 << 3;
+        if (config_parse_string_to(self, jail->mpol, sizeof(jail->mpol)) != 0) {
+            return -1;
+        }
+        if (!config_valid_mpol(jail->mpol)) {
+            DEBUG("json: '%s' is not a memory policy", jail->mpol);
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    return config_skip_value(self);
+}
+
+/**
+ *  jail 自体の構成をプランに追加する.
+ *
+ *  tmpfs のメンバが無い場合は, tmpfs の構成を追加しない.
+ */
+static int compile_jail(struct config_parser *self)
+{
+    struct config_jail jail = {
+        .flags = 0,
+        .size = 0,
+        .nr_inodes = 0,
+        .huge = 0,
+        .mpol = {0},
+        .seen = 0,
+    };
+
+    if (config_parse_object(self, compile_jail_member, &jail) != 0) {
+        return -1;
+    }
+    if ((jail.seen != 0)
+        && (plan_builder_set_tmpfs(self->builder,
+                                   (uint32_t)jail.size,
+                                   (uint32_t)jail.nr_inodes,
+                                   jail.huge,
+                                   jail.mpol) != 0)) {
+
+        return -1;
+    }
+
+    return plan_builder_set_flags(self->builder, jail.flags);
+}
+
+static int compile_section(struct config_parser *self, config_element element)
+{
+    return config_parse_array(self, element, NULL);
+}
+
+/**
+ *  設定ファイルのトップレベルのメンバを処理する.
+ */
+static int compile_root_member(struct config_parser *self, const char *key, void *arg)
+{
+    unsigned int *seen = (unsigned int *)arg;
+    int ret;
+
+    if (strcmp(key, "filesystem") == 0) {
+        *seen |= CONFIG_SEEN_FILESYSTEM;
+        ret = compile_kernelfs(self);
+    } else if (strcmp(key, "directory") == 0) {
+        ret = compile_section(self, compile_directory_element);
+    } else if (strcmp(key, "device") == 0) {
+        ret = compile_section(self, compile_device_element);
+    } else if (strcmp(key, "bind") == 0) {
+        ret = compile_section(self, compile_bind_element);
+    } else if (strcmp(key, "stdio") == 0) {
+        *seen |= CONFIG_SEEN_STDIO;
+        ret = compile_stdio(self);
+    } else if (strcmp(key, "keep_capability") == 0) {
+        *seen |= CONFIG_SEEN_CAPABILITY;
+        ret = compile_capability(self);
+    } else if (strcmp(key, "environment") == 0) {
+        ret = config_parse_object(self, compile_environment_member, NULL);
+    } else if (strcmp(key, "pool") == 0) {
+        ret = compile_pool(self);
+    } else if (strcmp(key, "template") == 0) {
+        ret = compile_template(self);
+    } else if (strcmp(key, "image") == 0) {
+        ret = compile_image(self);
+    } else if (strcmp(key, "archive") == 0) {
+        ret = compile_archive(self);
+    } else if (strcmp(key, "jail") == 0) {
+        ret = compile_jail(self);
+    } else if (strcmp(key, "elf") == 0) {
+        ret = compile_elf(self);
+    } else if (strcmp(key, "prewarm") == 0) {
+        ret = compile_prewarm(self);
+    } else {
+        return config_skip_value(self);
+    }
+    if (ret != 0) {
+        DEBUG("json: failed to '%s'", key);
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    json 形式の設定ファイルを検証し, プランに変換する.
+ *              設定ファイルは mmap して先頭から一度だけ走査し, 読んだ値は
+ *              その場でプランに追加する. 設定ファイルのサイズに上限は無い.
+ *              デバイスファイルやバインドの文字列指定, capability 名称,
+ *              標準入出力の URI はこの時点で解決する.
+ *
+ *  @param      [in]    pathname    設定ファイルのパス.
+ *  @return     成功時は, プランオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PLAN config_compile(const char *pathname)
+{
+    struct stat status;
+
+    int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), pathname);
+        return NULL;
+    }
+    if (fstat(fd, &status) != 0) {
+        DEBUG("fstat: %s (%s)", strerror(errno), pathname);
+        close(fd);
+        return NULL;
+    }
+    if (status.st_size == 0) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    const char *data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        DEBUG("mmap: %s (%s)", strerror(errno), pathname);
+        return NULL;
+    }
+    madvise((void *)data, status.st_size, MADV_SEQUENTIAL);
+
+    struct config_parser parser = {
+        .begin = data,
+        .cur = data,
+        .end = data + status.st_size,
+        .depth = 0,
+        .builder = plan_builder_init(),
+    };
+    unsigned int seen = 0;
+    PLAN plan = NULL;
+
+    if ((parser.builder != NULL)
+        && (plan_builder_set_source(parser.builder, pathname) == 0)
+        && (config_parse_object(&parser, compile_root_member, &seen) == 0)) {
+
+        if (config_peek(&parser) != '\0') {
+            config_error(&parser, "end of text expected");
+        } else if (!(seen & CONFIG_SEEN_FILESYSTEM)) {
+            DEBUG("json: 'filesystem' is not an object");
+            errno = EINVAL;
+        } else if (!(seen & CONFIG_SEEN_STDIO)) {
+            DEBUG("json: 'stdio' is not an string");
+            errno = EINVAL;
+        } else if (!(seen & CONFIG_SEEN_CAPABILITY)) {
+            DEBUG("json: keep_capability is not an array");
+            errno = EINVAL;
+        } else {
+            plan = plan_builder_finish(parser.builder);
+        }
+    }
+
+    plan_builder_release(parser.builder);
+    free(parser.key.data);
+    free(parser.value.data);
+    munmap((void *)data, status.st_size);
+
+    return plan;
+}
+
+/**
+ *  @details    @c pathname を読み込み, プランを返す.
+ *              プランファイルの場合は mmap して使用し, 元になった設定ファイルが
+ *              更新されていれば生成し直す. それ以外は設定ファイルとして変換する.
+ *
+ *  @param      [in]    pathname    設定ファイルまたはプランファイルのパス.
+ *  @return     成功時は, プランオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PLAN config_load(const char *pathname)
+{
+    if (plan_is_plan_file(pathname)) {
+        return plan_open(pathname, config_compile);
+    }
+
+    return config_compile(pathname);
+}
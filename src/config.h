@@ -0,0 +1,99 @@
+/** @file       config.h
+ *  @brief      設定ファイルの読み込みを提供する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_CONFIG_H__
+#define __ALCATRAZ_CONFIG_H__
+
+#include "plan.h"
+
+/** @defgroup cat_config Config
+ *  設定ファイルを読み込み, プランに変換するモジュール.
+ *  @{
+ */
+
+/**
+ *  実行時情報を格納するディレクトリ.
+ */
+#define ALCTRZ_RUN_DIR "/run/alctrz"
+
+/**
+ *  構築済み jail のプールを格納する標準のディレクトリ.
+ */
+#define POOL_DIR_DEF ALCTRZ_RUN_DIR "/pool"
+
+/**
+ *  rootfs の雛形を格納する標準のディレクトリ.
+ */
+#define TEMPLATE_DIR_DEF ALCTRZ_RUN_DIR "/template"
+
+/**
+ *  使用済み jail の破棄キューを格納するディレクトリ.
+ */
+#define TEARDOWN_DIR_DEF ALCTRZ_RUN_DIR "/teardown"
+
+/**
+ *  rootfs のイメージをマウントする標準のディレクトリ.
+ */
+#define IMAGE_DIR_DEF ALCTRZ_RUN_DIR "/image"
+
+/**
+ *  ELF の依存ファイルの解決結果を格納する標準のディレクトリ.
+ */
+#define ELF_CACHE_DIR_DEF ALCTRZ_RUN_DIR "/elf"
+
+/**
+ *  プリウォームしたファイルを mlock する合計サイズの標準の上限 (MiB).
+ */
+#define PREWARM_LOCK_LIMIT_DEF (64)
+
+/**
+ *  生成した ld.so.cache を保存する標準のディレクトリ.
+ */
+#define LD_CACHE_DIR_DEF ALCTRZ_RUN_DIR "/ldcache"
+
+/**
+ *  ユーザとグループの名前解決の結果を格納するディレクトリ.
+ */
+#define NSS_CACHE_DIR_DEF ALCTRZ_RUN_DIR "/nss"
+
+/**
+ *  存在するユーザとグループの名前解決の結果を使用する期間 (秒).
+ */
+#define NSS_CACHE_TTL_DEF (300)
+
+/**
+ *  存在しないユーザとグループの名前解決の結果を使用する期間 (秒).
+ */
+#define NSS_CACHE_NEGATIVE_TTL_DEF (30)
+
+/**
+ *  rootfs の構築の操作毎のコストを計測した結果を保存するファイル.
+ */
+#define CALIBRATION_PATH_DEF ALCTRZ_RUN_DIR "/calibration"
+
+/**
+ *  json 形式の設定ファイルを検証し, プランに変換する.
+ *
+ *  @par    使用例
+ *          @code
+ *          PLAN plan = config_compile("/etc/env.json");
+ *          plan_save(plan, "/etc/env.plan");
+ *          plan_release(plan);
+ *          @endcode
+ */
+PLAN config_compile(const char *pathname);
+
+/**
+ *  設定ファイルまたはプランファイルを読み込む.
+ */
+PLAN config_load(const char *pathname);
+
+/** @} */
+
+#endif /* __ALCATRAZ_CONFIG_H__ */
@@ -63,4 +63,11 @@
  */
 #define UNUSED_VARIABLE(x) (void)(x)
 
+/**
+ *  配列の長さを返す.
+ *
+ *  @param  [in]    array   配列.
+ */
+#define lengthof(array) (sizeof(array)/sizeof((array)[0]))
+
 #endif /* __ALCATRAZ_DEBUG_H__ */
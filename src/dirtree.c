@@ -0,0 +1,661 @@
+/** @file       dirtree.c
+ *  @brief      ディレクトリ fd を起点としたパスの作成を提供する.
+ *
+ *  jail の rootfs を O_PATH で開き, 各パスはその配下のディレクトリ fd を
+ *  起点として mkdirat / fchownat / mknodat で作成する.
+ *  作成済みのディレクトリは fd と共にキャッシュし, /usr/lib のような
+ *  共通の接頭辞を何度も作成 (EEXIST) しないようにする.
+ *
+ *  ディレクトリは openat2(RESOLVE_IN_ROOT) で開くため, jail 内の
+ *  シンボリックリンクは jail の外側を指さない.
+ *  openat2 が使用できない kernel では, 要素毎に O_NOFOLLOW の openat で開き,
+ *  シンボリックリンクと ".." を辿らない.
+ *  システムコールは sysops を経由して発行するため, 記録中は発行しない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "collections.h"
+#include "dirtree.h"
+#include "sysops.h"
+#include "debug.h"
+
+#ifndef RESOLVE_IN_ROOT
+#define RESOLVE_NO_MAGICLINKS 0x02
+#define RESOLVE_IN_ROOT 0x10
+#endif
+
+/**
+ *  キャッシュするディレクトリの初期の容量.
+ *
+ *  容量に達した場合は, 2 倍に拡張する.
+ */
+#define DIR_TREE_CAPACITY (4096)
+
+/**
+ *  開いたままにするディレクトリ fd の最大数.
+ *
+ *  これを超えたディレクトリは, 作成済みであることのみを記録し,
+ *  使用する度に開き直す.
+ */
+#define DIR_TREE_FD_MAX (256)
+
+/**
+ *  作成済みディレクトリの情報.
+ */
+struct dir_entry {
+    int fd; /**< ディレクトリ fd. (開いたままにしない場合は -1) */
+};
+
+/**
+ *  ディレクトリツリー管理構造体.
+ */
+struct dir_tree {
+    MAP dirs;          /**< 作成済みディレクトリ (rootfs からの相対パス). */
+    size_t capacity;   /**< @c dirs の容量. */
+    int root_fd;       /**< rootfs のディレクトリ fd. */
+    uid_t owner;       /**< 作成するパスの所有者. */
+    gid_t group;       /**< 作成するパスのグループ. */
+    mode_t dir_mode;   /**< 親ディレクトリのパーミッション. */
+    size_t fds;        /**< 開いたままにしているディレクトリ fd の数. */
+    bool legacy;       /**< openat2 が使用できないか. */
+    uint64_t syscalls; /**< 発行したシステムコールの数. */
+    uint64_t baseline; /**< 絶対パスで作成した場合のシステムコールの数. */
+    uint64_t hits;     /**< 作成済みのディレクトリをキャッシュから得た回数. */
+};
+
+/**
+ *  パスを rootfs からの相対パスに正規化する.
+ *
+ *  連続する '/' と "." を取り除く. ".." は受け付けない.
+ *
+ *  @param  [in]    pathname    パス.
+ *  @param  [out]   path        正規化したパスの格納先.
+ *  @param  [in]    length      @c path のサイズ.
+ *  @param  [out]   components  パスの要素の数.
+ *  @return 成功時は 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int dir_tree_normalize(const char *pathname,
+                              char *path,
+                              size_t length,
+                              size_t *components)
+{
+    size_t pos = 0;
+
+    *components = 0;
+    while (*pathname != '\0') {
+        while (*pathname == '/') {
+            ++pathname;
+        }
+        size_t n = strcspn(pathname, "/");
+        if ((n == 0) || ((n == 1) && (pathname[0] == '.'))) {
+            pathname += n;
+            continue;
+        }
+        if ((n == 2) && (strncmp(pathname, "..", 2) == 0)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (pos + (pos > 0) + n >= length) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        if (pos > 0) {
+            path[pos++] = '/';
+        }
+        memcpy(path + pos, pathname, n);
+        pos += n;
+        pathname += n;
+        ++*components;
+    }
+    path[pos] = '\0';
+
+    return 0;
+}
+
+/**
+ *  ディレクトリを要素毎に O_NOFOLLOW で開く.
+ *
+ *  openat2 が使用できない場合に使用する. シンボリックリンクと ".." は
+ *  辿らずに失敗とするため, @c parent_fd の外側を開くことはない.
+ */
+static int dir_tree_open_legacy(struct dir_tree *self, int parent_fd, const char *name)
+{
+    char component[NAME_MAX + 1];
+    int fd = parent_fd;
+
+    while (*name != '\0') {
+        size_t n = strcspn(name, "/");
+        if (n == 0) {
+            ++name;
+            continue;
+        }
+        if ((n == 2) && (strncmp(name, "..", 2) == 0)) {
+            errno = EINVAL;
+            goto failed;
+        }
+        if (n > NAME_MAX) {
+            errno = ENAMETOOLONG;
+            goto failed;
+        }
+        memcpy(component, name, n);
+        component[n] = '\0';
+        name += n;
+
+        ++self->syscalls;
+        int child = sysops_openat(fd, component, O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC, 0);
+        if (child < 0) {
+            goto failed;
+        }
+        if (fd != parent_fd) {
+            sysops_close(fd);
+        }
+        fd = child;
+    }
+    if (fd == parent_fd) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return fd;
+
+failed:
+    if (fd != parent_fd) {
+        int error = errno;
+        sysops_close(fd);
+        errno = error;
+    }
+    return -1;
+}
+
+/**
+ *  ディレクトリを開く.
+ *
+ *  @param  [in,out]    self        ディレクトリツリーオブジェクト.
+ *  @param  [in]        parent_fd   親ディレクトリ fd.
+ *  @param  [in]        path        rootfs からの相対パス.
+ *  @param  [in]        name        @c parent_fd からの相対パス.
+ *  @return 成功時はディレクトリ fd が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int dir_tree_open_dir(struct dir_tree *self,
+                             int parent_fd,
+                             const char *path,
+                             const char *name)
+{
+    int fd;
+
+    if (!self->legacy) {
+        ++self->syscalls;
+        fd = sysops_openat2(self->root_fd, path,
+                            O_PATH | O_DIRECTORY | O_CLOEXEC,
+                            RESOLVE_IN_ROOT | RESOLVE_NO_MAGICLINKS);
+        if ((fd >= 0) || (errno != ENOSYS)) {
+            return fd;
+        }
+        DEBUG("openat2: %s, fallback to openat", strerror(errno));
+        self->legacy = true;
+    }
+
+    return dir_tree_open_legacy(self, parent_fd, name);
+}
+
+/**
+ *  作成済みのディレクトリを記録する.
+ *
+ *  容量に達した場合は拡張するため, 記録できないディレクトリを作成し直したり,
+ *  重複して作成したと誤って扱うことはない.
+ *
+ *  @return 成功時は, マップ上の情報が返る.
+ *          失敗時は, NULL が返り, errno が適切に設定される.
+ */
+static struct dir_entry *dir_tree_put(struct dir_tree *self, const char *path, struct dir_entry *entry)
+{
+    if ((map_get(self->dirs, path) == NULL) && ((size_t)map_count(self->dirs) >= self->capacity)) {
+        if (map_resize(self->dirs, self->capacity * 2) != 0) {
+            DEBUG("map_resize: %s (%zu)", strerror(errno), self->capacity * 2);
+            return NULL;
+        }
+        self->capacity *= 2;
+    }
+
+    return map_put(self->dirs, path, entry);
+}
+
+/**
+ *  作成したディレクトリをキャッシュする.
+ *
+ *  @param  [in,out]    self    ディレクトリツリーオブジェクト.
+ *  @param  [in]        path    rootfs からの相対パス.
+ *  @param  [in]        fd      ディレクトリ fd.
+ *  @return @c fd をキャッシュに保持した場合は true が返る.
+ *          呼び出し側で @c fd を閉じる必要がある場合は false が返る.
+ */
+static bool dir_tree_cache(struct dir_tree *self, const char *path, int fd)
+{
+    struct dir_entry entry = {
+        .fd = (self->fds < DIR_TREE_FD_MAX) ? fd : -1,
+    };
+
+    if (dir_tree_put(self, path, &entry) == NULL) {
+        return false;
+    }
+    if (entry.fd < 0) {
+        return false;
+    }
+    ++self->fds;
+
+    return true;
+}
+
+/**
+ *  ディレクトリを親ディレクトリを含めて作成し, ディレクトリ fd を返す.
+ *
+ *  キャッシュ済みの最長の接頭辞から後ろの要素のみを作成する.
+ *  @c need_fd が false の場合, 最後の要素は開かずに作成済みであることのみを
+ *  記録し, 親ディレクトリとして使用する時に開く.
+ *
+ *  @param  [in,out]    self    ディレクトリツリーオブジェクト.
+ *  @param  [in,out]    path    正規化したパス. (作業中に書き換えるが, 元に戻す)
+ *  @param  [in]        mode    最後の要素のパーミッション.
+ *  @param  [in]        need_fd 最後の要素のディレクトリ fd が必要か.
+ *  @param  [out]       owned   呼び出し側で fd を閉じる必要があるか.
+ *  @return 成功時は, ディレクトリ fd (@c need_fd が false の場合は 0) が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int dir_tree_walk(struct dir_tree *self,
+                         char *path,
+                         mode_t mode,
+                         bool need_fd,
+                         bool *owned)
+{
+    const size_t length = strlen(path);
+    size_t pos = length;
+    int fd = self->root_fd;
+
+    *owned = false;
+
+    while (pos > 0) {
+        char saved = path[pos];
+        path[pos] = '\0';
+        struct dir_entry *entry = map_get(self->dirs, path);
+        if (entry != NULL) {
+            ++self->hits;
+            if ((pos == length) && !need_fd) {
+                return 0;
+            }
+            if (entry->fd >= 0) {
+                fd = entry->fd;
+            } else {
+                fd = dir_tree_open_dir(self, self->root_fd, path, path);
+                if (fd < 0) {
+                    DEBUG("open: %s (%s)", strerror(errno), path);
+                    path[pos] = saved;
+                    return -1;
+                }
+                if (self->fds < DIR_TREE_FD_MAX) {
+                    entry->fd = fd;
+                    ++self->fds;
+                } else {
+                    *owned = true;
+                }
+            }
+            path[pos] = saved;
+            break;
+        }
+        path[pos] = saved;
+        while ((pos > 0) && (path[--pos] != '/')) {
+            continue;
+        }
+    }
+
+    while (pos < length) {
+        char *name = path + ((pos == 0) ? 0 : pos + 1);
+        char *sep = strchr(name, '/');
+        size_t end = (sep != NULL) ? (size_t)(sep - path) : length;
+        mode_t mode_ = (end == length) ? mode : self->dir_mode;
+
+        path[end] = '\0';
+        ++self->syscalls;
+        if (sysops_mkdirat(fd, name, mode_) == 0) {
+            ++self->syscalls;
+            ++self->baseline;
+            if (sysops_fchownat(fd, name, self->owner, self->group, AT_SYMLINK_NOFOLLOW) != 0) {
+                DEBUG("fchownat: %s (%s)", strerror(errno), path);
+                goto failed;
+            }
+        } else if (errno != EEXIST) {
+            DEBUG("mkdirat: %s (%s)", strerror(errno), path);
+            goto failed;
+        }
+
+        if ((end == length) && !need_fd) {
+            dir_tree_put(self, path, &(struct dir_entry){.fd = -1});
+            if (*owned) {
+                sysops_close(fd);
+            }
+            *owned = false;
+            return 0;
+        }
+
+        int child = dir_tree_open_dir(self, fd, path, name);
+        if (child < 0) {
+            DEBUG("open: %s (%s)", strerror(errno), path);
+            goto failed;
+        }
+        if (*owned) {
+            sysops_close(fd);
+        }
+        *owned = !dir_tree_cache(self, path, child);
+        fd = child;
+
+        if (end < length) {
+            path[end] = '/';
+        }
+        pos = end;
+    }
+
+    return fd;
+
+failed:
+    if (*owned) {
+        sysops_close(fd);
+    }
+    if (strlen(path) < length) {
+        path[strlen(path)] = '/';
+    }
+    return -1;
+}
+
+/**
+ *  パスの最後の要素を分離し, 親ディレクトリ fd を返す.
+ *
+ *  @param  [in,out]    self        ディレクトリツリーオブジェクト.
+ *  @param  [in]        pathname    パス.
+ *  @param  [out]       path        正規化したパスの格納先.
+ *  @param  [in]        length      @c path のサイズ.
+ *  @param  [out]       name        最後の要素.
+ *  @param  [out]       owned       呼び出し側で fd を閉じる必要があるか.
+ *  @return 成功時は親ディレクトリ fd が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int dir_tree_parent(struct dir_tree *self,
+                           const char *pathname,
+                           char *path,
+                           size_t length,
+                           const char **name,
+                           bool *owned)
+{
+    size_t components;
+
+    if (dir_tree_normalize(pathname, path, length, &components) != 0) {
+        return -1;
+    }
+    if (components == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    self->baseline += components - 1;
+
+    char *sep = strrchr(path, '/');
+    if (sep == NULL) {
+        *name = path;
+        *owned = false;
+        return self->root_fd;
+    }
+
+    *sep = '\0';
+    *name = sep + 1;
+    return dir_tree_walk(self, path, self->dir_mode, true, owned);
+}
+
+/**
+ *  キャッシュしたディレクトリ fd を閉じる.
+ */
+static void dir_tree_close_entry(const char *key, void *payload, void *arg)
+{
+    struct dir_entry *entry = (struct dir_entry *)payload;
+
+    (void)key;
+    (void)arg;
+
+    if (entry->fd >= 0) {
+        sysops_close(entry->fd);
+    }
+}
+
+/**
+ *  @details    @c root を起点とするディレクトリツリーを開く.
+ *              作成するパスの所有者は @c owner, @c group とし,
+ *              親ディレクトリは @c dir_mode で作成する.
+ *
+ *  @param      [in]    root        rootfs のパス.
+ *  @param      [in]    owner       作成するパスの所有者.
+ *  @param      [in]    group       作成するパスのグループ.
+ *  @param      [in]    dir_mode    親ディレクトリのパーミッション.
+ *  @return     成功時は, ディレクトリツリーオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+DIR_TREE dir_tree_open(const char *root, uid_t owner, gid_t group, mode_t dir_mode)
+{
+    struct dir_tree *self;
+
+    if (root == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->dirs = map_init(sizeof(struct dir_entry), DIR_TREE_CAPACITY);
+    if (self->dirs == NULL) {
+        free(self);
+        return NULL;
+    }
+    self->capacity = DIR_TREE_CAPACITY;
+    self->root_fd = sysops_open(root, O_PATH | O_DIRECTORY | O_CLOEXEC, 0);
+    if (self->root_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), root);
+        map_release(self->dirs);
+        free(self);
+        return NULL;
+    }
+    self->owner = owner;
+    self->group = group;
+    self->dir_mode = dir_mode;
+
+    return (DIR_TREE)self;
+}
+
+/**
+ *  @details    @c tree を閉じる.
+ *              キャッシュしたディレクトリ fd も全て閉じる.
+ *
+ *  @param      [in,out]    tree    ディレクトリツリーオブジェクト.
+ */
+void dir_tree_close(DIR_TREE tree)
+{
+    struct dir_tree *self = (struct dir_tree *)tree;
+
+    if (self != NULL) {
+        map_foreach(self->dirs, dir_tree_close_entry, NULL);
+        map_release(self->dirs);
+        sysops_close(self->root_fd);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c pathname のディレクトリを, 親ディレクトリを含めて作成する.
+ *              既に存在する場合は成功とする.
+ *
+ *  @param      [in,out]    tree        ディレクトリツリーオブジェクト.
+ *  @param      [in]        pathname    rootfs 内のパス.
+ *  @param      [in]        mode        パーミッション.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int dir_tree_mkdir(DIR_TREE tree, const char *pathname, mode_t mode)
+{
+    struct dir_tree *self = (struct dir_tree *)tree;
+    char path[PATH_MAX];
+    size_t components;
+    bool owned;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (dir_tree_normalize(pathname, path, sizeof(path), &components) != 0) {
+        return -1;
+    }
+    self->baseline += components;
+
+    if (dir_tree_walk(self, path, mode, false, &owned) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c pathname のデバイスファイルを, 親ディレクトリを含めて作成する.
+ *
+ *  @param      [in,out]    tree        ディレクトリツリーオブジェクト.
+ *  @param      [in]        pathname    rootfs 内のパス.
+ *  @param      [in]        mode        ファイル種別とパーミッション.
+ *  @param      [in]        dev         デバイス番号.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int dir_tree_mknod(DIR_TREE tree, const char *pathname, mode_t mode, dev_t dev)
+{
+    struct dir_tree *self = (struct dir_tree *)tree;
+    char path[PATH_MAX];
+    const char *name;
+    bool owned;
+    int ret = -1;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = dir_tree_parent(self, pathname, path, sizeof(path), &name, &owned);
+    if (fd < 0) {
+        return -1;
+    }
+
+    self->syscalls += 2;
+    self->baseline += 2;
+    if (sysops_mknodat(fd, name, mode, dev) != 0) {
+        DEBUG("mknodat: %s (%s)", strerror(errno), pathname);
+    } else if (sysops_fchownat(fd, name, self->owner, self->group, AT_SYMLINK_NOFOLLOW) != 0) {
+        DEBUG("fchownat: %s (%s)", strerror(errno), pathname);
+    } else {
+        ret = 0;
+    }
+
+    if (owned) {
+        sysops_close(fd);
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    @c pathname の空ファイルを, 親ディレクトリを含めて作成する.
+ *              既に存在する場合は所有者のみ変更する.
+ *
+ *  @param      [in,out]    tree        ディレクトリツリーオブジェクト.
+ *  @param      [in]        pathname    rootfs 内のパス.
+ *  @param      [in]        mode        パーミッション.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int dir_tree_touch(DIR_TREE tree, const char *pathname, mode_t mode)
+{
+    struct dir_tree *self = (struct dir_tree *)tree;
+    char path[PATH_MAX];
+    const char *name;
+    bool owned;
+    int ret = -1;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = dir_tree_parent(self, pathname, path, sizeof(path), &name, &owned);
+    if (fd < 0) {
+        return -1;
+    }
+
+    self->syscalls += 1;
+    self->baseline += 3;
+    int file_fd = sysops_openat(fd, name, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, mode);
+    if (file_fd < 0) {
+        DEBUG("openat: %s (%s)", strerror(errno), pathname);
+    } else {
+        self->syscalls += 2;
+        if (sysops_fchown(file_fd, self->owner, self->group) != 0) {
+            DEBUG("fchown: %s (%s)", strerror(errno), pathname);
+        } else {
+            ret = 0;
+        }
+        sysops_close(file_fd);
+    }
+
+    if (owned) {
+        sysops_close(fd);
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    @c tree の統計情報を取得する.
+ *
+ *  @param      [in]    tree    ディレクトリツリーオブジェクト.
+ *  @param      [out]   stats   統計情報の格納先.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int dir_tree_get_stats(DIR_TREE tree, struct dir_tree_stats *stats)
+{
+    struct dir_tree *self = (struct dir_tree *)tree;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    stats->syscalls = self->syscalls;
+    stats->saved = (self->baseline > self->syscalls) ? self->baseline - self->syscalls : 0;
+    stats->hits = self->hits;
+    stats->cached = map_count(self->dirs);
+
+    return 0;
+}
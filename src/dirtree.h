@@ -0,0 +1,77 @@
+/** @file       dirtree.h
+ *  @brief      ディレクトリ fd を起点としたパスの作成を提供する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_DIRTREE_H__
+#define __ALCATRAZ_DIRTREE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/** @defgroup cat_dirtree Directory tree
+ *  ディレクトリ fd を起点としてパスを作成するモジュール.
+ *  @{
+ */
+
+/**
+ *  ディレクトリツリー型.
+ */
+typedef struct {} *DIR_TREE;
+
+/**
+ *  ディレクトリツリーの統計情報.
+ */
+struct dir_tree_stats {
+    uint64_t syscalls; /**< 発行したシステムコールの数. */
+    uint64_t saved;    /**< 絶対パスで作成した場合と比べて削減したシステムコールの数. */
+    uint64_t hits;     /**< 作成済みのディレクトリをキャッシュから得た回数. */
+    size_t cached;     /**< キャッシュしているディレクトリの数. */
+};
+
+/**
+ *  ディレクトリツリーを開く.
+ *
+ *  @par    使用例
+ *          @code
+ *          DIR_TREE tree = dir_tree_open("/tmp/chroot-XXXXXX", uid, gid, 0755);
+ *          dir_tree_mkdir(tree, "/usr/lib", 0755);
+ *          dir_tree_mknod(tree, "/dev/null", S_IFCHR | 0666, makedev(1, 3));
+ *          dir_tree_touch(tree, "/etc/passwd", 0644);
+ *          dir_tree_close(tree);
+ *          @endcode
+ */
+DIR_TREE dir_tree_open(const char *root, uid_t owner, gid_t group, mode_t dir_mode);
+
+/**
+ *  ディレクトリツリーを閉じる.
+ */
+void dir_tree_close(DIR_TREE tree);
+
+/**
+ *  親ディレクトリを含めてディレクトリを作成する.
+ */
+int dir_tree_mkdir(DIR_TREE tree, const char *pathname, mode_t mode);
+
+/**
+ *  親ディレクトリを含めてデバイスファイルを作成する.
+ */
+int dir_tree_mknod(DIR_TREE tree, const char *pathname, mode_t mode, dev_t dev);
+
+/**
+ *  親ディレクトリを含めて空ファイルを作成する.
+ */
+int dir_tree_touch(DIR_TREE tree, const char *pathname, mode_t mode);
+
+/**
+ *  ディレクトリツリーの統計情報を取得する.
+ */
+int dir_tree_get_stats(DIR_TREE tree, struct dir_tree_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_DIRTREE_H__ */
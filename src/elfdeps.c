@@ -0,0 +1,1198 @@
+/** @file       elfdeps.c
+ *  @brief      ELF の依存ライブラリの解決を提供する.
+ *
+ *  プログラムを起点に, 次のファイルを幅優先で辿る.
+ *  - PT_INTERP の動的リンカ. (スクリプトの場合は "#!" のインタプリタ)
+ *  - DT_NEEDED のライブラリ.
+ *
+ *  ライブラリは動的リンカと同じ順序で検索する.
+ *  1. DT_RUNPATH が無ければ, 自身とプログラムの DT_RPATH.
+ *  2. DT_RUNPATH.
+ *  3. 標準のディレクトリ.
+ *  ld.so.cache は参照しないため, /etc/ld.so.conf のディレクトリは
+ *  検索しない. また, クラスやマシンの異なるライブラリは読み飛ばす.
+ *
+ *  クロージャは `<cache>/<key>` に 1 行に 1 つずつ
+ *  "<dev> <ino> <mtime 秒> <mtime ナノ秒> <path>" の形式で記録する.
+ *  キーはプログラムのパス, デバイス, inode および更新時刻から求め,
+ *  記録したファイルのいずれかが更新されていれば解決し直す.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX, strdup, getline */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include "elfdeps.h"
+#include "collections.h"
+#include "fsutil.h"
+#include "hash.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  キャッシュディレクトリのアクセス権限.
+ */
+#define ELF_CACHE_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  一つの ELF から参照するセグメント (PT_LOAD, PT_INTERP, PT_DYNAMIC) の最大数.
+ */
+#define ELF_SEGMENTS_MAX (16)
+
+/**
+ *  一つの ELF から参照する DT_NEEDED の最大数.
+ */
+#define ELF_NEEDED_MAX (128)
+
+/**
+ *  ライブラリの検索パスの最大長.
+ */
+#define ELF_SEARCH_MAX (PATH_MAX * 2)
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ELFDATA_HOST ELFDATA2LSB
+#else
+#define ELFDATA_HOST ELFDATA2MSB
+#endif
+
+/**
+ *  マシン毎のマルチアーキテクチャのディレクトリ名.
+ */
+static const struct {
+    uint16_t machine;
+    unsigned char elf_class;
+    const char *triplet;
+} multiarch[] = {
+    {EM_X86_64, ELFCLASS64, "x86_64-linux-gnu"},
+    {EM_386, ELFCLASS32, "i386-linux-gnu"},
+    {EM_AARCH64, ELFCLASS64, "aarch64-linux-gnu"},
+    {EM_ARM, ELFCLASS32, "arm-linux-gnueabihf"},
+    {EM_RISCV, ELFCLASS64, "riscv64-linux-gnu"},
+    {EM_PPC64, ELFCLASS64, "powerpc64le-linux-gnu"},
+    {EM_S390, ELFCLASS64, "s390x-linux-gnu"},
+};
+
+/**
+ *  解析した ELF (またはスクリプト) の情報.
+ */
+struct elf_object {
+    const char *path;                /**< ファイルのパス. */
+    const unsigned char *image;      /**< ファイルの内容. */
+    size_t length;                   /**< @c image のサイズ. */
+    bool is_elf;                     /**< ELF か. */
+    unsigned char elf_class;         /**< ELF のクラス. */
+    uint16_t machine;                /**< ELF のマシン. */
+    uint16_t type;                   /**< ELF の種別. */
+    uint32_t flags;                  /**< ELF のマシン固有のフラグ. */
+    const char *interp;              /**< 動的リンカまたはインタプリタのパス. */
+    char script[PATH_MAX];           /**< スクリプトのインタプリタのパス. */
+    const char *strtab;              /**< 動的リンク用の文字列テーブル. */
+    size_t strsz;                    /**< @c strtab のサイズ. */
+    uint64_t needed[ELF_NEEDED_MAX]; /**< DT_NEEDED (文字列テーブルのオフセット). */
+    size_t num_needed;               /**< DT_NEEDED の数. */
+    const char *rpath;               /**< DT_RPATH. */
+    const char *runpath;             /**< DT_RUNPATH. */
+    const char *soname;              /**< DT_SONAME. */
+};
+
+/**
+ *  ELF のセグメントの情報.
+ */
+struct elf_segment {
+    uint32_t type;   /**< セグメントの種別. */
+    uint64_t offset; /**< ファイル先頭からのオフセット. */
+    uint64_t vaddr;  /**< 仮想アドレス. */
+    uint64_t filesz; /**< ファイル上のサイズ. */
+};
+
+/**
+ *  クロージャに含まれるファイル.
+ */
+struct elf_file {
+    char *path;            /**< ファイルのパス. */
+    dev_t dev;             /**< デバイス. */
+    ino_t ino;             /**< inode. */
+    struct timespec mtime; /**< 更新時刻. */
+};
+
+/**
+ *  ファイルの集合.
+ */
+struct elf_closure {
+    struct elf_file *files; /**< ファイルの配列. (追加順) */
+    size_t count;           /**< ファイルの数. */
+    size_t capacity;        /**< 確保したファイルの数. */
+    MAP paths;              /**< パスから @c files の添字を引くマップ. */
+    MAP names;              /**< 解決済みのライブラリ名. (NULL 可) */
+};
+
+/**
+ *  依存ファイル集合管理構造体.
+ */
+struct elf_deps {
+    char cache_path[PATH_MAX]; /**< キャッシュディレクトリ. (空文字列はキャッシュしない) */
+    struct elf_closure all;    /**< 全てのプログラムのクロージャの和集合. */
+    size_t binaries;           /**< 追加したプログラムの数. */
+    size_t cache_hits;         /**< キャッシュを使用したプログラムの数. */
+    uint64_t elapsed_ns;       /**< 解決に要した時間の合計. */
+};
+
+static int closure_init(struct elf_closure *self, bool names)
+{
+    self->files = NULL;
+    self->count = 0;
+    self->capacity = 0;
+    self->paths = map_init(sizeof(size_t), ELF_DEPS_FILES_MAX);
+    self->names = names ? map_init(sizeof(char), ELF_DEPS_FILES_MAX) : NULL;
+    if ((self->paths == NULL) || (names && (self->names == NULL))) {
+        map_release(self->paths);
+        map_release(self->names);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void closure_release(struct elf_closure *self)
+{
+    for (size_t i = 0; i < self->count; ++i) {
+        free(self->files[i].path);
+    }
+    free(self->files);
+    map_release(self->paths);
+    map_release(self->names);
+}
+
+/**
+ *  ファイルを集合に追加する.
+ *
+ *  既に含まれるパスは追加しない.
+ */
+static int closure_add(struct elf_closure *self, const char *path, const struct stat *status)
+{
+    if (map_get(self->paths, path) != NULL) {
+        return 0;
+    }
+    if (self->count == ELF_DEPS_FILES_MAX) {
+        DEBUG("elf: too many files (%s)", path);
+        errno = ENOSPC;
+        return -1;
+    }
+    if (self->count == self->capacity) {
+        size_t capacity = (self->capacity > 0) ? self->capacity * 2 : 32;
+        struct elf_file *files = realloc(self->files, sizeof(*files) * capacity);
+        if (files == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->files = files;
+        self->capacity = capacity;
+    }
+
+    struct elf_file *file = &self->files[self->count];
+    file->path = strdup(path);
+    if (file->path == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    file->dev = status->st_dev;
+    file->ino = status->st_ino;
+    file->mtime = status->st_mtim;
+    if (map_put(self->paths, path, &self->count) == NULL) {
+        free(file->path);
+        return -1;
+    }
+    ++self->count;
+
+    return 0;
+}
+
+/**
+ *  ファイルの情報を取得して, 集合に追加する.
+ */
+static int closure_add_path(struct elf_closure *self, const char *path)
+{
+    struct stat status;
+
+    if (stat(path, &status) != 0) {
+        DEBUG("stat: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+
+    return closure_add(self, path, &status);
+}
+
+/**
+ *  @c other の全てのファイルを集合に追加する.
+ */
+static int closure_merge(struct elf_closure *self, const struct elf_closure *other)
+{
+    for (size_t i = 0; i < other->count; ++i) {
+        const struct elf_file *file = &other->files[i];
+        struct stat status = {
+            .st_dev = file->dev,
+            .st_ino = file->ino,
+            .st_mtim = file->mtime,
+        };
+        if (closure_add(self, file->path, &status) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  範囲がファイルに収まっているかを判定する.
+ */
+static bool elf_in_range(const struct elf_object *obj, uint64_t offset, uint64_t size)
+{
+    return (offset <= obj->length) && (size <= obj->length - offset);
+}
+
+/**
+ *  動的リンク用の文字列テーブルから文字列を取得する.
+ *
+ *  @return 範囲外の場合は NULL が返る.
+ */
+static const char *elf_string(const struct elf_object *obj, uint64_t offset)
+{
+    if ((obj->strtab == NULL) || (offset >= obj->strsz)) {
+        return NULL;
+    }
+    if (memchr(obj->strtab + offset, '\0', obj->strsz - offset) == NULL) {
+        return NULL;
+    }
+
+    return obj->strtab + offset;
+}
+
+/**
+ *  ELF ヘッダの識別子を検証する.
+ */
+static bool elf_check_ident(const unsigned char *ident, size_t length)
+{
+    return (length >= EI_NIDENT)
+        && (memcmp(ident, ELFMAG, SELFMAG) == 0)
+        && ((ident[EI_CLASS] == ELFCLASS32) || (ident[EI_CLASS] == ELFCLASS64))
+        && (ident[EI_DATA] == ELFDATA_HOST);
+}
+
+/**
+ *  プログラムヘッダを読み込む.
+ */
+static int elf_read_segments(const struct elf_object *obj,
+                             struct elf_segment *segments,
+                             size_t *count)
+{
+    uint64_t phoff;
+    size_t phnum;
+    size_t phentsize;
+
+    if (obj->elf_class == ELFCLASS64) {
+        Elf64_Ehdr ehdr;
+        if (obj->length < sizeof(ehdr)) {
+            return -1;
+        }
+        memcpy(&ehdr, obj->image, sizeof(ehdr));
+        phoff = ehdr.e_phoff;
+        phnum = ehdr.e_phnum;
+        phentsize = sizeof(Elf64_Phdr);
+    } else {
+        Elf32_Ehdr ehdr;
+        if (obj->length < sizeof(ehdr)) {
+            return -1;
+        }
+        memcpy(&ehdr, obj->image, sizeof(ehdr));
+        phoff = ehdr.e_phoff;
+        phnum = ehdr.e_phnum;
+        phentsize = sizeof(Elf32_Phdr);
+    }
+    if (!elf_in_range(obj, phoff, (uint64_t)phnum * phentsize)) {
+        return -1;
+    }
+
+    *count = 0;
+    for (size_t i = 0; i < phnum; ++i) {
+        const unsigned char *p = obj->image + phoff + i * phentsize;
+        struct elf_segment *segment = &segments[*count];
+
+        if (obj->elf_class == ELFCLASS64) {
+            Elf64_Phdr phdr;
+            memcpy(&phdr, p, sizeof(phdr));
+            *segment = (struct elf_segment){phdr.p_type, phdr.p_offset, phdr.p_vaddr, phdr.p_filesz};
+        } else {
+            Elf32_Phdr phdr;
+            memcpy(&phdr, p, sizeof(phdr));
+            *segment = (struct elf_segment){phdr.p_type, phdr.p_offset, phdr.p_vaddr, phdr.p_filesz};
+        }
+        if ((segment->type == PT_LOAD) || (segment->type == PT_INTERP) || (segment->type == PT_DYNAMIC)) {
+            if (!elf_in_range(obj, segment->offset, segment->filesz)) {
+                return -1;
+            }
+            if (++*count == ELF_SEGMENTS_MAX) {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  仮想アドレスをファイル先頭からのオフセットに変換する.
+ */
+static bool elf_vaddr_to_offset(const struct elf_segment *segments,
+                                size_t count,
+                                uint64_t vaddr,
+                                uint64_t *offset)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if ((segments[i].type == PT_LOAD)
+            && (vaddr >= segments[i].vaddr)
+            && (vaddr - segments[i].vaddr < segments[i].filesz)) {
+
+            *offset = vaddr - segments[i].vaddr + segments[i].offset;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ *  ELF の PT_INTERP と動的セクションを解析する.
+ */
+static int elf_parse(struct elf_object *obj)
+{
+    struct elf_segment segments[ELF_SEGMENTS_MAX];
+    size_t count;
+
+    obj->elf_class = obj->image[EI_CLASS];
+    memcpy(&obj->machine, obj->image + offsetof(Elf64_Ehdr, e_machine), sizeof(obj->machine));
+    if (elf_read_segments(obj, segments, &count) != 0) {
+        return -1;
+    }
+    memcpy(&obj->type, obj->image + offsetof(Elf64_Ehdr, e_type), sizeof(obj->type));
+    if (obj->elf_class == ELFCLASS64) {
+        memcpy(&obj->flags, obj->image + offsetof(Elf64_Ehdr, e_flags), sizeof(obj->flags));
+    } else {
+        memcpy(&obj->flags, obj->image + offsetof(Elf32_Ehdr, e_flags), sizeof(obj->flags));
+    }
+
+    const struct elf_segment *dynamic = NULL;
+    for (size_t i = 0; i < count; ++i) {
+        if (segments[i].type == PT_INTERP) {
+            const char *interp = (const char *)obj->image + segments[i].offset;
+            if ((segments[i].filesz == 0) || (memchr(interp, '\0', segments[i].filesz) == NULL)) {
+                return -1;
+            }
+            obj->interp = interp;
+        } else if (segments[i].type == PT_DYNAMIC) {
+            dynamic = &segments[i];
+        }
+    }
+    if (dynamic == NULL) {
+        /* 静的リンクされたプログラム. */
+        return 0;
+    }
+
+    const size_t entsize = (obj->elf_class == ELFCLASS64) ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+    uint64_t strtab = 0;
+    uint64_t rpath = UINT64_MAX;
+    uint64_t runpath = UINT64_MAX;
+    uint64_t soname = UINT64_MAX;
+    for (uint64_t off = 0; off + entsize <= dynamic->filesz; off += entsize) {
+        const unsigned char *p = obj->image + dynamic->offset + off;
+        int64_t tag;
+        uint64_t val;
+
+        if (obj->elf_class == ELFCLASS64) {
+            Elf64_Dyn dyn;
+            memcpy(&dyn, p, sizeof(dyn));
+            tag = dyn.d_tag;
+            val = dyn.d_un.d_val;
+        } else {
+            Elf32_Dyn dyn;
+            memcpy(&dyn, p, sizeof(dyn));
+            tag = dyn.d_tag;
+            val = dyn.d_un.d_val;
+        }
+        if (tag == DT_NULL) {
+            break;
+        }
+        switch (tag) {
+        case DT_STRTAB:
+            strtab = val;
+            break;
+        case DT_STRSZ:
+            obj->strsz = val;
+            break;
+        case DT_NEEDED:
+            if (obj->num_needed == ELF_NEEDED_MAX) {
+                DEBUG("elf: too many DT_NEEDED (%s)", obj->path);
+                return -1;
+            }
+            obj->needed[obj->num_needed++] = val;
+            break;
+        case DT_RPATH:
+            rpath = val;
+            break;
+        case DT_RUNPATH:
+            runpath = val;
+            break;
+        case DT_SONAME:
+            soname = val;
+            break;
+        default:
+            break;
+        }
+    }
+
+    uint64_t offset;
+    bool has_strings = (obj->num_needed > 0) || (soname != UINT64_MAX);
+    if (has_strings
+        && (!elf_vaddr_to_offset(segments, count, strtab, &offset)
+            || !elf_in_range(obj, offset, obj->strsz))) {
+
+        return -1;
+    }
+    if (has_strings) {
+        obj->strtab = (const char *)obj->image + offset;
+    }
+    obj->rpath = elf_string(obj, rpath);
+    obj->runpath = elf_string(obj, runpath);
+    obj->soname = elf_string(obj, soname);
+
+    return 0;
+}
+
+/**
+ *  スクリプトの "#!" 行からインタプリタのパスを取り出す.
+ */
+static int elf_parse_script(struct elf_object *obj)
+{
+    size_t i = 2;
+
+    while ((i < obj->length) && ((obj->image[i] == ' ') || (obj->image[i] == '\t'))) {
+        ++i;
+    }
+    size_t begin = i;
+    while ((i < obj->length)
+           && (obj->image[i] != ' ') && (obj->image[i] != '\t') && (obj->image[i] != '\n')) {
+        ++i;
+    }
+    if ((i == begin) || (i - begin >= sizeof(obj->script)) || (obj->image[begin] != '/')) {
+        return -1;
+    }
+    memcpy(obj->script, obj->image + begin, i - begin);
+    obj->script[i - begin] = '\0';
+    obj->interp = obj->script;
+
+    return 0;
+}
+
+/**
+ *  開いたファイルを解析する.
+ *
+ *  ELF でもスクリプトでもないファイルは, 依存の無いファイルとして扱う.
+ */
+static int elf_object_map(struct elf_object *obj, int fd, const char *path)
+{
+    struct stat status;
+
+    memset(obj, 0, sizeof(*obj));
+    obj->path = path;
+
+    if (fstat(fd, &status) != 0) {
+        DEBUG("fstat: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    if (!S_ISREG(status.st_mode) || (status.st_size == 0)) {
+        return 0;
+    }
+    void *image = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (image == MAP_FAILED) {
+        DEBUG("mmap: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    obj->image = image;
+    obj->length = status.st_size;
+
+    int ret = 0;
+    if ((obj->length > 2) && (memcmp(obj->image, "#!", 2) == 0)) {
+        ret = elf_parse_script(obj);
+    } else if (elf_check_ident(obj->image, obj->length)) {
+        obj->is_elf = true;
+        ret = elf_parse(obj);
+    }
+    if (ret != 0) {
+        DEBUG("elf: %s is broken", path);
+        munmap((void *)obj->image, obj->length);
+        obj->image = NULL;
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  ファイルを開いて解析する.
+ */
+static int elf_object_open(struct elf_object *obj, const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    int ret = elf_object_map(obj, fd, path);
+    close(fd);
+
+    return ret;
+}
+
+static void elf_object_close(struct elf_object *obj)
+{
+    if (obj->image != NULL) {
+        munmap((void *)obj->image, obj->length);
+        obj->image = NULL;
+    }
+}
+
+/**
+ *  ファイルが指定のクラスとマシンの ELF かを判定する.
+ */
+static bool elf_matches(const char *path, unsigned char elf_class, uint16_t machine)
+{
+    unsigned char header[sizeof(Elf32_Ehdr)];
+    uint16_t candidate;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t length = pread(fd, header, sizeof(header), 0);
+    close(fd);
+    if ((length < (ssize_t)sizeof(header)) || !elf_check_ident(header, length)) {
+        return false;
+    }
+    memcpy(&candidate, header + offsetof(Elf32_Ehdr, e_machine), sizeof(candidate));
+
+    return (header[EI_CLASS] == elf_class) && (candidate == machine);
+}
+
+/**
+ *  検索パスを追加する.
+ *
+ *  $ORIGIN, $LIB, $PLATFORM を展開する.
+ *
+ *  @return 成功時は 0 が返り, 長すぎる場合は -1 が返る.
+ */
+static int append_search(char *search,
+                         size_t size,
+                         const char *dirs,
+                         const struct elf_object *obj)
+{
+    static const char * const tokens[] = {"ORIGIN", "LIB", "PLATFORM"};
+    char origin[PATH_MAX];
+    struct utsname uts;
+    size_t length = strlen(search);
+
+    snprintf(origin, sizeof(origin), "%s", obj->path);
+    char *slash = strrchr(origin, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+    }
+    if (uname(&uts) != 0) {
+        uts.machine[0] = '\0';
+    }
+
+    if ((length > 0) && (length < size - 1)) {
+        search[length++] = ':';
+    }
+    for (const char *p = dirs; *p != '\0'; ) {
+        const char *value = NULL;
+        size_t skip = 1;
+
+        if (*p == '$') {
+            bool braced = (p[1] == '{');
+            for (size_t i = 0; i < sizeof(tokens) / sizeof(tokens[0]); ++i) {
+                size_t n = strlen(tokens[i]);
+                const char *name = p + 1 + (braced ? 1 : 0);
+                if ((strncmp(name, tokens[i], n) == 0) && (!braced || (name[n] == '}'))) {
+                    skip = 1 + n + (braced ? 2 : 0);
+                    value = (i == 0) ? origin
+                          : (i == 1) ? ((obj->elf_class == ELFCLASS64) ? "lib64" : "lib")
+                          : uts.machine;
+                    break;
+                }
+            }
+        }
+        if (value == NULL) {
+            if (length >= size - 1) {
+                return -1;
+            }
+            search[length++] = *p;
+        } else {
+            size_t n = strlen(value);
+            if (length + n >= size - 1) {
+                return -1;
+            }
+            memcpy(search + length, value, n);
+            length += n;
+        }
+        p += skip;
+    }
+    search[length] = '\0';
+
+    return 0;
+}
+
+/**
+ *  標準のディレクトリを検索パスに追加する.
+ */
+static int append_default_search(char *search, size_t size, const struct elf_object *obj)
+{
+    char dirs[PATH_MAX] = {0};
+    size_t length = 0;
+
+    for (size_t i = 0; i < sizeof(multiarch) / sizeof(multiarch[0]); ++i) {
+        if ((multiarch[i].machine == obj->machine) && (multiarch[i].elf_class == obj->elf_class)) {
+            length = snprintf(dirs, sizeof(dirs), "/lib/%s:/usr/lib/%s:",
+                              multiarch[i].triplet, multiarch[i].triplet);
+            break;
+        }
+    }
+    if (obj->elf_class == ELFCLASS64) {
+        snprintf(dirs + length, sizeof(dirs) - length, "/lib64:/usr/lib64:/lib:/usr/lib");
+    } else {
+        snprintf(dirs + length, sizeof(dirs) - length, "/lib:/usr/lib");
+    }
+
+    return append_search(search, size, dirs, obj);
+}
+
+/**
+ *  検索パスからライブラリを探す.
+ *
+ *  @param  [in]    search  ':' 区切りの検索パス.
+ *  @param  [in]    name    ライブラリ名.
+ *  @param  [in]    obj     ライブラリを必要とする ELF.
+ *  @param  [out]   path    見つかったライブラリのパス.
+ *  @return 見つかった場合は true が返る.
+ */
+static bool find_library(const char *search,
+                         const char *name,
+                         const struct elf_object *obj,
+                         char *path,
+                         size_t size)
+{
+    const char *p = search;
+
+    while (*p != '\0') {
+        const char *end = strchr(p, ':');
+        size_t length = (end != NULL) ? (size_t)(end - p) : strlen(p);
+
+        /* 空の要素はカレントディレクトリを表すが, jail 内では意味を持たない. */
+        if ((length > 0) && (snprintf(path, size, "%.*s/%s", (int)length, p, name) < (int)size)
+            && elf_matches(path, obj->elf_class, obj->machine)) {
+
+            return true;
+        }
+        p += length;
+        if (*p == ':') {
+            ++p;
+        }
+    }
+
+    return false;
+}
+
+/**
+ *  ELF の直接の依存ファイルを集合に追加する.
+ *
+ *  @param  [in,out]    closure     ファイルの集合.
+ *  @param  [in]        obj         解析した ELF.
+ *  @param  [in,out]    main_rpath  プログラムの DT_RPATH. (展開済み)
+ *  @param  [in,out]    main_seen   プログラムを解析済みか.
+ */
+static int resolve_object(struct elf_closure *closure,
+                          const struct elf_object *obj,
+                          char *main_rpath,
+                          bool *main_seen)
+{
+    char search[ELF_SEARCH_MAX] = {0};
+    char path[PATH_MAX];
+
+    if ((obj->interp != NULL) && (closure_add_path(closure, obj->interp) != 0)) {
+        return -1;
+    }
+    if (!obj->is_elf) {
+        return 0;
+    }
+
+    /* DT_RUNPATH がある場合は, DT_RPATH は使用しない. */
+    if (obj->runpath != NULL) {
+        if (append_search(search, sizeof(search), obj->runpath, obj) != 0) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+    } else if (obj->rpath != NULL) {
+        if (append_search(search, sizeof(search), obj->rpath, obj) != 0) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+    }
+    if (!*main_seen) {
+        *main_seen = true;
+        if (obj->runpath == NULL) {
+            snprintf(main_rpath, ELF_SEARCH_MAX, "%s", search);
+        }
+    } else if ((obj->runpath == NULL) && (main_rpath[0] != '\0')) {
+        if (append_search(search, sizeof(search), main_rpath, obj) != 0) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+    }
+    if (append_default_search(search, sizeof(search), obj) != 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    for (size_t i = 0; i < obj->num_needed; ++i) {
+        const char *name = elf_string(obj, obj->needed[i]);
+        if (name == NULL) {
+            errno = ENOEXEC;
+            return -1;
+        }
+        if (map_get(closure->names, name) != NULL) {
+            continue;
+        }
+        if (strchr(name, '/') != NULL) {
+            snprintf(path, sizeof(path), "%s", name);
+            if (name[0] != '/') {
+                DEBUG("elf: %s: relative DT_NEEDED %s", obj->path, name);
+                errno = ENOENT;
+                return -1;
+            }
+        } else if (!find_library(search, name, obj, path, sizeof(path))) {
+            DEBUG("elf: %s: %s not found", obj->path, name);
+            errno = ENOENT;
+            return -1;
+        }
+        if ((closure_add_path(closure, path) != 0)
+            || (map_put(closure->names, name, &(char){0}) == NULL)) {
+
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *  プログラムのクロージャを求める.
+ *
+ *  集合の先頭はプログラム自身となる.
+ */
+static int resolve_closure(struct elf_closure *closure, const char *pathname, const struct stat *status)
+{
+    char *main_rpath = calloc(1, ELF_SEARCH_MAX);
+    bool main_seen = false;
+
+    if (main_rpath == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (closure_add(closure, pathname, status) != 0) {
+        free(main_rpath);
+        return -1;
+    }
+
+    /* 追加したファイルも, 順に解析する. */
+    int ret = 0;
+    for (size_t i = 0; (ret == 0) && (i < closure->count); ++i) {
+        struct elf_object obj;
+
+        ret = elf_object_open(&obj, closure->files[i].path);
+        if (ret == 0) {
+            ret = resolve_object(closure, &obj, main_rpath, &main_seen);
+            elf_object_close(&obj);
+        }
+    }
+    free(main_rpath);
+
+    return ret;
+}
+
+/**
+ *  プログラムのキャッシュファイルのパスを求める.
+ *
+ *  @return 成功時は 0 が返る.
+ *          パスが長すぎる場合は -1 が返り, errno に ENAMETOOLONG が設定される.
+ */
+static int cache_file_path(struct elf_deps *self,
+                            const char *pathname,
+                            const struct stat *status,
+                            char *path,
+                            size_t size)
+{
+    uint64_t key = fnv1a64_string(pathname);
+    key = fnv1a64_update(key, &status->st_dev, sizeof(status->st_dev));
+    key = fnv1a64_update(key, &status->st_ino, sizeof(status->st_ino));
+    key = fnv1a64_update(key, &status->st_mtim, sizeof(status->st_mtim));
+
+    if (snprintf(path, size, "%s/%016" PRIx64, self->cache_path, key) >= (int)size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  キャッシュからクロージャを読み込む.
+ *
+ *  記録したファイルが全て更新されていない場合のみ使用する.
+ *
+ *  @return 使用できる場合は 0 が返り, それ以外は -1 が返る.
+ */
+static int cache_load(const char *path, struct elf_closure *closure)
+{
+    FILE *fp = fopen(path, "re");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    int ret = 0;
+    while ((ret == 0) && ((length = getline(&line, &capacity, fp)) > 0)) {
+        uintmax_t dev;
+        uintmax_t ino;
+        intmax_t sec;
+        long nsec;
+        int offset;
+        struct stat status;
+
+        if (line[length - 1] == '\n') {
+            line[length - 1] = '\0';
+        }
+        if ((sscanf(line, "%ju %ju %jd %ld %n", &dev, &ino, &sec, &nsec, &offset) != 4)
+            || (line[offset] != '/')
+            || (stat(&line[offset], &status) != 0)
+            || ((uintmax_t)status.st_dev != dev)
+            || ((uintmax_t)status.st_ino != ino)
+            || (status.st_mtim.tv_sec != sec)
+            || (status.st_mtim.tv_nsec != nsec)) {
+
+            DEBUG("elf: cache %s is stale", path);
+            ret = -1;
+        } else {
+            ret = closure_add(closure, &line[offset], &status);
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    return ((ret == 0) && (closure->count > 0)) ? 0 : -1;
+}
+
+/**
+ *  クロージャをキャッシュに保存する.
+ *
+ *  一時ファイルに書き込んだ後に置き換えるため, 書き込み中のキャッシュを
+ *  他のプロセスが読むことはない.
+ */
+static int cache_save(struct elf_deps *self, const char *path, const struct elf_closure *closure)
+{
+    char temp[PATH_MAX];
+
+    if (make_directories(self->cache_path, ELF_CACHE_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), self->cache_path);
+        return -1;
+    }
+    if (snprintf(temp, sizeof(temp), "%s.XXXXXX", path) >= (int)sizeof(temp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(temp);
+    if (fd < 0) {
+        DEBUG("mkstemp: %s (%s)", strerror(errno), temp);
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        unlink(temp);
+        return -1;
+    }
+    for (size_t i = 0; i < closure->count; ++i) {
+        const struct elf_file *file = &closure->files[i];
+        fprintf(fp, "%ju %ju %jd %ld %s\n",
+                (uintmax_t)file->dev, (uintmax_t)file->ino,
+                (intmax_t)file->mtime.tv_sec, file->mtime.tv_nsec, file->path);
+    }
+    if ((fclose(fp) != 0) || (rename(temp, path) != 0)) {
+        DEBUG("elf: failed to save %s: %s", path, strerror(errno));
+        unlink(temp);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    空の依存ファイル集合を確保および初期化する.
+ *              @c cache_path が NULL または空文字列の場合は, キャッシュを使用しない.
+ *
+ *  @param      [in]    cache_path  クロージャのキャッシュを格納するディレクトリ.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+ELF_DEPS elf_deps_init(const char *cache_path)
+{
+    struct elf_deps *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    /* キャッシュファイルの名前 ("/" と 16 桁のキー) も収まる必要がある. */
+    if ((cache_path != NULL)
+        && (snprintf(self->cache_path, sizeof(self->cache_path), "%s", cache_path)
+            >= (int)(sizeof(self->cache_path) - 17))) {
+
+        free(self);
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    if (closure_init(&self->all, false) != 0) {
+        free(self);
+        return NULL;
+    }
+
+    return (ELF_DEPS)self;
+}
+
+/**
+ *  @details    @c deps を解放する.
+ *
+ *  @param      [in,out]    deps    依存ファイル集合オブジェクト.
+ */
+void elf_deps_release(ELF_DEPS deps)
+{
+    struct elf_deps *self = (struct elf_deps *)deps;
+
+    if (self != NULL) {
+        closure_release(&self->all);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c pathname と, その実行に必要な動的リンカ, ライブラリ,
+ *              インタプリタを集合に追加する.
+ *              有効なキャッシュがあれば ELF を解析せずに使用し,
+ *              無ければ解決した結果をキャッシュに保存する.
+ *
+ *  @param      [in,out]    deps        依存ファイル集合オブジェクト.
+ *  @param      [in]        pathname    プログラムの絶対パス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              依存ライブラリが見つからない場合は, errno に ENOENT が設定される.
+ */
+int elf_deps_add(ELF_DEPS deps, const char *pathname)
+{
+    struct elf_deps *self = (struct elf_deps *)deps;
+    struct elf_closure closure;
+    struct stat status;
+    char path[PATH_MAX];
+    uint64_t start = monotonic_ns();
+
+    if ((self == NULL) || (pathname == NULL) || (pathname[0] != '/')) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (stat(pathname, &status) != 0) {
+        DEBUG("stat: %s (%s)", strerror(errno), pathname);
+        return -1;
+    }
+
+    bool cached = false;
+    bool use_cache = (self->cache_path[0] != '\0')
+                  && (cache_file_path(self, pathname, &status, path, sizeof(path)) == 0);
+    int ret;
+    if (use_cache) {
+        if (closure_init(&closure, false) != 0) {
+            return -1;
+        }
+        cached = (cache_load(path, &closure) == 0);
+        if (!cached) {
+            closure_release(&closure);
+        }
+    }
+    if (cached) {
+        ret = 0;
+    } else {
+        if (closure_init(&closure, true) != 0) {
+            return -1;
+        }
+        ret = resolve_closure(&closure, pathname, &status);
+        if ((ret == 0) && use_cache) {
+            /* 保存できなくても, 次回も解決すれば良い. */
+            cache_save(self, path, &closure);
+        }
+    }
+    if (ret == 0) {
+        ret = closure_merge(&self->all, &closure);
+    }
+    int error = errno;
+    closure_release(&closure);
+
+    ++self->binaries;
+    self->cache_hits += cached ? 1 : 0;
+    self->elapsed_ns += monotonic_ns() - start;
+    errno = error;
+
+    return ret;
+}
+
+/**
+ *  @details    集合に含まれるファイルの数を取得する.
+ *
+ *  @param      [in]    deps    依存ファイル集合オブジェクト.
+ *  @return     ファイルの数が返る.
+ */
+size_t elf_deps_count(ELF_DEPS deps)
+{
+    struct elf_deps *self = (struct elf_deps *)deps;
+
+    return (self != NULL) ? self->all.count : 0;
+}
+
+/**
+ *  @details    集合に含まれるファイルのパスを, 追加した順に取得する.
+ *
+ *  @param      [in]    deps    依存ファイル集合オブジェクト.
+ *  @param      [in]    index   ファイルの番号.
+ *  @return     成功時は, ファイルのパスが返る.
+ *              範囲外の場合は, NULL が返る.
+ */
+const char *elf_deps_get(ELF_DEPS deps, size_t index)
+{
+    struct elf_deps *self = (struct elf_deps *)deps;
+
+    if ((self == NULL) || (index >= self->all.count)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return self->all.files[index].path;
+}
+
+/**
+ *  @details    依存ファイル集合の統計情報を取得する.
+ *
+ *  @param      [in]    deps    依存ファイル集合オブジェクト.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int elf_deps_get_stats(ELF_DEPS deps, struct elf_deps_stats *stats)
+{
+    struct elf_deps *self = (struct elf_deps *)deps;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    stats->binaries = self->binaries;
+    stats->cache_hits = self->cache_hits;
+    stats->files = self->all.count;
+    stats->elapsed_us = self->elapsed_ns / UINT64_C(1000);
+
+    return 0;
+}
+
+/**
+ *  @details    開いた ELF のクラス, マシン, 種別と DT_SONAME を取得する.
+ *
+ *  @param      [in]    fd      ファイル記述子.
+ *  @param      [out]   info    ELF の識別情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              ELF でない場合は, errno に ENOEXEC が設定される.
+ */
+int elf_read_info(int fd, struct elf_info *info)
+{
+    struct elf_object obj;
+
+    if (info == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (elf_object_map(&obj, fd, "-") != 0) {
+        return -1;
+    }
+    if (!obj.is_elf) {
+        elf_object_close(&obj);
+        errno = ENOEXEC;
+        return -1;
+    }
+
+    info->elf_class = obj.elf_class;
+    info->machine = obj.machine;
+    info->type = obj.type;
+    info->flags = obj.flags;
+    info->soname[0] = '\0';
+    if ((obj.soname != NULL) && (strlen(obj.soname) < sizeof(info->soname))) {
+        strcpy(info->soname, obj.soname);
+    }
+    elf_object_close(&obj);
+
+    return 0;
+}
+
+/**
+ *  @details    クラスとマシンに対応するマルチアーキテクチャのディレクトリ名
+ *              (例えば "x86_64-linux-gnu") を取得する.
+ *
+ *  @param      [in]    elf_class   ELF のクラス.
+ *  @param      [in]    machine     ELF のマシン.
+ *  @return     ディレクトリ名が返る. 対応するものが無い場合は NULL が返る.
+ */
+const char *elf_multiarch(unsigned char elf_class, uint16_t machine)
+{
+    for (size_t i = 0; i < sizeof(multiarch) / sizeof(multiarch[0]); ++i) {
+        if ((multiarch[i].machine == machine) && (multiarch[i].elf_class == elf_class)) {
+            return multiarch[i].triplet;
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,114 @@
+/** @file       elfdeps.h
+ *  @brief      ELF の依存ライブラリの解決を提供する.
+ *
+ *  プログラムの PT_INTERP と DT_NEEDED を再帰的に辿り, 実行に必要な
+ *  ファイルの一覧 (クロージャ) を求める. クロージャはプログラム毎に
+ *  キャッシュし, プログラムと依存ファイルが更新されていなければ再利用する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_ELFDEPS_H__
+#define __ALCATRAZ_ELFDEPS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup cat_elfdeps ELF dependencies
+ *  ELF の依存ライブラリを解決するモジュール.
+ *  @{
+ */
+
+/**
+ *  一つのクロージャに含められるファイルの最大数.
+ */
+#define ELF_DEPS_FILES_MAX (1024)
+
+/**
+ *  取得できる DT_SONAME の最大長.
+ */
+#define ELF_SONAME_MAX (256)
+
+/**
+ *  依存ファイル集合型.
+ */
+typedef struct {} *ELF_DEPS;
+
+/**
+ *  依存ファイル集合の統計情報.
+ */
+struct elf_deps_stats {
+    size_t binaries;     /**< 追加したプログラムの数. */
+    size_t cache_hits;   /**< キャッシュを使用したプログラムの数. */
+    size_t files;        /**< 集合に含まれるファイルの数. */
+    uint64_t elapsed_us; /**< 解決に要した時間の合計 (マイクロ秒). */
+};
+
+/**
+ *  ELF の識別情報.
+ */
+struct elf_info {
+    unsigned char elf_class;     /**< クラス. (ELFCLASS32 / ELFCLASS64) */
+    uint16_t machine;            /**< マシン. (EM_*) */
+    uint16_t type;               /**< 種別. (ET_*) */
+    uint32_t flags;              /**< マシン固有のフラグ. (e_flags) */
+    char soname[ELF_SONAME_MAX]; /**< DT_SONAME. 無い場合は空文字列. */
+};
+
+/**
+ *  依存ファイル集合を初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          ELF_DEPS deps = elf_deps_init("/run/alctrz/elf");
+ *          elf_deps_add(deps, "/usr/bin/env");
+ *          for (size_t i = 0; i < elf_deps_count(deps); ++i) {
+ *              const char *path = elf_deps_get(deps, i);
+ *              // path を jail にバインドする.
+ *          }
+ *          elf_deps_release(deps);
+ *          @endcode
+ */
+ELF_DEPS elf_deps_init(const char *cache_path);
+
+/**
+ *  依存ファイル集合を解放する.
+ */
+void elf_deps_release(ELF_DEPS deps);
+
+/**
+ *  プログラムと, その実行に必要なファイルを集合に追加する.
+ */
+int elf_deps_add(ELF_DEPS deps, const char *pathname);
+
+/**
+ *  集合に含まれるファイルの数を取得する.
+ */
+size_t elf_deps_count(ELF_DEPS deps);
+
+/**
+ *  集合に含まれるファイルのパスを取得する.
+ */
+const char *elf_deps_get(ELF_DEPS deps, size_t index);
+
+/**
+ *  依存ファイル集合の統計情報を取得する.
+ */
+int elf_deps_get_stats(ELF_DEPS deps, struct elf_deps_stats *stats);
+
+/**
+ *  ELF の識別情報を取得する.
+ */
+int elf_read_info(int fd, struct elf_info *info);
+
+/**
+ *  マルチアーキテクチャのディレクトリ名を取得する.
+ */
+const char *elf_multiarch(unsigned char elf_class, uint16_t machine);
+
+/** @} */
+
+#endif /* __ALCATRAZ_ELFDEPS_H__ */
@@ -0,0 +1,477 @@
+/** @file       fsutil.c
+ *  @brief      ファイルシステム操作の補助機能を提供する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX, getline */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+
+#include "fsutil.h"
+#include "debug.h"
+
+/**
+ *  @details    @c pathname までのディレクトリを順に作成する.
+ *              既に存在するディレクトリはそのまま使用する.
+ *
+ *  @param      [in]    pathname    作成するディレクトリのパス.
+ *  @param      [in]    mode        作成するディレクトリのアクセス権限.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int make_directories(const char *pathname, mode_t mode)
+{
+    char path[PATH_MAX];
+
+    if (strlen(pathname) > sizeof(path) - 1) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strncpy(path, pathname, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+
+    for (char *sep = path + 1; *sep != '\0'; ++sep) {
+        if (*sep == '/') {
+            *sep = '\0';
+            if ((mkdir(path, mode) != 0) && (errno != EEXIST)) {
+                return -1;
+            }
+            *sep = '/';
+        }
+    }
+    if ((mkdir(path, mode) != 0) && (errno != EEXIST)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    statx(2) の STATX_ATTR_MOUNT_ROOT でマウントポイントかを判定する.
+ *              カーネルが対応していない場合は, @c pathname と親ディレクトリの
+ *              デバイス番号を比較する.
+ *
+ *  @param      [in]    pathname    判定するディレクトリのパス.
+ *  @return     マウントポイントの場合は true が返る.
+ *  @remarks    statx(2) が使用できない場合, 同一ファイルシステムの
+ *              バインドマウントは判定できない.
+ */
+bool is_mount_point(const char *pathname)
+{
+    char parent[PATH_MAX];
+    struct stat self_stat, parent_stat;
+
+#ifdef STATX_ATTR_MOUNT_ROOT
+    struct statx status;
+    if ((statx(AT_FDCWD, pathname, AT_NO_AUTOMOUNT, 0, &status) == 0)
+        && (status.stx_attributes_mask & STATX_ATTR_MOUNT_ROOT)) {
+
+        return (status.stx_attributes & STATX_ATTR_MOUNT_ROOT) != 0;
+    }
+#endif
+
+    if (snprintf(parent, sizeof(parent), "%s/..", pathname) >= (int)sizeof(parent)) {
+        return false;
+    }
+    if ((stat(pathname, &self_stat) != 0) || (stat(parent, &parent_stat) != 0)) {
+        return false;
+    }
+
+    return (self_stat.st_dev != parent_stat.st_dev)
+        || (self_stat.st_ino == parent_stat.st_ino);
+}
+
+/**
+ *  @details    @c path が @c parent の配下 (@c parent 自身は除く) かどうかを判定する.
+ *              @c parent が '/' で終わる場合 ("/" など) も判定できる.
+ *
+ *  @param      [in]    path    判定するパス.
+ *  @param      [in]    parent  親ディレクトリのパス.
+ *  @return     配下にある場合は true が返る.
+ */
+bool is_path_under(const char *path, const char *parent)
+{
+    size_t length = strlen(parent);
+
+    return (strncmp(path, parent, length) == 0)
+        && ((path[length] == '/') || ((length > 0) && (parent[length - 1] == '/') && (path[length] != '\0')));
+}
+
+/**
+ *  @details    /proc/<pid>/mountinfo の行数から, @c pid のプロセスが属する
+ *              マウント名前空間のマウント数を数える.
+ *
+ *  @param      [in]    pid     プロセス ID. 0 の場合は自身.
+ *  @return     成功時は, マウントの数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+ssize_t count_mounts(pid_t pid)
+{
+    char path[PATH_MAX];
+    char buf[BUFSIZ];
+    ssize_t count = 0;
+    ssize_t length;
+
+    if (pid == 0) {
+        strncpy(path, "/proc/self/mountinfo", sizeof(path));
+    } else {
+        snprintf(path, sizeof(path), "/proc/%d/mountinfo", (int)pid);
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    while ((length = read(fd, buf, sizeof(buf))) > 0) {
+        for (const char *p = buf; (p = memchr(p, '\n', buf + length - p)) != NULL; ++p) {
+            ++count;
+        }
+    }
+    int err = errno;
+    close(fd);
+    if (length < 0) {
+        errno = err;
+        return -1;
+    }
+
+    return count;
+}
+
+/**
+ *  root の中で辿るシンボリックリンクの最大数. (カーネルの MAXSYMLINKS と同じ)
+ */
+#define IN_ROOT_LINKS_MAX (40)
+
+/**
+ *  root の中で辿るディレクトリの最大の深さ.
+ */
+#define IN_ROOT_DEPTH_MAX (PATH_MAX / 2)
+
+/**
+ *  パスの先頭の要素を取り出す.
+ *
+ *  @return 要素がある場合は, 要素の長さが返り, @c rest は残りの先頭に進む.
+ *          要素が無い場合は, 0 が返る.
+ */
+static size_t next_component(const char **rest, const char **component)
+{
+    const char *p = *rest;
+
+    while (*p == '/') {
+        ++p;
+    }
+    *component = p;
+    while ((*p != '\0') && (*p != '/')) {
+        ++p;
+    }
+    size_t length = p - *component;
+    while (*p == '/') {
+        ++p;
+    }
+    *rest = p;
+
+    return length;
+}
+
+/**
+ *  openat2(2) の RESOLVE_IN_ROOT と同様に, 要素を 1 つずつ辿って開く.
+ *
+ *  各要素は O_NOFOLLOW で開き, シンボリックリンクは root の中で解決する.
+ *  (絶対パスは root から, ".." は root より上には辿らない)
+ *  辿ったディレクトリは記述子のスタックに積むため, ".." も開いた
+ *  ディレクトリの親を指す.
+ */
+static int open_in_root_walk(int root_fd, const char *pathname, int flags, mode_t mode)
+{
+    char path[PATH_MAX];
+    char link[PATH_MAX];
+    const char *rest;
+    const char *component;
+    size_t length;
+    size_t depth = 0;
+    int links = 0;
+    int fd = -1;
+
+    if (snprintf(path, sizeof(path), "%s", pathname) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int *stack = malloc(sizeof(int) * (IN_ROOT_DEPTH_MAX + 1));
+    if (stack == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    stack[0] = root_fd;
+
+    rest = path;
+    for (;;) {
+        length = next_component(&rest, &component);
+        if (length == 0) {
+            /* 最後の要素が "." や ".." の場合は, 辿った先のディレクトリを開く. */
+            fd = openat(stack[depth], ".", flags | O_NOFOLLOW, mode);
+            break;
+        }
+        if ((length == 1) && (component[0] == '.')) {
+            continue;
+        }
+        if ((length == 2) && (component[0] == '.') && (component[1] == '.')) {
+            if (depth > 0) {
+                close(stack[depth--]);
+            }
+            continue;
+        }
+
+        char name[NAME_MAX + 1];
+        if (length > NAME_MAX) {
+            errno = ENAMETOOLONG;
+            break;
+        }
+        memcpy(name, component, length);
+        name[length] = '\0';
+        bool last = (*rest == '\0');
+
+        int child_fd = openat(stack[depth], name, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+        struct stat status;
+        if ((child_fd >= 0) && (fstat(child_fd, &status) != 0)) {
+            close(child_fd);
+            break;
+        }
+        if ((child_fd >= 0) && S_ISLNK(status.st_mode)
+            && (!last || ((flags & O_NOFOLLOW) == 0))) {
+
+            /* リンク先と残りの要素を繋げ, 辿り直す. */
+            ssize_t link_length = readlinkat(child_fd, "", link, sizeof(link) - 1);
+            close(child_fd);
+            if (link_length < 0) {
+                break;
+            }
+            link[link_length] = '\0';
+            if (++links > IN_ROOT_LINKS_MAX) {
+                errno = ELOOP;
+                break;
+            }
+            char joined[PATH_MAX];
+            if (snprintf(joined, sizeof(joined), "%s/%s", link, rest) >= (int)sizeof(joined)) {
+                errno = ENAMETOOLONG;
+                break;
+            }
+            memcpy(path, joined, sizeof(path));
+            rest = path;
+            if (link[0] == '/') {
+                while (depth > 0) {
+                    close(stack[depth--]);
+                }
+            }
+            continue;
+        }
+
+        if (last) {
+            if (child_fd >= 0) {
+                close(child_fd);
+            }
+            /* 最後の要素も O_NOFOLLOW で開くため, 確認後に置き換えられても辿らない. */
+            fd = openat(stack[depth], name, flags | O_NOFOLLOW, mode);
+            break;
+        }
+        if (child_fd < 0) {
+            break;
+        }
+        if (!S_ISDIR(status.st_mode)) {
+            close(child_fd);
+            errno = ENOTDIR;
+            break;
+        }
+        if (depth >= IN_ROOT_DEPTH_MAX) {
+            close(child_fd);
+            errno = ENAMETOOLONG;
+            break;
+        }
+        stack[++depth] = child_fd;
+    }
+
+    int error = errno;
+    while (depth > 0) {
+        close(stack[depth--]);
+    }
+    free(stack);
+    errno = error;
+
+    return fd;
+}
+
+/**
+ *  @details    @c root_fd を root として @c pathname を開く.
+ *              絶対パスのシンボリックリンクや ".." も @c root_fd の外には出ない.
+ *              openat2(2) が使用できない場合は, 要素を 1 つずつ O_NOFOLLOW で
+ *              開き, シンボリックリンクを root の中で解決する.
+ *
+ *  @param      [in]    root_fd     root とするディレクトリの記述子.
+ *  @param      [in]    pathname    root からのパス.
+ *  @param      [in]    flags       open(2) のフラグ.
+ *  @param      [in]    mode        作成する場合のアクセス権限.
+ *  @return     成功時は, ファイル記述子が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int open_in_root(int root_fd, const char *pathname, int flags, mode_t mode)
+{
+#ifdef SYS_openat2
+    struct open_how how = {
+        .flags = (uint64_t)flags,
+        .mode = ((flags & O_CREAT) != 0) ? mode : 0,
+        .resolve = RESOLVE_IN_ROOT | RESOLVE_NO_MAGICLINKS,
+    };
+
+    int fd = syscall(SYS_openat2, root_fd, pathname, &how, sizeof(how));
+    if ((fd >= 0) || (errno != ENOSYS)) {
+        return fd;
+    }
+#endif
+
+    return open_in_root_walk(root_fd, pathname, flags, mode);
+}
+
+/**
+ *  @details    標準入出力と @c keep_fd を除き, 全ての記述子を閉じる.
+ *              切り離したプロセスが, 呼び出し元の端末や FIFO, パイプを
+ *              開いたままにしないよう使用する.
+ *              close_range(2) が使用できない場合は, /proc/self/fd を走査する.
+ *
+ *  @param      [in]    keep_fd 閉じない記述子. (無い場合は -1)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int close_inherited_fds(int keep_fd)
+{
+    const unsigned int first = STDERR_FILENO + 1;
+
+#ifdef SYS_close_range
+    int ret = 0;
+    if (keep_fd < (int)first) {
+        ret = syscall(SYS_close_range, first, ~0U, 0);
+    } else {
+        if ((unsigned int)keep_fd > first) {
+            ret = syscall(SYS_close_range, first, (unsigned int)keep_fd - 1, 0);
+        }
+        if (ret == 0) {
+            ret = syscall(SYS_close_range, (unsigned int)keep_fd + 1, ~0U, 0);
+        }
+    }
+    if ((ret == 0) || (errno != ENOSYS)) {
+        return ret;
+    }
+#endif
+
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir == NULL) {
+        DEBUG("opendir: %s (/proc/self/fd)", strerror(errno));
+        return -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char *end;
+        long fd = strtol(entry->d_name, &end, 10);
+        if ((*end != '\0') || (end == entry->d_name) || (fd < (long)first)
+            || (fd == keep_fd) || (fd == dirfd(dir))) {
+
+            continue;
+        }
+        close((int)fd);
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+/**
+ *  @details    mountinfo のマウントポイントなどのエスケープ (\\ooo) を解除する.
+ *
+ *  @param      [out]   dst     解除した文字列.
+ *  @param      [in]    src     mountinfo のフィールド.
+ *  @param      [in]    length  @c dst のサイズ.
+ */
+void unescape_mountinfo(char *dst, const char *src, size_t length)
+{
+    size_t i = 0;
+
+    while ((*src != '\0') && (i + 1 < length)) {
+        if ((src[0] == '\\')
+            && (src[1] >= '0') && (src[1] <= '7')
+            && (src[2] >= '0') && (src[2] <= '7')
+            && (src[3] >= '0') && (src[3] <= '7')) {
+
+            dst[i++] = ((src[1] - '0') << 6) | ((src[2] - '0') << 3) | (src[3] - '0');
+            src += 4;
+        } else {
+            dst[i++] = *src++;
+        }
+    }
+    dst[i] = '\0';
+}
+
+/**
+ *  @details    /proc/self/mountinfo の各行について, マウントポイントと
+ *              ファイルシステムの種別を @c visitor に渡す.
+ *
+ *  @param      [in]    visitor マウントを通知する関数.
+ *  @param      [in]    arg     @c visitor に渡す引数.
+ *  @return     全て走査した場合は, 0 が返る.
+ *              @c visitor が中断した場合は, その戻り値が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int for_each_mount(mount_visitor visitor, void *arg)
+{
+    char mount_point[PATH_MAX];
+    char *line = NULL;
+    size_t capacity = 0;
+    int ret = 0;
+
+    FILE *fp = fopen("/proc/self/mountinfo", "re");
+    if (fp == NULL) {
+        DEBUG("fopen: %s (/proc/self/mountinfo)", strerror(errno));
+        return -1;
+    }
+    while ((ret == 0) && (getline(&line, &capacity, fp) > 0)) {
+        /* マウントポイントは 5 番目, 種別は " - " の次のフィールド. */
+        char *fields[5];
+        char *save = NULL;
+        char *field = strtok_r(line, " \n", &save);
+        for (int i = 0; (i < 5) && (field != NULL); ++i) {
+            fields[i] = field;
+            field = (i < 4) ? strtok_r(NULL, " \n", &save) : NULL;
+        }
+        char *fstype = NULL;
+        while ((field = strtok_r(NULL, " \n", &save)) != NULL) {
+            if (strcmp(field, "-") == 0) {
+                fstype = strtok_r(NULL, " \n", &save);
+                break;
+            }
+        }
+        if (fstype == NULL) {
+            continue;
+        }
+        unescape_mountinfo(mount_point, fields[4], sizeof(mount_point));
+        ret = visitor(arg, mount_point, fstype);
+    }
+    free(line);
+    fclose(fp);
+
+    return ret;
+}
@@ -0,0 +1,63 @@
+/** @file       fsutil.h
+ *  @brief      ファイルシステム操作の補助機能を提供する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_FSUTIL_H__
+#define __ALCATRAZ_FSUTIL_H__
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ *  親ディレクトリを含めてディレクトリを作成する.
+ */
+int make_directories(const char *pathname, mode_t mode);
+
+/**
+ *  指定のパスがマウントポイントかを判定する.
+ */
+bool is_mount_point(const char *pathname);
+
+/**
+ *  プロセスのマウント名前空間にあるマウントの数を返す.
+ */
+ssize_t count_mounts(pid_t pid);
+
+/**
+ *  パスが親ディレクトリの配下にあるかを判定する.
+ */
+bool is_path_under(const char *path, const char *parent);
+
+/**
+ *  jail などの root を起点にパスを解決して開く.
+ */
+int open_in_root(int root_fd, const char *pathname, int flags, mode_t mode);
+
+/**
+ *  mountinfo のエスケープ (\\ooo) を解除する.
+ */
+void unescape_mountinfo(char *dst, const char *src, size_t length);
+
+/**
+ *  標準入出力と指定の記述子を除き, 引き継いだ記述子を閉じる.
+ */
+int close_inherited_fds(int keep_fd);
+
+/**
+ *  マウントを通知する関数の型.
+ *
+ *  0 以外を返すと, 走査を中断する.
+ */
+typedef int (*mount_visitor)(void *arg, const char *mount_point, const char *fstype);
+
+/**
+ *  自身のマウント名前空間にある全てのマウントを走査する.
+ */
+int for_each_mount(mount_visitor visitor, void *arg);
+
+#endif /* __ALCATRAZ_FSUTIL_H__ */
@@ -0,0 +1,57 @@
+/** @file       hash.h
+ *  @brief      ハッシュ関数を提供する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_HASH_H__
+#define __ALCATRAZ_HASH_H__
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ *  FNV-1a (64bit) の初期値.
+ */
+#define FNV1A64_INIT UINT64_C(0xcbf29ce484222325)
+
+/**
+ *  FNV-1a (64bit) の素数.
+ */
+#define FNV1A64_PRIME UINT64_C(0x100000001b3)
+
+/**
+ *  FNV-1a (64bit) でハッシュ値を更新する.
+ *
+ *  @param  [in]    hash    更新前のハッシュ値.
+ *  @param  [in]    data    データ.
+ *  @param  [in]    length  データ長.
+ *  @return 更新後のハッシュ値が返る.
+ */
+static inline uint64_t fnv1a64_update(uint64_t hash, const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= p[i];
+        hash *= FNV1A64_PRIME;
+    }
+
+    return hash;
+}
+
+/**
+ *  文字列の FNV-1a (64bit) ハッシュ値を返す.
+ *
+ *  @param  [in]    str     文字列.
+ *  @return ハッシュ値が返る.
+ */
+static inline uint64_t fnv1a64_string(const char *str)
+{
+    return fnv1a64_update(FNV1A64_INIT, str, strlen(str));
+}
+
+#endif /* __ALCATRAZ_HASH_H__ */
@@ -0,0 +1,531 @@
+/** @file       image.c
+ *  @brief      rootfs のイメージ (squashfs, erofs) の共用を提供する.
+ *
+ *  イメージは次の構成で管理する.
+ *  - `<path>/<key>/lower/`     イメージのマウントポイント. (読み込み専用)
+ *  - `<path>/<key>/refs/`      イメージを使用する jail への参照.
+ *  - `<path>/<key>.lock`       マウントと参照の操作の排他用ロックファイル.
+ *
+ *  キーはイメージのパス, デバイス, inode, サイズ, 更新時刻および
+ *  ファイルシステムの種別から求めるため, イメージを置き換えると
+ *  新しいマウントを使用する.
+ *
+ *  参照は, jail のパスのハッシュ値を名前とし, jail のパスを指す
+ *  シンボリックリンクである. jail のディレクトリが無くなった参照は
+ *  破棄済みの jail のものとして削除する. ループデバイスは
+ *  LO_FLAGS_AUTOCLEAR で設定するため, イメージを切り離した後,
+ *  最後の jail の overlayfs がアンマウントされた時点で解放される.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <linux/loop.h>
+
+#include "image.h"
+#include "fsutil.h"
+#include "hash.h"
+#include "debug.h"
+
+/**
+ *  イメージ管理ディレクトリのアクセス権限.
+ */
+#define IMAGE_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  マウントポイントのアクセス権限.
+ */
+#define LOWER_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
+
+/**
+ *  空きループデバイスの取得を競合で失敗した場合に, 再試行する回数.
+ */
+#define IMAGE_LOOP_RETRY (8)
+
+/**
+ *  squashfs の識別子. (先頭, リトルエンディアン)
+ */
+#define SQUASHFS_MAGIC_LE "hsqs"
+
+/**
+ *  erofs のスーパーブロックの位置.
+ */
+#define EROFS_SUPER_OFFSET (1024)
+
+/**
+ *  erofs の識別子. (0xE0F5E1E2, リトルエンディアン)
+ */
+#define EROFS_MAGIC_LE "\xe2\xe1\xf5\xe0"
+
+/**
+ *  イメージのディレクトリのロックを取得する.
+ *
+ *  @return 成功時はロックファイルの記述子が返り, 失敗時は -1 が返る.
+ */
+static int lock_image(const char *dir)
+{
+    char path[PATH_MAX + 8];
+
+    snprintf(path, sizeof(path), "%s.lock", dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    if (flock(fd, LOCK_EX) != 0) {
+        DEBUG("flock: %s (%s)", strerror(errno), path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ *  ループデバイスにイメージを読み込み専用で設定する.
+ *
+ *  LOOP_CONFIGURE に対応していないカーネルでは, LOOP_SET_FD と
+ *  LOOP_SET_STATUS64 で設定する. ダイレクト I/O を使用できない場合は,
+ *  ダイレクト I/O を使用せずに設定する.
+ *
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int configure_loop(int loop_fd, int image_fd, const char *image)
+{
+    struct loop_config config = {
+        .fd = image_fd,
+        .block_size = 0,
+        .info = {
+            .lo_flags = LO_FLAGS_READ_ONLY | LO_FLAGS_AUTOCLEAR | LO_FLAGS_DIRECT_IO,
+        },
+    };
+    strncpy((char *)config.info.lo_file_name, image, LO_NAME_SIZE - 1);
+
+    if (ioctl(loop_fd, LOOP_CONFIGURE, &config) == 0) {
+        return 0;
+    }
+    if ((errno != EINVAL) && (errno != ENOTTY)) {
+        return -1;
+    }
+    config.info.lo_flags &= ~LO_FLAGS_DIRECT_IO;
+    if (ioctl(loop_fd, LOOP_CONFIGURE, &config) == 0) {
+        return 0;
+    }
+    if ((errno != EINVAL) && (errno != ENOTTY)) {
+        return -1;
+    }
+
+    if (ioctl(loop_fd, LOOP_SET_FD, image_fd) != 0) {
+        return -1;
+    }
+    if (ioctl(loop_fd, LOOP_SET_STATUS64, &config.info) != 0) {
+        int error = errno;
+        ioctl(loop_fd, LOOP_CLR_FD, 0);
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  イメージを空きループデバイスに設定し, @c lower にマウントする.
+ *
+ *  ループデバイスはマウントが保持するため, 記述子は閉じる.
+ */
+static int mount_image(const char *image, const char *fstype, const char *lower)
+{
+    char device[32];
+    int ret = -1;
+
+    int image_fd = open(image, O_RDONLY | O_CLOEXEC);
+    if (image_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), image);
+        return -1;
+    }
+    int control_fd = open("/dev/loop-control", O_RDWR | O_CLOEXEC);
+    if (control_fd < 0) {
+        DEBUG("open: %s (/dev/loop-control)", strerror(errno));
+        close(image_fd);
+        return -1;
+    }
+
+    int loop_fd = -1;
+    for (int i = 0; i < IMAGE_LOOP_RETRY; ++i) {
+        int number = ioctl(control_fd, LOOP_CTL_GET_FREE);
+        if (number < 0) {
+            DEBUG("ioctl: %s (LOOP_CTL_GET_FREE)", strerror(errno));
+            break;
+        }
+        snprintf(device, sizeof(device), "/dev/loop%d", number);
+        loop_fd = open(device, O_RDONLY | O_CLOEXEC);
+        if (loop_fd < 0) {
+            DEBUG("open: %s (%s)", strerror(errno), device);
+            break;
+        }
+        if (configure_loop(loop_fd, image_fd, image) == 0) {
+            break;
+        }
+        /* 他のプロセスが同じデバイスを先に設定した. */
+        int error = errno;
+        close(loop_fd);
+        loop_fd = -1;
+        if (error != EBUSY) {
+            DEBUG("ioctl: %s (%s)", strerror(error), device);
+            errno = error;
+            break;
+        }
+    }
+    close(control_fd);
+    close(image_fd);
+    if (loop_fd < 0) {
+        return -1;
+    }
+
+    ret = mount(device, lower, fstype, MS_RDONLY, NULL);
+    if (ret != 0) {
+        DEBUG("mount: %s (%s on %s, %s)", strerror(errno), device, lower, fstype);
+    } else {
+        DEBUG("image: %s attached to %s, mounted on %s", image, device, lower);
+    }
+    close(loop_fd);
+
+    return ret;
+}
+
+/**
+ *  jail からの参照の名前を生成する.
+ */
+static void ref_path(char *path, size_t length, const char *dir, const char *holder)
+{
+    snprintf(path, length, "%s/refs/%016" PRIx64, dir, fnv1a64_string(holder));
+}
+
+/**
+ *  jail からの参照を追加する.
+ */
+static int add_ref(const char *dir, const char *holder)
+{
+    char path[PATH_MAX + 32];
+
+    ref_path(path, sizeof(path), dir, holder);
+    if ((symlink(holder, path) != 0) && (errno != EEXIST)) {
+        DEBUG("symlink: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  破棄済みの jail の参照を削除し, 残った参照の数を数える.
+ */
+static size_t prune_refs(const char *dir, struct image_reap_stats *stats)
+{
+    char path[PATH_MAX + 8];
+    char holder[PATH_MAX];
+    size_t count = 0;
+
+    snprintf(path, sizeof(path), "%s/refs", dir);
+    DIR *refs = opendir(path);
+    if (refs == NULL) {
+        return 0;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(refs)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        ssize_t length = readlinkat(dirfd(refs), entry->d_name, holder, sizeof(holder) - 1);
+        if (length >= 0) {
+            struct stat status;
+            holder[length] = '\0';
+            if ((lstat(holder, &status) == 0) && S_ISDIR(status.st_mode)) {
+                ++count;
+                continue;
+            }
+        }
+        if (unlinkat(dirfd(refs), entry->d_name, 0) == 0) {
+            if (stats != NULL) {
+                ++stats->refs;
+            }
+        }
+    }
+    closedir(refs);
+
+    return count;
+}
+
+/**
+ *  jail からの参照を削除し, 参照が無くなればイメージを切り離す.
+ *
+ *  @param  [in]        dir     イメージのディレクトリ.
+ *  @param  [in]        holder  jail のパス. (NULL の場合は削除しない)
+ *  @param  [in,out]    stats   回収処理の結果. (NULL 可)
+ */
+static int release_image(const char *dir, const char *holder, struct image_reap_stats *stats)
+{
+    char path[PATH_MAX + 32];
+
+    int lock_fd = lock_image(dir);
+    if (lock_fd < 0) {
+        return -1;
+    }
+    if (holder != NULL) {
+        ref_path(path, sizeof(path), dir, holder);
+        if ((unlink(path) != 0) && (errno != ENOENT)) {
+            DEBUG("unlink: %s (%s)", strerror(errno), path);
+        }
+    }
+
+    int ret = 0;
+    snprintf(path, sizeof(path), "%s/lower", dir);
+    if ((prune_refs(dir, stats) == 0) && is_mount_point(path)) {
+        /* 使用中の jail の overlayfs は, 切り離した後もイメージを参照できる. */
+        ret = umount2(path, MNT_DETACH);
+        if (ret != 0) {
+            DEBUG("umount2: %s (%s)", strerror(errno), path);
+        } else {
+            DEBUG("image: detached %s", path);
+            if (stats != NULL) {
+                ++stats->detached;
+            }
+        }
+    }
+    close(lock_fd);
+
+    return ret;
+}
+
+/**
+ *  @details    @c image の先頭を読み, ファイルシステムの種別を判定する.
+ *
+ *  @param      [in]    image   イメージファイルのパス.
+ *  @return     成功時は, "squashfs" または "erofs" が返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+const char *image_detect(const char *image)
+{
+    char magic[4];
+
+    if (image == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int fd = open(image, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), image);
+        return NULL;
+    }
+    const char *fstype = NULL;
+    if ((pread(fd, magic, sizeof(magic), 0) == sizeof(magic))
+        && (memcmp(magic, SQUASHFS_MAGIC_LE, sizeof(magic)) == 0)) {
+
+        fstype = "squashfs";
+    } else if ((pread(fd, magic, sizeof(magic), EROFS_SUPER_OFFSET) == sizeof(magic))
+               && (memcmp(magic, EROFS_MAGIC_LE, sizeof(magic)) == 0)) {
+
+        fstype = "erofs";
+    }
+    close(fd);
+
+    if (fstype == NULL) {
+        DEBUG("image: %s is neither squashfs nor erofs", image);
+        errno = EINVAL;
+    }
+
+    return fstype;
+}
+
+/**
+ *  @details    @c image がマウントされていなければ, ループデバイス経由で
+ *              読み込み専用でマウントし, @c holder からの参照を追加する.
+ *              マウント済みの場合は, 参照の追加のみを行う.
+ *
+ *  @param      [in]    path    イメージのマウントを管理するディレクトリ.
+ *  @param      [in]    image   イメージファイルのパス.
+ *  @param      [in]    fstype  ファイルシステムの種別. (NULL または空文字列の場合は判定する)
+ *  @param      [in]    holder  参照する jail のパス. (NULL の場合は参照を追加しない)
+ *  @param      [out]   lower   イメージのマウントポイント.
+ *  @param      [in]    length  @c lower のサイズ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    参照を追加しない場合, マウントは他の jail の
+ *              @ref image_detach で切り離される可能性がある.
+ */
+int image_attach(const char *path,
+                 const char *image,
+                 const char *fstype,
+                 const char *holder,
+                 char *lower,
+                 size_t length)
+{
+    char dir[PATH_MAX];
+    char mount_point[PATH_MAX + 8];
+    struct stat status;
+
+    if ((path == NULL) || (image == NULL) || (lower == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((fstype == NULL) || (fstype[0] == '\0')) {
+        fstype = image_detect(image);
+        if (fstype == NULL) {
+            return -1;
+        }
+    }
+    if (stat(image, &status) != 0) {
+        DEBUG("stat: %s (%s)", strerror(errno), image);
+        return -1;
+    }
+    if (!S_ISREG(status.st_mode)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t key = fnv1a64_string(image);
+    key = fnv1a64_update(key, &status.st_dev, sizeof(status.st_dev));
+    key = fnv1a64_update(key, &status.st_ino, sizeof(status.st_ino));
+    key = fnv1a64_update(key, &status.st_size, sizeof(status.st_size));
+    key = fnv1a64_update(key, &status.st_mtim, sizeof(status.st_mtim));
+    key = fnv1a64_update(key, fstype, strlen(fstype) + 1);
+
+    if (make_directories(path, IMAGE_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    if (snprintf(dir, sizeof(dir), "%s/%016" PRIx64, path, key) >= (int)sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    int lock_fd = lock_image(dir);
+    if (lock_fd < 0) {
+        return -1;
+    }
+
+    int ret = -1;
+    do {
+        snprintf(mount_point, sizeof(mount_point), "%s/refs", dir);
+        if (((mkdir(dir, IMAGE_DIR_PERM) != 0) && (errno != EEXIST))
+            || ((mkdir(mount_point, IMAGE_DIR_PERM) != 0) && (errno != EEXIST))) {
+
+            DEBUG("mkdir: %s (%s)", strerror(errno), mount_point);
+            break;
+        }
+        snprintf(mount_point, sizeof(mount_point), "%s/lower", dir);
+        if ((mkdir(mount_point, LOWER_DIR_PERM) != 0) && (errno != EEXIST)) {
+            DEBUG("mkdir: %s (%s)", strerror(errno), mount_point);
+            break;
+        }
+        if (!is_mount_point(mount_point) && (mount_image(image, fstype, mount_point) != 0)) {
+            break;
+        }
+        if ((holder != NULL) && (add_ref(dir, holder) != 0)) {
+            break;
+        }
+        ret = 0;
+    } while (0);
+    close(lock_fd);
+
+    if (ret == 0) {
+        snprintf(lower, length, "%s", mount_point);
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    @c holder からの参照を削除する. 破棄済みの jail の参照も削除し,
+ *              参照が残っていなければ, イメージのマウントを切り離す.
+ *
+ *  @param      [in]    lower   @ref image_attach で取得したマウントポイント.
+ *  @param      [in]    holder  参照を追加した jail のパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int image_detach(const char *lower, const char *holder)
+{
+    char dir[PATH_MAX];
+
+    if ((lower == NULL) || (holder == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const char *sep = strrchr(lower, '/');
+    if ((sep == NULL) || (strcmp(sep, "/lower") != 0) || ((size_t)(sep - lower) >= sizeof(dir))) {
+        errno = EINVAL;
+        return -1;
+    }
+    snprintf(dir, sizeof(dir), "%.*s", (int)(sep - lower), lower);
+
+    return release_image(dir, holder, NULL);
+}
+
+/**
+ *  @details    @c path が管理する全てのイメージについて, 破棄済みの jail の
+ *              参照を削除し, 参照が残っていないイメージを切り離す.
+ *              異常終了した jail の参照を回収するために使用する.
+ *
+ *  @param      [in]    path    イメージのマウントを管理するディレクトリ.
+ *  @param      [out]   stats   回収処理の結果. (NULL 可)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int image_reap(const char *path, struct image_reap_stats *stats)
+{
+    char dir[PATH_MAX];
+
+    if (path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (stats != NULL) {
+        *stats = (struct image_reap_stats){0};
+    }
+
+    DIR *images = opendir(path);
+    if (images == NULL) {
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(images)) != NULL) {
+        struct stat status;
+        if ((entry->d_name[0] == '.')
+            || (fstatat(dirfd(images), entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+            || !S_ISDIR(status.st_mode)
+            || (snprintf(dir, sizeof(dir), "%s/%s", path, entry->d_name) >= (int)sizeof(dir))) {
+
+            continue;
+        }
+        if (stats != NULL) {
+            ++stats->images;
+        }
+        release_image(dir, NULL, stats);
+    }
+    closedir(images);
+
+    return 0;
+}
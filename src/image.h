@@ -0,0 +1,70 @@
+/** @file       image.h
+ *  @brief      rootfs のイメージ (squashfs, erofs) の共用を提供する.
+ *
+ *  読み込み専用のイメージファイルをループデバイス経由で一度だけマウントし,
+ *  同じイメージを使用する全ての jail で overlayfs の下位層として共用する.
+ *  マウントは jail 毎の参照で管理し, 参照が無くなれば切り離す.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_IMAGE_H__
+#define __ALCATRAZ_IMAGE_H__
+
+#include <stddef.h>
+
+/** @defgroup cat_image Image
+ *  rootfs のイメージを共用するモジュール.
+ *  @{
+ */
+
+/**
+ *  イメージの回収処理の結果.
+ */
+struct image_reap_stats {
+    size_t images;   /**< 調べたイメージの数. */
+    size_t refs;     /**< 削除した参照の数. */
+    size_t detached; /**< 切り離したイメージの数. */
+};
+
+/**
+ *  イメージのファイルシステムの種別を判定する.
+ */
+const char *image_detect(const char *image);
+
+/**
+ *  イメージをマウントし, jail からの参照を追加する.
+ *
+ *  @par    使用例
+ *          @code
+ *          char lower[PATH_MAX];
+ *          image_attach("/run/alctrz/image", "/srv/rootfs.squashfs", NULL,
+ *                       "/tmp/chroot-abcdef", lower, sizeof(lower));
+ *          template_mount(lower, "/tmp/chroot-abcdef", uid, gid);
+ *          // jail の使用後.
+ *          image_detach(lower, "/tmp/chroot-abcdef");
+ *          @endcode
+ */
+int image_attach(const char *path,
+                 const char *image,
+                 const char *fstype,
+                 const char *holder,
+                 char *lower,
+                 size_t length);
+
+/**
+ *  jail からの参照を削除し, 参照が無くなればイメージを切り離す.
+ */
+int image_detach(const char *lower, const char *holder);
+
+/**
+ *  使用されていないイメージを切り離す.
+ */
+int image_reap(const char *path, struct image_reap_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_IMAGE_H__ */
@@ -0,0 +1,300 @@
+/** @file       landlock.c
+ *  @brief      Landlock によるファイルアクセスの制限を提供する.
+ *
+ *  ルールセットは, カーネルが対応する全てのファイルシステムのアクセス権を
+ *  扱い, 許可したパス以下のみアクセスできるようにする. ファイル
+ *  (ディレクトリ以外) に対するルールは, ファイルに適用できる権利のみとする.
+ *  ネットワークなど, ファイルシステム以外は制限しない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for syscall */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/landlock.h>
+
+#include "landlock.h"
+#include "debug.h"
+
+#ifndef LANDLOCK_ACCESS_FS_REFER
+#define LANDLOCK_ACCESS_FS_REFER (1ULL << 13)
+#endif
+#ifndef LANDLOCK_ACCESS_FS_TRUNCATE
+#define LANDLOCK_ACCESS_FS_TRUNCATE (1ULL << 14)
+#endif
+#ifndef LANDLOCK_ACCESS_FS_IOCTL_DEV
+#define LANDLOCK_ACCESS_FS_IOCTL_DEV (1ULL << 15)
+#endif
+
+/**
+ *  ABI バージョン 1 で扱えるアクセス権.
+ */
+#define ACCESS_FS_V1 (LANDLOCK_ACCESS_FS_EXECUTE     \
+                    | LANDLOCK_ACCESS_FS_WRITE_FILE  \
+                    | LANDLOCK_ACCESS_FS_READ_FILE   \
+                    | LANDLOCK_ACCESS_FS_READ_DIR    \
+                    | LANDLOCK_ACCESS_FS_REMOVE_DIR  \
+                    | LANDLOCK_ACCESS_FS_REMOVE_FILE \
+                    | LANDLOCK_ACCESS_FS_MAKE_CHAR   \
+                    | LANDLOCK_ACCESS_FS_MAKE_DIR    \
+                    | LANDLOCK_ACCESS_FS_MAKE_REG    \
+                    | LANDLOCK_ACCESS_FS_MAKE_SOCK   \
+                    | LANDLOCK_ACCESS_FS_MAKE_FIFO   \
+                    | LANDLOCK_ACCESS_FS_MAKE_BLOCK  \
+                    | LANDLOCK_ACCESS_FS_MAKE_SYM)
+
+/**
+ *  ファイルに適用できるアクセス権.
+ */
+#define ACCESS_FILE (LANDLOCK_ACCESS_FS_EXECUTE    \
+                   | LANDLOCK_ACCESS_FS_WRITE_FILE \
+                   | LANDLOCK_ACCESS_FS_READ_FILE  \
+                   | LANDLOCK_ACCESS_FS_TRUNCATE   \
+                   | LANDLOCK_ACCESS_FS_IOCTL_DEV)
+
+/**
+ *  LANDLOCK_ALLOW_READ に対応するアクセス権.
+ */
+#define ACCESS_READ (LANDLOCK_ACCESS_FS_READ_FILE | LANDLOCK_ACCESS_FS_READ_DIR)
+
+/**
+ *  LANDLOCK_ALLOW_WRITE に対応するアクセス権.
+ */
+#define ACCESS_WRITE (LANDLOCK_ACCESS_FS_WRITE_FILE  \
+                    | LANDLOCK_ACCESS_FS_REMOVE_DIR  \
+                    | LANDLOCK_ACCESS_FS_REMOVE_FILE \
+                    | LANDLOCK_ACCESS_FS_MAKE_CHAR   \
+                    | LANDLOCK_ACCESS_FS_MAKE_DIR    \
+                    | LANDLOCK_ACCESS_FS_MAKE_REG    \
+                    | LANDLOCK_ACCESS_FS_MAKE_SOCK   \
+                    | LANDLOCK_ACCESS_FS_MAKE_FIFO   \
+                    | LANDLOCK_ACCESS_FS_MAKE_BLOCK  \
+                    | LANDLOCK_ACCESS_FS_MAKE_SYM    \
+                    | LANDLOCK_ACCESS_FS_REFER       \
+                    | LANDLOCK_ACCESS_FS_TRUNCATE    \
+                    | LANDLOCK_ACCESS_FS_IOCTL_DEV)
+
+/**
+ *  Landlock ルールセット管理構造体.
+ */
+struct landlock {
+    int fd;           /**< ルールセットの記述子. */
+    int abi;          /**< ABI バージョン. */
+    uint64_t handled; /**< ルールセットで扱うアクセス権. */
+    size_t rules;     /**< 追加したルールの数. */
+};
+
+/**
+ *  @details    カーネルが対応する Landlock の ABI バージョンを取得する.
+ *
+ *  @return     成功時は, 1 以上の ABI バージョンが返る.
+ *              Landlock が使用できない場合は, -1 が返り, errno が適切に設定される.
+ */
+int landlock_abi(void)
+{
+#ifdef SYS_landlock_create_ruleset
+    long abi = syscall(SYS_landlock_create_ruleset, NULL, 0, LANDLOCK_CREATE_RULESET_VERSION);
+    if (abi < 0) {
+        DEBUG("landlock_create_ruleset: %s", strerror(errno));
+        return -1;
+    }
+
+    return (int)abi;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/**
+ *  @details    カーネルが対応する全てのファイルシステムのアクセス権を扱う
+ *              Landlock ルールセットを作成する.
+ *
+ *  @return     成功時は, ルールセットオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+LANDLOCK landlock_init(void)
+{
+    int abi = landlock_abi();
+    if (abi < 0) {
+        return NULL;
+    }
+
+    struct landlock *self = malloc(sizeof(*self));
+    if (self == NULL) {
+        return NULL;
+    }
+    self->abi = abi;
+    self->rules = 0;
+    self->handled = ACCESS_FS_V1;
+    if (abi >= 2) {
+        self->handled |= LANDLOCK_ACCESS_FS_REFER;
+    }
+    if (abi >= 3) {
+        self->handled |= LANDLOCK_ACCESS_FS_TRUNCATE;
+    }
+    if (abi >= 5) {
+        self->handled |= LANDLOCK_ACCESS_FS_IOCTL_DEV;
+    }
+
+    struct landlock_ruleset_attr attr = {
+        .handled_access_fs = self->handled,
+    };
+    self->fd = (int)syscall(SYS_landlock_create_ruleset, &attr, sizeof(attr), 0);
+    if (self->fd < 0) {
+        DEBUG("landlock_create_ruleset: %s", strerror(errno));
+        free(self);
+        return NULL;
+    }
+
+    return (LANDLOCK)self;
+}
+
+/**
+ *  @details    Landlock ルールセットを解放する.
+ *              適用済みの制限は解除されない.
+ *
+ *  @param      [in]    ruleset ルールセットオブジェクト.
+ */
+void landlock_release(LANDLOCK ruleset)
+{
+    struct landlock *self = (struct landlock *)ruleset;
+
+    if (self != NULL) {
+        close(self->fd);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c pathname 以下へのアクセスを許可する.
+ *              @c pathname がディレクトリでない場合は, そのファイルのみ許可する.
+ *
+ *  @param      [in,out]    ruleset     ルールセットオブジェクト.
+ *  @param      [in]        pathname    許可するパス.
+ *  @param      [in]        access      許可するアクセス (LANDLOCK_ALLOW_*).
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int landlock_allow(LANDLOCK ruleset, const char *pathname, unsigned int access)
+{
+    struct landlock *self = (struct landlock *)ruleset;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = open(pathname, O_PATH | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), pathname);
+        return -1;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        DEBUG("fstat: %s (%s)", strerror(errno), pathname);
+        close(fd);
+        return -1;
+    }
+
+    uint64_t allowed = 0;
+    if (access & LANDLOCK_ALLOW_READ) {
+        allowed |= ACCESS_READ;
+    }
+    if (access & LANDLOCK_ALLOW_WRITE) {
+        allowed |= ACCESS_WRITE;
+    }
+    if (access & LANDLOCK_ALLOW_EXEC) {
+        allowed |= LANDLOCK_ACCESS_FS_EXECUTE;
+    }
+    if (!S_ISDIR(status.st_mode)) {
+        allowed &= ACCESS_FILE;
+    }
+
+    struct landlock_path_beneath_attr attr = {
+        .allowed_access = allowed & self->handled,
+        .parent_fd = fd,
+    };
+    int ret = 0;
+    if (attr.allowed_access != 0) {
+        ret = (int)syscall(SYS_landlock_add_rule, self->fd, LANDLOCK_RULE_PATH_BENEATH, &attr, 0);
+        if (ret != 0) {
+            DEBUG("landlock_add_rule: %s (%s)", strerror(errno), pathname);
+        } else {
+            self->rules++;
+        }
+    }
+    int error = errno;
+    close(fd);
+    errno = error;
+
+    return ret;
+}
+
+/**
+ *  @details    ルールセットを呼び出したスレッドに適用する.
+ *              CAP_SYS_ADMIN が無い場合は, no_new_privs を設定して適用する.
+ *
+ *  @param      [in]    ruleset ルールセットオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int landlock_enforce(LANDLOCK ruleset)
+{
+    struct landlock *self = (struct landlock *)ruleset;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int ret = (int)syscall(SYS_landlock_restrict_self, self->fd, 0);
+    if ((ret != 0) && (errno == EPERM)) {
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) {
+            DEBUG("prctl: %s", strerror(errno));
+            return -1;
+        }
+        ret = (int)syscall(SYS_landlock_restrict_self, self->fd, 0);
+    }
+    if (ret != 0) {
+        DEBUG("landlock_restrict_self: %s", strerror(errno));
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    Landlock ルールセットの統計情報を取得する.
+ *
+ *  @param      [in]    ruleset ルールセットオブジェクト.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int landlock_get_stats(LANDLOCK ruleset, struct landlock_stats *stats)
+{
+    struct landlock *self = (struct landlock *)ruleset;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    stats->abi = self->abi;
+    stats->rules = self->rules;
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/** @file       landlock.h
+ *  @brief      Landlock によるファイルアクセスの制限を提供する.
+ *
+ *  rootfs を構築せず, 許可したパス以下へのアクセスのみを Landlock の
+ *  ルールセットで許可する. 制限は呼び出したスレッドと, その後に
+ *  生成したプロセスに適用され, 解除できない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_LANDLOCK_H__
+#define __ALCATRAZ_LANDLOCK_H__
+
+#include <stddef.h>
+
+/** @defgroup cat_landlock Landlock
+ *  Landlock でファイルアクセスを制限するモジュール.
+ *  @{
+ */
+
+/**
+ *  許可するアクセス: ファイルの読み込みとディレクトリの一覧.
+ */
+#define LANDLOCK_ALLOW_READ (1 << 0)
+
+/**
+ *  許可するアクセス: ファイルの書き込み, 作成, 削除.
+ */
+#define LANDLOCK_ALLOW_WRITE (1 << 1)
+
+/**
+ *  許可するアクセス: ファイルの実行.
+ */
+#define LANDLOCK_ALLOW_EXEC (1 << 2)
+
+/**
+ *  Landlock ルールセット型.
+ */
+typedef struct {} *LANDLOCK;
+
+/**
+ *  Landlock ルールセットの統計情報.
+ */
+struct landlock_stats {
+    int abi;      /**< 使用した Landlock の ABI バージョン. */
+    size_t rules; /**< 追加したルールの数. */
+};
+
+/**
+ *  カーネルが対応する Landlock の ABI バージョンを取得する.
+ */
+int landlock_abi(void);
+
+/**
+ *  Landlock ルールセットを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          LANDLOCK ruleset = landlock_init();
+ *          landlock_allow(ruleset, "/usr", LANDLOCK_ALLOW_READ | LANDLOCK_ALLOW_EXEC);
+ *          landlock_allow(ruleset, "/tmp", LANDLOCK_ALLOW_READ | LANDLOCK_ALLOW_WRITE);
+ *          landlock_enforce(ruleset);
+ *          landlock_release(ruleset);
+ *          execvp(argv[0], argv);
+ *          @endcode
+ */
+LANDLOCK landlock_init(void);
+
+/**
+ *  Landlock ルールセットを解放する.
+ */
+void landlock_release(LANDLOCK ruleset);
+
+/**
+ *  パス以下へのアクセスを許可する.
+ */
+int landlock_allow(LANDLOCK ruleset, const char *pathname, unsigned int access);
+
+/**
+ *  ルールセットを呼び出したスレッドに適用する.
+ */
+int landlock_enforce(LANDLOCK ruleset);
+
+/**
+ *  Landlock ルールセットの統計情報を取得する.
+ */
+int landlock_get_stats(LANDLOCK ruleset, struct landlock_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_LANDLOCK_H__ */
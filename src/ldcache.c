@@ -0,0 +1,945 @@
+/** @file       ldcache.c
+ *  @brief      jail 向けの ld.so.cache の生成を提供する.
+ *
+ *  glibc 2.32 以降の形式 ("glibc-ld.so.cache1.1") のみを生成する.
+ *
+ *  | 領域           | 内容                                   |
+ *  | -------------- | -------------------------------------- |
+ *  | ヘッダ         | struct ld_cache_header                 |
+ *  | ライブラリ     | struct ld_cache_entry × nlibs          |
+ *  | 文字列         | NUL 終端文字列の並び                   |
+ *
+ *  文字列はファイル先頭からのオフセットで参照する. 動的リンカはライブラリを
+ *  二分探索するため, ライブラリは名前の降順 (数字部分は数値で比較) に並べる.
+ *  同じ名前のライブラリは, 先に追加したディレクトリのものを使用する.
+ *
+ *  jail 内のパスは jail の root を起点に解決するため, jail 内の絶対パスの
+ *  シンボリックリンクがホストのファイルを指すことはない.
+ *
+ *  保存する ld.so.cache のキーは, 構成を表す値と, 各ディレクトリの
+ *  パスと状態から求める. ホストからバインドしたディレクトリの状態は
+ *  デバイス, inode と更新時刻で, jail の tmpfs 上のディレクトリの状態は
+ *  各エントリのデバイス, inode と更新時刻で表す.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX, strdup, getline */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <elf.h>
+#include <glob.h>
+#include <libgen.h>
+#include <sys/stat.h>
+
+#include "ldcache.h"
+#include "elfdeps.h"
+#include "collections.h"
+#include "fsutil.h"
+#include "hash.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  ld.so.cache の識別子. (NUL 終端を含まない)
+ */
+#define LD_CACHE_MAGIC "glibc-ld.so.cache1.1"
+
+/**
+ *  ld.so.cache のバイトオーダー: リトルエンディアン.
+ */
+#define LD_CACHE_ENDIAN_LITTLE (2)
+
+/**
+ *  ld.so.cache のバイトオーダー: ビッグエンディアン.
+ */
+#define LD_CACHE_ENDIAN_BIG (3)
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define LD_CACHE_ENDIAN_HOST LD_CACHE_ENDIAN_LITTLE
+#else
+#define LD_CACHE_ENDIAN_HOST LD_CACHE_ENDIAN_BIG
+#endif
+
+/**
+ *  ライブラリの種別: glibc の ELF.
+ */
+#define LD_CACHE_FLAG_ELF_LIBC6 (0x0003)
+
+/**
+ *  ld.so.conf の include を辿る深さの最大.
+ */
+#define LD_CACHE_INCLUDE_DEPTH_MAX (8)
+
+/**
+ *  保存するディレクトリのアクセス権限.
+ */
+#define LD_CACHE_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  ld.so.cache のヘッダ.
+ */
+struct ld_cache_header {
+    char magic[sizeof(LD_CACHE_MAGIC) - 1]; /**< 識別子と形式のバージョン. */
+    uint32_t nlibs;                         /**< ライブラリの数. */
+    uint32_t len_strings;                   /**< 文字列の合計サイズ. */
+    uint8_t flags;                          /**< バイトオーダー. */
+    uint8_t padding[3];                     /**< 未使用. */
+    uint32_t extension_offset;              /**< 拡張領域のオフセット. (0 は無し) */
+    uint32_t unused[3];                     /**< 予約. */
+};
+
+/**
+ *  ld.so.cache のライブラリ.
+ */
+struct ld_cache_entry {
+    int32_t flags;      /**< ライブラリの種別とアーキテクチャ. */
+    uint32_t key;       /**< ライブラリ名. (文字列のオフセット) */
+    uint32_t value;     /**< ライブラリのパス. (文字列のオフセット) */
+    uint32_t osversion; /**< 必要な OS のバージョン. (0 は指定無し) */
+    uint64_t hwcap;     /**< 必要なハードウェア機能. (0 は指定無し) */
+};
+
+/**
+ *  マシン毎の ld.so.cache のアーキテクチャのフラグ.
+ */
+static const struct {
+    uint16_t machine;
+    unsigned char elf_class;
+    int32_t flags;
+} architectures[] = {
+    {EM_X86_64, ELFCLASS64, 0x0300},
+    {EM_X86_64, ELFCLASS32, 0x0800},
+    {EM_386, ELFCLASS32, 0x0000},
+    {EM_AARCH64, ELFCLASS64, 0x0a00},
+    {EM_PPC64, ELFCLASS64, 0x0500},
+    {EM_PPC, ELFCLASS32, 0x0000},
+    {EM_S390, ELFCLASS64, 0x0400},
+    {EM_S390, ELFCLASS32, 0x0000},
+};
+
+/**
+ *  走査したライブラリ.
+ */
+struct ld_cache_library {
+    char *key;       /**< ライブラリ名. */
+    char *value;     /**< jail 内のパス. */
+    int32_t flags;   /**< ライブラリの種別とアーキテクチャ. */
+    size_t order;    /**< 追加した順序. */
+    size_t dir;      /**< 見つかったディレクトリ. */
+    bool exact;      /**< ファイル名がライブラリ名と一致するか. */
+};
+
+/**
+ *  ld.so.cache 生成器管理構造体.
+ */
+struct ld_cache {
+    int root_fd;                            /**< jail の root. */
+    dev_t root_dev;                         /**< jail の root のデバイス. */
+    char memo_path[PATH_MAX];               /**< 生成結果を保存するディレクトリ. (空文字列は保存しない) */
+    char *dirs[LD_CACHE_DIRS_MAX];          /**< 走査するディレクトリ. (jail 内のパス) */
+    size_t num_dirs;                        /**< ディレクトリの数. */
+    struct ld_cache_library *libraries;     /**< 走査したライブラリ. */
+    size_t count;                           /**< ライブラリの数. */
+    size_t capacity;                        /**< 確保したライブラリの数. */
+    MAP keys;                               /**< "<flags>:<名前>" から @c libraries の添字を引くマップ. */
+    struct ld_cache_stats stats;            /**< 統計情報. */
+};
+
+/**
+ *  動的リンカと同じ規則でライブラリ名を比較する.
+ *
+ *  数字の並びは数値として比較する.
+ */
+static int ld_cache_libcmp(const char *p1, const char *p2)
+{
+    while (*p1 != '\0') {
+        if ((*p1 >= '0') && (*p1 <= '9')) {
+            if ((*p2 >= '0') && (*p2 <= '9')) {
+                int val1 = *p1++ - '0';
+                int val2 = *p2++ - '0';
+                while ((*p1 >= '0') && (*p1 <= '9')) {
+                    val1 = val1 * 10 + *p1++ - '0';
+                }
+                while ((*p2 >= '0') && (*p2 <= '9')) {
+                    val2 = val2 * 10 + *p2++ - '0';
+                }
+                if (val1 != val2) {
+                    return val1 - val2;
+                }
+            } else {
+                return 1;
+            }
+        } else if ((*p2 >= '0') && (*p2 <= '9')) {
+            return -1;
+        } else if (*p1 != *p2) {
+            return *p1 - *p2;
+        } else {
+            ++p1;
+            ++p2;
+        }
+    }
+
+    return *p1 - *p2;
+}
+
+/**
+ *  ライブラリを ld.so.cache の順序 (名前の降順, 種別の降順, 追加順) に並べる.
+ */
+static int compare_libraries(const void *a, const void *b)
+{
+    const struct ld_cache_library *lib1 = (const struct ld_cache_library *)a;
+    const struct ld_cache_library *lib2 = (const struct ld_cache_library *)b;
+
+    int ret = ld_cache_libcmp(lib2->key, lib1->key);
+    if (ret != 0) {
+        return ret;
+    }
+    if (lib1->flags != lib2->flags) {
+        return (lib1->flags < lib2->flags) ? 1 : -1;
+    }
+
+    return (lib1->order > lib2->order) ? 1 : -1;
+}
+
+/**
+ *  ELF から ld.so.cache のフラグを求める.
+ *
+ *  @return 対応していないアーキテクチャの場合は -1 が返る.
+ */
+static int32_t library_flags(const struct elf_info *info)
+{
+    if (info->machine == EM_ARM) {
+        /* ハードウェア浮動小数点 (0x0900) とソフトウェア浮動小数点 (0x0b00). */
+        return LD_CACHE_FLAG_ELF_LIBC6 | ((info->flags & EF_ARM_ABI_FLOAT_HARD) ? 0x0900 : 0x0b00);
+    }
+    if ((info->machine == EM_RISCV) && (info->elf_class == ELFCLASS64)) {
+        /* 倍精度浮動小数点 (0x1000) とソフトウェア浮動小数点 (0x0f00). */
+        switch (info->flags & EF_RISCV_FLOAT_ABI) {
+        case EF_RISCV_FLOAT_ABI_DOUBLE:
+            return LD_CACHE_FLAG_ELF_LIBC6 | 0x1000;
+        case EF_RISCV_FLOAT_ABI_SOFT:
+            return LD_CACHE_FLAG_ELF_LIBC6 | 0x0f00;
+        default:
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < sizeof(architectures) / sizeof(architectures[0]); ++i) {
+        if ((architectures[i].machine == info->machine)
+            && (architectures[i].elf_class == info->elf_class)) {
+
+            return LD_CACHE_FLAG_ELF_LIBC6 | architectures[i].flags;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ *  ld.so.cache に含めるファイル名かを判定する.
+ *
+ *  ldconfig と同じく, "lib" または "ld-" で始まる共有ライブラリのみを含める.
+ */
+static bool is_library_name(const char *name)
+{
+    return ((strncmp(name, "lib", 3) == 0) || (strncmp(name, "ld-", 3) == 0))
+        && (strstr(name, ".so") != NULL);
+}
+
+/**
+ *  ライブラリを追加する.
+ *
+ *  同じ名前と種別のライブラリは, 先に見つかったディレクトリのものを使用する.
+ *  同じディレクトリでは, ファイル名がライブラリ名と一致するものを優先する.
+ */
+static int add_library(struct ld_cache *self,
+                       const char *key,
+                       const char *value,
+                       int32_t flags,
+                       size_t dir,
+                       bool exact)
+{
+    char map_key[ELF_SONAME_MAX + 16];
+
+    snprintf(map_key, sizeof(map_key), "%" PRIx32 ":%s", (uint32_t)flags, key);
+    size_t *index = map_get(self->keys, map_key);
+    if (index != NULL) {
+        struct ld_cache_library *lib = &self->libraries[*index];
+        if ((lib->dir == dir) && !lib->exact && exact) {
+            char *copy = strdup(value);
+            if (copy == NULL) {
+                errno = ENOMEM;
+                return -1;
+            }
+            free(lib->value);
+            lib->value = copy;
+            lib->exact = true;
+        }
+        return 0;
+    }
+    if (self->count == LD_CACHE_ENTRIES_MAX) {
+        DEBUG("ldcache: too many libraries (%s)", value);
+        errno = ENOSPC;
+        return -1;
+    }
+    if (self->count == self->capacity) {
+        size_t capacity = (self->capacity > 0) ? self->capacity * 2 : 256;
+        struct ld_cache_library *libraries = realloc(self->libraries, sizeof(*libraries) * capacity);
+        if (libraries == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->libraries = libraries;
+        self->capacity = capacity;
+    }
+
+    struct ld_cache_library *lib = &self->libraries[self->count];
+    lib->key = strdup(key);
+    lib->value = strdup(value);
+    if ((lib->key == NULL) || (lib->value == NULL)) {
+        free(lib->key);
+        free(lib->value);
+        errno = ENOMEM;
+        return -1;
+    }
+    lib->flags = flags;
+    lib->order = self->count;
+    lib->dir = dir;
+    lib->exact = exact;
+    if (map_put(self->keys, map_key, &self->count) == NULL) {
+        free(lib->key);
+        free(lib->value);
+        return -1;
+    }
+    ++self->count;
+
+    return 0;
+}
+
+/**
+ *  jail 内のディレクトリのライブラリを追加する.
+ */
+static int scan_directory(struct ld_cache *self, size_t index)
+{
+    const char *dir_path = self->dirs[index];
+    char path[PATH_MAX];
+    int ret = 0;
+
+    int dir_fd = open_in_root(self->root_fd, dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0);
+    if (dir_fd < 0) {
+        return 0;
+    }
+    DIR *dir = fdopendir(dir_fd);
+    if (dir == NULL) {
+        close(dir_fd);
+        return 0;
+    }
+    ++self->stats.directories;
+
+    struct dirent *entry;
+    while ((ret == 0) && ((entry = readdir(dir)) != NULL)) {
+        if (((entry->d_type != DT_REG) && (entry->d_type != DT_LNK) && (entry->d_type != DT_UNKNOWN))
+            || !is_library_name(entry->d_name)) {
+
+            continue;
+        }
+        if (snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name) >= (int)sizeof(path)) {
+            continue;
+        }
+
+        /* シンボリックリンクは jail の root を起点に辿る. */
+        int fd = open_in_root(self->root_fd, path, O_RDONLY | O_CLOEXEC | O_NONBLOCK, 0);
+        if (fd < 0) {
+            continue;
+        }
+        struct elf_info info;
+        int parsed = elf_read_info(fd, &info);
+        close(fd);
+        if ((parsed != 0) || (info.type != ET_DYN)) {
+            continue;
+        }
+        int32_t flags = library_flags(&info);
+        if (flags < 0) {
+            continue;
+        }
+
+        /* ldconfig と同じく, ライブラリ名と異なる名前のリンクはその名前で登録する. */
+        struct stat status;
+        bool is_link = (entry->d_type == DT_LNK)
+                    || ((entry->d_type == DT_UNKNOWN)
+                        && (fstatat(dirfd(dir), entry->d_name, &status, AT_SYMLINK_NOFOLLOW) == 0)
+                        && S_ISLNK(status.st_mode));
+        const char *key = entry->d_name;
+        if ((info.soname[0] != '\0') && (!is_link || (strcmp(info.soname, entry->d_name) == 0))) {
+            key = info.soname;
+        }
+        ret = add_library(self, key, path, flags, index, strcmp(key, entry->d_name) == 0);
+    }
+    closedir(dir);
+
+    return ret;
+}
+
+/**
+ *  ディレクトリの状態をキーに加える.
+ *
+ *  jail の tmpfs 上のディレクトリは jail 毎に作り直されるため,
+ *  エントリの状態を加える.
+ */
+static uint64_t mix_directory(struct ld_cache *self, uint64_t key, const char *dir_path)
+{
+    struct stat status;
+
+    key = fnv1a64_update(key, dir_path, strlen(dir_path) + 1);
+
+    int dir_fd = open_in_root(self->root_fd, dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0);
+    if ((dir_fd < 0) || (fstat(dir_fd, &status) != 0)) {
+        if (dir_fd >= 0) {
+            close(dir_fd);
+        }
+        return fnv1a64_update(key, "-", 1);
+    }
+    if (status.st_dev != self->root_dev) {
+        close(dir_fd);
+        key = fnv1a64_update(key, &status.st_dev, sizeof(status.st_dev));
+        key = fnv1a64_update(key, &status.st_ino, sizeof(status.st_ino));
+        return fnv1a64_update(key, &status.st_mtim, sizeof(status.st_mtim));
+    }
+
+    DIR *dir = fdopendir(dir_fd);
+    if (dir == NULL) {
+        close(dir_fd);
+        return fnv1a64_update(key, "-", 1);
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_library_name(entry->d_name)
+            || (fstatat(dirfd(dir), entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0)) {
+
+            continue;
+        }
+        key = fnv1a64_update(key, entry->d_name, strlen(entry->d_name) + 1);
+        key = fnv1a64_update(key, &status.st_dev, sizeof(status.st_dev));
+        key = fnv1a64_update(key, &status.st_ino, sizeof(status.st_ino));
+        key = fnv1a64_update(key, &status.st_mtim, sizeof(status.st_mtim));
+    }
+    closedir(dir);
+
+    return key;
+}
+
+/**
+ *  走査したライブラリから ld.so.cache の内容を作成する.
+ *
+ *  @param  [out]   length  作成した内容のサイズ.
+ *  @return 成功時は確保した内容が返り, 失敗時は NULL が返る.
+ */
+static char *build_image(struct ld_cache *self, size_t *length)
+{
+    qsort(self->libraries, self->count, sizeof(*self->libraries), compare_libraries);
+
+    size_t strings = 0;
+    for (size_t i = 0; i < self->count; ++i) {
+        strings += strlen(self->libraries[i].key) + 1 + strlen(self->libraries[i].value) + 1;
+    }
+    size_t offset = sizeof(struct ld_cache_header) + sizeof(struct ld_cache_entry) * self->count;
+    if (offset + strings > UINT32_MAX) {
+        errno = EFBIG;
+        return NULL;
+    }
+    char *image = calloc(1, offset + strings);
+    if (image == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    struct ld_cache_header header = {
+        .nlibs = self->count,
+        .len_strings = strings,
+        .flags = LD_CACHE_ENDIAN_HOST,
+        .extension_offset = 0,
+    };
+    memcpy(header.magic, LD_CACHE_MAGIC, sizeof(header.magic));
+    memcpy(image, &header, sizeof(header));
+
+    for (size_t i = 0; i < self->count; ++i) {
+        const struct ld_cache_library *lib = &self->libraries[i];
+        struct ld_cache_entry entry = {
+            .flags = lib->flags,
+            .osversion = 0,
+            .hwcap = 0,
+        };
+
+        entry.key = offset;
+        size_t n = strlen(lib->key) + 1;
+        memcpy(image + offset, lib->key, n);
+        offset += n;
+        entry.value = offset;
+        n = strlen(lib->value) + 1;
+        memcpy(image + offset, lib->value, n);
+        offset += n;
+        memcpy(image + sizeof(header) + sizeof(entry) * i, &entry, sizeof(entry));
+    }
+    *length = offset;
+
+    return image;
+}
+
+/**
+ *  保存済みの ld.so.cache を読み込む.
+ *
+ *  @return 使用できる場合は確保した内容が返り, それ以外は NULL が返る.
+ */
+static char *load_memo(const char *path, size_t *length)
+{
+    struct stat status;
+    struct ld_cache_header header;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    if ((fstat(fd, &status) != 0) || ((size_t)status.st_size < sizeof(header))) {
+        close(fd);
+        return NULL;
+    }
+    char *image = malloc(status.st_size);
+    if ((image == NULL) || (pread(fd, image, status.st_size, 0) != status.st_size)) {
+        free(image);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+
+    memcpy(&header, image, sizeof(header));
+    if ((memcmp(header.magic, LD_CACHE_MAGIC, sizeof(header.magic)) != 0)
+        || (((size_t)status.st_size - sizeof(header)) / sizeof(struct ld_cache_entry) < header.nlibs)) {
+
+        DEBUG("ldcache: %s is broken", path);
+        free(image);
+        return NULL;
+    }
+    *length = status.st_size;
+
+    return image;
+}
+
+/**
+ *  生成した ld.so.cache を保存する.
+ *
+ *  一時ファイルに書き込んだ後に置き換える.
+ */
+static int save_memo(struct ld_cache *self, const char *path, const char *image, size_t length)
+{
+    char temp[PATH_MAX];
+
+    if (make_directories(self->memo_path, LD_CACHE_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), self->memo_path);
+        return -1;
+    }
+    if (snprintf(temp, sizeof(temp), "%s.XXXXXX", path) >= (int)sizeof(temp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(temp);
+    if (fd < 0) {
+        DEBUG("mkstemp: %s (%s)", strerror(errno), temp);
+        return -1;
+    }
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    ssize_t written = write(fd, image, length);
+    if ((close(fd) != 0) || (written != (ssize_t)length) || (rename(temp, path) != 0)) {
+        DEBUG("ldcache: failed to save %s", path);
+        unlink(temp);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int add_config(struct ld_cache *self, const char *pathname, int depth);
+
+/**
+ *  ld.so.conf の include に一致するファイルを全て読み込む.
+ *
+ *  相対パスは, include を記載したファイルのディレクトリを起点とする.
+ */
+static int include_config(struct ld_cache *self, const char *pathname, const char *pattern, int depth)
+{
+    char base[PATH_MAX];
+    char path[PATH_MAX];
+    glob_t matched;
+
+    if (pattern[0] == '/') {
+        snprintf(path, sizeof(path), "%s", pattern);
+    } else {
+        snprintf(base, sizeof(base), "%s", pathname);
+        snprintf(path, sizeof(path), "%s/%s", dirname(base), pattern);
+    }
+    if (glob(path, 0, NULL, &matched) != 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < matched.gl_pathc; ++i) {
+        add_config(self, matched.gl_pathv[i], depth + 1);
+    }
+    globfree(&matched);
+
+    return 0;
+}
+
+/**
+ *  ld.so.conf を読み込む.
+ *
+ *  ディレクトリは空白, ',' または ':' で区切られる. hwcap の行は無視する.
+ */
+static int add_config(struct ld_cache *self, const char *pathname, int depth)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+
+    if (depth > LD_CACHE_INCLUDE_DEPTH_MAX) {
+        DEBUG("ldcache: too deep include (%s)", pathname);
+        errno = ELOOP;
+        return -1;
+    }
+    FILE *fp = fopen(pathname, "re");
+    if (fp == NULL) {
+        return -1;
+    }
+    while (getline(&line, &capacity, fp) > 0) {
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char *save = NULL;
+        char *token = strtok_r(line, " \t\r\n,:", &save);
+        if (token == NULL) {
+            continue;
+        }
+        if (strcmp(token, "include") == 0) {
+            while ((token = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+                include_config(self, pathname, token, depth);
+            }
+            continue;
+        }
+        if (strcmp(token, "hwcap") == 0) {
+            continue;
+        }
+        for (; token != NULL; token = strtok_r(NULL, " \t\r\n,:", &save)) {
+            /* 旧い "dir=TYPE" の形式の TYPE は無視する. */
+            char *type = strchr(token, '=');
+            if (type != NULL) {
+                *type = '\0';
+            }
+            if (token[0] == '/') {
+                ld_cache_add_directory((LD_CACHE)self, token);
+            }
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    return 0;
+}
+
+/**
+ *  @details    jail の root を @c root とする ld.so.cache 生成器を確保および初期化する.
+ *              @c memo_path が NULL または空文字列の場合は, 生成結果を保存しない.
+ *
+ *  @param      [in]    root        jail の root のパス.
+ *  @param      [in]    memo_path   生成結果を保存するディレクトリ.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+LD_CACHE ld_cache_init(const char *root, const char *memo_path)
+{
+    struct stat status;
+
+    if (root == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((memo_path != NULL) && (strlen(memo_path) >= PATH_MAX)) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    struct ld_cache *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->root_fd = open(root, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if ((self->root_fd < 0) || (fstat(self->root_fd, &status) != 0)) {
+        DEBUG("open: %s (%s)", strerror(errno), root);
+        if (self->root_fd >= 0) {
+            close(self->root_fd);
+        }
+        free(self);
+        return NULL;
+    }
+    self->root_dev = status.st_dev;
+    self->keys = map_init(sizeof(size_t), LD_CACHE_ENTRIES_MAX);
+    if (self->keys == NULL) {
+        close(self->root_fd);
+        free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (memo_path != NULL) {
+        strcpy(self->memo_path, memo_path);
+    }
+
+    return (LD_CACHE)self;
+}
+
+/**
+ *  @details    @c cache を解放する.
+ *
+ *  @param      [in,out]    cache   ld.so.cache 生成器オブジェクト.
+ */
+void ld_cache_release(LD_CACHE cache)
+{
+    struct ld_cache *self = (struct ld_cache *)cache;
+
+    if (self != NULL) {
+        for (size_t i = 0; i < self->count; ++i) {
+            free(self->libraries[i].key);
+            free(self->libraries[i].value);
+        }
+        free(self->libraries);
+        for (size_t i = 0; i < self->num_dirs; ++i) {
+            free(self->dirs[i]);
+        }
+        map_release(self->keys);
+        close(self->root_fd);
+        free(self);
+    }
+}
+
+/**
+ *  @details    ライブラリを探す jail 内のディレクトリを追加する.
+ *              先に追加したディレクトリのライブラリが優先される.
+ *              追加済みのディレクトリは無視する.
+ *
+ *  @param      [in,out]    cache       ld.so.cache 生成器オブジェクト.
+ *  @param      [in]        pathname    jail 内のディレクトリのパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int ld_cache_add_directory(LD_CACHE cache, const char *pathname)
+{
+    struct ld_cache *self = (struct ld_cache *)cache;
+
+    if ((self == NULL) || (pathname == NULL) || (pathname[0] != '/')) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t length = strlen(pathname);
+    while ((length > 1) && (pathname[length - 1] == '/')) {
+        --length;
+    }
+    for (size_t i = 0; i < self->num_dirs; ++i) {
+        if ((strncmp(self->dirs[i], pathname, length) == 0) && (self->dirs[i][length] == '\0')) {
+            return 0;
+        }
+    }
+    if (self->num_dirs == LD_CACHE_DIRS_MAX) {
+        DEBUG("ldcache: too many directories (%s)", pathname);
+        errno = ENOSPC;
+        return -1;
+    }
+    self->dirs[self->num_dirs] = strndup(pathname, length);
+    if (self->dirs[self->num_dirs] == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    ++self->num_dirs;
+
+    return 0;
+}
+
+/**
+ *  @details    ホストの ld.so.conf に記載されたディレクトリを追加する.
+ *              include に一致するファイルも読み込む.
+ *              jail 内に存在しないディレクトリは, 生成時に読み飛ばす.
+ *
+ *  @param      [in,out]    cache       ld.so.cache 生成器オブジェクト.
+ *  @param      [in]        pathname    ld.so.conf のパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int ld_cache_add_config(LD_CACHE cache, const char *pathname)
+{
+    struct ld_cache *self = (struct ld_cache *)cache;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return add_config(self, pathname, 0);
+}
+
+/**
+ *  @details    ホストのアーキテクチャのマルチアーキテクチャのディレクトリと,
+ *              動的リンカが常に検索するディレクトリを追加する.
+ *
+ *  @param      [in,out]    cache   ld.so.cache 生成器オブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int ld_cache_add_defaults(LD_CACHE cache)
+{
+    char path[PATH_MAX];
+    struct elf_info info;
+
+    if (cache == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* ホストのアーキテクチャは自身の実行ファイルから求める. */
+    int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) || (elf_read_info(fd, &info) != 0)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    close(fd);
+
+    const char *triplet = elf_multiarch(info.elf_class, info.machine);
+    if (triplet != NULL) {
+        snprintf(path, sizeof(path), "/lib/%s", triplet);
+        ld_cache_add_directory(cache, path);
+        snprintf(path, sizeof(path), "/usr/lib/%s", triplet);
+        ld_cache_add_directory(cache, path);
+    }
+    if (info.elf_class == ELFCLASS64) {
+        ld_cache_add_directory(cache, "/lib64");
+        ld_cache_add_directory(cache, "/usr/lib64");
+    }
+    ld_cache_add_directory(cache, "/lib");
+    ld_cache_add_directory(cache, "/usr/lib");
+
+    return 0;
+}
+
+/**
+ *  @details    追加したディレクトリを走査して ld.so.cache を生成し,
+ *              jail 内の @c pathname に書き込む. 親ディレクトリは
+ *              作成済みでなければならない.
+ *              @c salt とディレクトリの状態が同じ ld.so.cache が保存済みの
+ *              場合は, 走査せずにそれを書き込む.
+ *
+ *  @param      [in,out]    cache       ld.so.cache 生成器オブジェクト.
+ *  @param      [in]        pathname    jail 内の ld.so.cache のパス.
+ *  @param      [in]        salt        構成を表す値.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int ld_cache_install(LD_CACHE cache, const char *pathname, uint64_t salt)
+{
+    struct ld_cache *self = (struct ld_cache *)cache;
+    char memo[PATH_MAX] = {0};
+    char *image = NULL;
+    size_t length = 0;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t start = monotonic_ns();
+    if (self->memo_path[0] != '\0') {
+        uint64_t key = fnv1a64_update(FNV1A64_INIT, &salt, sizeof(salt));
+        for (size_t i = 0; i < self->num_dirs; ++i) {
+            key = mix_directory(self, key, self->dirs[i]);
+        }
+        if (snprintf(memo, sizeof(memo), "%s/%016" PRIx64, self->memo_path, key) < (int)sizeof(memo)) {
+            image = load_memo(memo, &length);
+        } else {
+            memo[0] = '\0';
+        }
+    }
+    if (image != NULL) {
+        struct ld_cache_header header;
+        memcpy(&header, image, sizeof(header));
+        self->stats.memoized = true;
+        self->stats.entries = header.nlibs;
+    } else {
+        for (size_t i = 0; i < self->num_dirs; ++i) {
+            if (scan_directory(self, i) != 0) {
+                return -1;
+            }
+        }
+        image = build_image(self, &length);
+        if (image == NULL) {
+            return -1;
+        }
+        self->stats.entries = self->count;
+        if (memo[0] != '\0') {
+            /* 保存できなくても, 生成した ld.so.cache は使用できる. */
+            save_memo(self, memo, image, length);
+        }
+    }
+
+    int ret = -1;
+    int fd = open_in_root(self->root_fd, pathname,
+                          O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC,
+                          S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), pathname);
+    } else {
+        ssize_t written = write(fd, image, length);
+        if ((close(fd) == 0) && (written == (ssize_t)length)) {
+            ret = 0;
+        } else {
+            DEBUG("ldcache: failed to write %s", pathname);
+            errno = EIO;
+        }
+    }
+    free(image);
+    self->stats.elapsed_us = elapsed_us(start);
+
+    return ret;
+}
+
+/**
+ *  @details    ld.so.cache の生成の統計情報を取得する.
+ *
+ *  @param      [in]    cache   ld.so.cache 生成器オブジェクト.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int ld_cache_get_stats(LD_CACHE cache, struct ld_cache_stats *stats)
+{
+    struct ld_cache *self = (struct ld_cache *)cache;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *stats = self->stats;
+
+    return 0;
+}
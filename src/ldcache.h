@@ -0,0 +1,97 @@
+/** @file       ldcache.h
+ *  @brief      jail 向けの ld.so.cache の生成を提供する.
+ *
+ *  jail 内のライブラリディレクトリを走査し, 動的リンカが参照する
+ *  ld.so.cache を jail に書き込む. 生成した ld.so.cache は, 構成と
+ *  ディレクトリの状態をキーとして保存し, 変化が無ければ再利用する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_LDCACHE_H__
+#define __ALCATRAZ_LDCACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @defgroup cat_ldcache ld.so.cache
+ *  jail 向けの ld.so.cache を生成するモジュール.
+ *  @{
+ */
+
+/**
+ *  走査するディレクトリの最大数.
+ */
+#define LD_CACHE_DIRS_MAX (64)
+
+/**
+ *  ld.so.cache に含められるライブラリの最大数.
+ */
+#define LD_CACHE_ENTRIES_MAX (8192)
+
+/**
+ *  ld.so.cache 生成器型.
+ */
+typedef struct {} *LD_CACHE;
+
+/**
+ *  ld.so.cache の生成の統計情報.
+ */
+struct ld_cache_stats {
+    size_t directories;  /**< 走査したディレクトリの数. */
+    size_t entries;      /**< ld.so.cache に含めたライブラリの数. */
+    bool memoized;       /**< 保存済みの ld.so.cache を使用したか. */
+    uint64_t elapsed_us; /**< 生成に要した時間 (マイクロ秒). */
+};
+
+/**
+ *  ld.so.cache 生成器を初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          LD_CACHE cache = ld_cache_init("/tmp/chroot-XXXXXX", "/run/alctrz/ldcache");
+ *          ld_cache_add_config(cache, "/etc/ld.so.conf");
+ *          ld_cache_add_defaults(cache);
+ *          ld_cache_install(cache, "/etc/ld.so.cache", plan_key(plan));
+ *          ld_cache_release(cache);
+ *          @endcode
+ */
+LD_CACHE ld_cache_init(const char *root, const char *memo_path);
+
+/**
+ *  ld.so.cache 生成器を解放する.
+ */
+void ld_cache_release(LD_CACHE cache);
+
+/**
+ *  走査するディレクトリを追加する.
+ */
+int ld_cache_add_directory(LD_CACHE cache, const char *pathname);
+
+/**
+ *  ld.so.conf に記載されたディレクトリを追加する.
+ */
+int ld_cache_add_config(LD_CACHE cache, const char *pathname);
+
+/**
+ *  動的リンカの標準のディレクトリを追加する.
+ */
+int ld_cache_add_defaults(LD_CACHE cache);
+
+/**
+ *  ld.so.cache を生成して jail に書き込む.
+ */
+int ld_cache_install(LD_CACHE cache, const char *pathname, uint64_t salt);
+
+/**
+ *  ld.so.cache の生成の統計情報を取得する.
+ */
+int ld_cache_get_stats(LD_CACHE cache, struct ld_cache_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_LDCACHE_H__ */
@@ -0,0 +1,586 @@
+/** @file       nsscache.c
+ *  @brief      ユーザとグループの名前解決 (NSS) のキャッシュを提供する.
+ *
+ *  名前は `<dir>/user.<name>` または `<dir>/group.<name>` に次の形式で記録する.
+ *  1 行目: "<found> <有効期限> <ino> <size> <mtime 秒> <mtime ナノ秒> <uid> <gid>"
+ *  2 行目以降: ユーザ名, ホームディレクトリ, シェル.
+ *  ino, size, mtime は解決時の /etc/passwd または /etc/group のもので,
+ *  現在のものと異なる場合は使用しない. 自身以外が所有するファイルや,
+ *  他者が書き込めるファイルも使用しない.
+ *
+ *  メモリ上のキャッシュは, inotify で /etc/passwd と /etc/group の更新を
+ *  検知して破棄する. inotify が使用できない場合は, ファイルと同様に
+ *  ino, size, mtime を比較する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pwd.h>
+#include <grp.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "nsscache.h"
+#include "collections.h"
+#include "fsutil.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  キャッシュディレクトリのアクセス権限.
+ */
+#define NSS_CACHE_DIR_PERM (S_IRWXU)
+
+/**
+ *  getpwnam_r(3) と getgrnam_r(3) に渡すバッファのサイズ.
+ */
+#define NSS_BUFFER_SIZE (16384)
+
+/**
+ *  名前解決の元になるファイルの状態.
+ */
+struct nss_stamp {
+    uintmax_t ino; /**< inode 番号. */
+    intmax_t size; /**< サイズ. */
+    intmax_t sec;  /**< 更新時刻 (秒). */
+    long nsec;     /**< 更新時刻 (ナノ秒). */
+};
+
+/**
+ *  キャッシュした名前解決の結果.
+ */
+struct nss_entry {
+    bool found;             /**< 名前が存在するか. */
+    time_t expires;         /**< 有効期限. */
+    struct nss_stamp stamp; /**< 解決時の /etc/passwd または /etc/group の状態. */
+    struct nss_user user;   /**< ユーザの情報. (グループの場合は gid のみ) */
+};
+
+/**
+ *  名前の種別毎の情報.
+ */
+struct nss_kind {
+    char prefix;        /**< メモリ上のキーの接頭辞. */
+    const char *file;   /**< キャッシュファイルの接頭辞. */
+    const char *source; /**< 名前解決の元になるファイル. */
+};
+
+/**
+ *  ユーザの名前解決.
+ */
+static const struct nss_kind nss_user_kind = {'u', "user", "/etc/passwd"};
+
+/**
+ *  グループの名前解決.
+ */
+static const struct nss_kind nss_group_kind = {'g', "group", "/etc/group"};
+
+/**
+ *  NSS キャッシュ管理構造体.
+ */
+struct nss_cache {
+    pthread_mutex_t lock;         /**< @c entries と @c stats を保護するロック. */
+    MAP entries;                  /**< メモリ上のキャッシュ. */
+    char dir[PATH_MAX];           /**< キャッシュディレクトリ. (空文字列はファイルに保存しない) */
+    unsigned int ttl;             /**< 存在する名前の有効期間 (秒). */
+    unsigned int negative_ttl;    /**< 存在しない名前の有効期間 (秒). */
+    int inotify_fd;               /**< /etc の更新を監視する inotify. (使用できない場合は -1) */
+    struct nss_cache_stats stats; /**< 統計情報. */
+};
+
+/**
+ *  名前解決の元になるファイルの状態を取得する.
+ */
+static void nss_stamp_get(const char *source, struct nss_stamp *stamp)
+{
+    struct stat status;
+
+    memset(stamp, 0, sizeof(*stamp));
+    if (stat(source, &status) == 0) {
+        stamp->ino = (uintmax_t)status.st_ino;
+        stamp->size = (intmax_t)status.st_size;
+        stamp->sec = (intmax_t)status.st_mtim.tv_sec;
+        stamp->nsec = status.st_mtim.tv_nsec;
+    }
+}
+
+/**
+ *  キャッシュした結果が有効かどうかを判定する.
+ */
+static bool nss_entry_valid(const struct nss_entry *entry, const struct nss_stamp *stamp)
+{
+    return (entry->expires > time(NULL))
+        && ((stamp == NULL) || (memcmp(&entry->stamp, stamp, sizeof(*stamp)) == 0));
+}
+
+/**
+ *  inotify のイベントを読み出し, /etc/passwd または /etc/group が
+ *  更新されていればメモリ上のキャッシュを破棄する.
+ *
+ *  @c lock を獲得して呼び出すこと.
+ */
+static void nss_cache_poll(struct nss_cache *self)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t length;
+
+    while ((length = read(self->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if ((event->mask & IN_Q_OVERFLOW)
+                || ((event->len > 0)
+                    && ((strcmp(event->name, "passwd") == 0) || (strcmp(event->name, "group") == 0)))) {
+
+                changed = true;
+            }
+            p += sizeof(*event) + event->len;
+        }
+    }
+    if (changed) {
+        DEBUG("nss: /etc/passwd or /etc/group changed");
+        map_clear(self->entries);
+        self->stats.invalidations++;
+    }
+}
+
+/**
+ *  キャッシュファイルのパスを求める.
+ *
+ *  ファイル名に使用できない名前の場合は, -1 が返る.
+ */
+static int nss_file_path(struct nss_cache *self,
+                         const struct nss_kind *kind,
+                         const char *name,
+                         char *path,
+                         size_t size)
+{
+    if ((self->dir[0] == '\0') || (name[0] == '\0') || (name[0] == '.') || (strchr(name, '/') != NULL)) {
+        return -1;
+    }
+    if (snprintf(path, size, "%s/%s.%s", self->dir, kind->file, name) >= (int)size) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  1 行を読み込み, 改行を取り除く.
+ */
+static int nss_read_line(FILE *fp, char *buf, size_t size)
+{
+    if (fgets(buf, size, fp) == NULL) {
+        return -1;
+    }
+    size_t length = strlen(buf);
+    if ((length == 0) || (buf[length - 1] != '\n')) {
+        return -1;
+    }
+    buf[length - 1] = '\0';
+
+    return 0;
+}
+
+/**
+ *  キャッシュファイルから結果を読み込む.
+ *
+ *  @return 有効な結果を読み込んだ場合は 0 が返り, それ以外は -1 が返る.
+ */
+static int nss_file_load(const char *path, const struct nss_stamp *stamp, struct nss_entry *entry)
+{
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat status;
+    if ((fstat(fd, &status) != 0)
+        || (status.st_uid != geteuid())
+        || (status.st_mode & (S_IWGRP | S_IWOTH))) {
+
+        DEBUG("nss: ignore %s", path);
+        close(fd);
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "r");
+    if (fp == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    int found;
+    intmax_t expires;
+    unsigned int uid;
+    unsigned int gid;
+    int ret = -1;
+    memset(entry, 0, sizeof(*entry));
+    /* 存在しない名前の行は空のため, 改行は読み飛ばさずに 1 文字ずつ確認する. */
+    if ((fscanf(fp, "%d %jd %ju %jd %jd %ld %u %u",
+                &found, &expires, &entry->stamp.ino, &entry->stamp.size,
+                &entry->stamp.sec, &entry->stamp.nsec, &uid, &gid) == 8)
+        && (fgetc(fp) == '\n')
+        && (nss_read_line(fp, entry->user.name, sizeof(entry->user.name)) == 0)
+        && (nss_read_line(fp, entry->user.dir, sizeof(entry->user.dir)) == 0)
+        && (nss_read_line(fp, entry->user.shell, sizeof(entry->user.shell)) == 0)) {
+
+        entry->found = (found != 0);
+        entry->expires = (time_t)expires;
+        entry->user.uid = (uid_t)uid;
+        entry->user.gid = (gid_t)gid;
+        ret = nss_entry_valid(entry, stamp) ? 0 : -1;
+    }
+    fclose(fp);
+
+    return ret;
+}
+
+/**
+ *  結果をキャッシュファイルに保存する.
+ *
+ *  一時ファイルに書き込んだ後に置き換えるため, 書き込み中のファイルを
+ *  他のプロセスが読むことはない.
+ */
+static int nss_file_save(struct nss_cache *self, const char *path, const struct nss_entry *entry)
+{
+    char temp[PATH_MAX];
+
+    /* 改行を含む値は, 1 行ずつの形式で記録できない. */
+    if ((strchr(entry->user.name, '\n') != NULL)
+        || (strchr(entry->user.dir, '\n') != NULL)
+        || (strchr(entry->user.shell, '\n') != NULL)) {
+
+        return -1;
+    }
+    if (make_directories(self->dir, NSS_CACHE_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), self->dir);
+        return -1;
+    }
+    if (snprintf(temp, sizeof(temp), "%s.XXXXXX", path) >= (int)sizeof(temp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(temp);
+    if (fd < 0) {
+        DEBUG("mkstemp: %s (%s)", strerror(errno), temp);
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        unlink(temp);
+        return -1;
+    }
+    fprintf(fp, "%d %jd %ju %jd %jd %ld %u %u\n%s\n%s\n%s\n",
+            entry->found ? 1 : 0, (intmax_t)entry->expires,
+            entry->stamp.ino, entry->stamp.size, entry->stamp.sec, entry->stamp.nsec,
+            (unsigned int)entry->user.uid, (unsigned int)entry->user.gid,
+            entry->user.name, entry->user.dir, entry->user.shell);
+    if ((fclose(fp) != 0) || (rename(temp, path) != 0)) {
+        DEBUG("nss: failed to save %s: %s", path, strerror(errno));
+        unlink(temp);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  NSS に問い合わせる.
+ *
+ *  @return 名前が存在するかを判定できた場合は 0 が返る.
+ *          それ以外は -1 が返り, errno が適切に設定される.
+ */
+static int nss_resolve(const struct nss_kind *kind, const char *name, struct nss_entry *entry)
+{
+    char *buf = malloc(NSS_BUFFER_SIZE);
+    if (buf == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int error;
+    if (kind == &nss_user_kind) {
+        struct passwd pw;
+        struct passwd *result = NULL;
+        error = getpwnam_r(name, &pw, buf, NSS_BUFFER_SIZE, &result);
+        if ((error == 0) && (result != NULL)) {
+            entry->found = true;
+            entry->user.uid = pw.pw_uid;
+            entry->user.gid = pw.pw_gid;
+            snprintf(entry->user.name, sizeof(entry->user.name), "%s", (pw.pw_name != NULL) ? pw.pw_name : "");
+            snprintf(entry->user.dir, sizeof(entry->user.dir), "%s", (pw.pw_dir != NULL) ? pw.pw_dir : "");
+            snprintf(entry->user.shell, sizeof(entry->user.shell), "%s", (pw.pw_shell != NULL) ? pw.pw_shell : "");
+        }
+    } else {
+        struct group gr;
+        struct group *result = NULL;
+        error = getgrnam_r(name, &gr, buf, NSS_BUFFER_SIZE, &result);
+        if ((error == 0) && (result != NULL)) {
+            entry->found = true;
+            entry->user.gid = gr.gr_gid;
+            snprintf(entry->user.name, sizeof(entry->user.name), "%s", (gr.gr_name != NULL) ? gr.gr_name : "");
+        }
+    }
+    free(buf);
+
+    /* 名前が無い場合のエラーは, 実装によって異なる. (getpwnam(3) 参照) */
+    if ((error == 0) || (error == ENOENT) || (error == ESRCH) || (error == EBADF) || (error == EPERM)) {
+        return 0;
+    }
+    DEBUG("nss: %s %s: %s", kind->file, name, strerror(error));
+    errno = error;
+
+    return -1;
+}
+
+/**
+ *  キャッシュを使用して名前を解決する.
+ *
+ *  メモリ, キャッシュファイル, NSS の順に参照する.
+ */
+static int nss_cache_lookup(struct nss_cache *self,
+                            const struct nss_kind *kind,
+                            const char *name,
+                            struct nss_entry *entry)
+{
+    uint64_t start = monotonic_ns();
+    char key[LOGIN_NAME_MAX + 2];
+    char path[PATH_MAX];
+    struct nss_stamp stamp;
+    bool cached = false;
+    bool cacheable = (snprintf(key, sizeof(key), "%c%s", kind->prefix, name) < (int)sizeof(key));
+
+    nss_stamp_get(kind->source, &stamp);
+    if (cacheable) {
+        pthread_mutex_lock(&self->lock);
+        if (self->inotify_fd >= 0) {
+            nss_cache_poll(self);
+        }
+        const struct nss_entry *found = map_get(self->entries, key);
+        if ((found != NULL) && nss_entry_valid(found, (self->inotify_fd >= 0) ? NULL : &stamp)) {
+            *entry = *found;
+            cached = true;
+        }
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    bool has_file = cacheable && (nss_file_path(self, kind, name, path, sizeof(path)) == 0);
+    if (!cached && has_file && (nss_file_load(path, &stamp, entry) == 0)) {
+        cached = true;
+        pthread_mutex_lock(&self->lock);
+        if ((map_put(self->entries, key, entry) == NULL) && (map_clear(self->entries) == 0)) {
+            map_put(self->entries, key, entry);
+        }
+        pthread_mutex_unlock(&self->lock);
+    }
+
+    int ret = 0;
+    if (!cached) {
+        memset(entry, 0, sizeof(*entry));
+        entry->stamp = stamp;
+        ret = nss_resolve(kind, name, entry);
+        if ((ret == 0) && cacheable) {
+            entry->expires = time(NULL) + (entry->found ? self->ttl : self->negative_ttl);
+            pthread_mutex_lock(&self->lock);
+            if ((map_put(self->entries, key, entry) == NULL) && (map_clear(self->entries) == 0)) {
+                map_put(self->entries, key, entry);
+            }
+            pthread_mutex_unlock(&self->lock);
+            if (has_file) {
+                nss_file_save(self, path, entry);
+            }
+        }
+    }
+    int error = errno;
+
+    pthread_mutex_lock(&self->lock);
+    if (cached) {
+        self->stats.hits++;
+        self->stats.negative_hits += entry->found ? 0 : 1;
+    } else {
+        self->stats.misses++;
+    }
+    self->stats.lookup_ns += monotonic_ns() - start;
+    pthread_mutex_unlock(&self->lock);
+
+    if (ret != 0) {
+        errno = error;
+        return -1;
+    }
+    if (!entry->found) {
+        errno = ENOENT;
+        return -1;
+    }
+    /* 空の名前や, 異なる名前の結果は使用しない. */
+    if (strcmp(entry->user.name, name) != 0) {
+        DEBUG("nss: asked for %s %s, got %s", kind->file, name, entry->user.name);
+        errno = ENOENT;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    NSS キャッシュを開く.
+ *              @c dir が NULL または空文字列の場合は, メモリ上のみで
+ *              キャッシュする.
+ *
+ *  @param      [in]    dir             キャッシュファイルを格納するディレクトリ.
+ *  @param      [in]    ttl             存在する名前の有効期間 (秒).
+ *  @param      [in]    negative_ttl    存在しない名前の有効期間 (秒).
+ *  @return     成功時は, NSS キャッシュオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+NSS_CACHE nss_cache_open(const char *dir, unsigned int ttl, unsigned int negative_ttl)
+{
+    struct nss_cache *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if ((dir != NULL)
+        && (snprintf(self->dir, sizeof(self->dir), "%s", dir) >= (int)sizeof(self->dir))) {
+
+        free(self);
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    self->entries = map_init(sizeof(struct nss_entry), NSS_CACHE_ENTRIES_MAX);
+    if (self->entries == NULL) {
+        free(self);
+        return NULL;
+    }
+    pthread_mutex_init(&self->lock, NULL);
+    self->ttl = ttl;
+    self->negative_ttl = negative_ttl;
+
+    /* 置き換えによる更新も検知するため, ファイルではなく /etc を監視する. */
+    self->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if ((self->inotify_fd >= 0)
+        && (inotify_add_watch(self->inotify_fd, "/etc",
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0)) {
+
+        DEBUG("inotify_add_watch: %s (/etc)", strerror(errno));
+        close(self->inotify_fd);
+        self->inotify_fd = -1;
+    }
+
+    return (NSS_CACHE)self;
+}
+
+/**
+ *  @details    NSS キャッシュを閉じる.
+ *              キャッシュファイルは削除しない.
+ *
+ *  @param      [in]    cache   NSS キャッシュオブジェクト.
+ */
+void nss_cache_close(NSS_CACHE cache)
+{
+    struct nss_cache *self = (struct nss_cache *)cache;
+
+    if (self != NULL) {
+        if (self->inotify_fd >= 0) {
+            close(self->inotify_fd);
+        }
+        map_release(self->entries);
+        pthread_mutex_destroy(&self->lock);
+        free(self);
+    }
+}
+
+/**
+ *  @details    ユーザ名からユーザの情報を取得する.
+ *              存在しない名前も, 有効期間の間はキャッシュする.
+ *
+ *  @param      [in]    cache   NSS キャッシュオブジェクト.
+ *  @param      [in]    name    ユーザ名.
+ *  @param      [out]   user    ユーザの情報.
+ *  @return     成功時は, 0 が返る.
+ *              ユーザが存在しない場合は, -1 が返り, errno に ENOENT が設定される.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int nss_cache_get_user(NSS_CACHE cache, const char *name, struct nss_user *user)
+{
+    struct nss_cache *self = (struct nss_cache *)cache;
+    struct nss_entry entry;
+
+    if ((self == NULL) || (name == NULL) || (user == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nss_cache_lookup(self, &nss_user_kind, name, &entry) != 0) {
+        return -1;
+    }
+    *user = entry.user;
+
+    return 0;
+}
+
+/**
+ *  @details    グループ名からグループ ID を取得する.
+ *              存在しない名前も, 有効期間の間はキャッシュする.
+ *
+ *  @param      [in]    cache   NSS キャッシュオブジェクト.
+ *  @param      [in]    name    グループ名.
+ *  @param      [out]   gid     グループ ID.
+ *  @return     成功時は, 0 が返る.
+ *              グループが存在しない場合は, -1 が返り, errno に ENOENT が設定される.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int nss_cache_get_group(NSS_CACHE cache, const char *name, gid_t *gid)
+{
+    struct nss_cache *self = (struct nss_cache *)cache;
+    struct nss_entry entry;
+
+    if ((self == NULL) || (name == NULL) || (gid == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nss_cache_lookup(self, &nss_group_kind, name, &entry) != 0) {
+        return -1;
+    }
+    *gid = entry.user.gid;
+
+    return 0;
+}
+
+/**
+ *  @details    NSS キャッシュの統計情報を取得する.
+ *
+ *  @param      [in]    cache   NSS キャッシュオブジェクト.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int nss_cache_get_stats(NSS_CACHE cache, struct nss_cache_stats *stats)
+{
+    struct nss_cache *self = (struct nss_cache *)cache;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    pthread_mutex_lock(&self->lock);
+    *stats = self->stats;
+    pthread_mutex_unlock(&self->lock);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/** @file       nsscache.h
+ *  @brief      ユーザとグループの名前解決 (NSS) のキャッシュを提供する.
+ *
+ *  getpwnam(3) と getgrnam(3) の結果を, 存在しない名前も含めて有効期限付きで
+ *  保持する. 同じプロセスの起動間ではメモリ上で, 別のプロセスの起動間では
+ *  キャッシュディレクトリのファイルで共有する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_NSSCACHE_H__
+#define __ALCATRAZ_NSSCACHE_H__
+
+#include <stdint.h>
+#include <limits.h>
+#include <sys/types.h>
+
+/** @defgroup cat_nsscache NSS cache
+ *  ユーザとグループの名前解決をキャッシュするモジュール.
+ *  @{
+ */
+
+/**
+ *  メモリ上に保持する名前の最大数.
+ */
+#define NSS_CACHE_ENTRIES_MAX (32)
+
+/**
+ *  NSS キャッシュ型.
+ */
+typedef struct {} *NSS_CACHE;
+
+/**
+ *  ユーザの情報.
+ */
+struct nss_user {
+    uid_t uid;                 /**< ユーザ ID. */
+    gid_t gid;                 /**< グループ ID. */
+    char name[LOGIN_NAME_MAX]; /**< ユーザ名. */
+    char dir[PATH_MAX];        /**< ホームディレクトリのパス. */
+    char shell[PATH_MAX];      /**< シェルのパス. */
+};
+
+/**
+ *  NSS キャッシュの統計情報.
+ */
+struct nss_cache_stats {
+    uint64_t hits;          /**< キャッシュで解決した回数. */
+    uint64_t negative_hits; /**< キャッシュで存在しないと判定した回数. */
+    uint64_t misses;        /**< NSS に問い合わせた回数. */
+    uint64_t invalidations; /**< /etc/passwd または /etc/group の更新で破棄した回数. */
+    uint64_t lookup_ns;     /**< 名前解決に要した合計時間 (ナノ秒). */
+};
+
+/**
+ *  NSS キャッシュを開く.
+ *
+ *  @par    使用例
+ *          @code
+ *          NSS_CACHE cache = nss_cache_open("/run/alctrz/nss", 300, 30);
+ *          struct nss_user user;
+ *          if (nss_cache_get_user(cache, "nobody", &user) == 0) {
+ *              // do something.
+ *          }
+ *          nss_cache_close(cache);
+ *          @endcode
+ */
+NSS_CACHE nss_cache_open(const char *dir, unsigned int ttl, unsigned int negative_ttl);
+
+/**
+ *  NSS キャッシュを閉じる.
+ */
+void nss_cache_close(NSS_CACHE cache);
+
+/**
+ *  ユーザ名からユーザの情報を取得する.
+ */
+int nss_cache_get_user(NSS_CACHE cache, const char *name, struct nss_user *user);
+
+/**
+ *  グループ名からグループ ID を取得する.
+ */
+int nss_cache_get_group(NSS_CACHE cache, const char *name, gid_t *gid);
+
+/**
+ *  NSS キャッシュの統計情報を取得する.
+ */
+int nss_cache_get_stats(NSS_CACHE cache, struct nss_cache_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_NSSCACHE_H__ */
@@ -0,0 +1,329 @@
+/** @file       pipeline.c
+ *  @brief      依存関係を持つ処理段階の並行実行を提供する.
+ *
+ *  フェーズは登録済みのフェーズにのみ依存できるため, 依存関係は常に
+ *  有向非巡回グラフとなる. 実行可能なフェーズが一つだけの場合は
+ *  呼び出し元のスレッドで実行し, 複数ある場合はスレッドを生成する.
+ *  依存するフェーズが失敗した場合, そのフェーズは実行しない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for clock_gettime */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "pipeline.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  フェーズの状態: 未実行.
+ */
+#define PHASE_PENDING (2)
+
+/**
+ *  フェーズの状態: 実行中.
+ */
+#define PHASE_RUNNING (3)
+
+struct pipeline;
+
+/**
+ *  フェーズの登録情報.
+ */
+struct pipeline_entry {
+    struct pipeline *owner; /**< 所属するパイプライン. */
+    const char *name;       /**< フェーズの名前. */
+    pipeline_phase phase;   /**< フェーズの処理. */
+    void *arg;              /**< @c phase に渡す引数. */
+    uint32_t deps;          /**< 依存するフェーズ. */
+    int state;              /**< フェーズの状態. */
+    int error;              /**< 失敗時の errno. */
+    uint64_t start_ns;      /**< 開始時刻. */
+    uint64_t end_ns;        /**< 終了時刻. */
+    pthread_t thread;       /**< フェーズを実行するスレッド. */
+    bool threaded;          /**< スレッドで実行したか. */
+};
+
+/**
+ *  パイプライン管理構造体.
+ */
+struct pipeline {
+    struct pipeline_entry entries[PIPELINE_PHASES_MAX]; /**< フェーズの登録情報. */
+    size_t count;                                       /**< 登録済みのフェーズの数. */
+    uint32_t done;                                      /**< 成功したフェーズ. */
+    uint32_t failed;                                    /**< 失敗または未実行のフェーズ. */
+    uint64_t start_ns;                                  /**< 開始時刻. */
+    pthread_mutex_t lock;                               /**< 状態を保護するロック. */
+    pthread_cond_t cond;                                /**< フェーズの完了を通知する条件変数. */
+};
+
+/**
+ *  フェーズを実行し, 結果を記録する.
+ *
+ *  ロックを保持せずに呼び出す.
+ */
+static void run_entry(struct pipeline *self, struct pipeline_entry *entry)
+{
+    entry->start_ns = monotonic_ns();
+    int ret = entry->phase(entry->arg);
+    int error = errno;
+    uint64_t end_ns = monotonic_ns();
+
+    pthread_mutex_lock(&self->lock);
+    entry->end_ns = end_ns;
+    if (ret == 0) {
+        entry->state = PIPELINE_PHASE_DONE;
+        self->done |= PIPELINE_DEP(entry - self->entries);
+    } else {
+        DEBUG("pipeline: phase '%s' failed: %s", entry->name, strerror(error));
+        entry->state = PIPELINE_PHASE_FAILED;
+        entry->error = error;
+        self->failed |= PIPELINE_DEP(entry - self->entries);
+    }
+    pthread_cond_broadcast(&self->cond);
+    pthread_mutex_unlock(&self->lock);
+}
+
+static void *entry_thread(void *arg)
+{
+    struct pipeline_entry *entry = (struct pipeline_entry *)arg;
+
+    run_entry(entry->owner, entry);
+
+    return NULL;
+}
+
+/**
+ *  @details    空の @ref PIPELINE オブジェクトを確保および初期化する.
+ *
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PIPELINE pipeline_init(void)
+{
+    struct pipeline *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->cond, NULL);
+
+    return (PIPELINE)self;
+}
+
+/**
+ *  @details    @c pipeline を解放する.
+ *              実行中のフェーズがある場合は呼び出してはならない.
+ *
+ *  @param      [in,out]    pipeline    パイプラインオブジェクト.
+ */
+void pipeline_release(PIPELINE pipeline)
+{
+    struct pipeline *self = (struct pipeline *)pipeline;
+
+    if (self != NULL) {
+        pthread_cond_destroy(&self->cond);
+        pthread_mutex_destroy(&self->lock);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c phase を @c pipeline に登録する.
+ *              @c deps には登録済みのフェーズの ID を @ref PIPELINE_DEP で
+ *              変換して指定する.
+ *
+ *  @param      [in,out]    pipeline    パイプラインオブジェクト.
+ *  @param      [in]        name        フェーズの名前.
+ *  @param      [in]        phase       フェーズの処理.
+ *  @param      [in]        arg         @c phase に渡す引数.
+ *  @param      [in]        deps        依存するフェーズ.
+ *  @return     成功時は, フェーズの ID が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int pipeline_add(PIPELINE pipeline,
+                 const char *name,
+                 pipeline_phase phase,
+                 void *arg,
+                 uint32_t deps)
+{
+    struct pipeline *self = (struct pipeline *)pipeline;
+
+    if ((self == NULL) || (name == NULL) || (phase == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (self->count == PIPELINE_PHASES_MAX) {
+        errno = ENOSPC;
+        return -1;
+    }
+    /* 未登録のフェーズには依存できないため, 循環は生じない. */
+    if ((deps & ~(PIPELINE_DEP(self->count) - 1)) != 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct pipeline_entry *entry = &self->entries[self->count];
+    entry->owner = self;
+    entry->name = name;
+    entry->phase = phase;
+    entry->arg = arg;
+    entry->deps = deps;
+    entry->state = PHASE_PENDING;
+    entry->error = 0;
+    entry->threaded = false;
+
+    return (int)self->count++;
+}
+
+/**
+ *  @details    @c pipeline に登録したフェーズを, 依存関係に従って全て実行する.
+ *              依存するフェーズが全て成功したフェーズから実行し,
+ *              同時に実行可能なフェーズはスレッドで並行に実行する.
+ *
+ *  @param      [in,out]    pipeline    パイプラインオブジェクト.
+ *  @return     全てのフェーズが成功した場合は, 0 が返る.
+ *              失敗したフェーズがある場合は, 全てのフェーズの終了を待って
+ *              -1 が返り, errno には最初に失敗したフェーズの errno が設定される.
+ *  @warning    一つの @c pipeline に対して一度のみ呼び出せる.
+ */
+int pipeline_run(PIPELINE pipeline)
+{
+    struct pipeline *self = (struct pipeline *)pipeline;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&self->lock);
+    self->start_ns = monotonic_ns();
+    for (;;) {
+        struct pipeline_entry *ready[PIPELINE_PHASES_MAX];
+        size_t num_ready = 0;
+        size_t running = 0;
+
+        /* 依存先は常に前方にあるため, 一度の走査で未実行の判定は伝播する. */
+        for (size_t i = 0; i < self->count; ++i) {
+            struct pipeline_entry *entry = &self->entries[i];
+
+            if (entry->state == PHASE_RUNNING) {
+                ++running;
+            } else if (entry->state == PHASE_PENDING) {
+                if ((entry->deps & self->failed) != 0) {
+                    entry->state = PIPELINE_PHASE_SKIPPED;
+                    self->failed |= PIPELINE_DEP(i);
+                } else if ((entry->deps & ~self->done) == 0) {
+                    entry->state = PHASE_RUNNING;
+                    ready[num_ready++] = entry;
+                }
+            }
+        }
+
+        if ((num_ready == 1) && (running == 0)) {
+            /* 並行して実行するものが無ければ, スレッドは生成しない. */
+            pthread_mutex_unlock(&self->lock);
+            run_entry(self, ready[0]);
+            pthread_mutex_lock(&self->lock);
+            continue;
+        }
+        for (size_t i = 0; i < num_ready; ++i) {
+            int ret = pthread_create(&ready[i]->thread, NULL, entry_thread, ready[i]);
+            if (ret == 0) {
+                ready[i]->threaded = true;
+                ++running;
+            } else {
+                DEBUG("pthread_create: %s (%s)", strerror(ret), ready[i]->name);
+                pthread_mutex_unlock(&self->lock);
+                run_entry(self, ready[i]);
+                pthread_mutex_lock(&self->lock);
+            }
+        }
+
+        if (running == 0) {
+            if (num_ready == 0) {
+                break;
+            }
+            continue;
+        }
+        pthread_cond_wait(&self->cond, &self->lock);
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    int error = 0;
+    for (size_t i = 0; i < self->count; ++i) {
+        struct pipeline_entry *entry = &self->entries[i];
+
+        if (entry->threaded) {
+            pthread_join(entry->thread, NULL);
+            entry->threaded = false;
+        }
+        if ((error == 0) && (entry->state != PIPELINE_PHASE_DONE)) {
+            error = (entry->state == PIPELINE_PHASE_FAILED) ? entry->error : ECANCELED;
+        }
+    }
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c pipeline に登録したフェーズの数を返す.
+ *
+ *  @param      [in]    pipeline    パイプラインオブジェクト.
+ *  @return     登録したフェーズの数が返る.
+ */
+size_t pipeline_count(PIPELINE pipeline)
+{
+    struct pipeline *self = (struct pipeline *)pipeline;
+
+    return (self != NULL) ? self->count : 0;
+}
+
+/**
+ *  @details    @c pipeline_run で実行したフェーズの結果を取得する.
+ *
+ *  @param      [in]    pipeline    パイプラインオブジェクト.
+ *  @param      [in]    id          フェーズの ID.
+ *  @param      [out]   stats       フェーズの実行結果.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int pipeline_get_stats(PIPELINE pipeline, size_t id, struct pipeline_stats *stats)
+{
+    struct pipeline *self = (struct pipeline *)pipeline;
+
+    if ((self == NULL) || (id >= self->count) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const struct pipeline_entry *entry = &self->entries[id];
+    stats->name = entry->name;
+    stats->state = entry->state;
+    if ((entry->state == PIPELINE_PHASE_DONE) || (entry->state == PIPELINE_PHASE_FAILED)) {
+        stats->start_us = (entry->start_ns - self->start_ns) / UINT64_C(1000);
+        stats->elapsed_us = (entry->end_ns - entry->start_ns) / UINT64_C(1000);
+    } else {
+        stats->start_us = 0;
+        stats->elapsed_us = 0;
+    }
+
+    return 0;
+}
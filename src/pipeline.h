@@ -0,0 +1,118 @@
+/** @file       pipeline.h
+ *  @brief      依存関係を持つ処理段階の並行実行を提供する.
+ *
+ *  起動処理を段階 (フェーズ) に分け, 依存するフェーズが全て完了した
+ *  フェーズから順に, 互いに独立したものはスレッドで並行に実行する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_PIPELINE_H__
+#define __ALCATRAZ_PIPELINE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup cat_pipeline Pipeline
+ *  依存関係を持つフェーズを並行に実行するモジュール.
+ *  @{
+ */
+
+/**
+ *  登録できるフェーズの最大数.
+ */
+#define PIPELINE_PHASES_MAX (32)
+
+/**
+ *  フェーズの ID から依存関係のビットを求める.
+ */
+#define PIPELINE_DEP(id) (UINT32_C(1) << (id))
+
+/**
+ *  フェーズの状態: 成功.
+ */
+#define PIPELINE_PHASE_DONE (0)
+
+/**
+ *  フェーズの状態: 失敗.
+ */
+#define PIPELINE_PHASE_FAILED (-1)
+
+/**
+ *  フェーズの状態: 依存するフェーズの失敗により未実行.
+ */
+#define PIPELINE_PHASE_SKIPPED (1)
+
+/**
+ *  パイプライン型.
+ */
+typedef struct {} *PIPELINE;
+
+/**
+ *  フェーズの処理の型.
+ *
+ *  成功時は 0 を, 失敗時は errno を設定して -1 を返す.
+ */
+typedef int (*pipeline_phase)(void *arg);
+
+/**
+ *  フェーズの実行結果.
+ */
+struct pipeline_stats {
+    const char *name;    /**< フェーズの名前. */
+    int state;           /**< フェーズの状態. */
+    uint64_t start_us;   /**< パイプラインの開始から, フェーズの開始までの時間 (マイクロ秒). */
+    uint64_t elapsed_us; /**< フェーズに要した時間 (マイクロ秒). */
+};
+
+/**
+ *  パイプラインオブジェクトを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          PIPELINE pipeline = pipeline_init();
+ *          int user = pipeline_add(pipeline, "user", resolve_user, ctx, 0);
+ *          int jail = pipeline_add(pipeline, "jail", mount_jail, ctx, 0);
+ *          pipeline_add(pipeline, "rootfs", build_rootfs, ctx,
+ *                       PIPELINE_DEP(user) | PIPELINE_DEP(jail));
+ *          pipeline_run(pipeline);
+ *          pipeline_release(pipeline);
+ *          @endcode
+ */
+PIPELINE pipeline_init(void);
+
+/**
+ *  パイプラインオブジェクトを解放する.
+ */
+void pipeline_release(PIPELINE pipeline);
+
+/**
+ *  フェーズを登録する.
+ */
+int pipeline_add(PIPELINE pipeline,
+                 const char *name,
+                 pipeline_phase phase,
+                 void *arg,
+                 uint32_t deps);
+
+/**
+ *  登録したフェーズを全て実行する.
+ */
+int pipeline_run(PIPELINE pipeline);
+
+/**
+ *  登録したフェーズの数を取得する.
+ */
+size_t pipeline_count(PIPELINE pipeline);
+
+/**
+ *  フェーズの実行結果を取得する.
+ */
+int pipeline_get_stats(PIPELINE pipeline, size_t id, struct pipeline_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_PIPELINE_H__ */
@@ -0,0 +1,1413 @@
+/** @file       plan.c
+ *  @brief      コンパイル済みの jail 構成 (プラン) を提供する.
+ *
+ *  プランファイルは以下の構成で, 各セクションは 8 バイト境界に配置する.
+ *  文字列は文字列セクションからのオフセットで参照し, オフセット 0 は
+ *  空文字列を表す.
+ *
+ *  | セクション      | 内容                              |
+ *  | --------------- | --------------------------------- |
+ *  | ヘッダ          | struct plan_header                |
+ *  | directory       | uint32_t (文字列のオフセット)     |
+ *  | device          | struct plan_device                |
+ *  | bind            | struct plan_bind                  |
+ *  | environment     | struct plan_env                   |
+ *  | binary          | uint32_t (文字列のオフセット)     |
+ *  | prewarm         | uint32_t (文字列のオフセット)     |
+ *  | 文字列          | NUL 終端文字列の並び              |
+ *
+ *  プランファイルは mmap して, そのまま参照する.
+ *  元になった設定ファイルの更新時刻やハッシュ値が変わった場合は,
+ *  プランを生成し直す.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX, realpath */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "plan.h"
+#include "hash.h"
+#include "debug.h"
+
+/**
+ *  プランファイルの識別子.
+ */
+#define PLAN_MAGIC "ALCPLAN"
+
+/**
+ *  プランファイルの形式のバージョン.
+ */
+#define PLAN_FORMAT_VERSION (6)
+
+/**
+ *  セクションの配置境界.
+ */
+#define PLAN_ALIGN (8)
+
+/**
+ *  セクションの位置情報.
+ */
+struct plan_section {
+    uint32_t offset; /**< ファイル先頭からのオフセット. */
+    uint32_t count;  /**< 要素の数. (文字列セクションはバイト数) */
+};
+
+/**
+ *  プランファイルのヘッダ.
+ */
+struct plan_header {
+    char magic[8];                   /**< 識別子. */
+    uint32_t version;                /**< 形式のバージョン. */
+    uint32_t length;                 /**< ファイルサイズ. */
+    uint64_t key;                    /**< 内容を表すキー. */
+    uint64_t source_hash;            /**< 設定ファイルのハッシュ値. */
+    uint64_t source_size;            /**< 設定ファイルのサイズ. */
+    int64_t source_mtime_sec;        /**< 設定ファイルの更新時刻 (秒). */
+    int64_t source_mtime_nsec;       /**< 設定ファイルの更新時刻 (ナノ秒). */
+    uint32_t source;                 /**< 設定ファイルのパス. */
+    uint32_t flags;                  /**< プランの属性. */
+    uint64_t capabilities;           /**< 残す capability. */
+    uint32_t stdio;                  /**< 標準入出力の FIFO のパス. */
+    uint32_t template_path;          /**< rootfs の雛形を格納するディレクトリ. */
+    uint32_t elf_cache;              /**< ELF の依存ファイルのキャッシュを格納するディレクトリ. */
+    uint32_t prewarm_lock_limit;     /**< mlock するファイルの合計サイズの上限 (MiB). */
+    struct plan_pool pool;           /**< jail プールの構成. */
+    struct plan_image rootfs_image;  /**< rootfs のイメージの構成. */
+    struct plan_archive archive;     /**< rootfs に展開するアーカイブの構成. */
+    struct plan_tmpfs tmpfs;         /**< jail の tmpfs の構成. */
+    struct plan_section directories; /**< ディレクトリ. */
+    struct plan_section devices;     /**< デバイスファイル. */
+    struct plan_section binds;       /**< バインド. */
+    struct plan_section environment; /**< 環境変数. */
+    struct plan_section binaries;    /**< 依存ファイルを解決するプログラム. */
+    struct plan_section prewarm;     /**< プリウォームするパス. */
+    struct plan_section strings;     /**< 文字列. */
+};
+
+/**
+ *  プラン管理構造体.
+ */
+struct plan {
+    const struct plan_header *image; /**< プランファイルの内容. */
+    size_t length;                   /**< @c image のサイズ. */
+    bool mapped;                     /**< @c image を mmap したか. */
+};
+
+/**
+ *  伸長可能なバッファ.
+ */
+struct plan_buffer {
+    char *data;      /**< データ. */
+    size_t length;   /**< データ長. */
+    size_t capacity; /**< 確保したサイズ. */
+};
+
+/**
+ *  プラン構築器管理構造体.
+ */
+struct plan_builder {
+    struct plan_header header;       /**< 構築中のヘッダ. */
+    struct plan_buffer directories;  /**< ディレクトリ. */
+    struct plan_buffer devices;      /**< デバイスファイル. */
+    struct plan_buffer binds;        /**< バインド. */
+    struct plan_buffer environment;  /**< 環境変数. */
+    struct plan_buffer binaries;     /**< 依存ファイルを解決するプログラム. */
+    struct plan_buffer prewarm;      /**< プリウォームするパス. */
+    struct plan_buffer strings;      /**< 文字列. */
+};
+
+/**
+ *  バッファにデータを追加する.
+ *
+ *  @param  [in,out]    buf     バッファ.
+ *  @param  [in]        data    データ.
+ *  @param  [in]        length  データ長.
+ *  @param  [out]       offset  追加した位置. (NULL 可)
+ *  @return 成功時は 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int plan_buffer_append(struct plan_buffer *buf,
+                              const void *data,
+                              size_t length,
+                              uint32_t *offset)
+{
+    if (buf->length + length > UINT32_MAX) {
+        errno = EFBIG;
+        return -1;
+    }
+    if (buf->length + length > buf->capacity) {
+        size_t capacity = (buf->capacity > 0) ? buf->capacity : 256;
+        while (capacity < buf->length + length) {
+            capacity *= 2;
+        }
+        char *p = realloc(buf->data, capacity);
+        if (p == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        buf->data = p;
+        buf->capacity = capacity;
+    }
+
+    memcpy(buf->data + buf->length, data, length);
+    if (offset != NULL) {
+        *offset = buf->length;
+    }
+    buf->length += length;
+
+    return 0;
+}
+
+/**
+ *  文字列を追加する.
+ *
+ *  空文字列はオフセット 0 として追加しない.
+ *
+ *  @param  [in,out]    self    プラン構築器オブジェクト.
+ *  @param  [in]        str     文字列. (NULL 可)
+ *  @param  [out]       offset  追加した位置.
+ *  @return 成功時は 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int plan_builder_add_string(struct plan_builder *self, const char *str, uint32_t *offset)
+{
+    if ((str == NULL) || (str[0] == '\0')) {
+        *offset = 0;
+        return 0;
+    }
+
+    return plan_buffer_append(&self->strings, str, strlen(str) + 1, offset);
+}
+
+/**
+ *  プランの内容を表すキーを更新する.
+ *
+ *  元になった設定ファイルの情報はキーに含めない.
+ *  異なる種別の内容が同じキーにならないよう, @c tag は種別毎に異なる文字とする.
+ *
+ *  @param  [in,out]    self    プラン構築器オブジェクト.
+ *  @param  [in]        tag     内容の種別.
+ *  @param  [in]        data    内容.
+ *  @param  [in]        length  @c data のサイズ.
+ *  @param  [in]        str1    内容に含む文字列. (NULL 可)
+ *  @param  [in]        str2    内容に含む文字列. (NULL 可)
+ */
+static void plan_builder_mix(struct plan_builder *self,
+                             char tag,
+                             const void *data,
+                             size_t length,
+                             const char *str1,
+                             const char *str2)
+{
+    uint64_t key = self->header.key;
+
+    key = fnv1a64_update(key, &tag, sizeof(tag));
+    key = fnv1a64_update(key, data, length);
+    key = fnv1a64_update(key, (str1 != NULL) ? str1 : "", (str1 != NULL) ? strlen(str1) + 1 : 1);
+    key = fnv1a64_update(key, (str2 != NULL) ? str2 : "", (str2 != NULL) ? strlen(str2) + 1 : 1);
+    self->header.key = key;
+}
+
+/**
+ *  ファイルの情報とハッシュ値を取得する.
+ *
+ *  @param  [in]    pathname    ファイルのパス.
+ *  @param  [out]   status      ファイルの情報.
+ *  @param  [out]   hash        ファイルの内容のハッシュ値.
+ *  @return 成功時は 0 が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int plan_hash_file(const char *pathname, struct stat *status, uint64_t *hash)
+{
+    int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), pathname);
+        return -1;
+    }
+    if (fstat(fd, status) != 0) {
+        DEBUG("fstat: %s (%s)", strerror(errno), pathname);
+        close(fd);
+        return -1;
+    }
+
+    *hash = FNV1A64_INIT;
+    if (status->st_size > 0) {
+        void *data = mmap(NULL, status->st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            DEBUG("mmap: %s (%s)", strerror(errno), pathname);
+            close(fd);
+            return -1;
+        }
+        *hash = fnv1a64_update(*hash, data, status->st_size);
+        munmap(data, status->st_size);
+    }
+    close(fd);
+
+    return 0;
+}
+
+/**
+ *  プランファイルの内容を検証する.
+ *
+ *  各セクションがファイルの範囲内にあることのみを検証し,
+ *  要素の内容は参照時に範囲を確認する.
+ *
+ *  @param  [in]    image   プランファイルの内容.
+ *  @param  [in]    length  @c image のサイズ.
+ *  @return 正しい場合は true が返る.
+ */
+static bool plan_validate(const struct plan_header *image, size_t length)
+{
+    if ((length < sizeof(*image))
+        || (memcmp(image->magic, PLAN_MAGIC, sizeof(image->magic)) != 0)
+        || (image->version != PLAN_FORMAT_VERSION)
+        || (image->length != length)) {
+
+        return false;
+    }
+
+    const struct {
+        const struct plan_section *section;
+        size_t size;
+    } sections[] = {
+        {&image->directories, sizeof(uint32_t)},
+        {&image->devices, sizeof(struct plan_device)},
+        {&image->binds, sizeof(struct plan_bind)},
+        {&image->environment, sizeof(struct plan_env)},
+        {&image->binaries, sizeof(uint32_t)},
+        {&image->prewarm, sizeof(uint32_t)},
+        {&image->strings, 1},
+    };
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+        uint64_t offset = sections[i].section->offset;
+        uint64_t bytes = (uint64_t)sections[i].section->count * sections[i].size;
+        if ((offset < sizeof(*image)) || ((offset % PLAN_ALIGN) != 0) || (offset + bytes > length)) {
+            return false;
+        }
+    }
+
+    const char *strings = (const char *)image + image->strings.offset;
+    if ((image->strings.count == 0) || (strings[image->strings.count - 1] != '\0')) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  プランの元になった設定ファイルが更新されていないかを確認する.
+ *
+ *  更新時刻とサイズが一致しない場合は, 内容のハッシュ値で判断する.
+ *  設定ファイルが無い場合は, プランのみで使用できるものとする.
+ *
+ *  @param  [in]    self    プランオブジェクト.
+ *  @return 更新されていない場合は true が返る.
+ */
+static bool plan_is_fresh(struct plan *self)
+{
+    const struct plan_header *header = self->image;
+    const char *source = plan_string((PLAN)self, header->source);
+    struct stat status;
+    uint64_t hash;
+
+    if (source[0] == '\0') {
+        return true;
+    }
+    if (stat(source, &status) != 0) {
+        DEBUG("stat: %s (%s), use the plan as is", strerror(errno), source);
+        return true;
+    }
+    if (((uint64_t)status.st_size == header->source_size)
+        && (status.st_mtim.tv_sec == header->source_mtime_sec)
+        && (status.st_mtim.tv_nsec == header->source_mtime_nsec)) {
+
+        return true;
+    }
+    if (plan_hash_file(source, &status, &hash) != 0) {
+        return false;
+    }
+
+    return ((uint64_t)status.st_size == header->source_size) && (hash == header->source_hash);
+}
+
+/**
+ *  @details    空のプラン構築器を確保および初期化する.
+ *
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PLAN_BUILDER plan_builder_init(void)
+{
+    struct plan_builder *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(self->header.magic, PLAN_MAGIC, sizeof(self->header.magic));
+    self->header.version = PLAN_FORMAT_VERSION;
+    self->header.key = FNV1A64_INIT;
+
+    /* オフセット 0 は空文字列とする. */
+    if (plan_buffer_append(&self->strings, "", 1, NULL) != 0) {
+        free(self);
+        return NULL;
+    }
+
+    return (PLAN_BUILDER)self;
+}
+
+/**
+ *  @details    @c builder を解放する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ */
+void plan_builder_release(PLAN_BUILDER builder)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if (self != NULL) {
+        free(self->directories.data);
+        free(self->devices.data);
+        free(self->binds.data);
+        free(self->environment.data);
+        free(self->binaries.data);
+        free(self->prewarm.data);
+        free(self->strings.data);
+        free(self);
+    }
+}
+
+/**
+ *  @details    プランの元になった設定ファイルの, パス, 更新時刻,
+ *              サイズおよびハッシュ値を記録する.
+ *              記録した情報は, プランファイルを開く際の更新の確認に使用する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        source  設定ファイルのパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_source(PLAN_BUILDER builder, const char *source)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    char path[PATH_MAX];
+    struct stat status;
+    uint64_t hash;
+
+    if ((self == NULL) || (source == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (realpath(source, path) == NULL) {
+        DEBUG("realpath: %s (%s)", strerror(errno), source);
+        return -1;
+    }
+    if (plan_hash_file(path, &status, &hash) != 0) {
+        return -1;
+    }
+    if (plan_builder_add_string(self, path, &self->header.source) != 0) {
+        return -1;
+    }
+    self->header.source_hash = hash;
+    self->header.source_size = status.st_size;
+    self->header.source_mtime_sec = status.st_mtim.tv_sec;
+    self->header.source_mtime_nsec = status.st_mtim.tv_nsec;
+
+    return 0;
+}
+
+/**
+ *  @details    プランの属性 (PLAN_KERNELFS_*, PLAN_MOUNT_NAMESPACE) を追加する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        flags   プランの属性.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_flags(PLAN_BUILDER builder, uint32_t flags)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->header.flags |= flags;
+    plan_builder_mix(self, 'f', &flags, sizeof(flags), NULL, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    残す capability をビットマスクで設定する.
+ *
+ *  @param      [in,out]    builder         プラン構築器オブジェクト.
+ *  @param      [in]        capabilities    残す capability のビットマスク.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_capabilities(PLAN_BUILDER builder, uint64_t capabilities)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->header.capabilities = capabilities;
+    plan_builder_mix(self, 'c', &capabilities, sizeof(capabilities), NULL, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    標準入出力の FIFO のパスを設定する.
+ *              パスは, ファイル記述子番号を埋め込む書式文字列である.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        path    FIFO のパスの書式.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_stdio(PLAN_BUILDER builder, const char *path)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (path == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, path, &self->header.stdio) != 0) {
+        return -1;
+    }
+    plan_builder_mix(self, 's', NULL, 0, path, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail プールの構成を設定する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        path        プールを格納するディレクトリ.
+ *  @param      [in]        size        保持する jail の数.
+ *  @param      [in]        low_water   補充を開始する jail の数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_pool(PLAN_BUILDER builder,
+                          const char *path,
+                          uint32_t size,
+                          uint32_t low_water)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (path == NULL) || (size == 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, path, &self->header.pool.path) != 0) {
+        return -1;
+    }
+    self->header.pool.size = size;
+    self->header.pool.low_water = low_water;
+    self->header.flags |= PLAN_POOL;
+    plan_builder_mix(self, 'p', &self->header.pool.size, sizeof(uint32_t) * 2, path, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    rootfs の雛形を格納するディレクトリを設定する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        path    雛形を格納するディレクトリ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_template(PLAN_BUILDER builder, const char *path)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (path == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, path, &self->header.template_path) != 0) {
+        return -1;
+    }
+    self->header.flags |= PLAN_TEMPLATE;
+    plan_builder_mix(self, 't', NULL, 0, path, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    rootfs の下位層として使用するイメージを設定する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        source  イメージファイルのパス.
+ *  @param      [in]        fstype  ファイルシステムの種別. (NULL または空文字列の場合は判定する)
+ *  @param      [in]        path    イメージのマウントを管理するディレクトリ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_image(PLAN_BUILDER builder,
+                           const char *source,
+                           const char *fstype,
+                           const char *path)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (source == NULL) || (path == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((plan_builder_add_string(self, source, &self->header.rootfs_image.source) != 0)
+        || (plan_builder_add_string(self, fstype, &self->header.rootfs_image.fstype) != 0)
+        || (plan_builder_add_string(self, path, &self->header.rootfs_image.path) != 0)) {
+
+        return -1;
+    }
+    self->header.flags |= PLAN_IMAGE;
+    plan_builder_mix(self, 'i', fstype, (fstype != NULL) ? strlen(fstype) : 0, source, path);
+
+    return 0;
+}
+
+/**
+ *  @details    rootfs に展開する tar アーカイブを設定する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        source  アーカイブのパス.
+ *  @param      [in]        workers ファイルを書き込むスレッドの数. (0 の場合は標準)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_archive(PLAN_BUILDER builder, const char *source, uint32_t workers)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (source == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, source, &self->header.archive.source) != 0) {
+        return -1;
+    }
+    self->header.archive.workers = workers;
+    self->header.flags |= PLAN_ARCHIVE;
+    plan_builder_mix(self, 'a', NULL, 0, source, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail の tmpfs の構成を設定する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        size        サイズ (MiB). (0 の場合は標準)
+ *  @param      [in]        nr_inodes   inode の最大数. (0 の場合は tmpfs の既定値)
+ *  @param      [in]        huge        透過的ヒュージページの割り当て (PLAN_TMPFS_HUGE_*).
+ *  @param      [in]        mpol        NUMA メモリポリシー. (NULL の場合は指定しない)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_tmpfs(PLAN_BUILDER builder,
+                           uint32_t size,
+                           uint32_t nr_inodes,
+                           uint32_t huge,
+                           const char *mpol)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (huge > PLAN_TMPFS_HUGE_ALWAYS)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, mpol, &self->header.tmpfs.mpol) != 0) {
+        return -1;
+    }
+    self->header.tmpfs.size = size;
+    self->header.tmpfs.nr_inodes = nr_inodes;
+    self->header.tmpfs.huge = huge;
+    uint32_t values[] = {size, nr_inodes, huge};
+    /* 雛形 ('t') と区別する. */
+    plan_builder_mix(self, 'm', values, sizeof(values), mpol, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail に閉じ込めるプログラムの ELF の依存ファイルを解決し,
+ *              rootfs にバインドするよう設定する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        cache_path  解決結果のキャッシュを格納するディレクトリ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_elf(PLAN_BUILDER builder, const char *cache_path)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if ((self == NULL) || (cache_path == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, cache_path, &self->header.elf_cache) != 0) {
+        return -1;
+    }
+    self->header.flags |= PLAN_ELF_DEPS;
+    plan_builder_mix(self, 'l', NULL, 0, cache_path, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    閉じ込めるプログラムの他に, 依存ファイルを解決して
+ *              バインドするプログラムを追加する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        pathname    プログラムのパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_add_binary(PLAN_BUILDER builder, const char *pathname)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    uint32_t offset;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((plan_builder_add_string(self, pathname, &offset) != 0)
+        || (plan_buffer_append(&self->binaries, &offset, sizeof(offset), NULL) != 0)) {
+
+        return -1;
+    }
+    plan_builder_mix(self, 'x', NULL, 0, pathname, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail の起動と並行して, ファイルをページキャッシュに読み込むよう設定する.
+ *              @c flags には PLAN_PREWARM_FADVISE, PLAN_PREWARM_POPULATE,
+ *              PLAN_PREWARM_LOCK を指定する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        flags       プリウォームの方法.
+ *  @param      [in]        lock_limit  mlock するファイルの合計サイズの上限 (MiB).
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_set_prewarm(PLAN_BUILDER builder, uint32_t flags, uint32_t lock_limit)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    const uint32_t methods = PLAN_PREWARM_FADVISE | PLAN_PREWARM_POPULATE;
+
+    if ((self == NULL)
+        || ((flags & ~(methods | PLAN_PREWARM_LOCK)) != 0)
+        || ((flags & methods) == methods)) {
+
+        errno = EINVAL;
+        return -1;
+    }
+
+    self->header.flags &= ~(methods | PLAN_PREWARM_LOCK);
+    self->header.flags |= PLAN_PREWARM | flags;
+    self->header.prewarm_lock_limit = lock_limit;
+    plan_builder_mix(self, 'w', &flags, sizeof(flags), NULL, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    プリウォームするファイルまたはディレクトリを追加する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        pathname    ホスト上のパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_add_prewarm(PLAN_BUILDER builder, const char *pathname)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    uint32_t offset;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((plan_builder_add_string(self, pathname, &offset) != 0)
+        || (plan_buffer_append(&self->prewarm, &offset, sizeof(offset), NULL) != 0)) {
+
+        return -1;
+    }
+    plan_builder_mix(self, 'W', NULL, 0, pathname, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail の rootfs に作成するディレクトリを追加する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        pathname    jail 内のパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_add_directory(PLAN_BUILDER builder, const char *pathname)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    uint32_t offset;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((plan_builder_add_string(self, pathname, &offset) != 0)
+        || (plan_buffer_append(&self->directories, &offset, sizeof(offset), NULL) != 0)) {
+
+        return -1;
+    }
+    plan_builder_mix(self, 'd', NULL, 0, pathname, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail の rootfs に作成するデバイスファイルを追加する.
+ *
+ *  @param      [in,out]    builder     プラン構築器オブジェクト.
+ *  @param      [in]        pathname    jail 内のパス.
+ *  @param      [in]        mode        ファイル種別とパーミッション.
+ *  @param      [in]        major       メジャー番号.
+ *  @param      [in]        minor       マイナー番号.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_add_device(PLAN_BUILDER builder,
+                            const char *pathname,
+                            uint32_t mode,
+                            uint32_t major,
+                            uint32_t minor)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    struct plan_device device = {
+        .mode = mode,
+        .major = major,
+        .minor = minor,
+    };
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((plan_builder_add_string(self, pathname, &device.pathname) != 0)
+        || (plan_buffer_append(&self->devices, &device, sizeof(device), NULL) != 0)) {
+
+        return -1;
+    }
+    plan_builder_mix(self, 'n', &device.mode, sizeof(uint32_t) * 3, pathname, NULL);
+
+    return 0;
+}
+
+/**
+ *  @details    jail の rootfs へのバインドを追加する.
+ *              @c target が NULL の場合は, @c source と同じパスにバインドする.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        source  バインド元のパス.
+ *  @param      [in]        target  jail 内のバインド先のパス. (NULL 可)
+ *  @param      [in]        attrs   バインドの属性.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_add_bind(PLAN_BUILDER builder,
+                          const char *source,
+                          const char *target,
+                          uint32_t attrs)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    struct plan_bind bind = {
+        .attrs = attrs,
+    };
+
+    if ((self == NULL) || (source == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (plan_builder_add_string(self, source, &bind.source) != 0) {
+        return -1;
+    }
+    if ((target == NULL) || (strcmp(target, source) == 0)) {
+        bind.target = bind.source;
+    } else if (plan_builder_add_string(self, target, &bind.target) != 0) {
+        return -1;
+    }
+    if (plan_buffer_append(&self->binds, &bind, sizeof(bind), NULL) != 0) {
+        return -1;
+    }
+    plan_builder_mix(self, 'b', &attrs, sizeof(attrs), source, (target != NULL) ? target : source);
+
+    return 0;
+}
+
+/**
+ *  @details    jail で設定する環境変数を追加する.
+ *
+ *  @param      [in,out]    builder プラン構築器オブジェクト.
+ *  @param      [in]        name    変数名.
+ *  @param      [in]        value   値.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_builder_add_environment(PLAN_BUILDER builder, const char *name, const char *value)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+    struct plan_env env;
+
+    if ((self == NULL) || (name == NULL) || (value == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((plan_builder_add_string(self, name, &env.name) != 0)
+        || (plan_builder_add_string(self, value, &env.value) != 0)
+        || (plan_buffer_append(&self->environment, &env, sizeof(env), NULL) != 0)) {
+
+        return -1;
+    }
+    plan_builder_mix(self, 'e', NULL, 0, name, value);
+
+    return 0;
+}
+
+/**
+ *  @details    @c builder に追加した内容から, プランを生成する.
+ *              生成したプランは @c builder とは独立している.
+ *
+ *  @param      [in]    builder プラン構築器オブジェクト.
+ *  @return     成功時は, プランオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PLAN plan_builder_finish(PLAN_BUILDER builder)
+{
+    struct plan_builder *self = (struct plan_builder *)builder;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct {
+        struct plan_section *section;
+        const struct plan_buffer *buffer;
+        size_t size;
+    } sections[] = {
+        {&self->header.directories, &self->directories, sizeof(uint32_t)},
+        {&self->header.devices, &self->devices, sizeof(struct plan_device)},
+        {&self->header.binds, &self->binds, sizeof(struct plan_bind)},
+        {&self->header.environment, &self->environment, sizeof(struct plan_env)},
+        {&self->header.binaries, &self->binaries, sizeof(uint32_t)},
+        {&self->header.prewarm, &self->prewarm, sizeof(uint32_t)},
+        {&self->header.strings, &self->strings, 1},
+    };
+
+    uint64_t length = sizeof(self->header);
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+        length = (length + PLAN_ALIGN - 1) & ~(uint64_t)(PLAN_ALIGN - 1);
+        sections[i].section->offset = length;
+        sections[i].section->count = sections[i].buffer->length / sections[i].size;
+        length += sections[i].buffer->length;
+    }
+    if (length > UINT32_MAX) {
+        errno = EFBIG;
+        return NULL;
+    }
+    self->header.length = length;
+
+    struct plan *plan = malloc(sizeof(*plan));
+    char *image = calloc(1, length);
+    if ((plan == NULL) || (image == NULL)) {
+        free(image);
+        free(plan);
+        errno = ENOMEM;
+        return NULL;
+    }
+    memcpy(image, &self->header, sizeof(self->header));
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); ++i) {
+        if (sections[i].buffer->length > 0) {
+            memcpy(image + sections[i].section->offset,
+                   sections[i].buffer->data,
+                   sections[i].buffer->length);
+        }
+    }
+    plan->image = (const struct plan_header *)image;
+    plan->length = length;
+    plan->mapped = false;
+
+    return (PLAN)plan;
+}
+
+/**
+ *  @details    プランファイルを mmap して開く.
+ *              元になった設定ファイルが更新されている場合は, @c compiler で
+ *              プランを生成し直し, プランファイルも更新する.
+ *
+ *  @param      [in]    pathname    プランファイルのパス.
+ *  @param      [in]    compiler    プランを生成する関数. (NULL 可)
+ *  @return     成功時は, プランオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *              設定ファイルが更新されていて @c compiler が NULL の場合は,
+ *              errno に ESTALE が設定される.
+ */
+PLAN plan_open(const char *pathname, plan_compiler compiler)
+{
+    struct plan *self;
+    struct stat status;
+
+    if (pathname == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), pathname);
+        return NULL;
+    }
+    if (fstat(fd, &status) != 0) {
+        DEBUG("fstat: %s (%s)", strerror(errno), pathname);
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)status.st_size < sizeof(struct plan_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    void *image = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        DEBUG("mmap: %s (%s)", strerror(errno), pathname);
+        return NULL;
+    }
+    if (!plan_validate(image, status.st_size)) {
+        DEBUG("plan: %s is broken", pathname);
+        munmap(image, status.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    self = malloc(sizeof(*self));
+    if (self == NULL) {
+        munmap(image, status.st_size);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->image = image;
+    self->length = status.st_size;
+    self->mapped = true;
+
+    if (plan_is_fresh(self)) {
+        return (PLAN)self;
+    }
+
+    char source[PATH_MAX] = {0};
+    strncpy(source, plan_string((PLAN)self, self->image->source), sizeof(source) - 1);
+    plan_release((PLAN)self);
+    if (compiler == NULL) {
+        errno = ESTALE;
+        return NULL;
+    }
+
+    DEBUG("plan: %s is stale, recompile from %s", pathname, source);
+    PLAN plan = compiler(source);
+    if ((plan != NULL) && (plan_save(plan, pathname) != 0)) {
+        DEBUG("plan_save: %s (%s)", strerror(errno), pathname);
+    }
+
+    return plan;
+}
+
+/**
+ *  @details    @c plan を解放する.
+ *
+ *  @param      [in,out]    plan    プランオブジェクト.
+ */
+void plan_release(PLAN plan)
+{
+    struct plan *self = (struct plan *)plan;
+
+    if (self != NULL) {
+        if (self->mapped) {
+            munmap((void *)self->image, self->length);
+        } else {
+            free((void *)self->image);
+        }
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c plan を @c pathname に保存する.
+ *              一時ファイルに書き込んだ後に置き換えるため,
+ *              保存中のプランファイルを他のプロセスが開くことはない.
+ *
+ *  @param      [in]    plan        プランオブジェクト.
+ *  @param      [in]    pathname    プランファイルのパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int plan_save(PLAN plan, const char *pathname)
+{
+    struct plan *self = (struct plan *)plan;
+    char path[PATH_MAX];
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (snprintf(path, sizeof(path), "%s.XXXXXX", pathname) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        DEBUG("mkstemp: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+
+    const char *p = (const char *)self->image;
+    size_t remain = self->length;
+    while (remain > 0) {
+        ssize_t written = write(fd, p, remain);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            DEBUG("write: %s (%s)", strerror(errno), path);
+            close(fd);
+            unlink(path);
+            return -1;
+        }
+        p += written;
+        remain -= written;
+    }
+    if ((fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) != 0) || (close(fd) != 0)) {
+        DEBUG("close: %s (%s)", strerror(errno), path);
+        unlink(path);
+        return -1;
+    }
+    if (rename(path, pathname) != 0) {
+        DEBUG("rename: %s (%s)", strerror(errno), pathname);
+        unlink(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c pathname がプランファイルかどうかを, 識別子で判定する.
+ *
+ *  @param      [in]    pathname    ファイルのパス.
+ *  @return     プランファイルの場合は true が返る.
+ */
+bool plan_is_plan_file(const char *pathname)
+{
+    char magic[sizeof(((struct plan_header *)0)->magic)];
+
+    int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t length = read(fd, magic, sizeof(magic));
+    close(fd);
+
+    return (length == (ssize_t)sizeof(magic)) && (memcmp(magic, PLAN_MAGIC, sizeof(magic)) == 0);
+}
+
+/**
+ *  @details    プランの内容を表すキーを取得する.
+ *              元になった設定ファイルのパスや更新時刻は, キーに影響しない.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     キーが返る.
+ */
+uint64_t plan_key(PLAN plan)
+{
+    return ((struct plan *)plan)->image->key;
+}
+
+/**
+ *  @details    プランの属性 (PLAN_KERNELFS_*, PLAN_POOL, PLAN_TEMPLATE,
+ *              PLAN_MOUNT_NAMESPACE, PLAN_JAIL_*, PLAN_ELF_DEPS, PLAN_PREWARM*,
+ *              PLAN_LD_CACHE, PLAN_IMAGE, PLAN_ARCHIVE, PLAN_LANDLOCK) を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     プランの属性が返る.
+ */
+uint32_t plan_flags(PLAN plan)
+{
+    return ((struct plan *)plan)->image->flags;
+}
+
+/**
+ *  @details    残す capability のビットマスクを取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     capability のビットマスクが返る.
+ */
+uint64_t plan_capabilities(PLAN plan)
+{
+    return ((struct plan *)plan)->image->capabilities;
+}
+
+/**
+ *  @details    標準入出力の FIFO のパスの書式を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     FIFO のパスの書式が返る.
+ */
+const char *plan_stdio(PLAN plan)
+{
+    return plan_string(plan, ((struct plan *)plan)->image->stdio);
+}
+
+/**
+ *  @details    jail プールの構成を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     プールを使用する場合は構成が返り, 使用しない場合は NULL が返る.
+ */
+const struct plan_pool *plan_pool(PLAN plan)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    return (image->flags & PLAN_POOL) ? &image->pool : NULL;
+}
+
+/**
+ *  @details    rootfs の雛形を格納するディレクトリを取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     雛形を使用する場合はディレクトリが返り, 使用しない場合は NULL が返る.
+ */
+const char *plan_template(PLAN plan)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    return (image->flags & PLAN_TEMPLATE) ? plan_string(plan, image->template_path) : NULL;
+}
+
+/**
+ *  @details    rootfs の下位層として使用するイメージの構成を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     イメージを使用する場合は構成が返り, 使用しない場合は NULL が返る.
+ */
+const struct plan_image *plan_image(PLAN plan)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    return (image->flags & PLAN_IMAGE) ? &image->rootfs_image : NULL;
+}
+
+/**
+ *  @details    rootfs に展開するアーカイブの構成を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     アーカイブを展開する場合は構成が返り, 展開しない場合は NULL が返る.
+ */
+const struct plan_archive *plan_archive(PLAN plan)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    return (image->flags & PLAN_ARCHIVE) ? &image->archive : NULL;
+}
+
+/**
+ *  @details    jail の tmpfs の構成を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     tmpfs の構成が返る. 設定が無い場合は, 全て 0 の構成が返る.
+ */
+const struct plan_tmpfs *plan_tmpfs(PLAN plan)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    return &image->tmpfs;
+}
+
+/**
+ *  @details    ELF の依存ファイルの解決結果のキャッシュを格納するディレクトリを取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     依存ファイルを解決する場合はディレクトリが返り, 解決しない場合は NULL が返る.
+ */
+const char *plan_elf_cache(PLAN plan)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    return (image->flags & PLAN_ELF_DEPS) ? plan_string(plan, image->elf_cache) : NULL;
+}
+
+/**
+ *  @details    依存ファイルを解決するプログラムのパス (文字列のオフセット) の
+ *              一覧を取得する. 閉じ込めるプログラムは含まない.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [out]   count   要素の数.
+ *  @return     一覧の先頭が返る.
+ */
+const uint32_t *plan_binaries(PLAN plan, size_t *count)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    *count = image->binaries.count;
+    return (const uint32_t *)((const char *)image + image->binaries.offset);
+}
+
+/**
+ *  @details    プリウォームするパス (文字列のオフセット) の一覧を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [out]   count   要素の数.
+ *  @return     一覧の先頭が返る.
+ */
+const uint32_t *plan_prewarm(PLAN plan, size_t *count)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    *count = image->prewarm.count;
+    return (const uint32_t *)((const char *)image + image->prewarm.offset);
+}
+
+/**
+ *  @details    プリウォームしたファイルを mlock する合計サイズの上限を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @return     上限 (MiB) が返る.
+ */
+uint32_t plan_prewarm_lock_limit(PLAN plan)
+{
+    return ((struct plan *)plan)->image->prewarm_lock_limit;
+}
+
+/**
+ *  @details    作成するディレクトリのパス (文字列のオフセット) の一覧を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [out]   count   要素の数.
+ *  @return     一覧の先頭が返る.
+ */
+const uint32_t *plan_directories(PLAN plan, size_t *count)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    *count = image->directories.count;
+    return (const uint32_t *)((const char *)image + image->directories.offset);
+}
+
+/**
+ *  @details    作成するデバイスファイルの一覧を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [out]   count   要素の数.
+ *  @return     一覧の先頭が返る.
+ */
+const struct plan_device *plan_devices(PLAN plan, size_t *count)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    *count = image->devices.count;
+    return (const struct plan_device *)((const char *)image + image->devices.offset);
+}
+
+/**
+ *  @details    バインドの一覧を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [out]   count   要素の数.
+ *  @return     一覧の先頭が返る.
+ */
+const struct plan_bind *plan_binds(PLAN plan, size_t *count)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    *count = image->binds.count;
+    return (const struct plan_bind *)((const char *)image + image->binds.offset);
+}
+
+/**
+ *  @details    環境変数の一覧を取得する.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [out]   count   要素の数.
+ *  @return     一覧の先頭が返る.
+ */
+const struct plan_env *plan_environment(PLAN plan, size_t *count)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    *count = image->environment.count;
+    return (const struct plan_env *)((const char *)image + image->environment.offset);
+}
+
+/**
+ *  @details    文字列のオフセットから文字列を取得する.
+ *              範囲外のオフセットは空文字列として扱う.
+ *
+ *  @param      [in]    plan    プランオブジェクト.
+ *  @param      [in]    offset  文字列のオフセット.
+ *  @return     文字列が返る.
+ */
+const char *plan_string(PLAN plan, uint32_t offset)
+{
+    const struct plan_header *image = ((struct plan *)plan)->image;
+
+    if (offset >= image->strings.count) {
+        offset = 0;
+    }
+
+    return (const char *)image + image->strings.offset + offset;
+}
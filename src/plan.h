@@ -0,0 +1,443 @@
+/** @file       plan.h
+ *  @brief      コンパイル済みの jail 構成 (プラン) を提供する.
+ *
+ *  プランは設定ファイルを検証済みの平坦なバイナリに変換したもので,
+ *  mmap したまま解析せずに jail の構築に使用する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_PLAN_H__
+#define __ALCATRAZ_PLAN_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup cat_plan Plan
+ *  コンパイル済みの jail 構成を提供するモジュール.
+ *  @{
+ */
+
+/**
+ *  プランの属性: devtmpfs をマウントする.
+ */
+#define PLAN_KERNELFS_DEVTMPFS (1 << 0)
+
+/**
+ *  プランの属性: procfs をマウントする.
+ */
+#define PLAN_KERNELFS_PROCFS (1 << 1)
+
+/**
+ *  プランの属性: sysfs をマウントする.
+ */
+#define PLAN_KERNELFS_SYSFS (1 << 2)
+
+/**
+ *  プランの属性: jail プールを使用する.
+ */
+#define PLAN_POOL (1 << 8)
+
+/**
+ *  プランの属性: rootfs の雛形を使用する.
+ */
+#define PLAN_TEMPLATE (1 << 9)
+
+/**
+ *  プランの属性: jail を専用のマウント名前空間に構築する.
+ */
+#define PLAN_MOUNT_NAMESPACE (1 << 10)
+
+/**
+ *  プランの属性: jail の root をホストからのマウントイベントのみを受け取る
+ *  スレーブとする. (既定はプライベート)
+ */
+#define PLAN_JAIL_SLAVE (1 << 11)
+
+/**
+ *  プランの属性: jail の root の伝播の種別を変更しない.
+ */
+#define PLAN_JAIL_SHARED (1 << 12)
+
+/**
+ *  プランの属性: プログラムの ELF の依存ファイルを解決してバインドする.
+ */
+#define PLAN_ELF_DEPS (1 << 13)
+
+/**
+ *  プランの属性: 起動時にファイルをページキャッシュに読み込む (プリウォーム).
+ */
+#define PLAN_PREWARM (1 << 14)
+
+/**
+ *  プランの属性: プリウォームに posix_fadvise(POSIX_FADV_WILLNEED) を使用する.
+ */
+#define PLAN_PREWARM_FADVISE (1 << 15)
+
+/**
+ *  プランの属性: プリウォームに mmap(MAP_POPULATE) を使用する.
+ */
+#define PLAN_PREWARM_POPULATE (1 << 16)
+
+/**
+ *  プランの属性: プリウォームしたファイルを, jail の終了まで mlock する.
+ */
+#define PLAN_PREWARM_LOCK (1 << 17)
+
+/**
+ *  プランの属性: jail のライブラリディレクトリから ld.so.cache を生成する.
+ */
+#define PLAN_LD_CACHE (1 << 18)
+
+/**
+ *  プランの属性: イメージを rootfs の下位層として使用する.
+ */
+#define PLAN_IMAGE (1 << 19)
+
+/**
+ *  プランの属性: tar アーカイブを rootfs に展開する.
+ */
+#define PLAN_ARCHIVE (1 << 20)
+
+/**
+ *  プランの属性: rootfs を構築せず, Landlock でアクセスを制限する.
+ */
+#define PLAN_LANDLOCK (1 << 21)
+
+/**
+ *  デバイスファイルの構成.
+ */
+struct plan_device {
+    uint32_t pathname; /**< jail 内のパス. (文字列のオフセット) */
+    uint32_t mode;     /**< ファイル種別とパーミッション. */
+    uint32_t major;    /**< メジャー番号. */
+    uint32_t minor;    /**< マイナー番号. */
+};
+
+/**
+ *  バインドの構成.
+ */
+struct plan_bind {
+    uint32_t source; /**< バインド元のパス. (文字列のオフセット) */
+    uint32_t target; /**< jail 内のバインド先のパス. (文字列のオフセット) */
+    uint32_t attrs;  /**< バインドの属性. */
+    uint32_t unused; /**< 予約. */
+};
+
+/**
+ *  環境変数の構成.
+ */
+struct plan_env {
+    uint32_t name;  /**< 変数名. (文字列のオフセット) */
+    uint32_t value; /**< 値. (文字列のオフセット) */
+};
+
+/**
+ *  jail プールの構成.
+ */
+struct plan_pool {
+    uint32_t path;      /**< プールを格納するディレクトリ. (文字列のオフセット) */
+    uint32_t size;      /**< 保持する jail の数. */
+    uint32_t low_water; /**< 補充を開始する jail の数. */
+    uint32_t unused;    /**< 予約. */
+};
+
+/**
+ *  rootfs のイメージの構成.
+ */
+struct plan_image {
+    uint32_t source; /**< イメージファイルのパス. (文字列のオフセット) */
+    uint32_t fstype; /**< ファイルシステムの種別. (文字列のオフセット, 空文字列は判定する) */
+    uint32_t path;   /**< イメージのマウントを管理するディレクトリ. (文字列のオフセット) */
+    uint32_t unused; /**< 予約. */
+};
+
+/**
+ *  rootfs に展開するアーカイブの構成.
+ */
+struct plan_archive {
+    uint32_t source;  /**< アーカイブのパス. (文字列のオフセット) */
+    uint32_t workers; /**< ファイルを書き込むスレッドの数. (0 は標準) */
+};
+
+/**
+ *  jail の tmpfs の透過的ヒュージページの割り当て: ファイルサイズの範囲内で割り当てる.
+ */
+#define PLAN_TMPFS_HUGE_WITHIN_SIZE (1)
+
+/**
+ *  jail の tmpfs の透過的ヒュージページの割り当て: 常に割り当てる.
+ */
+#define PLAN_TMPFS_HUGE_ALWAYS (2)
+
+/**
+ *  jail の tmpfs の構成.
+ */
+struct plan_tmpfs {
+    uint32_t size;      /**< サイズ (MiB, 0 は標準). */
+    uint32_t nr_inodes; /**< inode の最大数 (0 は tmpfs の既定値). */
+    uint32_t huge;      /**< 透過的ヒュージページの割り当て (PLAN_TMPFS_HUGE_*, 0 は割り当てない). */
+    uint32_t mpol;      /**< NUMA メモリポリシー. (文字列のオフセット, 空文字列はプロセスのポリシー) */
+};
+
+/**
+ *  プラン型.
+ */
+typedef struct {} *PLAN;
+
+/**
+ *  プラン構築器型.
+ */
+typedef struct {} *PLAN_BUILDER;
+
+/**
+ *  設定ファイルからプランを生成する関数の型.
+ */
+typedef PLAN (*plan_compiler)(const char *source);
+
+/**
+ *  プラン構築器を初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          PLAN_BUILDER builder = plan_builder_init();
+ *          plan_builder_set_source(builder, "/etc/env.json");
+ *          plan_builder_add_directory(builder, "/etc");
+ *          plan_builder_add_bind(builder, "/bin", NULL, BIND_ATTR_RDONLY);
+ *          PLAN plan = plan_builder_finish(builder);
+ *          plan_builder_release(builder);
+ *          plan_save(plan, "/etc/env.plan");
+ *          plan_release(plan);
+ *          @endcode
+ */
+PLAN_BUILDER plan_builder_init(void);
+
+/**
+ *  プラン構築器を解放する.
+ */
+void plan_builder_release(PLAN_BUILDER builder);
+
+/**
+ *  プランの元になった設定ファイルを記録する.
+ */
+int plan_builder_set_source(PLAN_BUILDER builder, const char *source);
+
+/**
+ *  プランの属性を設定する.
+ */
+int plan_builder_set_flags(PLAN_BUILDER builder, uint32_t flags);
+
+/**
+ *  残す capability を設定する.
+ */
+int plan_builder_set_capabilities(PLAN_BUILDER builder, uint64_t capabilities);
+
+/**
+ *  標準入出力の FIFO のパスを設定する.
+ */
+int plan_builder_set_stdio(PLAN_BUILDER builder, const char *path);
+
+/**
+ *  jail プールの構成を設定する.
+ */
+int plan_builder_set_pool(PLAN_BUILDER builder,
+                          const char *path,
+                          uint32_t size,
+                          uint32_t low_water);
+
+/**
+ *  rootfs の雛形の構成を設定する.
+ */
+int plan_builder_set_template(PLAN_BUILDER builder, const char *path);
+
+/**
+ *  rootfs のイメージの構成を設定する.
+ */
+int plan_builder_set_image(PLAN_BUILDER builder,
+                           const char *source,
+                           const char *fstype,
+                           const char *path);
+
+/**
+ *  rootfs に展開するアーカイブを設定する.
+ */
+int plan_builder_set_archive(PLAN_BUILDER builder, const char *source, uint32_t workers);
+
+/**
+ *  jail の tmpfs の構成を設定する.
+ */
+int plan_builder_set_tmpfs(PLAN_BUILDER builder,
+                           uint32_t size,
+                           uint32_t nr_inodes,
+                           uint32_t huge,
+                           const char *mpol);
+
+/**
+ *  ELF の依存ファイルの解決を設定する.
+ */
+int plan_builder_set_elf(PLAN_BUILDER builder, const char *cache_path);
+
+/**
+ *  依存ファイルを解決するプログラムを追加する.
+ */
+int plan_builder_add_binary(PLAN_BUILDER builder, const char *pathname);
+
+/**
+ *  プリウォームの方法を設定する.
+ */
+int plan_builder_set_prewarm(PLAN_BUILDER builder, uint32_t flags, uint32_t lock_limit);
+
+/**
+ *  プリウォームするパスを追加する.
+ */
+int plan_builder_add_prewarm(PLAN_BUILDER builder, const char *pathname);
+
+/**
+ *  作成するディレクトリを追加する.
+ */
+int plan_builder_add_directory(PLAN_BUILDER builder, const char *pathname);
+
+/**
+ *  作成するデバイスファイルを追加する.
+ */
+int plan_builder_add_device(PLAN_BUILDER builder,
+                            const char *pathname,
+                            uint32_t mode,
+                            uint32_t major,
+                            uint32_t minor);
+
+/**
+ *  バインドを追加する.
+ */
+int plan_builder_add_bind(PLAN_BUILDER builder,
+                          const char *source,
+                          const char *target,
+                          uint32_t attrs);
+
+/**
+ *  環境変数を追加する.
+ */
+int plan_builder_add_environment(PLAN_BUILDER builder, const char *name, const char *value);
+
+/**
+ *  構築したプランを生成する.
+ */
+PLAN plan_builder_finish(PLAN_BUILDER builder);
+
+/**
+ *  プランファイルを開く.
+ */
+PLAN plan_open(const char *pathname, plan_compiler compiler);
+
+/**
+ *  プランを解放する.
+ */
+void plan_release(PLAN plan);
+
+/**
+ *  プランをファイルに保存する.
+ */
+int plan_save(PLAN plan, const char *pathname);
+
+/**
+ *  プランファイルかどうかを判定する.
+ */
+bool plan_is_plan_file(const char *pathname);
+
+/**
+ *  プランの内容を表すキーを取得する.
+ */
+uint64_t plan_key(PLAN plan);
+
+/**
+ *  プランの属性を取得する.
+ */
+uint32_t plan_flags(PLAN plan);
+
+/**
+ *  残す capability を取得する.
+ */
+uint64_t plan_capabilities(PLAN plan);
+
+/**
+ *  標準入出力の FIFO のパスを取得する.
+ */
+const char *plan_stdio(PLAN plan);
+
+/**
+ *  jail プールの構成を取得する.
+ */
+const struct plan_pool *plan_pool(PLAN plan);
+
+/**
+ *  rootfs の雛形を格納するディレクトリを取得する.
+ */
+const char *plan_template(PLAN plan);
+
+/**
+ *  rootfs のイメージの構成を取得する.
+ */
+const struct plan_image *plan_image(PLAN plan);
+
+/**
+ *  rootfs に展開するアーカイブの構成を取得する.
+ */
+const struct plan_archive *plan_archive(PLAN plan);
+
+/**
+ *  jail の tmpfs の構成を取得する.
+ */
+const struct plan_tmpfs *plan_tmpfs(PLAN plan);
+
+/**
+ *  ELF の依存ファイルのキャッシュを格納するディレクトリを取得する.
+ */
+const char *plan_elf_cache(PLAN plan);
+
+/**
+ *  依存ファイルを解決するプログラムの一覧を取得する.
+ */
+const uint32_t *plan_binaries(PLAN plan, size_t *count);
+
+/**
+ *  プリウォームするパスの一覧を取得する.
+ */
+const uint32_t *plan_prewarm(PLAN plan, size_t *count);
+
+/**
+ *  mlock するファイルの合計サイズの上限を取得する.
+ */
+uint32_t plan_prewarm_lock_limit(PLAN plan);
+
+/**
+ *  作成するディレクトリの一覧を取得する.
+ */
+const uint32_t *plan_directories(PLAN plan, size_t *count);
+
+/**
+ *  作成するデバイスファイルの一覧を取得する.
+ */
+const struct plan_device *plan_devices(PLAN plan, size_t *count);
+
+/**
+ *  バインドの一覧を取得する.
+ */
+const struct plan_bind *plan_binds(PLAN plan, size_t *count);
+
+/**
+ *  環境変数の一覧を取得する.
+ */
+const struct plan_env *plan_environment(PLAN plan, size_t *count);
+
+/**
+ *  文字列のオフセットから文字列を取得する.
+ */
+const char *plan_string(PLAN plan, uint32_t offset);
+
+/** @} */
+
+#endif /* __ALCATRAZ_PLAN_H__ */
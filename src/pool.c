@@ -0,0 +1,443 @@
+/** @file       pool.c
+ *  @brief      構築済み jail のプールを提供する.
+ *
+ *  プールは次の構成のディレクトリで管理する.
+ *  - `<path>/<key>/jails/`      構築済み jail のマウントポイント.
+ *  - `<path>/<key>/ready/`      未使用の jail を示すマーカファイル.
+ *  - `<path>/<key>/stats`       取得成功 / 失敗回数.
+ *  - `<path>/<key>/refill.lock` 補充処理の排他用ロックファイル.
+ *
+ *  jail の取得はマーカファイルの unlink で行うため, 複数プロセスから
+ *  同時に取得しても同じ jail が重複して割り当てられることはない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for mkdtemp */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "pool.h"
+#include "fsutil.h"
+#include "debug.h"
+
+/**
+ *  プール管理ディレクトリのアクセス権限.
+ */
+#define POOL_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  jail プール管理構造体.
+ */
+struct pool {
+    char path[PATH_MAX]; /**< 設定毎のプールディレクトリのパス. */
+    int dir_fd;          /**< プールディレクトリのファイル記述子. */
+    size_t size;         /**< 保持する構築済み jail の数. */
+    size_t low_water;    /**< 補充を開始する未使用 jail の数. */
+};
+
+/**
+ *  jail プール管理構造体の初期化子.
+ */
+#define POOL_INITIALIZER(s, l) \
+    (struct pool){             \
+        .path = {0},           \
+        .dir_fd = -1,          \
+        .size = (s),           \
+        .low_water = (l)       \
+    }
+
+/**
+ *  未使用の jail を示すマーカファイルのディレクトリを開く.
+ *
+ *  @param  [in]    self    jail プールオブジェクト.
+ *  @return 成功時はディレクトリストリームが返り, 失敗時は NULL が返る.
+ */
+static DIR *open_ready_dir(struct pool *self)
+{
+    int fd = openat(self->dir_fd, POOL_READY_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/ready)", strerror(errno), self->path);
+        return NULL;
+    }
+
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        DEBUG("fdopendir: %s (%s/ready)", strerror(errno), self->path);
+        close(fd);
+    }
+
+    return dir;
+}
+
+/**
+ *  未使用の jail の数を数える.
+ *
+ *  @param  [in]    self    jail プールオブジェクト.
+ *  @return 成功時は未使用の jail の数が返り, 失敗時は -1 が返る.
+ */
+static ssize_t count_ready(struct pool *self)
+{
+    DIR *dir = open_ready_dir(self);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    ssize_t count = 0;
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        if (ent->d_name[0] != '.') {
+            ++count;
+        }
+    }
+    closedir(dir);
+
+    return count;
+}
+
+/**
+ *  統計情報を更新する.
+ *
+ *  @param  [in]    self    jail プールオブジェクト.
+ *  @param  [in]    hits    取得成功回数の増分.
+ *  @param  [in]    misses  取得失敗回数の増分.
+ *  @param  [out]   stats   更新後の統計情報. (NULL 可)
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int update_stats(struct pool *self,
+                        uint64_t hits,
+                        uint64_t misses,
+                        struct pool_stats *stats)
+{
+    int fd = openat(self->dir_fd, "stats", O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/stats)", strerror(errno), self->path);
+        return -1;
+    }
+    if (flock(fd, LOCK_EX) != 0) {
+        DEBUG("flock: %s (%s/stats)", strerror(errno), self->path);
+        close(fd);
+        return -1;
+    }
+
+    char buf[128] = {0};
+    uint64_t cur_hits = 0, cur_misses = 0;
+    if (pread(fd, buf, sizeof(buf) - 1, 0) > 0) {
+        sscanf(buf, "hits %" SCNu64 "\nmisses %" SCNu64, &cur_hits, &cur_misses);
+    }
+    cur_hits += hits;
+    cur_misses += misses;
+
+    if ((hits != 0) || (misses != 0)) {
+        int length = snprintf(buf, sizeof(buf),
+                              "hits %" PRIu64 "\nmisses %" PRIu64 "\n",
+                              cur_hits, cur_misses);
+        if ((ftruncate(fd, 0) != 0) || (pwrite(fd, buf, length, 0) != length)) {
+            DEBUG("pwrite: %s (%s/stats)", strerror(errno), self->path);
+        }
+    }
+    close(fd);
+
+    if (stats != NULL) {
+        stats->hits = cur_hits;
+        stats->misses = cur_misses;
+    }
+
+    return 0;
+}
+
+/**
+ *  jail を 1 つ構築してプールに登録する.
+ *
+ *  @param  [in]    self    jail プールオブジェクト.
+ *  @param  [in]    builder jail を構築する関数.
+ *  @param  [in]    arg     @c builder に渡す引数.
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int build_one(struct pool *self, pool_builder builder, void *arg)
+{
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/" POOL_JAILS_DIR "/" POOL_JAIL_PREFIX "XXXXXX", self->path) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (mkdtemp(path) == NULL) {
+        DEBUG("mkdtemp: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+
+    if (builder(arg, path) != 0) {
+        DEBUG("pool: failed to build jail (%s)", path);
+        umount2(path, MNT_DETACH);
+        rmdir(path);
+        return -1;
+    }
+
+    const char *name = strrchr(path, '/') + 1;
+    char marker[NAME_MAX + 8];
+    snprintf(marker, sizeof(marker), POOL_READY_DIR "/%s", name);
+    int fd = openat(self->dir_fd, marker, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/%s)", strerror(errno), self->path, marker);
+        umount2(path, MNT_DETACH);
+        rmdir(path);
+        return -1;
+    }
+    close(fd);
+
+    return 0;
+}
+
+/**
+ *  @details    設定毎のプールディレクトリを作成し, @ref POOL オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    path        プールのルートディレクトリのパス.
+ *  @param      [in]    key         設定を識別するキー.
+ *  @param      [in]    size        保持する構築済み jail の数.
+ *  @param      [in]    low_water   補充を開始する未使用 jail の数.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+POOL pool_open(const char *path, uint64_t key, size_t size, size_t low_water)
+{
+    if ((path == NULL) || (size == 0) || (low_water >= size)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct pool *self = malloc(sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    *self = POOL_INITIALIZER(size, low_water);
+
+    snprintf(self->path, sizeof(self->path), "%s/%016" PRIx64, path, key);
+    char dir[PATH_MAX + 8];
+    snprintf(dir, sizeof(dir), "%s/" POOL_JAILS_DIR, self->path);
+    if (make_directories(dir, POOL_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), dir);
+        free(self);
+        return NULL;
+    }
+    snprintf(dir, sizeof(dir), "%s/" POOL_READY_DIR, self->path);
+    if (make_directories(dir, POOL_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), dir);
+        free(self);
+        return NULL;
+    }
+
+    self->dir_fd = open(self->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (self->dir_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), self->path);
+        free(self);
+        return NULL;
+    }
+
+    return (POOL)self;
+}
+
+/**
+ *  @details    @c pool を閉じる.
+ *              構築済みの jail はプールに残る.
+ *
+ *  @param      [in,out]    pool    jail プールオブジェクト.
+ */
+void pool_close(POOL pool)
+{
+    struct pool *self = (struct pool *)pool;
+
+    if (self != NULL) {
+        close(self->dir_fd);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c pool から未使用の jail を 1 つ取得する.
+ *              取得した jail は, 以降プールの管理から外れる.
+ *
+ *  @param      [in,out]    pool        jail プールオブジェクト.
+ *  @param      [out]       mount_point 取得した jail のパス.
+ *  @param      [in]        length      @c mount_point のサイズ.
+ *  @return     取得できた場合は, 0 が返る.
+ *              未使用の jail が無い場合は, -1 が返り, errno に ENOENT が
+ *              設定される.
+ *  @remarks    取得の成否は統計情報に記録される.
+ */
+int pool_claim(POOL pool, char *mount_point, size_t length)
+{
+    struct pool *self = (struct pool *)pool;
+
+    if ((self == NULL) || (mount_point == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    DIR *dir = open_ready_dir(self);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    bool claimed = false;
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        /* マーカファイルを削除できたプロセスのみが jail を取得できる. */
+        if (unlinkat(dirfd(dir), ent->d_name, 0) == 0) {
+            snprintf(mount_point, length, "%s/" POOL_JAILS_DIR "/%s", self->path, ent->d_name);
+            /* マニフェストを作成するまでの間は, 回収処理の猶予期間で保護する. */
+            utimensat(AT_FDCWD, mount_point, NULL, 0);
+            claimed = true;
+            break;
+        }
+        if (errno != ENOENT) {
+            DEBUG("unlinkat: %s (%s/ready/%s)", strerror(errno), self->path, ent->d_name);
+        }
+    }
+    closedir(dir);
+
+    update_stats(self, claimed ? 1 : 0, claimed ? 0 : 1, NULL);
+    if (!claimed) {
+        errno = ENOENT;
+        return -1;
+    }
+    DEBUG("pool: claimed %s", mount_point);
+
+    return 0;
+}
+
+/**
+ *  @details    @c pool の未使用の jail が規定数になるまで jail を構築する.
+ *              他のプロセスが補充中の場合は何もしない.
+ *
+ *  @param      [in,out]    pool    jail プールオブジェクト.
+ *  @param      [in]        builder jail を構築する関数.
+ *  @param      [in]        arg     @c builder に渡す引数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int pool_refill(POOL pool, pool_builder builder, void *arg)
+{
+    struct pool *self = (struct pool *)pool;
+
+    if ((self == NULL) || (builder == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int lock_fd = openat(self->dir_fd, "refill.lock",
+                         O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (lock_fd < 0) {
+        DEBUG("openat: %s (%s/refill.lock)", strerror(errno), self->path);
+        return -1;
+    }
+    if (flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        close(lock_fd);
+        return (errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    int ret = 0;
+    for (ssize_t ready = count_ready(self);
+         (ready >= 0) && ((size_t)ready < self->size);
+         ++ready) {
+
+        if (build_one(self, builder, arg) != 0) {
+            ret = -1;
+            break;
+        }
+    }
+    close(lock_fd);
+
+    return ret;
+}
+
+/**
+ *  @details    @c pool の未使用の jail が補充開始数以下の場合, 子孫プロセスで
+ *              @ref pool_refill を実行する.
+ *              呼び出し元は補充の完了を待たない.
+ *
+ *  @param      [in,out]    pool    jail プールオブジェクト.
+ *  @param      [in]        builder jail を構築する関数.
+ *  @param      [in]        arg     @c builder に渡す引数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    補充プロセスは孫プロセスとして生成するため, 呼び出し元に
+ *              SIGCHLD は届かない.
+ */
+int pool_refill_async(POOL pool, pool_builder builder, void *arg)
+{
+    struct pool *self = (struct pool *)pool;
+
+    if ((self == NULL) || (builder == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ssize_t ready = count_ready(self);
+    if ((ready < 0) || ((size_t)ready > self->low_water)) {
+        return (ready < 0) ? -1 : 0;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        DEBUG("fork: %s", strerror(errno));
+        return -1;
+    } else if (pid == 0) {
+        if (fork() == 0) {
+            setsid();
+            /* 呼び出し元の端末や FIFO を, 補充が終わるまで開いたままにしない. */
+            close_inherited_fds(self->dir_fd);
+            _exit((pool_refill(pool, builder, arg) == 0) ? 0 : 1);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+
+    return 0;
+}
+
+/**
+ *  @details    @c pool の統計情報を取得する.
+ *
+ *  @param      [in]    pool    jail プールオブジェクト.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int pool_get_stats(POOL pool, struct pool_stats *stats)
+{
+    struct pool *self = (struct pool *)pool;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (update_stats(self, 0, 0, stats) != 0) {
+        return -1;
+    }
+    ssize_t ready = count_ready(self);
+    stats->ready = (ready < 0) ? 0 : (size_t)ready;
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/** @file       pool.h
+ *  @brief      構築済み jail のプールを提供する.
+ *
+ *  rootfs まで構築済みで未使用の jail を, 設定毎に保持する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_POOL_H__
+#define __ALCATRAZ_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup cat_pool Pool
+ *  構築済み jail のプールを提供するモジュール.
+ *  @{
+ */
+
+/**
+ *  構築済み jail のマウントポイントを置くディレクトリ. (設定毎のプールディレクトリからの相対パス)
+ */
+#define POOL_JAILS_DIR "jails"
+
+/**
+ *  未使用の jail を示すマーカファイルを置くディレクトリ. (設定毎のプールディレクトリからの相対パス)
+ */
+#define POOL_READY_DIR "ready"
+
+/**
+ *  構築済み jail のマウントポイントの名前の接頭辞.
+ */
+#define POOL_JAIL_PREFIX "jail-"
+
+/**
+ *  jail プール型.
+ */
+typedef struct {} *POOL;
+
+/**
+ *  jail を構築する関数の型.
+ *
+ *  @c mount_point に作成済みの空ディレクトリへ jail を構築する.
+ *  成功時は 0, 失敗時は -1 を返すこと.
+ */
+typedef int (*pool_builder)(void *arg, const char *mount_point);
+
+/**
+ *  jail プールの統計情報.
+ */
+struct pool_stats {
+    uint64_t hits;   /**< 構築済み jail を取得できた回数. */
+    uint64_t misses; /**< 構築済み jail が無かった回数. */
+    size_t ready;    /**< 未使用の構築済み jail の数. */
+};
+
+/**
+ *  jail プールを開く.
+ *
+ *  @par    使用例
+ *          @code
+ *          POOL pool = pool_open("/run/alctrz/pool", key, 4, 1);
+ *          char mount_point[PATH_MAX];
+ *          if (pool_claim(pool, mount_point, sizeof(mount_point)) != 0) {
+ *              // 自前で jail を構築する.
+ *          }
+ *          pool_refill_async(pool, builder, arg);
+ *          pool_close(pool);
+ *          @endcode
+ */
+POOL pool_open(const char *path, uint64_t key, size_t size, size_t low_water);
+
+/**
+ *  jail プールを閉じる.
+ */
+void pool_close(POOL pool);
+
+/**
+ *  構築済み jail を 1 つ取得する.
+ */
+int pool_claim(POOL pool, char *mount_point, size_t length);
+
+/**
+ *  jail プールを規定数まで補充する.
+ */
+int pool_refill(POOL pool, pool_builder builder, void *arg);
+
+/**
+ *  必要であれば, バックグラウンドで jail プールを補充する.
+ */
+int pool_refill_async(POOL pool, pool_builder builder, void *arg);
+
+/**
+ *  jail プールの統計情報を取得する.
+ */
+int pool_get_stats(POOL pool, struct pool_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_POOL_H__ */
@@ -0,0 +1,376 @@
+/** @file       prewarm.c
+ *  @brief      ファイルのページキャッシュへの事前読み込み (プリウォーム) を提供する.
+ *
+ *  追加したファイルとディレクトリ以下の通常のファイルを, 追加した順に
+ *  読み込む. 同じファイル (デバイスと inode が同じもの) は一度だけ読み込む.
+ *  readahead(2) と posix_fadvise(2) は読み込みを開始するのみで,
+ *  完了は待たない. mmap(MAP_POPULATE) と mlock(2) は読み込みの完了を待つ.
+ *  mlock したマッピングは @ref prewarm_release まで保持する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for readahead, MAP_POPULATE */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "prewarm.h"
+#include "collections.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  プリウォームの方法を取り出すマスク.
+ */
+#define PREWARM_METHOD_MASK (0xff)
+
+/**
+ *  mlock したマッピング.
+ */
+struct prewarm_region {
+    void *addr;    /**< マッピングの先頭. */
+    size_t length; /**< マッピングのサイズ. */
+};
+
+/**
+ *  プリウォーム管理構造体.
+ */
+struct prewarm {
+    unsigned int flags;              /**< プリウォームの方法. */
+    uint64_t lock_limit;             /**< mlock する合計サイズの上限. */
+    char **paths;                    /**< 読み込むファイル. (追加順) */
+    size_t count;                    /**< ファイルの数. */
+    size_t capacity;                 /**< 確保したファイルの数. */
+    MAP seen;                        /**< 追加済みのファイル. ("<dev>:<ino>") */
+    struct prewarm_region *regions;  /**< mlock したマッピング. */
+    size_t num_regions;              /**< mlock したマッピングの数. */
+    struct prewarm_stats stats;      /**< 統計情報. */
+};
+
+/**
+ *  通常のファイルを追加する.
+ *
+ *  追加済みのファイルは追加しない.
+ */
+static int add_file(struct prewarm *self, const char *path, const struct stat *status)
+{
+    char key[64];
+
+    snprintf(key, sizeof(key), "%jx:%jx", (uintmax_t)status->st_dev, (uintmax_t)status->st_ino);
+    if (map_get(self->seen, key) != NULL) {
+        return 0;
+    }
+    if (self->count == PREWARM_FILES_MAX) {
+        DEBUG("prewarm: too many files (%s)", path);
+        errno = ENOSPC;
+        return -1;
+    }
+    if (self->count == self->capacity) {
+        size_t capacity = (self->capacity > 0) ? self->capacity * 2 : 64;
+        char **paths = realloc(self->paths, sizeof(*paths) * capacity);
+        if (paths == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->paths = paths;
+        self->capacity = capacity;
+    }
+
+    self->paths[self->count] = strdup(path);
+    if (self->paths[self->count] == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (map_put(self->seen, key, &(char){0}) == NULL) {
+        free(self->paths[self->count]);
+        return -1;
+    }
+    ++self->count;
+
+    return 0;
+}
+
+/**
+ *  ディレクトリ以下の通常のファイルを追加する.
+ *
+ *  シンボリックリンクは辿らず, 別のファイルシステムには入らない.
+ */
+static int add_directory(struct prewarm *self, const char *path, dev_t dev, int depth)
+{
+    char child[PATH_MAX];
+    int ret = 0;
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        DEBUG("opendir: %s (%s)", strerror(errno), path);
+        return 0;
+    }
+    struct dirent *entry;
+    while ((ret == 0) && ((entry = readdir(dir)) != NULL)) {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+            continue;
+        }
+        struct stat status;
+        if ((fstatat(dirfd(dir), entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+            || (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >= (int)sizeof(child))) {
+
+            continue;
+        }
+        if (S_ISREG(status.st_mode)) {
+            ret = add_file(self, child, &status);
+        } else if (S_ISDIR(status.st_mode) && (status.st_dev == dev) && (depth < PREWARM_DEPTH_MAX)) {
+            ret = add_directory(self, child, dev, depth + 1);
+        }
+    }
+    closedir(dir);
+
+    return ret;
+}
+
+/**
+ *  ファイルを mlock する.
+ *
+ *  @c addr が NULL の場合は新たにマッピングする.
+ *
+ *  @return mlock した場合は true が返る.
+ */
+static bool lock_file(struct prewarm *self, int fd, void *addr, size_t length)
+{
+    if (((self->flags & PREWARM_LOCK) == 0)
+        || (self->stats.locked + length > self->lock_limit)) {
+
+        return false;
+    }
+    struct prewarm_region *regions = realloc(self->regions, sizeof(*regions) * (self->num_regions + 1));
+    if (regions == NULL) {
+        return false;
+    }
+    self->regions = regions;
+
+    if (addr == NULL) {
+        addr = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            DEBUG("mmap: %s", strerror(errno));
+            return false;
+        }
+    }
+    if (mlock(addr, length) != 0) {
+        DEBUG("mlock: %s", strerror(errno));
+        munmap(addr, length);
+        return false;
+    }
+    self->regions[self->num_regions].addr = addr;
+    self->regions[self->num_regions].length = length;
+    ++self->num_regions;
+    self->stats.locked += length;
+
+    return true;
+}
+
+/**
+ *  一つのファイルを読み込む.
+ */
+static int prewarm_file(struct prewarm *self, const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    struct stat status;
+    if ((fstat(fd, &status) != 0) || !S_ISREG(status.st_mode) || (status.st_size == 0)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t length = (size_t)status.st_size;
+    void *addr = NULL;
+    int ret = 0;
+    switch (self->flags & PREWARM_METHOD_MASK) {
+    case PREWARM_FADVISE:
+        ret = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        if (ret != 0) {
+            DEBUG("posix_fadvise: %s (%s)", strerror(ret), path);
+            ret = -1;
+        }
+        break;
+    case PREWARM_POPULATE:
+        addr = mmap(NULL, length, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            DEBUG("mmap: %s (%s)", strerror(errno), path);
+            addr = NULL;
+            ret = -1;
+        }
+        break;
+    default:
+        ret = readahead(fd, 0, length);
+        if (ret != 0) {
+            DEBUG("readahead: %s (%s)", strerror(errno), path);
+        }
+        break;
+    }
+    if (ret == 0) {
+        ++self->stats.files;
+        self->stats.bytes += length;
+        if (!lock_file(self, fd, addr, length) && (addr != NULL)) {
+            munmap(addr, length);
+        }
+    }
+    close(fd);
+
+    return ret;
+}
+
+/**
+ *  @details    空のプリウォームを確保および初期化する.
+ *              @c flags には PREWARM_READAHEAD, PREWARM_FADVISE,
+ *              PREWARM_POPULATE のいずれかと, 必要に応じて PREWARM_LOCK を指定する.
+ *
+ *  @param      [in]    flags       プリウォームの方法.
+ *  @param      [in]    lock_limit  mlock する合計サイズの上限 (バイト).
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+PREWARM prewarm_init(unsigned int flags, uint64_t lock_limit)
+{
+    if ((flags & PREWARM_METHOD_MASK) > PREWARM_POPULATE) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct prewarm *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->seen = map_init(sizeof(char), PREWARM_FILES_MAX);
+    if (self->seen == NULL) {
+        free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->flags = flags;
+    self->lock_limit = lock_limit;
+
+    return (PREWARM)self;
+}
+
+/**
+ *  @details    @c prewarm を解放する.
+ *              mlock したファイルは, ここでマッピングを解除する.
+ *
+ *  @param      [in,out]    prewarm プリウォームオブジェクト.
+ */
+void prewarm_release(PREWARM prewarm)
+{
+    struct prewarm *self = (struct prewarm *)prewarm;
+
+    if (self != NULL) {
+        for (size_t i = 0; i < self->num_regions; ++i) {
+            munmap(self->regions[i].addr, self->regions[i].length);
+        }
+        free(self->regions);
+        for (size_t i = 0; i < self->count; ++i) {
+            free(self->paths[i]);
+        }
+        free(self->paths);
+        map_release(self->seen);
+        free(self);
+    }
+}
+
+/**
+ *  @details    @c pathname を読み込むファイルに追加する.
+ *              ディレクトリの場合は, その下の通常のファイルを全て追加する.
+ *
+ *  @param      [in,out]    prewarm     プリウォームオブジェクト.
+ *  @param      [in]        pathname    ファイルまたはディレクトリのパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int prewarm_add(PREWARM prewarm, const char *pathname)
+{
+    struct prewarm *self = (struct prewarm *)prewarm;
+    struct stat status;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (stat(pathname, &status) != 0) {
+        DEBUG("stat: %s (%s)", strerror(errno), pathname);
+        return -1;
+    }
+
+    if (S_ISREG(status.st_mode)) {
+        return add_file(self, pathname, &status);
+    } else if (S_ISDIR(status.st_mode)) {
+        return add_directory(self, pathname, status.st_dev, 0);
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    追加したファイルを, 追加した順にページキャッシュに読み込む.
+ *              読み込めないファイルは読み飛ばす.
+ *
+ *  @param      [in,out]    prewarm プリウォームオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int prewarm_run(PREWARM prewarm)
+{
+    struct prewarm *self = (struct prewarm *)prewarm;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t start = monotonic_ns();
+    for (size_t i = 0; i < self->count; ++i) {
+        prewarm_file(self, self->paths[i]);
+    }
+    self->stats.elapsed_us += elapsed_us(start);
+
+    return 0;
+}
+
+/**
+ *  @details    読み込んだファイルの数とサイズを取得する.
+ *
+ *  @param      [in]    prewarm プリウォームオブジェクト.
+ *  @param      [out]   stats   統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int prewarm_get_stats(PREWARM prewarm, struct prewarm_stats *stats)
+{
+    struct prewarm *self = (struct prewarm *)prewarm;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *stats = self->stats;
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/** @file       prewarm.h
+ *  @brief      ファイルのページキャッシュへの事前読み込み (プリウォーム) を提供する.
+ *
+ *  jail で実行するプログラムやライブラリを exec の前にページキャッシュに
+ *  読み込み, 起動直後のメジャーフォルトを減らす. 読み込んだファイルは
+ *  必要に応じて mlock し, jail の終了まで常駐させる.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_PREWARM_H__
+#define __ALCATRAZ_PREWARM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup cat_prewarm Prewarm
+ *  ファイルをページキャッシュに読み込むモジュール.
+ *  @{
+ */
+
+/**
+ *  一度にプリウォームできるファイルの最大数.
+ */
+#define PREWARM_FILES_MAX (16384)
+
+/**
+ *  ディレクトリを辿る深さの最大.
+ */
+#define PREWARM_DEPTH_MAX (16)
+
+/**
+ *  プリウォームの方法: readahead(2).
+ */
+#define PREWARM_READAHEAD (0)
+
+/**
+ *  プリウォームの方法: posix_fadvise(POSIX_FADV_WILLNEED).
+ */
+#define PREWARM_FADVISE (1)
+
+/**
+ *  プリウォームの方法: mmap(MAP_POPULATE).
+ */
+#define PREWARM_POPULATE (2)
+
+/**
+ *  プリウォームしたファイルを mlock する.
+ */
+#define PREWARM_LOCK (1 << 8)
+
+/**
+ *  プリウォーム型.
+ */
+typedef struct {} *PREWARM;
+
+/**
+ *  プリウォームの統計情報.
+ */
+struct prewarm_stats {
+    size_t files;        /**< 読み込んだファイルの数. */
+    uint64_t bytes;      /**< 読み込んだ合計サイズ. */
+    uint64_t locked;     /**< mlock した合計サイズ. */
+    uint64_t elapsed_us; /**< 読み込みに要した時間 (マイクロ秒). */
+};
+
+/**
+ *  プリウォームを初期化する.
+ *
+ *  @par    使用例
+ *          @code
+ *          PREWARM prewarm = prewarm_init(PREWARM_POPULATE | PREWARM_LOCK, 64 << 20);
+ *          prewarm_add(prewarm, "/usr/bin/env");
+ *          prewarm_add(prewarm, "/usr/lib/x86_64-linux-gnu");
+ *          prewarm_run(prewarm);
+ *          // プログラムを実行する.
+ *          prewarm_release(prewarm);
+ *          @endcode
+ */
+PREWARM prewarm_init(unsigned int flags, uint64_t lock_limit);
+
+/**
+ *  プリウォームを解放する.
+ */
+void prewarm_release(PREWARM prewarm);
+
+/**
+ *  プリウォームするファイルまたはディレクトリを追加する.
+ */
+int prewarm_add(PREWARM prewarm, const char *pathname);
+
+/**
+ *  追加した順にファイルをページキャッシュに読み込む.
+ */
+int prewarm_run(PREWARM prewarm);
+
+/**
+ *  プリウォームの統計情報を取得する.
+ */
+int prewarm_get_stats(PREWARM prewarm, struct prewarm_stats *stats);
+
+/** @} */
+
+#endif /* __ALCATRAZ_PREWARM_H__ */
@@ -0,0 +1,604 @@
+/** @file       profile.c
+ *  @brief      jail 内のファイルアクセスの記録 (アクセスプロファイル) を提供する.
+ *
+ *  jail の root 以下のマウントに fanotify のマウントマークを設定し,
+ *  FAN_OPEN (および FAN_OPEN_EXEC) のイベントを別スレッドで受け取る.
+ *  イベントのファイル記述子からパスを求め, 初めて開かれたファイルのみを
+ *  開かれた順に記録する. 記録する時刻はイベントを受け取った時刻のため,
+ *  実際に開かれた時刻よりわずかに遅れる.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for pipe2, getline */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/fanotify.h>
+
+#include "profile.h"
+#include "collections.h"
+#include "fsutil.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  プロファイルファイルの先頭行.
+ */
+#define PROFILE_HEADER "# alctrz access profile"
+
+/**
+ *  監視するイベント.
+ */
+#ifdef FAN_OPEN_EXEC
+#define PROFILE_EVENTS (FAN_OPEN | FAN_OPEN_EXEC)
+#else
+#define PROFILE_EVENTS (FAN_OPEN)
+#endif
+
+/**
+ *  記録したファイル.
+ */
+struct profile_file {
+    uint64_t offset_us; /**< 最初に開かれるまでの時間 (マイクロ秒). */
+    char *source;       /**< ホスト上のパス. (NULL 可) */
+    char *target;       /**< jail 内のパス. */
+};
+
+/**
+ *  アクセスプロファイル管理構造体.
+ */
+struct access_profile {
+    struct profile_file *files; /**< ファイルの配列. (最初に開かれた順) */
+    size_t count;               /**< ファイルの数. */
+    size_t capacity;            /**< 確保したファイルの数. */
+    MAP paths;                  /**< 記録済みの jail 内のパス. */
+    bool truncated;             /**< アクセスを取りこぼしたか. */
+
+    char root[PATH_MAX];        /**< 監視する jail の root. */
+    size_t root_length;         /**< @c root の長さ. */
+    int fanotify_fd;            /**< fanotify の記述子. */
+    int stop_fds[2];            /**< 記録スレッドに停止を指示するパイプ. */
+    pthread_t thread;           /**< 記録スレッド. */
+    bool recording;             /**< 記録スレッドが動作中か. */
+    uint64_t start_ns;          /**< 記録の開始時刻. */
+};
+
+static struct access_profile *profile_alloc(void)
+{
+    struct access_profile *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->paths = map_init(sizeof(char), PROFILE_FILES_MAX);
+    if (self->paths == NULL) {
+        free(self);
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->fanotify_fd = -1;
+    self->stop_fds[0] = -1;
+    self->stop_fds[1] = -1;
+
+    return self;
+}
+
+/**
+ *  ファイルを記録する.
+ *
+ *  記録済みのパスは追加しない.
+ */
+static int profile_add(struct access_profile *self,
+                       uint64_t offset_us,
+                       const char *source,
+                       const char *target)
+{
+    if (map_get(self->paths, target) != NULL) {
+        return 0;
+    }
+    if (self->count == PROFILE_FILES_MAX) {
+        self->truncated = true;
+        errno = ENOSPC;
+        return -1;
+    }
+    if (self->count == self->capacity) {
+        size_t capacity = (self->capacity > 0) ? self->capacity * 2 : 64;
+        struct profile_file *files = realloc(self->files, sizeof(*files) * capacity);
+        if (files == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        self->files = files;
+        self->capacity = capacity;
+    }
+
+    struct profile_file *file = &self->files[self->count];
+    file->offset_us = offset_us;
+    file->target = strdup(target);
+    file->source = (source != NULL) ? strdup(source) : NULL;
+    if ((file->target == NULL) || ((source != NULL) && (file->source == NULL))) {
+        free(file->target);
+        free(file->source);
+        errno = ENOMEM;
+        return -1;
+    }
+    if (map_put(self->paths, target, &(char){0}) == NULL) {
+        free(file->target);
+        free(file->source);
+        return -1;
+    }
+    ++self->count;
+
+    return 0;
+}
+
+/**
+ *  イベントのファイル記述子から jail 内のパスを求めて記録する.
+ */
+static void record_event(struct access_profile *self, int fd)
+{
+    char proc_path[64];
+    char path[PATH_MAX];
+
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+    ssize_t length = readlink(proc_path, path, sizeof(path) - 1);
+    if (length < 0) {
+        DEBUG("readlink: %s (%s)", strerror(errno), proc_path);
+        return;
+    }
+    path[length] = '\0';
+
+    if ((strncmp(path, self->root, self->root_length) != 0)
+        || ((path[self->root_length] != '/') && (path[self->root_length] != '\0'))) {
+
+        return;
+    }
+    const char *target = (path[self->root_length] != '\0') ? &path[self->root_length] : "/";
+    /* 1 行 1 ファイルで保存するため, 区切り文字を含むパスは記録しない. */
+    if (strpbrk(target, "\t\n") != NULL) {
+        return;
+    }
+    profile_add(self, elapsed_us(self->start_ns), NULL, target);
+}
+
+/**
+ *  読み出せるイベントを全て処理する.
+ *
+ *  @return イベントを処理した場合は 1 が, 無かった場合は 0 が返る.
+ */
+static int read_events(struct access_profile *self)
+{
+    char buf[8192] __attribute__((aligned(__alignof__(struct fanotify_event_metadata))));
+    pid_t pid = getpid();
+    int ret = 0;
+
+    for (;;) {
+        ssize_t length = read(self->fanotify_fd, buf, sizeof(buf));
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                DEBUG("read: %s (fanotify)", strerror(errno));
+            }
+            return ret;
+        }
+        ret = 1;
+
+        const struct fanotify_event_metadata *event = (const struct fanotify_event_metadata *)buf;
+        for (; FAN_EVENT_OK(event, length); event = FAN_EVENT_NEXT(event, length)) {
+            if (event->vers != FANOTIFY_METADATA_VERSION) {
+                DEBUG("fanotify: unexpected metadata version %u", event->vers);
+                continue;
+            }
+            if ((event->mask & FAN_Q_OVERFLOW) != 0) {
+                self->truncated = true;
+            }
+            if (event->fd < 0) {
+                continue;
+            }
+            if (event->pid != pid) {
+                record_event(self, event->fd);
+            }
+            close(event->fd);
+        }
+    }
+}
+
+static void *record_thread(void *arg)
+{
+    struct access_profile *self = (struct access_profile *)arg;
+    struct pollfd fds[] = {
+        {.fd = self->fanotify_fd, .events = POLLIN},
+        {.fd = self->stop_fds[0], .events = POLLIN},
+    };
+
+    for (;;) {
+        int ret = poll(fds, sizeof(fds) / sizeof(fds[0]), -1);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            DEBUG("poll: %s", strerror(errno));
+            break;
+        }
+        if ((fds[0].revents & POLLIN) != 0) {
+            read_events(self);
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+    }
+    /* 停止の指示までに発生したイベントを取りこぼさない. */
+    while (read_events(self) != 0) {
+    }
+
+    return NULL;
+}
+
+/**
+ *  jail の root 以下のマウントに, マウントマークを設定する.
+ *
+ *  kernel 関連の filesystem は監視しない.
+ */
+static int mark_mount(void *arg, const char *mount_point, const char *fstype)
+{
+    static const char * const ignored[] = {
+        "proc", "sysfs", "devtmpfs", "devpts", "mqueue", "cgroup", "cgroup2",
+    };
+    struct access_profile *self = (struct access_profile *)arg;
+
+    if ((strncmp(mount_point, self->root, self->root_length) != 0)
+        || ((mount_point[self->root_length] != '/') && (mount_point[self->root_length] != '\0'))) {
+
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(ignored) / sizeof(ignored[0]); ++i) {
+        if (strcmp(fstype, ignored[i]) == 0) {
+            return 0;
+        }
+    }
+
+    int ret = fanotify_mark(self->fanotify_fd, FAN_MARK_ADD | FAN_MARK_MOUNT,
+                            PROFILE_EVENTS, AT_FDCWD, mount_point);
+    if ((ret != 0) && (errno == EINVAL) && (PROFILE_EVENTS != FAN_OPEN)) {
+        /* FAN_OPEN_EXEC は Linux 5.0 以降. */
+        ret = fanotify_mark(self->fanotify_fd, FAN_MARK_ADD | FAN_MARK_MOUNT,
+                            FAN_OPEN, AT_FDCWD, mount_point);
+    }
+    if (ret != 0) {
+        DEBUG("fanotify_mark: %s (%s)", strerror(errno), mount_point);
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    @c root 以下のマウントで開かれたファイルの記録を開始する.
+ *              記録は @ref profile_stop を呼び出すまで別スレッドで行う.
+ *              fanotify のマウントマークには CAP_SYS_ADMIN が必要.
+ *
+ *  @param      [in]    root    jail の root のパス.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+ACCESS_PROFILE profile_record(const char *root)
+{
+    if (root == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+    size_t root_length = strlen(root);
+    while ((root_length > 0) && (root[root_length - 1] == '/')) {
+        --root_length;
+    }
+    if ((root_length == 0) || (root_length >= PATH_MAX)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct access_profile *self = profile_alloc();
+    if (self == NULL) {
+        return NULL;
+    }
+    memcpy(self->root, root, root_length);
+    self->root[root_length] = '\0';
+    self->root_length = root_length;
+
+    self->fanotify_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK,
+                                      O_RDONLY | O_LARGEFILE | O_CLOEXEC);
+    if (self->fanotify_fd < 0) {
+        DEBUG("fanotify_init: %s", strerror(errno));
+        goto error;
+    }
+    if (pipe2(self->stop_fds, O_CLOEXEC) != 0) {
+        DEBUG("pipe2: %s", strerror(errno));
+        goto error;
+    }
+    if (for_each_mount(mark_mount, self) != 0) {
+        goto error;
+    }
+
+    self->start_ns = monotonic_ns();
+    int ret = pthread_create(&self->thread, NULL, record_thread, self);
+    if (ret != 0) {
+        DEBUG("pthread_create: %s", strerror(ret));
+        errno = ret;
+        goto error;
+    }
+    self->recording = true;
+
+    return (ACCESS_PROFILE)self;
+
+error:
+    profile_release((ACCESS_PROFILE)self);
+    return NULL;
+}
+
+/**
+ *  @details    @ref profile_record で開始した記録を停止する.
+ *              停止までに発生したイベントは全て記録する.
+ *
+ *  @param      [in,out]    profile プロファイルオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int profile_stop(ACCESS_PROFILE profile)
+{
+    struct access_profile *self = (struct access_profile *)profile;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!self->recording) {
+        return 0;
+    }
+
+    if (write(self->stop_fds[1], "", 1) < 0) {
+        DEBUG("write: %s (stop)", strerror(errno));
+    }
+    pthread_join(self->thread, NULL);
+    self->recording = false;
+    close(self->fanotify_fd);
+    self->fanotify_fd = -1;
+
+    return 0;
+}
+
+/**
+ *  @details    記録したファイルを, 最初に開かれた順に @c pathname に保存する.
+ *              各行は "<時間 (us)>\t<ホスト上のパス>\t<jail 内のパス>" の形式.
+ *              ホスト上のパスが未設定のファイルは @c translate で変換し,
+ *              変換できないファイルは保存しない.
+ *              一時ファイルに書き込んだ後に置き換える.
+ *
+ *  @param      [in]    profile     プロファイルオブジェクト.
+ *  @param      [in]    pathname    保存するファイルのパス.
+ *  @param      [in]    translate   jail 内のパスをホスト上のパスに変換する関数. (NULL 可)
+ *  @param      [in]    arg         @c translate に渡す引数.
+ *  @return     成功時は, 保存したファイルの数が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int profile_save(ACCESS_PROFILE profile,
+                 const char *pathname,
+                 profile_translator translate,
+                 void *arg)
+{
+    struct access_profile *self = (struct access_profile *)profile;
+    char temp[PATH_MAX];
+    char source[PATH_MAX];
+    int saved = 0;
+
+    if ((self == NULL) || (pathname == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (snprintf(temp, sizeof(temp), "%s.XXXXXX", pathname) >= (int)sizeof(temp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(temp);
+    if (fd < 0) {
+        DEBUG("mkstemp: %s (%s)", strerror(errno), temp);
+        return -1;
+    }
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    FILE *fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        unlink(temp);
+        return -1;
+    }
+    fprintf(fp, "%s\n", PROFILE_HEADER);
+    if (self->truncated) {
+        fprintf(fp, "# truncated\n");
+    }
+    for (size_t i = 0; i < self->count; ++i) {
+        const struct profile_file *file = &self->files[i];
+        const char *host = file->source;
+
+        if (host == NULL) {
+            if (translate == NULL) {
+                host = file->target;
+            } else if (translate(arg, file->target, source, sizeof(source)) == 0) {
+                host = source;
+            } else {
+                continue;
+            }
+        }
+        if (strpbrk(host, "\t\n") != NULL) {
+            continue;
+        }
+        fprintf(fp, "%" PRIu64 "\t%s\t%s\n", file->offset_us, host, file->target);
+        ++saved;
+    }
+    if ((fclose(fp) != 0) || (rename(temp, pathname) != 0)) {
+        DEBUG("profile: failed to save %s: %s", pathname, strerror(errno));
+        unlink(temp);
+        return -1;
+    }
+
+    return saved;
+}
+
+/**
+ *  @details    @ref profile_save で保存したプロファイルを読み込む.
+ *              読み込んだプロファイルの全てのファイルはホスト上のパスを持つ.
+ *
+ *  @param      [in]    pathname    プロファイルファイルのパス.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+ACCESS_PROFILE profile_load(const char *pathname)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+
+    FILE *fp = fopen(pathname, "re");
+    if (fp == NULL) {
+        return NULL;
+    }
+    struct access_profile *self = profile_alloc();
+    if (self == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+
+    while ((length = getline(&line, &capacity, fp)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+        if ((line[0] == '#') || (line[0] == '\0')) {
+            if (strcmp(line, "# truncated") == 0) {
+                self->truncated = true;
+            }
+            continue;
+        }
+
+        char *source = strchr(line, '\t');
+        char *target = (source != NULL) ? strchr(source + 1, '\t') : NULL;
+        if (target == NULL) {
+            DEBUG("profile: malformed line in %s", pathname);
+            continue;
+        }
+        *source++ = '\0';
+        *target++ = '\0';
+        if ((source[0] != '/') || (target[0] != '/')) {
+            DEBUG("profile: malformed line in %s", pathname);
+            continue;
+        }
+        if ((profile_add(self, strtoull(line, NULL, 10), source, target) != 0)
+            && (errno != ENOSPC)) {
+
+            free(line);
+            fclose(fp);
+            profile_release((ACCESS_PROFILE)self);
+            return NULL;
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    return (ACCESS_PROFILE)self;
+}
+
+/**
+ *  @details    @c profile を解放する.
+ *              記録中の場合は, 記録を停止してから解放する.
+ *
+ *  @param      [in,out]    profile プロファイルオブジェクト.
+ */
+void profile_release(ACCESS_PROFILE profile)
+{
+    struct access_profile *self = (struct access_profile *)profile;
+
+    if (self != NULL) {
+        profile_stop(profile);
+        if (self->fanotify_fd >= 0) {
+            close(self->fanotify_fd);
+        }
+        if (self->stop_fds[0] >= 0) {
+            close(self->stop_fds[0]);
+            close(self->stop_fds[1]);
+        }
+        for (size_t i = 0; i < self->count; ++i) {
+            free(self->files[i].source);
+            free(self->files[i].target);
+        }
+        free(self->files);
+        map_release(self->paths);
+        free(self);
+    }
+}
+
+/**
+ *  @details    記録したファイルの数を返す.
+ *
+ *  @param      [in]    profile プロファイルオブジェクト.
+ *  @return     記録したファイルの数が返る.
+ */
+size_t profile_count(ACCESS_PROFILE profile)
+{
+    struct access_profile *self = (struct access_profile *)profile;
+
+    return (self != NULL) ? self->count : 0;
+}
+
+/**
+ *  @details    @c index 番目に開かれたファイルを取得する.
+ *              取得したパスは @c profile を解放するまで有効.
+ *
+ *  @param      [in]    profile プロファイルオブジェクト.
+ *  @param      [in]    index   ファイルの番号. (0 起算)
+ *  @param      [out]   entry   記録したファイル.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int profile_get(ACCESS_PROFILE profile, size_t index, struct profile_entry *entry)
+{
+    struct access_profile *self = (struct access_profile *)profile;
+
+    if ((self == NULL) || (index >= self->count) || (entry == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const struct profile_file *file = &self->files[index];
+    entry->offset_us = file->offset_us;
+    entry->source = file->source;
+    entry->target = file->target;
+
+    return 0;
+}
+
+/**
+ *  @details    記録中に fanotify のキューが溢れたか, 記録できる
+ *              ファイルの最大数を超えたかを返す.
+ *
+ *  @param      [in]    profile プロファイルオブジェクト.
+ *  @return     アクセスを取りこぼした場合は, true が返る.
+ */
+bool profile_truncated(ACCESS_PROFILE profile)
+{
+    struct access_profile *self = (struct access_profile *)profile;
+
+    return (self != NULL) && self->truncated;
+}
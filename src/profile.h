@@ -0,0 +1,106 @@
+/** @file       profile.h
+ *  @brief      jail 内のファイルアクセスの記録 (アクセスプロファイル) を提供する.
+ *
+ *  jail 内のマウントを fanotify で監視し, プログラムが開いたファイルを
+ *  最初に開いた順に記録する. 記録したプロファイルは, 次回以降の起動時の
+ *  ページキャッシュの先読みや, 必要最小限のバインドの一覧の生成に使用する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_PROFILE_H__
+#define __ALCATRAZ_PROFILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @defgroup cat_profile Access profile
+ *  jail 内のファイルアクセスを記録するモジュール.
+ *  @{
+ */
+
+/**
+ *  一つのプロファイルに記録できるファイルの最大数.
+ */
+#define PROFILE_FILES_MAX (4096)
+
+/**
+ *  アクセスプロファイル型.
+ */
+typedef struct {} *ACCESS_PROFILE;
+
+/**
+ *  記録したファイル.
+ */
+struct profile_entry {
+    uint64_t offset_us; /**< 記録の開始から, 最初に開かれるまでの時間 (マイクロ秒). */
+    const char *source; /**< ホスト上のパス. (未変換の場合は NULL) */
+    const char *target; /**< jail 内のパス. */
+};
+
+/**
+ *  jail 内のパスをホスト上のパスに変換する関数の型.
+ *
+ *  変換できない場合は -1 を返し, そのファイルは保存しない.
+ */
+typedef int (*profile_translator)(void *arg, const char *target, char *source, size_t length);
+
+/**
+ *  jail 内のファイルアクセスの記録を開始する.
+ *
+ *  @par    使用例
+ *          @code
+ *          ACCESS_PROFILE profile = profile_record("/tmp/chroot-XXXXXX");
+ *          // jail 内でプログラムを実行する.
+ *          profile_stop(profile);
+ *          profile_save(profile, "env.json.profile", to_host_path, ctx);
+ *          profile_release(profile);
+ *          @endcode
+ */
+ACCESS_PROFILE profile_record(const char *root);
+
+/**
+ *  ファイルアクセスの記録を停止する.
+ */
+int profile_stop(ACCESS_PROFILE profile);
+
+/**
+ *  プロファイルをファイルに保存する.
+ */
+int profile_save(ACCESS_PROFILE profile,
+                 const char *pathname,
+                 profile_translator translate,
+                 void *arg);
+
+/**
+ *  ファイルからプロファイルを読み込む.
+ */
+ACCESS_PROFILE profile_load(const char *pathname);
+
+/**
+ *  プロファイルを解放する.
+ */
+void profile_release(ACCESS_PROFILE profile);
+
+/**
+ *  記録したファイルの数を取得する.
+ */
+size_t profile_count(ACCESS_PROFILE profile);
+
+/**
+ *  記録したファイルを取得する.
+ */
+int profile_get(ACCESS_PROFILE profile, size_t index, struct profile_entry *entry);
+
+/**
+ *  記録が溢れて, 一部のアクセスを取りこぼしたかを取得する.
+ */
+bool profile_truncated(ACCESS_PROFILE profile);
+
+/** @} */
+
+#endif /* __ALCATRAZ_PROFILE_H__ */
@@ -0,0 +1,1002 @@
+/** @file       sysops.c
+ *  @brief      rootfs の構築に使用するシステムコールの呼び出し口を提供する.
+ *
+ *  記録中は, システムコールを発行せずに操作の対象のパスを記録する.
+ *  記録中に開いたファイル記述子は, 実在しない番号 (SYSOPS_FD_BASE 以降) と
+ *  開いたパスの対応として管理し, 以降の *at 系の操作のパスの解決に使用する.
+ *  作成したパスも記録し, 同じパスを再度作成した場合は EEXIST で失敗させる.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for asprintf, syscall */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+
+#include "collections.h"
+#include "sysops.h"
+#include "timeutil.h"
+#include "debug.h"
+
+#ifndef RESOLVE_IN_ROOT
+struct open_how {
+    uint64_t flags;
+    uint64_t mode;
+    uint64_t resolve;
+};
+#endif
+#ifndef SYS_openat2
+#define SYS_openat2 437
+#endif
+#ifndef OPEN_TREE_CLONE
+#define OPEN_TREE_CLONE 1
+#endif
+#ifndef MOVE_MOUNT_F_EMPTY_PATH
+#define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#endif
+#ifndef AT_RECURSIVE
+#define AT_RECURSIVE 0x8000
+#endif
+#ifndef MOUNT_ATTR_RDONLY
+#define MOUNT_ATTR_RDONLY 0x00000001
+struct mount_attr {
+    uint64_t attr_set;
+    uint64_t attr_clr;
+    uint64_t propagation;
+    uint64_t userns_fd;
+};
+#endif
+
+/**
+ *  記録中に開いたファイル記述子の最小値.
+ */
+#define SYSOPS_FD_BASE (1 << 20)
+
+/**
+ *  記録する作成済みのパスの最大数.
+ */
+#define SYSOPS_PATHS_MAX (65536)
+
+/**
+ *  操作の種別の名称と, コストの既定値 (ナノ秒).
+ *
+ *  既定値は, tmpfs 上で sysops_calibrate() により計測した値の目安.
+ */
+static const struct {
+    const char *name;
+    uint64_t ns;
+} sysops_kinds[SYSOPS_KINDS] = {
+    [SYSOPS_OPEN] = {"open", 2000},
+    [SYSOPS_OPENAT] = {"openat", 3000},
+    [SYSOPS_OPENAT2] = {"openat2", 1500},
+    [SYSOPS_MKDIRAT] = {"mkdirat", 3000},
+    [SYSOPS_MKNODAT] = {"mknodat", 3000},
+    [SYSOPS_FCHOWNAT] = {"fchownat", 1000},
+    [SYSOPS_FCHOWN] = {"fchown", 500},
+    [SYSOPS_CLOSE] = {"close", 300},
+    [SYSOPS_MOUNT] = {"mount", 20000},
+    [SYSOPS_UMOUNT2] = {"umount2", 10000},
+    [SYSOPS_OPEN_TREE] = {"open_tree", 10000},
+    [SYSOPS_MOUNT_SETATTR] = {"mount_setattr", 3000},
+    [SYSOPS_MOVE_MOUNT] = {"move_mount", 15000},
+};
+
+/**
+ *  記録器管理構造体.
+ */
+struct sysops_recorder {
+    struct sysops_op *ops; /**< 記録した操作の配列. */
+    size_t count;          /**< 記録した操作の数. */
+    size_t capacity;       /**< 確保した操作の数. */
+    char **fds;            /**< 開いたファイル記述子のパス. (閉じた場合は NULL) */
+    size_t num_fds;        /**< 払い出したファイル記述子の数. */
+    MAP created;           /**< 作成済みのパス. */
+};
+
+/**
+ *  記録中の記録器. (記録中でない場合は NULL)
+ */
+static struct sysops_recorder *recording = NULL;
+
+/**
+ *  操作を記録する.
+ *
+ *  @param  [in,out]    self    記録器.
+ *  @param  [in]        kind    操作の種別.
+ *  @param  [in]        path    操作の対象のパス. (所有権を移す)
+ *  @param  [in]        source  マウント元のパス. (NULL 可)
+ *  @param  [in]        error   操作の結果の errno.
+ *  @param  [in]        create  パスを作成する操作か.
+ *  @return @c error が 0 の場合は 0 が返る.
+ *          それ以外の場合は -1 が返り, errno に @c error が設定される.
+ */
+static int recorder_add(struct sysops_recorder *self,
+                        unsigned int kind,
+                        char *path,
+                        const char *source,
+                        int error,
+                        bool create)
+{
+    if (path == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    if (self->count == self->capacity) {
+        size_t capacity = (self->capacity == 0) ? 256 : self->capacity * 2;
+        struct sysops_op *ops = realloc(self->ops, sizeof(*ops) * capacity);
+        if (ops == NULL) {
+            free(path);
+            errno = ENOMEM;
+            return -1;
+        }
+        self->ops = ops;
+        self->capacity = capacity;
+    }
+
+    struct sysops_op *op = &self->ops[self->count];
+    op->kind = kind;
+    op->path = path;
+    op->source = (source != NULL) ? strdup(source) : NULL;
+    op->error = error;
+    op->create = create;
+    if ((source != NULL) && (op->source == NULL)) {
+        free(path);
+        errno = ENOMEM;
+        return -1;
+    }
+    ++self->count;
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ *  ファイル記述子とパスから, 操作の対象のパスを生成する.
+ *
+ *  @return 成功時は確保したパスが返る.
+ *          失敗時は NULL が返り, errno が適切に設定される.
+ */
+static char *recorder_path(struct sysops_recorder *self, int dirfd, const char *pathname)
+{
+    const char *base = "";
+
+    if ((pathname[0] != '/') && (dirfd != AT_FDCWD)) {
+        size_t index = (size_t)(dirfd - SYSOPS_FD_BASE);
+        if ((dirfd < SYSOPS_FD_BASE) || (index >= self->num_fds) || (self->fds[index] == NULL)) {
+            errno = EBADF;
+            return NULL;
+        }
+        base = self->fds[index];
+    }
+    if (pathname[0] == '\0') {
+        return strdup(base);
+    }
+
+    size_t length = strlen(base);
+    char *path;
+    if (asprintf(&path, "%s%s%s", base,
+                 ((length > 0) && (base[length - 1] != '/') && (pathname[0] != '/')) ? "/" : "",
+                 pathname) < 0) {
+
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return path;
+}
+
+/**
+ *  パスに対応するファイル記述子を払い出す.
+ *
+ *  @return 成功時はファイル記述子が返る.
+ *          失敗時は -1 が返り, errno が適切に設定される.
+ */
+static int recorder_open_fd(struct sysops_recorder *self, const char *path)
+{
+    char **fds = realloc(self->fds, sizeof(*fds) * (self->num_fds + 1));
+    if (fds == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    self->fds = fds;
+    self->fds[self->num_fds] = strdup(path);
+    if (self->fds[self->num_fds] == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return SYSOPS_FD_BASE + (int)self->num_fds++;
+}
+
+/**
+ *  パスを開く操作を記録し, ファイル記述子を払い出す.
+ */
+static int recorder_open(struct sysops_recorder *self,
+                         unsigned int kind,
+                         int dirfd,
+                         const char *pathname,
+                         bool create)
+{
+    char *path = recorder_path(self, dirfd, pathname);
+    if (path == NULL) {
+        int error = errno;
+        return recorder_add(self, kind, strdup(pathname), NULL, error, false);
+    }
+    if (create) {
+        map_put(self->created, path, &(char){0});
+    }
+    int fd = recorder_open_fd(self, path);
+    if (recorder_add(self, kind, path, NULL, (fd < 0) ? errno : 0, create) != 0) {
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ *  パスを作成する操作を記録する.
+ *
+ *  作成済みのパスの場合は, EEXIST で失敗する.
+ */
+static int recorder_create(struct sysops_recorder *self,
+                           unsigned int kind,
+                           int dirfd,
+                           const char *pathname)
+{
+    char *path = recorder_path(self, dirfd, pathname);
+    if (path == NULL) {
+        int error = errno;
+        return recorder_add(self, kind, strdup(pathname), NULL, error, false);
+    }
+
+    int error = 0;
+    if (map_get(self->created, path) != NULL) {
+        error = EEXIST;
+    } else if (map_put(self->created, path, &(char){0}) == NULL) {
+        error = errno;
+    }
+
+    return recorder_add(self, kind, path, NULL, error, true);
+}
+
+/**
+ *  パスに対する操作を記録する.
+ */
+static int recorder_touch(struct sysops_recorder *self,
+                          unsigned int kind,
+                          int dirfd,
+                          const char *pathname,
+                          const char *source)
+{
+    char *path = recorder_path(self, dirfd, pathname);
+    if (path == NULL) {
+        int error = errno;
+        return recorder_add(self, kind, strdup(pathname), source, error, false);
+    }
+
+    return recorder_add(self, kind, path, source, 0, false);
+}
+
+/**
+ *  @details    操作の種別の名称を取得する.
+ *
+ *  @param      [in]    kind    操作の種別 (SYSOPS_*).
+ *  @return     操作の種別の名称が返る. 不明な種別の場合は "unknown" が返る.
+ */
+const char *sysops_kind_name(unsigned int kind)
+{
+    return (kind < SYSOPS_KINDS) ? sysops_kinds[kind].name : "unknown";
+}
+
+/**
+ *  @details    操作の種別を名称から取得する.
+ *
+ *  @param      [in]    name    操作の種別の名称.
+ *  @return     成功時は, 操作の種別が返る.
+ *              不明な名称の場合は, -1 が返り, errno に EINVAL が設定される.
+ */
+int sysops_kind_by_name(const char *name)
+{
+    for (unsigned int i = 0; i < SYSOPS_KINDS; ++i) {
+        if (strcmp(name, sysops_kinds[i].name) == 0) {
+            return (int)i;
+        }
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+/**
+ *  @details    操作の記録を開始する.
+ *              記録を終了するまで, このモジュールの関数はシステムコールを
+ *              発行せずに操作を記録する.
+ *
+ *  @return     成功時は, 記録器オブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ *  @warning    スレッドセーフではない. 記録はプロセス全体に作用する.
+ */
+SYSOPS_RECORDER sysops_record_start(void)
+{
+    if (recording != NULL) {
+        errno = EBUSY;
+        return NULL;
+    }
+
+    struct sysops_recorder *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    self->created = map_init(sizeof(char), SYSOPS_PATHS_MAX);
+    if (self->created == NULL) {
+        free(self);
+        return NULL;
+    }
+    recording = self;
+
+    return (SYSOPS_RECORDER)self;
+}
+
+/**
+ *  @details    操作の記録を終了し, システムコールの発行に戻す.
+ *              記録した操作は, 記録器を解放するまで参照できる.
+ *
+ *  @param      [in]    recorder    記録器オブジェクト.
+ */
+void sysops_record_stop(SYSOPS_RECORDER recorder)
+{
+    if (recording == (struct sysops_recorder *)recorder) {
+        recording = NULL;
+    }
+}
+
+/**
+ *  @details    記録器を解放する.
+ *              記録中の場合は, 記録を終了する.
+ *
+ *  @param      [in]    recorder    記録器オブジェクト.
+ */
+void sysops_recorder_release(SYSOPS_RECORDER recorder)
+{
+    struct sysops_recorder *self = (struct sysops_recorder *)recorder;
+
+    if (self != NULL) {
+        sysops_record_stop(recorder);
+        for (size_t i = 0; i < self->count; ++i) {
+            free((char *)self->ops[i].path);
+            free((char *)self->ops[i].source);
+        }
+        free(self->ops);
+        for (size_t i = 0; i < self->num_fds; ++i) {
+            free(self->fds[i]);
+        }
+        free(self->fds);
+        map_release(self->created);
+        free(self);
+    }
+}
+
+/**
+ *  @details    記録した操作を, 記録した順に取得する.
+ *
+ *  @param      [in]    recorder    記録器オブジェクト.
+ *  @param      [out]   count       操作の数.
+ *  @return     記録した操作の配列が返る.
+ */
+const struct sysops_op *sysops_recorded(SYSOPS_RECORDER recorder, size_t *count)
+{
+    struct sysops_recorder *self = (struct sysops_recorder *)recorder;
+
+    *count = (self != NULL) ? self->count : 0;
+    return (self != NULL) ? self->ops : NULL;
+}
+
+/**
+ *  @details    操作を記録中かどうかを判定する.
+ *
+ *  @return     記録中の場合は true が返る.
+ */
+bool sysops_recording(void)
+{
+    return recording != NULL;
+}
+
+/**
+ *  @details    open(2) を発行する.
+ *
+ *  @param      [in]    pathname    パス.
+ *  @param      [in]    flags       open(2) のフラグ.
+ *  @param      [in]    mode        作成する場合のパーミッション.
+ *  @return     成功時は, ファイル記述子が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_open(const char *pathname, int flags, mode_t mode)
+{
+    if (recording != NULL) {
+        return recorder_open(recording, SYSOPS_OPEN, AT_FDCWD, pathname, (flags & O_CREAT) != 0);
+    }
+
+    return open(pathname, flags, mode);
+}
+
+/**
+ *  @details    openat(2) を発行する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    flags       open(2) のフラグ.
+ *  @param      [in]    mode        作成する場合のパーミッション.
+ *  @return     成功時は, ファイル記述子が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_openat(int dirfd, const char *pathname, int flags, mode_t mode)
+{
+    if (recording != NULL) {
+        return recorder_open(recording, SYSOPS_OPENAT, dirfd, pathname, (flags & O_CREAT) != 0);
+    }
+
+    return openat(dirfd, pathname, flags, mode);
+}
+
+/**
+ *  @details    openat2(2) を発行する.
+ *              openat2 が使用できない kernel では, ENOSYS で失敗する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    flags       open(2) のフラグ.
+ *  @param      [in]    resolve     パスの解決の制限 (RESOLVE_*).
+ *  @return     成功時は, ファイル記述子が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_openat2(int dirfd, const char *pathname, uint64_t flags, uint64_t resolve)
+{
+    if (recording != NULL) {
+        /* RESOLVE_IN_ROOT では, 絶対パスも dirfd を起点とする. */
+        while (*pathname == '/') {
+            ++pathname;
+        }
+        return recorder_open(recording, SYSOPS_OPENAT2, dirfd, pathname, false);
+    }
+
+    struct open_how how = {
+        .flags = flags,
+        .resolve = resolve,
+    };
+    return (int)syscall(SYS_openat2, dirfd, pathname, &how, sizeof(how));
+}
+
+/**
+ *  @details    mkdirat(2) を発行する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    mode        パーミッション.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_mkdirat(int dirfd, const char *pathname, mode_t mode)
+{
+    if (recording != NULL) {
+        return recorder_create(recording, SYSOPS_MKDIRAT, dirfd, pathname);
+    }
+
+    return mkdirat(dirfd, pathname, mode);
+}
+
+/**
+ *  @details    mknodat(2) を発行する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    mode        ファイル種別とパーミッション.
+ *  @param      [in]    dev         デバイス番号.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_mknodat(int dirfd, const char *pathname, mode_t mode, dev_t dev)
+{
+    if (recording != NULL) {
+        return recorder_create(recording, SYSOPS_MKNODAT, dirfd, pathname);
+    }
+
+    return mknodat(dirfd, pathname, mode, dev);
+}
+
+/**
+ *  @details    fchownat(2) を発行する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    owner       所有者.
+ *  @param      [in]    group       グループ.
+ *  @param      [in]    flags       fchownat(2) のフラグ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_fchownat(int dirfd, const char *pathname, uid_t owner, gid_t group, int flags)
+{
+    if (recording != NULL) {
+        return recorder_touch(recording, SYSOPS_FCHOWNAT, dirfd, pathname, NULL);
+    }
+
+    return fchownat(dirfd, pathname, owner, group, flags);
+}
+
+/**
+ *  @details    fchown(2) を発行する.
+ *
+ *  @param      [in]    fd      ファイル記述子.
+ *  @param      [in]    owner   所有者.
+ *  @param      [in]    group   グループ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_fchown(int fd, uid_t owner, gid_t group)
+{
+    if (recording != NULL) {
+        return recorder_touch(recording, SYSOPS_FCHOWN, fd, "", NULL);
+    }
+
+    return fchown(fd, owner, group);
+}
+
+/**
+ *  @details    close(2) を発行する.
+ *              記録中に払い出したファイル記述子以外は, 記録中も閉じる.
+ *
+ *  @param      [in]    fd  ファイル記述子.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_close(int fd)
+{
+    if ((recording != NULL) && (fd >= SYSOPS_FD_BASE)) {
+        size_t index = (size_t)(fd - SYSOPS_FD_BASE);
+        int ret = recorder_touch(recording, SYSOPS_CLOSE, fd, "", NULL);
+        if (index < recording->num_fds) {
+            free(recording->fds[index]);
+            recording->fds[index] = NULL;
+        }
+        return ret;
+    }
+
+    return close(fd);
+}
+
+/**
+ *  @details    mount(2) を発行する.
+ *
+ *  @param      [in]    source  マウント元.
+ *  @param      [in]    target  マウント先.
+ *  @param      [in]    fstype  ファイルシステムの種別.
+ *  @param      [in]    flags   マウントフラグ.
+ *  @param      [in]    data    マウントオプション.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_mount(const char *source,
+                 const char *target,
+                 const char *fstype,
+                 unsigned long flags,
+                 const void *data)
+{
+    if (recording != NULL) {
+        /*
+         *  バインドはマウント元, それ以外はファイルシステムの種別を記録する.
+         *  再マウントは取り付けではないため, マウント元を記録しない.
+         */
+        const char *from = (flags & MS_REMOUNT) ? NULL : (flags & MS_BIND) ? source : fstype;
+        return recorder_touch(recording, SYSOPS_MOUNT, AT_FDCWD, target, from);
+    }
+
+    return mount(source, target, fstype, flags, data);
+}
+
+/**
+ *  @details    umount2(2) を発行する.
+ *
+ *  @param      [in]    target  マウント先.
+ *  @param      [in]    flags   アンマウントのフラグ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_umount2(const char *target, int flags)
+{
+    if (recording != NULL) {
+        return recorder_touch(recording, SYSOPS_UMOUNT2, AT_FDCWD, target, NULL);
+    }
+
+    return umount2(target, flags);
+}
+
+/**
+ *  @details    open_tree(2) を発行する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    flags       open_tree(2) のフラグ.
+ *  @return     成功時は, マウントツリーのファイル記述子が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_open_tree(int dirfd, const char *pathname, unsigned int flags)
+{
+    if (recording != NULL) {
+        return recorder_open(recording, SYSOPS_OPEN_TREE, dirfd, pathname, false);
+    }
+
+    return (int)syscall(SYS_open_tree, dirfd, pathname, flags);
+}
+
+/**
+ *  @details    mount_setattr(2) を発行する.
+ *
+ *  @param      [in]    dirfd       起点のディレクトリ fd.
+ *  @param      [in]    pathname    @c dirfd からの相対パス.
+ *  @param      [in]    flags       mount_setattr(2) のフラグ.
+ *  @param      [in]    attr        マウントの属性 (struct mount_attr).
+ *  @param      [in]    size        @c attr のサイズ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_mount_setattr(int dirfd, const char *pathname, unsigned int flags, void *attr, size_t size)
+{
+    if (recording != NULL) {
+        return recorder_touch(recording, SYSOPS_MOUNT_SETATTR, dirfd, pathname, NULL);
+    }
+
+    return (int)syscall(SYS_mount_setattr, dirfd, pathname, flags, attr, size);
+}
+
+/**
+ *  @details    move_mount(2) を発行する.
+ *
+ *  @param      [in]    from_dirfd      取り付けるマウントツリーの起点.
+ *  @param      [in]    from_pathname   @c from_dirfd からの相対パス.
+ *  @param      [in]    to_dirfd        取り付け先の起点.
+ *  @param      [in]    to_pathname     @c to_dirfd からの相対パス.
+ *  @param      [in]    flags           move_mount(2) のフラグ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_move_mount(int from_dirfd,
+                      const char *from_pathname,
+                      int to_dirfd,
+                      const char *to_pathname,
+                      unsigned int flags)
+{
+    if (recording != NULL) {
+        char *from = recorder_path(recording, from_dirfd, from_pathname);
+        int ret = recorder_touch(recording, SYSOPS_MOVE_MOUNT, to_dirfd, to_pathname, from);
+        free(from);
+        return ret;
+    }
+
+    return (int)syscall(SYS_move_mount, from_dirfd, from_pathname, to_dirfd, to_pathname, flags);
+}
+
+/**
+ *  @details    操作の種別毎のコストの既定値を取得する.
+ *
+ *  @param      [out]   costs   コストの格納先.
+ */
+void sysops_default_costs(struct sysops_costs *costs)
+{
+    for (unsigned int i = 0; i < SYSOPS_KINDS; ++i) {
+        costs->ns[i] = sysops_kinds[i].ns;
+    }
+    costs->measured = 0;
+}
+
+/**
+ *  計測した時間を, 1 回あたりのコストとして記録する.
+ */
+static void sysops_measured(struct sysops_costs *costs, unsigned int kind, uint64_t start, unsigned int done)
+{
+    if (done > 0) {
+        costs->ns[kind] = (monotonic_ns() - start) / done;
+        costs->measured |= 1U << kind;
+    }
+}
+
+/**
+ *  @details    @c dir の配下でシステムコールを繰り返し発行し,
+ *              操作の種別毎のコストを計測する.
+ *              権限が無く発行できない種別は, 既定値とする.
+ *
+ *  @param      [in]    dir         計測に使用する空のディレクトリ.
+ *  @param      [in]    iterations  種別毎に発行する回数.
+ *  @param      [out]   costs       コストの格納先.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @warning    マウントの計測は @c dir の配下にマウントするため, 専用の
+ *              マウント名前空間で呼び出すこと.
+ */
+int sysops_calibrate(const char *dir, unsigned int iterations, struct sysops_costs *costs)
+{
+    char name[32];
+    uint64_t start;
+    unsigned int done;
+
+    if ((dir == NULL) || (iterations == 0) || (costs == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    sysops_default_costs(costs);
+
+    int *fds = calloc(iterations, sizeof(*fds));
+    if (fds == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    int dir_fd = open(dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), dir);
+        free(fds);
+        return -1;
+    }
+
+    start = monotonic_ns();
+    for (done = 0; done < iterations; ++done) {
+        snprintf(name, sizeof(name), "d%u", done);
+        if (mkdirat(dir_fd, name, S_IRWXU) != 0) {
+            DEBUG("mkdirat: %s (%s/%s)", strerror(errno), dir, name);
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_MKDIRAT, start, done);
+    unsigned int dirs = done;
+
+    start = monotonic_ns();
+    for (done = 0; done < dirs; ++done) {
+        snprintf(name, sizeof(name), "d%u", done);
+        if (fchownat(dir_fd, name, geteuid(), getegid(), AT_SYMLINK_NOFOLLOW) != 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_FCHOWNAT, start, done);
+
+    start = monotonic_ns();
+    for (done = 0; done < dirs; ++done) {
+        snprintf(name, sizeof(name), "d%u", done);
+        struct open_how how = {
+            .flags = O_PATH | O_DIRECTORY | O_CLOEXEC,
+            .resolve = 0x10, /* RESOLVE_IN_ROOT */
+        };
+        fds[done] = (int)syscall(SYS_openat2, dir_fd, name, &how, sizeof(how));
+        if (fds[done] < 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_OPENAT2, start, done);
+
+    start = monotonic_ns();
+    unsigned int opened = done;
+    for (done = 0; done < opened; ++done) {
+        close(fds[done]);
+    }
+    sysops_measured(costs, SYSOPS_CLOSE, start, done);
+
+    char path[PATH_MAX];
+    start = monotonic_ns();
+    for (done = 0; done < dirs; ++done) {
+        snprintf(path, sizeof(path), "%s/d%u", dir, done);
+        fds[done] = open(path, O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (fds[done] < 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_OPEN, start, done);
+    for (unsigned int i = 0; i < done; ++i) {
+        close(fds[i]);
+    }
+
+    /* ファイルの作成は openat, 所有者の変更は fchown で計測する. */
+    start = monotonic_ns();
+    for (done = 0; done < iterations; ++done) {
+        snprintf(name, sizeof(name), "f%u", done);
+        fds[done] = openat(dir_fd, name, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (fds[done] < 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_OPENAT, start, done);
+    unsigned int files = done;
+
+    start = monotonic_ns();
+    for (done = 0; done < files; ++done) {
+        if (fchown(fds[done], geteuid(), getegid()) != 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_FCHOWN, start, done);
+    for (unsigned int i = 0; i < files; ++i) {
+        close(fds[i]);
+    }
+
+    start = monotonic_ns();
+    for (done = 0; done < iterations; ++done) {
+        snprintf(name, sizeof(name), "n%u", done);
+        if (mknodat(dir_fd, name, S_IFCHR | S_IRUSR | S_IWUSR, makedev(1, 3)) != 0) {
+            DEBUG("mknodat: %s (%s/%s)", strerror(errno), dir, name);
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_MKNODAT, start, done);
+    unsigned int nodes = done;
+
+    start = monotonic_ns();
+    for (done = 0; done < dirs; ++done) {
+        snprintf(path, sizeof(path), "%s/d%u", dir, done);
+        if (mount("none", path, "proc", 0, NULL) != 0) {
+            DEBUG("mount: %s (%s)", strerror(errno), path);
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_MOUNT, start, done);
+    unsigned int mounts = done;
+
+    start = monotonic_ns();
+    for (done = 0; done < mounts; ++done) {
+        snprintf(path, sizeof(path), "%s/d%u", dir, done);
+        if (umount2(path, MNT_DETACH) != 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_UMOUNT2, start, done);
+
+    start = monotonic_ns();
+    for (done = 0; done < dirs; ++done) {
+        fds[done] = (int)syscall(SYS_open_tree, dir_fd, "d0",
+                                 OPEN_TREE_CLONE | O_CLOEXEC | AT_RECURSIVE);
+        if (fds[done] < 0) {
+            DEBUG("open_tree: %s (%s/d0)", strerror(errno), dir);
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_OPEN_TREE, start, done);
+    unsigned int trees = done;
+
+    struct mount_attr attr = {
+        .attr_set = MOUNT_ATTR_RDONLY,
+    };
+    start = monotonic_ns();
+    for (done = 0; done < trees; ++done) {
+        if (syscall(SYS_mount_setattr, fds[done], "", AT_EMPTY_PATH | AT_RECURSIVE, &attr, sizeof(attr)) != 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_MOUNT_SETATTR, start, done);
+
+    start = monotonic_ns();
+    for (done = 0; done < trees; ++done) {
+        snprintf(name, sizeof(name), "d%u", done);
+        if (syscall(SYS_move_mount, fds[done], "", dir_fd, name, MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+            break;
+        }
+    }
+    sysops_measured(costs, SYSOPS_MOVE_MOUNT, start, done);
+    unsigned int moved = done;
+
+    for (unsigned int i = 0; i < trees; ++i) {
+        close(fds[i]);
+    }
+    for (unsigned int i = 0; i < moved; ++i) {
+        snprintf(path, sizeof(path), "%s/d%u", dir, i);
+        umount2(path, MNT_DETACH);
+    }
+    free(fds);
+
+    /* 計測に使用したパスを削除する. */
+    int root_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd >= 0) {
+        for (unsigned int i = 0; i < iterations; ++i) {
+            snprintf(name, sizeof(name), "d%u", i);
+            unlinkat(root_fd, name, AT_REMOVEDIR);
+            snprintf(name, sizeof(name), "f%u", i);
+            unlinkat(root_fd, name, 0);
+        }
+        for (unsigned int i = 0; i < nodes; ++i) {
+            snprintf(name, sizeof(name), "n%u", i);
+            unlinkat(root_fd, name, 0);
+        }
+        close(root_fd);
+    }
+    close(dir_fd);
+
+    return 0;
+}
+
+/**
+ *  @details    操作の種別毎のコストをファイルから読み込む.
+ *              ファイルに無い種別は, 既定値とする.
+ *
+ *  @param      [in]    pathname    ファイルのパス.
+ *  @param      [out]   costs       コストの格納先.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_load_costs(const char *pathname, struct sysops_costs *costs)
+{
+    char line[128];
+    char name[64];
+    uint64_t ns;
+
+    if ((pathname == NULL) || (costs == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    sysops_default_costs(costs);
+
+    FILE *fp = fopen(pathname, "re");
+    if (fp == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if ((line[0] == '#') || (sscanf(line, "%63s %" SCNu64, name, &ns) != 2)) {
+            continue;
+        }
+        int kind = sysops_kind_by_name(name);
+        if (kind >= 0) {
+            costs->ns[kind] = ns;
+            costs->measured |= 1U << kind;
+        }
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+/**
+ *  @details    計測した操作の種別のコストをファイルに保存する.
+ *
+ *  @param      [in]    pathname    ファイルのパス.
+ *  @param      [in]    costs       コスト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int sysops_save_costs(const char *pathname, const struct sysops_costs *costs)
+{
+    if ((pathname == NULL) || (costs == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    FILE *fp = fopen(pathname, "we");
+    if (fp == NULL) {
+        return -1;
+    }
+    fprintf(fp, "# <operation> <ns>\n");
+    for (unsigned int i = 0; i < SYSOPS_KINDS; ++i) {
+        if (costs->measured & (1U << i)) {
+            fprintf(fp, "%s %" PRIu64 "\n", sysops_kinds[i].name, costs->ns[i]);
+        }
+    }
+    if (fclose(fp) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
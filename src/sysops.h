@@ -0,0 +1,265 @@
+/** @file       sysops.h
+ *  @brief      rootfs の構築に使用するシステムコールの呼び出し口を提供する.
+ *
+ *  jail の rootfs を構築するシステムコールは, 全てこのモジュールを経由して
+ *  発行する. 記録を開始すると, システムコールを発行せずに操作の列として
+ *  記録するため, 権限無しで rootfs の構築を試行 (ドライラン) できる.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_SYSOPS_H__
+#define __ALCATRAZ_SYSOPS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** @defgroup cat_sysops System call operations
+ *  rootfs の構築に使用するシステムコールを発行または記録するモジュール.
+ *  @{
+ */
+
+/**
+ *  操作の種別: open.
+ */
+#define SYSOPS_OPEN (0)
+
+/**
+ *  操作の種別: openat.
+ */
+#define SYSOPS_OPENAT (1)
+
+/**
+ *  操作の種別: openat2.
+ */
+#define SYSOPS_OPENAT2 (2)
+
+/**
+ *  操作の種別: mkdirat.
+ */
+#define SYSOPS_MKDIRAT (3)
+
+/**
+ *  操作の種別: mknodat.
+ */
+#define SYSOPS_MKNODAT (4)
+
+/**
+ *  操作の種別: fchownat.
+ */
+#define SYSOPS_FCHOWNAT (5)
+
+/**
+ *  操作の種別: fchown.
+ */
+#define SYSOPS_FCHOWN (6)
+
+/**
+ *  操作の種別: close.
+ */
+#define SYSOPS_CLOSE (7)
+
+/**
+ *  操作の種別: mount.
+ */
+#define SYSOPS_MOUNT (8)
+
+/**
+ *  操作の種別: umount2.
+ */
+#define SYSOPS_UMOUNT2 (9)
+
+/**
+ *  操作の種別: open_tree.
+ */
+#define SYSOPS_OPEN_TREE (10)
+
+/**
+ *  操作の種別: mount_setattr.
+ */
+#define SYSOPS_MOUNT_SETATTR (11)
+
+/**
+ *  操作の種別: move_mount.
+ */
+#define SYSOPS_MOVE_MOUNT (12)
+
+/**
+ *  操作の種別の数.
+ */
+#define SYSOPS_KINDS (13)
+
+/**
+ *  記録器型.
+ */
+typedef struct {} *SYSOPS_RECORDER;
+
+/**
+ *  記録した操作.
+ */
+struct sysops_op {
+    unsigned int kind;  /**< 操作の種別 (SYSOPS_*). */
+    const char *path;   /**< 操作の対象のパス. */
+    const char *source; /**< マウント元のパスまたはファイルシステムの種別. (無い場合は NULL) */
+    int error;          /**< 失敗した場合の errno. (成功した場合は 0) */
+    bool create;        /**< パスを作成する操作か. */
+};
+
+/**
+ *  操作の種別毎のコスト.
+ */
+struct sysops_costs {
+    uint64_t ns[SYSOPS_KINDS]; /**< 1 回の操作に要する時間 (ナノ秒). */
+    unsigned int measured;     /**< 計測した種別のビットマスク. */
+};
+
+/**
+ *  操作の種別の名称を取得する.
+ */
+const char *sysops_kind_name(unsigned int kind);
+
+/**
+ *  操作の種別を名称から取得する.
+ */
+int sysops_kind_by_name(const char *name);
+
+/**
+ *  操作の記録を開始する.
+ *
+ *  @par    使用例
+ *          @code
+ *          SYSOPS_RECORDER recorder = sysops_record_start();
+ *          DIR_TREE tree = dir_tree_open("/tmp/chroot-XXXXXX", uid, gid, 0755);
+ *          dir_tree_mkdir(tree, "/usr/lib", 0755);
+ *          dir_tree_close(tree);
+ *          sysops_record_stop(recorder);
+ *
+ *          size_t count;
+ *          const struct sysops_op *ops = sysops_recorded(recorder, &count);
+ *          // do something.
+ *          sysops_recorder_release(recorder);
+ *          @endcode
+ */
+SYSOPS_RECORDER sysops_record_start(void);
+
+/**
+ *  操作の記録を終了し, システムコールの発行に戻す.
+ */
+void sysops_record_stop(SYSOPS_RECORDER recorder);
+
+/**
+ *  記録器を解放する.
+ */
+void sysops_recorder_release(SYSOPS_RECORDER recorder);
+
+/**
+ *  記録した操作を取得する.
+ */
+const struct sysops_op *sysops_recorded(SYSOPS_RECORDER recorder, size_t *count);
+
+/**
+ *  操作を記録中かどうかを判定する.
+ */
+bool sysops_recording(void);
+
+/**
+ *  パスを開く.
+ */
+int sysops_open(const char *pathname, int flags, mode_t mode);
+
+/**
+ *  ディレクトリ fd からの相対パスを開く.
+ */
+int sysops_openat(int dirfd, const char *pathname, int flags, mode_t mode);
+
+/**
+ *  ディレクトリ fd からの相対パスを, 解決の制限付きで開く.
+ */
+int sysops_openat2(int dirfd, const char *pathname, uint64_t flags, uint64_t resolve);
+
+/**
+ *  ディレクトリを作成する.
+ */
+int sysops_mkdirat(int dirfd, const char *pathname, mode_t mode);
+
+/**
+ *  デバイスファイルを作成する.
+ */
+int sysops_mknodat(int dirfd, const char *pathname, mode_t mode, dev_t dev);
+
+/**
+ *  パスの所有者を変更する.
+ */
+int sysops_fchownat(int dirfd, const char *pathname, uid_t owner, gid_t group, int flags);
+
+/**
+ *  ファイル記述子の所有者を変更する.
+ */
+int sysops_fchown(int fd, uid_t owner, gid_t group);
+
+/**
+ *  ファイル記述子を閉じる.
+ */
+int sysops_close(int fd);
+
+/**
+ *  ファイルシステムをマウントする.
+ */
+int sysops_mount(const char *source,
+                 const char *target,
+                 const char *fstype,
+                 unsigned long flags,
+                 const void *data);
+
+/**
+ *  ファイルシステムをアンマウントする.
+ */
+int sysops_umount2(const char *target, int flags);
+
+/**
+ *  マウントツリーを開く.
+ */
+int sysops_open_tree(int dirfd, const char *pathname, unsigned int flags);
+
+/**
+ *  マウントツリーの属性を変更する.
+ */
+int sysops_mount_setattr(int dirfd, const char *pathname, unsigned int flags, void *attr, size_t size);
+
+/**
+ *  マウントツリーを取り付ける.
+ */
+int sysops_move_mount(int from_dirfd,
+                      const char *from_pathname,
+                      int to_dirfd,
+                      const char *to_pathname,
+                      unsigned int flags);
+
+/**
+ *  操作の種別毎のコストの既定値を取得する.
+ */
+void sysops_default_costs(struct sysops_costs *costs);
+
+/**
+ *  操作の種別毎のコストを計測する.
+ */
+int sysops_calibrate(const char *dir, unsigned int iterations, struct sysops_costs *costs);
+
+/**
+ *  操作の種別毎のコストをファイルから読み込む.
+ */
+int sysops_load_costs(const char *pathname, struct sysops_costs *costs);
+
+/**
+ *  操作の種別毎のコストをファイルに保存する.
+ */
+int sysops_save_costs(const char *pathname, const struct sysops_costs *costs);
+
+/** @} */
+
+#endif /* __ALCATRAZ_SYSOPS_H__ */
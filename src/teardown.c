@@ -0,0 +1,1409 @@
+/** @file       teardown.c
+ *  @brief      使用済み jail の非同期な破棄を提供する.
+ *
+ *  破棄キューは次の構成のディレクトリで管理する.
+ *  - `<path>/jails/`           使用中の jail のマニフェスト.
+ *  - `<path>/queue/`           破棄待ちの jail のマニフェスト.
+ *  - `<path>/workers/<n>.lock` ワーカの同時実行数を制限するロックファイル.
+ *  - `<path>/stats`            破棄した jail の数と所要時間.
+ *  - `<path>/reap.lock`        回収処理の排他用ロックファイル.
+ *  - `<path>/reap.stamp`       前回の回収処理の時刻.
+ *
+ *  マニフェストは 1 行に 1 つずつ "mount <path>", "bind <path>",
+ *  "fifo <path>" を記録したテキストファイルとする. jail を使用するプロセスが
+ *  参照する属性は "set <key> <value>" として記録し, 破棄には使用しない.
+ *  ワーカは破棄待ちのマニフェストを先頭に '.' を付けた名前に rename して
+ *  取得するため, 複数のワーカが同じ jail を重複して破棄することはない.
+ *
+ *  使用中の jail のマニフェストは, jail を管理するプロセスが flock で
+ *  ロックし続ける. ロックされていないマニフェストは管理するプロセスが
+ *  異常終了したものとして, 回収処理 (@ref teardown_reap) が破棄する.
+ *  jail プールの jail は, 未使用を示すマーカファイルがある間は回収しない.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for F_OFD_SETLK */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "teardown.h"
+#include "pool.h"
+#include "collections.h"
+#include "fsutil.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  破棄キュー管理ディレクトリのアクセス権限.
+ */
+#define TEARDOWN_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  破棄キュー管理構造体.
+ */
+struct teardown {
+    char path[PATH_MAX]; /**< 破棄キューのディレクトリのパス. */
+    int dir_fd;          /**< 破棄キューのディレクトリのファイル記述子. */
+};
+
+/**
+ *  jail マニフェスト構造体.
+ */
+struct jail_manifest {
+    int fd;                  /**< マニフェストのファイル記述子. */
+    char name[NAME_MAX + 1]; /**< マニフェストの名前. */
+};
+
+/**
+ *  マニフェストの名前として使用できるかを判定する.
+ */
+static bool is_valid_name(const char *name)
+{
+    return (name != NULL)
+        && (name[0] != '\0')
+        && (name[0] != '.')
+        && (strchr(name, '/') == NULL)
+        && (strlen(name) <= NAME_MAX);
+}
+
+/**
+ *  統計情報を更新する.
+ *
+ *  @param  [in]    self        破棄キューオブジェクト.
+ *  @param  [in]    done        破棄した jail の数の増分.
+ *  @param  [in]    elapsed_us  所要時間の増分.
+ *  @param  [out]   stats       更新後の統計情報. (NULL 可)
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int update_stats(struct teardown *self,
+                        uint64_t done,
+                        uint64_t elapsed_us,
+                        struct teardown_stats *stats)
+{
+    int fd = openat(self->dir_fd, "stats", O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/stats)", strerror(errno), self->path);
+        return -1;
+    }
+    if (flock(fd, LOCK_EX) != 0) {
+        DEBUG("flock: %s (%s/stats)", strerror(errno), self->path);
+        close(fd);
+        return -1;
+    }
+
+    char buf[128] = {0};
+    uint64_t cur_done = 0, cur_elapsed_us = 0;
+    if (pread(fd, buf, sizeof(buf) - 1, 0) > 0) {
+        sscanf(buf, "done %" SCNu64 "\nelapsed_us %" SCNu64, &cur_done, &cur_elapsed_us);
+    }
+    cur_done += done;
+    cur_elapsed_us += elapsed_us;
+
+    if (done != 0) {
+        int length = snprintf(buf, sizeof(buf),
+                              "done %" PRIu64 "\nelapsed_us %" PRIu64 "\n",
+                              cur_done, cur_elapsed_us);
+        if ((ftruncate(fd, 0) != 0) || (pwrite(fd, buf, length, 0) != length)) {
+            DEBUG("pwrite: %s (%s/stats)", strerror(errno), self->path);
+        }
+    }
+    close(fd);
+
+    if (stats != NULL) {
+        stats->done = cur_done;
+        stats->elapsed_us = cur_elapsed_us;
+    }
+
+    return 0;
+}
+
+/**
+ *  ワーカのロックファイルを開く.
+ */
+static int open_worker_lock(struct teardown *self, int slot)
+{
+    char name[32];
+
+    snprintf(name, sizeof(name), "workers/%d.lock", slot);
+    int fd = openat(self->dir_fd, name, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/%s)", strerror(errno), self->path, name);
+    }
+
+    return fd;
+}
+
+/**
+ *  空いているワーカの枠を取得する.
+ *
+ *  枠は open file description 単位のロックで表し, ワーカが異常終了した
+ *  場合でも枠は自動的に解放される.
+ *
+ *  @return 成功時はロックを取得したファイル記述子が返り,
+ *          空きが無い場合および失敗時は -1 が返る.
+ */
+static int acquire_worker_slot(struct teardown *self)
+{
+    for (int i = 0; i < TEARDOWN_WORKERS_MAX; ++i) {
+        int fd = open_worker_lock(self, i);
+        if (fd < 0) {
+            return -1;
+        }
+        struct flock lock = {
+            .l_type = F_WRLCK,
+            .l_whence = SEEK_SET,
+            .l_start = 0,
+            .l_len = 0,
+        };
+        if (fcntl(fd, F_OFD_SETLK, &lock) == 0) {
+            return fd;
+        }
+        close(fd);
+    }
+
+    errno = EBUSY;
+    return -1;
+}
+
+/**
+ *  動作中のワーカの数を数える.
+ */
+static size_t count_workers(struct teardown *self)
+{
+    size_t count = 0;
+
+    for (int i = 0; i < TEARDOWN_WORKERS_MAX; ++i) {
+        int fd = open_worker_lock(self, i);
+        if (fd < 0) {
+            continue;
+        }
+        struct flock lock = {
+            .l_type = F_WRLCK,
+            .l_whence = SEEK_SET,
+            .l_start = 0,
+            .l_len = 0,
+        };
+        if ((fcntl(fd, F_OFD_GETLK, &lock) == 0) && (lock.l_type != F_UNLCK)) {
+            ++count;
+        }
+        close(fd);
+    }
+
+    return count;
+}
+
+/**
+ *  破棄待ちのマニフェストのディレクトリを開く.
+ */
+static DIR *open_queue_dir(struct teardown *self)
+{
+    int fd = openat(self->dir_fd, "queue", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/queue)", strerror(errno), self->path);
+        return NULL;
+    }
+
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        DEBUG("fdopendir: %s (%s/queue)", strerror(errno), self->path);
+        close(fd);
+    }
+
+    return dir;
+}
+
+/**
+ *  破棄待ちの jail の数を数える.
+ *
+ *  @param  [in]    self    破棄キューオブジェクト.
+ *  @param  [in]    claimed ワーカが破棄中の jail も数えるか.
+ *  @return 成功時は jail の数が返り, 失敗時は -1 が返る.
+ */
+static ssize_t count_queued(struct teardown *self, bool claimed)
+{
+    DIR *dir = open_queue_dir(self);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    ssize_t count = 0;
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+            continue;
+        }
+        if (claimed || (ent->d_name[0] != '.')) {
+            ++count;
+        }
+    }
+    closedir(dir);
+
+    return count;
+}
+
+/**
+ *  破棄待ちの jail を 1 つ取得する.
+ *
+ *  @param  [in]    self    破棄キューオブジェクト.
+ *  @param  [out]   entry   取得したマニフェストの, 破棄キューからの相対パス.
+ *  @param  [in]    length  @c entry の長さ.
+ *  @return 取得できた場合は 0 が返り, 破棄待ちの jail が無い場合は -1 が返る.
+ */
+static int claim_one(struct teardown *self, char *entry, size_t length)
+{
+    DIR *dir = open_queue_dir(self);
+    if (dir == NULL) {
+        return -1;
+    }
+
+    int ret = -1;
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        char queued[NAME_MAX + 8];
+        snprintf(queued, sizeof(queued), "queue/%s", ent->d_name);
+        snprintf(entry, length, "queue/.%s", ent->d_name);
+        if (renameat(self->dir_fd, queued, self->dir_fd, entry) == 0) {
+            ret = 0;
+            break;
+        }
+        /* 他のワーカが先に取得した. */
+    }
+    closedir(dir);
+
+    return ret;
+}
+
+/**
+ *  マニフェストの 1 行から, 指定の種別のパスを取り出す.
+ *
+ *  @return 種別が一致する場合はパスが返り, 一致しない場合は NULL が返る.
+ */
+static const char *manifest_line_path(const char *line, const char *kind)
+{
+    size_t length = strlen(kind);
+
+    if ((strncmp(line, kind, length) == 0) && (line[length] == ' ')) {
+        return line + length + 1;
+    }
+    return NULL;
+}
+
+/**
+ *  マニフェストの内容を読み込む.
+ *
+ *  @param  [in]    self    破棄キューオブジェクト.
+ *  @param  [in]    entry   マニフェストの, 破棄キューからの相対パス.
+ *  @return 成功時は NUL 終端した内容が返り, 失敗時は NULL が返る.
+ *          内容は free で解放すること.
+ */
+static char *read_manifest(struct teardown *self, const char *entry)
+{
+    struct stat status;
+
+    int fd = openat(self->dir_fd, entry, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/%s)", strerror(errno), self->path, entry);
+        return NULL;
+    }
+    if (fstat(fd, &status) != 0) {
+        DEBUG("fstat: %s (%s/%s)", strerror(errno), self->path, entry);
+        close(fd);
+        return NULL;
+    }
+    char *data = malloc(status.st_size + 1);
+    if (data == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    ssize_t length = pread(fd, data, status.st_size, 0);
+    close(fd);
+    if (length < 0) {
+        DEBUG("pread: %s (%s/%s)", strerror(errno), self->path, entry);
+        free(data);
+        return NULL;
+    }
+    data[length] = '\0';
+
+    return data;
+}
+
+/**
+ *  マニフェストに従って jail を破棄する.
+ *
+ *  バインドは取り付けた順の逆に切り離し, 次に jail の tmpfs (雛形を使用した
+ *  場合は overlayfs と tmpfs) を切り離してから, ディレクトリと FIFO を削除する.
+ *  既に存在しないものは破棄済みとして扱う.
+ */
+static int dismantle(struct teardown *self, const char *entry)
+{
+    char *data = read_manifest(self, entry);
+    if (data == NULL) {
+        return -1;
+    }
+
+    size_t count = 0;
+    for (char *p = data; *p != '\0'; ++p) {
+        if (*p == '\n') {
+            ++count;
+        }
+    }
+    const char **lines = calloc(count + 1, sizeof(*lines));
+    if (lines == NULL) {
+        free(data);
+        errno = ENOMEM;
+        return -1;
+    }
+    count = 0;
+    for (char *save = NULL, *line = strtok_r(data, "\n", &save);
+         line != NULL;
+         line = strtok_r(NULL, "\n", &save)) {
+
+        lines[count++] = line;
+    }
+
+    const char *path;
+    for (size_t i = count; i > 0; --i) {
+        if (((path = manifest_line_path(lines[i - 1], "bind")) != NULL)
+            && (umount2(path, MNT_DETACH) != 0)
+            && (errno != EINVAL) && (errno != ENOENT)) {
+
+            DEBUG("umount2: %s (%s)", strerror(errno), path);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if ((path = manifest_line_path(lines[i], "mount")) != NULL) {
+            while (umount2(path, MNT_DETACH) == 0) {
+                continue;
+            }
+            if ((rmdir(path) != 0) && (errno != ENOENT)) {
+                DEBUG("rmdir: %s (%s)", strerror(errno), path);
+            }
+        } else if ((path = manifest_line_path(lines[i], "fifo")) != NULL) {
+            if ((unlink(path) != 0) && (errno != ENOENT)) {
+                DEBUG("unlink: %s (%s)", strerror(errno), path);
+            }
+        }
+    }
+    free(lines);
+    free(data);
+
+    if (unlinkat(self->dir_fd, entry, 0) != 0) {
+        DEBUG("unlinkat: %s (%s/%s)", strerror(errno), self->path, entry);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    破棄キューのディレクトリを作成し, @ref TEARDOWN オブジェクトを
+ *              確保および初期化する.
+ *
+ *  @param      [in]    path    破棄キューのディレクトリのパス.
+ *  @return     成功時は, 確保および初期化したオブジェクトのポインタが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+TEARDOWN teardown_open(const char *path)
+{
+    static const char * const subdirs[] = {
+        "jails",
+        "queue",
+        "workers",
+    };
+
+    if (path == NULL) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct teardown *self = malloc(sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    strncpy(self->path, path, sizeof(self->path) - 1);
+    self->path[sizeof(self->path) - 1] = '\0';
+
+    char dir[PATH_MAX + 8];
+    for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); ++i) {
+        snprintf(dir, sizeof(dir), "%s/%s", self->path, subdirs[i]);
+        if (make_directories(dir, TEARDOWN_DIR_PERM) != 0) {
+            DEBUG("mkdir: %s (%s)", strerror(errno), dir);
+            free(self);
+            return NULL;
+        }
+    }
+
+    self->dir_fd = open(self->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (self->dir_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), self->path);
+        free(self);
+        return NULL;
+    }
+
+    return (TEARDOWN)self;
+}
+
+/**
+ *  @details    @c teardown を閉じる.
+ *              破棄待ちの jail はキューに残る.
+ *
+ *  @param      [in,out]    teardown    破棄キューオブジェクト.
+ */
+void teardown_close(TEARDOWN teardown)
+{
+    struct teardown *self = (struct teardown *)teardown;
+
+    if (self != NULL) {
+        close(self->dir_fd);
+        free(self);
+    }
+}
+
+/**
+ *  バックグラウンドで実行する処理の型.
+ */
+typedef int (*teardown_task)(struct teardown *self, void *arg);
+
+/**
+ *  呼び出し元から切り離したプロセスで処理を実行する.
+ *
+ *  呼び出し元は処理の完了を待たない.
+ */
+static int spawn_detached(struct teardown *self, teardown_task task, void *arg)
+{
+    pid_t pid = fork();
+    if (pid < 0) {
+        DEBUG("fork: %s", strerror(errno));
+        return -1;
+    } else if (pid == 0) {
+        if (fork() == 0) {
+            setsid();
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, STDIN_FILENO);
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                close(null_fd);
+            }
+            /* 呼び出し元の端末やパイプを, 処理が終わるまで開いたままにしない. */
+            close_inherited_fds(self->dir_fd);
+            _exit((task(self, arg) == 0) ? 0 : 1);
+        }
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+
+    return 0;
+}
+
+/**
+ *  切り離したプロセスで, 破棄キューの jail を全て破棄する.
+ */
+static int run_task(struct teardown *self, void *arg)
+{
+    (void)arg;
+    return teardown_run((TEARDOWN)self);
+}
+
+/**
+ *  @details    @c mount_point に構築する jail のマニフェストを作成する.
+ *              マニフェストの名前は @c mount_point の最後の要素とする.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @param      [in]    mount_point jail のパス.
+ *  @return     成功時は, マニフェストオブジェクトが返る.
+ *              失敗時は, NULL が返り, errno が適切に設定される.
+ */
+JAIL_MANIFEST jail_manifest_create(TEARDOWN teardown, const char *mount_point)
+{
+    struct teardown *owner = (struct teardown *)teardown;
+
+    if ((owner == NULL) || (mount_point == NULL)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    const char *name = strrchr(mount_point, '/');
+    name = (name != NULL) ? name + 1 : mount_point;
+    if (!is_valid_name(name)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    struct jail_manifest *self = malloc(sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    strncpy(self->name, name, sizeof(self->name) - 1);
+    self->name[sizeof(self->name) - 1] = '\0';
+
+    /* ロックを取得するまでは, 回収処理から見えない名前で作成する. */
+    char entry[NAME_MAX + 8];
+    char live[NAME_MAX + 8];
+    snprintf(entry, sizeof(entry), "jails/.%s", self->name);
+    snprintf(live, sizeof(live), "jails/%s", self->name);
+    self->fd = openat(owner->dir_fd,
+                      entry,
+                      O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                      S_IRUSR | S_IWUSR);
+    if (self->fd < 0) {
+        DEBUG("openat: %s (%s/%s)", strerror(errno), owner->path, entry);
+        free(self);
+        return NULL;
+    }
+
+    char line[PATH_MAX + 8];
+    int length = snprintf(line, sizeof(line), "mount %s\n", mount_point);
+    if ((flock(self->fd, LOCK_EX) != 0)
+        || (length >= (int)sizeof(line))
+        || (write(self->fd, line, length) != length)
+        || (renameat(owner->dir_fd, entry, owner->dir_fd, live) != 0)) {
+
+        DEBUG("manifest: %s (%s/%s)", strerror(errno), owner->path, entry);
+        unlinkat(owner->dir_fd, entry, 0);
+        close(self->fd);
+        free(self);
+        return NULL;
+    }
+
+    return (JAIL_MANIFEST)self;
+}
+
+/**
+ *  マニフェストに 1 行追加する.
+ */
+static int manifest_add(struct jail_manifest *self, const char *kind, const char *path)
+{
+    if ((self == NULL) || (path == NULL) || (strchr(path, '\n') != NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char line[PATH_MAX + 8];
+    int length = snprintf(line, sizeof(line), "%s %s\n", kind, path);
+    if (length >= (int)sizeof(line)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (write(self->fd, line, length) != length) {
+        DEBUG("write: %s (%s)", strerror(errno), self->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ *  @details    jail に取り付けたバインドを @c manifest に記録する.
+ *              破棄時は, 記録した順の逆に切り離す.
+ *
+ *  @param      [in]    manifest    マニフェストオブジェクト.
+ *  @param      [in]    path        バインドを取り付けたパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int jail_manifest_add_bind(JAIL_MANIFEST manifest, const char *path)
+{
+    return manifest_add((struct jail_manifest *)manifest, "bind", path);
+}
+
+/**
+ *  @details    jail で使用する FIFO を @c manifest に記録する.
+ *
+ *  @param      [in]    manifest    マニフェストオブジェクト.
+ *  @param      [in]    path        FIFO のパス.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int jail_manifest_add_fifo(JAIL_MANIFEST manifest, const char *path)
+{
+    return manifest_add((struct jail_manifest *)manifest, "fifo", path);
+}
+
+/**
+ *  @details    jail の属性 @c key を @c manifest に記録する.
+ *              マニフェストは root のみが読み書きできるため, jail の中の
+ *              プロセスには改ざんされない. 同じ @c key は複数回記録できる.
+ *
+ *  @param      [in]    manifest    マニフェストオブジェクト.
+ *  @param      [in]    key         属性の名前. (空白と改行を含まない)
+ *  @param      [in]    value       属性の値. (改行を含まない)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int jail_manifest_set(JAIL_MANIFEST manifest, const char *key, const char *value)
+{
+    if ((key == NULL) || (key[0] == '\0') || (strpbrk(key, " \n") != NULL) || (value == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char line[PATH_MAX + NAME_MAX];
+    int length = snprintf(line, sizeof(line), "%s %s", key, value);
+    if (length >= (int)sizeof(line)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    return manifest_add((struct jail_manifest *)manifest, "set", line);
+}
+
+/**
+ *  @details    @c manifest の名前を取得する.
+ *              @ref teardown_submit には, この名前を指定する.
+ *
+ *  @param      [in]    manifest    マニフェストオブジェクト.
+ *  @return     マニフェストの名前が返る.
+ */
+const char *jail_manifest_name(JAIL_MANIFEST manifest)
+{
+    return ((struct jail_manifest *)manifest)->name;
+}
+
+/**
+ *  @details    @c manifest を閉じる.
+ *              マニフェストのファイルは, 破棄を依頼するまで残る.
+ *
+ *  @param      [in,out]    manifest    マニフェストオブジェクト.
+ */
+void jail_manifest_close(JAIL_MANIFEST manifest)
+{
+    struct jail_manifest *self = (struct jail_manifest *)manifest;
+
+    if (self != NULL) {
+        close(self->fd);
+        free(self);
+    }
+}
+
+/**
+ *  @details    使用中の jail @c name の属性を, 記録した順に @c visitor に渡す.
+ *              破棄待ちの jail や, 管理するプロセスが異常終了した jail は
+ *              対象外とする.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @param      [in]    name        マニフェストの名前.
+ *  @param      [in]    visitor     属性を通知する関数.
+ *  @param      [in]    arg         @c visitor に渡す引数.
+ *  @return     全て走査した場合は, 0 が返る.
+ *              @c visitor が中断した場合は, その戻り値が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              (使用中の jail が無い場合は ESRCH)
+ */
+int teardown_visit_jail(TEARDOWN teardown, const char *name, jail_attr_visitor visitor, void *arg)
+{
+    struct teardown *self = (struct teardown *)teardown;
+
+    if ((self == NULL) || !is_valid_name(name) || (visitor == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char live[NAME_MAX + 8];
+    snprintf(live, sizeof(live), "jails/%s", name);
+    int fd = openat(self->dir_fd, live, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        errno = (errno == ENOENT) ? ESRCH : errno;
+        return -1;
+    }
+    /* 管理するプロセスがロックしていなければ, jail は使用されていない. */
+    bool unused = (flock(fd, LOCK_SH | LOCK_NB) == 0);
+    close(fd);
+    if (unused) {
+        errno = ESRCH;
+        return -1;
+    }
+
+    char *data = read_manifest(self, live);
+    if (data == NULL) {
+        return -1;
+    }
+    int ret = 0;
+    for (char *save = NULL, *line = strtok_r(data, "\n", &save);
+         (line != NULL) && (ret == 0);
+         line = strtok_r(NULL, "\n", &save)) {
+
+        char *key = (char *)manifest_line_path(line, "set");
+        char *value = (key != NULL) ? strchr(key, ' ') : NULL;
+        if (value != NULL) {
+            *value++ = '\0';
+            ret = visitor(arg, key, value);
+        }
+    }
+    free(data);
+
+    return ret;
+}
+
+/**
+ *  @details    @c name の jail をキューに移し, バックグラウンドのワーカに
+ *              破棄させる. ワーカが既に上限まで動作中の場合は, 動作中の
+ *              ワーカが破棄する. 呼び出し元は破棄の完了を待たない.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @param      [in]    name        マニフェストの名前.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int teardown_submit(TEARDOWN teardown, const char *name)
+{
+    struct teardown *self = (struct teardown *)teardown;
+
+    if ((self == NULL) || !is_valid_name(name)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char live[NAME_MAX + 8];
+    char queued[NAME_MAX + 8];
+    snprintf(live, sizeof(live), "jails/%s", name);
+    snprintf(queued, sizeof(queued), "queue/%s", name);
+    if (renameat(self->dir_fd, live, self->dir_fd, queued) != 0) {
+        DEBUG("renameat: %s (%s/%s)", strerror(errno), self->path, live);
+        return -1;
+    }
+
+    return spawn_detached(self, run_task, NULL);
+}
+
+/**
+ *  @details    ワーカの枠が空いていれば, 破棄待ちの jail が無くなるまで
+ *              破棄を行う. 枠が空いていない場合は, 何もせずに戻る.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int teardown_run(TEARDOWN teardown)
+{
+    struct teardown *self = (struct teardown *)teardown;
+
+    if (self == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (;;) {
+        int slot_fd = acquire_worker_slot(self);
+        if (slot_fd < 0) {
+            /* 動作中のワーカに任せる. */
+            return (errno == EBUSY) ? 0 : -1;
+        }
+
+        char entry[NAME_MAX + 8];
+        while (claim_one(self, entry, sizeof(entry)) == 0) {
+            uint64_t start = monotonic_ns();
+            dismantle(self, entry);
+            update_stats(self, 1, elapsed_us(start), NULL);
+        }
+        close(slot_fd);
+
+        /* 枠の解放前に追加された依頼を取りこぼさないよう, 解放後に確認し直す. */
+        if (count_queued(self, false) <= 0) {
+            return 0;
+        }
+    }
+}
+
+/**
+ *  @details    @c teardown の統計情報を取得する.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @param      [out]   stats       統計情報.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int teardown_get_stats(TEARDOWN teardown, struct teardown_stats *stats)
+{
+    struct teardown *self = (struct teardown *)teardown;
+
+    if ((self == NULL) || (stats == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (update_stats(self, 0, 0, stats) != 0) {
+        return -1;
+    }
+    ssize_t pending = count_queued(self, true);
+    stats->pending = (pending < 0) ? 0 : (size_t)pending;
+    stats->workers = count_workers(self);
+
+    return 0;
+}
+
+/**
+ *  jail の回収処理の状態.
+ */
+struct reaper {
+    struct teardown *owner;              /**< 破棄キューオブジェクト. */
+    const char *prefix;                  /**< 回収中の jail のパスの接頭辞. */
+    const char *ready;                   /**< 未使用の jail を示すマーカのディレクトリ. (NULL 可) */
+    const char *pool_root;               /**< jail プールのディレクトリ. (NULL 可) */
+    const char *mountinfo;               /**< mountinfo の内容. */
+    MAP live;                            /**< 使用中および破棄待ちの jail のパス. */
+    MAP orphans;                         /**< 放棄された jail のパスとマウント数. */
+    struct teardown_reap_stats *stats;   /**< 回収結果. */
+};
+
+/**
+ *  マニフェストに記録した jail のパスを取得する.
+ *
+ *  @param  [in]    self    破棄キューオブジェクト.
+ *  @param  [in]    entry   マニフェストの, 破棄キューからの相対パス.
+ *  @param  [out]   path    jail のパス.
+ *  @param  [in]    length  @c path の長さ.
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int read_manifest_mount(struct teardown *self, const char *entry, char *path, size_t length)
+{
+    char *data = read_manifest(self, entry);
+    if (data == NULL) {
+        return -1;
+    }
+
+    char *eol = strchr(data, '\n');
+    if (eol != NULL) {
+        *eol = '\0';
+    }
+    const char *mount_point = manifest_line_path(data, "mount");
+    int ret = -1;
+    if ((mount_point != NULL) && (strlen(mount_point) < length)) {
+        strcpy(path, mount_point);
+        ret = 0;
+    }
+    free(data);
+
+    return ret;
+}
+
+/**
+ *  ディレクトリ内のエントリの数を数える.
+ */
+static ssize_t count_entries(struct teardown *self, const char *subdir)
+{
+    int fd = openat(self->dir_fd, subdir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    ssize_t count = 0;
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        ++count;
+    }
+    closedir(dir);
+
+    return count;
+}
+
+/**
+ *  管理するプロセスが終了した jail のマニフェストを破棄待ちに移し,
+ *  それ以外の jail のパスを使用中として記録する.
+ *  破棄待ちに移した jail のマウントは, 放棄された jail として回収する.
+ *
+ *  ワーカが動作していない場合, 破棄中のまま残ったマニフェストも
+ *  破棄待ちに戻す.
+ */
+static int collect_manifests(struct reaper *self, const char *subdir)
+{
+    struct teardown *owner = self->owner;
+    bool requeue_claimed = (strcmp(subdir, "queue") == 0) && (count_workers(owner) == 0);
+
+    int fd = openat(owner->dir_fd, subdir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/%s)", strerror(errno), owner->path, subdir);
+        return -1;
+    }
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        DEBUG("fdopendir: %s (%s/%s)", strerror(errno), owner->path, subdir);
+        close(fd);
+        return -1;
+    }
+
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+            continue;
+        }
+        char entry[NAME_MAX + 16];
+        char queued[NAME_MAX + 16];
+        char path[PATH_MAX];
+        bool reclaimed = false;
+        snprintf(entry, sizeof(entry), "%s/%s", subdir, ent->d_name);
+
+        if (strcmp(subdir, "jails") == 0) {
+            if (ent->d_name[0] == '.') {
+                /* 作成中. */
+                continue;
+            }
+            int manifest_fd = openat(owner->dir_fd, entry, O_RDONLY | O_CLOEXEC);
+            if (manifest_fd < 0) {
+                continue;
+            }
+            if (flock(manifest_fd, LOCK_EX | LOCK_NB) == 0) {
+                snprintf(queued, sizeof(queued), "queue/%s", ent->d_name);
+                reclaimed = (renameat(owner->dir_fd, entry, owner->dir_fd, queued) == 0);
+            }
+            close(manifest_fd);
+        } else if (requeue_claimed && (ent->d_name[0] == '.')) {
+            snprintf(queued, sizeof(queued), "queue/%s", ent->d_name + 1);
+            reclaimed = (renameat(owner->dir_fd, entry, owner->dir_fd, queued) == 0);
+        }
+        if (reclaimed) {
+            /* マウントは mountinfo から他の放棄された jail とまとめて切り離す. */
+            ++self->stats->manifests;
+            continue;
+        }
+
+        /* 破棄待ちの jail はワーカが破棄するため, 使用中と同様に扱う. */
+        if (read_manifest_mount(owner, entry, path, sizeof(path)) == 0) {
+            map_put(self->live, path, &(char){0});
+        }
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+/**
+ *  mountinfo を読み込む.
+ *
+ *  @param  [out]   lines   行数.
+ *  @return 成功時は NUL 終端した内容が返り, 失敗時は NULL が返る.
+ */
+static char *read_mountinfo(size_t *lines)
+{
+    int fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        DEBUG("open: %s (/proc/self/mountinfo)", strerror(errno));
+        return NULL;
+    }
+
+    size_t capacity = BUFSIZ * 4;
+    size_t length = 0;
+    char *data = malloc(capacity);
+    ssize_t ret;
+    while (data != NULL) {
+        if (length + 1 >= capacity) {
+            char *p = realloc(data, capacity * 2);
+            if (p == NULL) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = p;
+            capacity *= 2;
+        }
+        ret = read(fd, data + length, capacity - length - 1);
+        if (ret <= 0) {
+            if (ret < 0) {
+                DEBUG("read: %s (/proc/self/mountinfo)", strerror(errno));
+                free(data);
+                data = NULL;
+            }
+            break;
+        }
+        length += ret;
+    }
+    close(fd);
+    if (data == NULL) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    data[length] = '\0';
+
+    *lines = 0;
+    for (const char *p = data; (p = strchr(p, '\n')) != NULL; ++p) {
+        ++*lines;
+    }
+
+    return data;
+}
+
+/**
+ *  jail プールの未使用の jail かを判定する.
+ *
+ *  未使用の jail はマニフェストを持たないため, マーカファイルの有無で判定する.
+ */
+static bool is_ready(struct reaper *self, const char *mount_point)
+{
+    char marker[PATH_MAX];
+    const char *name = strrchr(mount_point, '/');
+
+    if ((self->ready == NULL) || (name == NULL)) {
+        return false;
+    }
+    if (snprintf(marker, sizeof(marker), "%s/%s", self->ready, name + 1) >= (int)sizeof(marker)) {
+        /* 判定できない場合は, 回収しない. */
+        return true;
+    }
+
+    return access(marker, F_OK) == 0;
+}
+
+/**
+ *  mountinfo から, 使用中でない jail のマウントを数える.
+ */
+static int collect_orphan_mounts(struct reaper *self)
+{
+    size_t prefix_length = strlen(self->prefix);
+    char mount_point[PATH_MAX];
+
+    char *mountinfo = strdup(self->mountinfo);
+    if (mountinfo == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (char *save = NULL, *line = strtok_r(mountinfo, "\n", &save);
+         line != NULL;
+         line = strtok_r(NULL, "\n", &save)) {
+
+        /* マウントポイントは 5 番目のフィールド. */
+        char *field = line;
+        for (int i = 0; (i < 4) && (field != NULL); ++i) {
+            field = strchr(field, ' ');
+            if (field != NULL) {
+                ++field;
+            }
+        }
+        if (field == NULL) {
+            continue;
+        }
+        char *end = strchr(field, ' ');
+        if (end != NULL) {
+            *end = '\0';
+        }
+        unescape_mountinfo(mount_point, field, sizeof(mount_point));
+        if (strncmp(mount_point, self->prefix, prefix_length) != 0) {
+            continue;
+        }
+
+        /* jail の配下のマウントは, jail のパスにまとめる. */
+        char *sep = strchr(mount_point + prefix_length, '/');
+        if (sep != NULL) {
+            *sep = '\0';
+        }
+        if ((map_get(self->live, mount_point) != NULL) || is_ready(self, mount_point)) {
+            continue;
+        }
+        size_t *count = map_get(self->orphans, mount_point);
+        if (count != NULL) {
+            ++*count;
+        } else if (map_put(self->orphans, mount_point, &(size_t){1}) == NULL) {
+            free(mountinfo);
+            return -1;
+        }
+    }
+    free(mountinfo);
+
+    return 0;
+}
+
+/**
+ *  作成直後の jail かを判定する.
+ *
+ *  jail の作成からマニフェストの作成までの間は, 使用中の jail も
+ *  放棄された jail と区別できないため, 猶予期間の間は回収しない.
+ */
+static bool is_recent(const char *path)
+{
+    struct stat status;
+
+    if (stat(path, &status) != 0) {
+        return false;
+    }
+    time_t now = time(NULL);
+
+    return (now - status.st_ctime < TEARDOWN_REAP_GRACE)
+        || (now - status.st_mtime < TEARDOWN_REAP_GRACE);
+}
+
+/**
+ *  放棄された jail をまとめて切り離す.
+ *
+ *  jail のパスを MNT_DETACH で切り離すと, 配下のバインドや kernel 関連の
+ *  filesystem も同時に切り離される.
+ */
+static void detach_orphan(const char *key, void *payload, void *arg)
+{
+    struct reaper *self = (struct reaper *)arg;
+    size_t count = *(size_t *)payload;
+
+    if (is_recent(key)) {
+        return;
+    }
+    bool detached = false;
+    while (umount2(key, MNT_DETACH) == 0) {
+        detached = true;
+    }
+    if (!detached) {
+        DEBUG("umount2: %s (%s)", strerror(errno), key);
+        return;
+    }
+    self->stats->mounts += count;
+    if (rmdir(key) == 0) {
+        ++self->stats->directories;
+    }
+}
+
+/**
+ *  マウントが残っていない, 放棄された jail のディレクトリを削除する.
+ */
+static int remove_orphan_directories(struct reaper *self)
+{
+    char parent[PATH_MAX];
+    strncpy(parent, self->prefix, sizeof(parent) - 1);
+    parent[sizeof(parent) - 1] = '\0';
+
+    char *base = strrchr(parent, '/');
+    if ((base == NULL) || (base[1] == '\0')) {
+        return 0;
+    }
+    *base++ = '\0';
+    size_t base_length = strlen(base);
+
+    DIR *dir = opendir((parent[0] != '\0') ? parent : "/");
+    if (dir == NULL) {
+        DEBUG("opendir: %s (%s)", strerror(errno), parent);
+        return 0;
+    }
+    char path[PATH_MAX];
+    for (struct dirent *ent = readdir(dir); ent != NULL; ent = readdir(dir)) {
+        if (strncmp(ent->d_name, base, base_length) != 0) {
+            continue;
+        }
+        if ((snprintf(path, sizeof(path), "%s/%s", parent, ent->d_name) >= (int)sizeof(path))
+            || (map_get(self->live, path) != NULL)
+            || is_ready(self, path)
+            || is_recent(path)) {
+
+            continue;
+        }
+        /* 空でないディレクトリやマウントポイントは削除できない. */
+        if (rmdir(path) == 0) {
+            ++self->stats->directories;
+        }
+    }
+    closedir(dir);
+
+    return 0;
+}
+
+/**
+ *  jail プールの設定毎のディレクトリに, @c func を適用する.
+ *
+ *  各ディレクトリの jail を回収の対象とするため, @c self の接頭辞と
+ *  マーカのディレクトリを切り替えながら適用する.
+ */
+static int foreach_pool_site(struct reaper *self, int (*func)(struct reaper *self))
+{
+    if (self->pool_root == NULL) {
+        return 0;
+    }
+
+    DIR *dir = opendir(self->pool_root);
+    if (dir == NULL) {
+        /* プールを使用していない. */
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    const char *prefix = self->prefix;
+    char site[PATH_MAX];
+    char ready[PATH_MAX];
+    int ret = 0;
+    for (struct dirent *ent = readdir(dir); (ent != NULL) && (ret == 0); ent = readdir(dir)) {
+        if ((ent->d_name[0] == '.') || ((ent->d_type != DT_DIR) && (ent->d_type != DT_UNKNOWN))) {
+            continue;
+        }
+        if ((snprintf(site, sizeof(site), "%s/%s/" POOL_JAILS_DIR "/" POOL_JAIL_PREFIX,
+                      self->pool_root, ent->d_name) >= (int)sizeof(site))
+            || (snprintf(ready, sizeof(ready), "%s/%s/" POOL_READY_DIR,
+                         self->pool_root, ent->d_name) >= (int)sizeof(ready))) {
+
+            continue;
+        }
+        self->prefix = site;
+        self->ready = ready;
+        ret = func(self);
+    }
+    closedir(dir);
+    self->prefix = prefix;
+    self->ready = NULL;
+
+    return ret;
+}
+
+/**
+ *  @details    管理するプロセスが異常終了した jail を回収する.
+ *              ロックされていないマニフェストの jail を破棄し, さらに
+ *              マニフェストの無い jail のマウントを /proc/self/mountinfo から
+ *              探して, まとめて切り離す.
+ *              @c pool_root を指定した場合は, jail プールの jail のうち,
+ *              未使用のマーカもマニフェストも無いものも回収する.
+ *              作成から @ref TEARDOWN_REAP_GRACE 秒以内の jail は回収しない.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @param      [in]    prefix      jail のパスの接頭辞. (例: "/tmp/alctrz/chroot-")
+ *  @param      [in]    pool_root   jail プールのディレクトリ. (NULL 可)
+ *  @param      [out]   stats       回収結果. (NULL 可)
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int teardown_reap(TEARDOWN teardown,
+                  const char *prefix,
+                  const char *pool_root,
+                  struct teardown_reap_stats *stats)
+{
+    struct teardown *owner = (struct teardown *)teardown;
+    struct teardown_reap_stats dummy;
+
+    if ((owner == NULL) || (prefix == NULL) || (prefix[0] != '/')) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (stats == NULL) {
+        stats = &dummy;
+    }
+    *stats = (struct teardown_reap_stats){0};
+    uint64_t start = monotonic_ns();
+
+    /* 回収処理は同時に 1 つのみ. */
+    int lock_fd = openat(owner->dir_fd, "reap.lock", O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if ((lock_fd < 0) || (flock(lock_fd, LOCK_EX) != 0)) {
+        DEBUG("reap.lock: %s (%s)", strerror(errno), owner->path);
+        if (lock_fd >= 0) {
+            close(lock_fd);
+        }
+        return -1;
+    }
+
+    size_t lines = 0;
+    char *mountinfo = read_mountinfo(&lines);
+    ssize_t jails = count_entries(owner, "jails");
+    ssize_t queued = count_entries(owner, "queue");
+    struct reaper self = {
+        .owner = owner,
+        .prefix = prefix,
+        .ready = NULL,
+        .pool_root = pool_root,
+        .mountinfo = mountinfo,
+        .live = map_init(sizeof(char), ((jails > 0) ? jails : 0) + ((queued > 0) ? queued : 0) + 1),
+        .orphans = map_init(sizeof(size_t), lines + 1),
+        .stats = stats,
+    };
+    int ret = -1;
+
+    if ((mountinfo != NULL) && (self.live != NULL) && (self.orphans != NULL)
+        && (collect_manifests(&self, "queue") == 0)
+        && (collect_manifests(&self, "jails") == 0)
+        && (collect_orphan_mounts(&self) == 0)
+        && (foreach_pool_site(&self, collect_orphan_mounts) == 0)) {
+
+        map_foreach(self.orphans, detach_orphan, &self);
+        /* マニフェストのある jail は, FIFO の削除も含めてワーカと同様に破棄する. */
+        teardown_run(teardown);
+        remove_orphan_directories(&self);
+        foreach_pool_site(&self, remove_orphan_directories);
+        ret = 0;
+    }
+    map_release(self.orphans);
+    map_release(self.live);
+    free(mountinfo);
+    close(lock_fd);
+
+    stats->elapsed_us = elapsed_us(start);
+
+    return ret;
+}
+
+/**
+ *  バックグラウンドの回収処理の引数.
+ */
+struct reap_args {
+    const char *prefix;    /**< jail のパスの接頭辞. */
+    const char *pool_root; /**< jail プールのディレクトリ. (NULL 可) */
+};
+
+/**
+ *  切り離したプロセスで, 残された jail を回収する.
+ */
+static int reap_task(struct teardown *self, void *arg)
+{
+    const struct reap_args *args = (const struct reap_args *)arg;
+
+    return teardown_reap((TEARDOWN)self, args->prefix, args->pool_root, NULL);
+}
+
+/**
+ *  @details    前回の回収から @c interval 秒以上経過していれば,
+ *              バックグラウンドで @ref teardown_reap を実行する.
+ *              呼び出し元は回収の完了を待たない.
+ *
+ *  @param      [in]    teardown    破棄キューオブジェクト.
+ *  @param      [in]    prefix      jail のパスの接頭辞.
+ *  @param      [in]    pool_root   jail プールのディレクトリ. (NULL 可)
+ *  @param      [in]    interval    回収の間隔 (秒).
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int teardown_reap_async(TEARDOWN teardown,
+                        const char *prefix,
+                        const char *pool_root,
+                        unsigned int interval)
+{
+    struct teardown *self = (struct teardown *)teardown;
+    struct stat status;
+
+    if ((self == NULL) || (prefix == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((fstatat(self->dir_fd, "reap.stamp", &status, 0) == 0)
+        && (time(NULL) - status.st_mtime < (time_t)interval)) {
+
+        return 0;
+    }
+    int fd = openat(self->dir_fd, "reap.stamp", O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        DEBUG("openat: %s (%s/reap.stamp)", strerror(errno), self->path);
+        return -1;
+    }
+    futimens(fd, NULL);
+    close(fd);
+
+    /* 回収処理は fork した子プロセスで実行するため, 引数は自動変数で良い. */
+    struct reap_args args = {
+        .prefix = prefix,
+        .pool_root = pool_root,
+    };
+    return spawn_detached(self, reap_task, &args);
+}
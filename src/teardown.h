@@ -0,0 +1,162 @@
+/** @file       teardown.h
+ *  @brief      使用済み jail の非同期な破棄を提供する.
+ *
+ *  jail 毎にマウントポイント, バインド, FIFO を記録したマニフェストを作成し,
+ *  使用後はマニフェストをキューに移してバックグラウンドのワーカに破棄させる.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_TEARDOWN_H__
+#define __ALCATRAZ_TEARDOWN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @defgroup cat_teardown Teardown
+ *  使用済み jail を非同期に破棄するモジュール.
+ *  @{
+ */
+
+/**
+ *  同時に動作するワーカの最大数.
+ */
+#define TEARDOWN_WORKERS_MAX (4)
+
+/**
+ *  回収処理の対象外とする, 作成直後の jail の経過時間 (秒).
+ */
+#define TEARDOWN_REAP_GRACE (60)
+
+/**
+ *  破棄キュー型.
+ */
+typedef struct {} *TEARDOWN;
+
+/**
+ *  jail マニフェスト型.
+ */
+typedef struct {} *JAIL_MANIFEST;
+
+/**
+ *  jail の属性を通知する関数.
+ *
+ *  @return 走査を続ける場合は 0 を, 中断する場合はそれ以外を返す.
+ */
+typedef int (*jail_attr_visitor)(void *arg, const char *key, const char *value);
+
+/**
+ *  破棄キューの統計情報.
+ */
+struct teardown_stats {
+    size_t pending;      /**< 破棄待ちおよび破棄中の jail の数. */
+    size_t workers;      /**< 動作中のワーカの数. */
+    uint64_t done;       /**< 破棄した jail の数. */
+    uint64_t elapsed_us; /**< 破棄に要した時間の合計 (マイクロ秒). */
+};
+
+/**
+ *  回収処理の結果.
+ */
+struct teardown_reap_stats {
+    size_t mounts;       /**< 切り離したマウントの数. */
+    size_t manifests;    /**< 破棄待ちに移したマニフェストの数. */
+    size_t directories;  /**< 削除した jail のディレクトリの数. */
+    uint64_t elapsed_us; /**< 回収に要した時間 (マイクロ秒). */
+};
+
+/**
+ *  破棄キューを開く.
+ *
+ *  @par    使用例
+ *          @code
+ *          TEARDOWN teardown = teardown_open("/run/alctrz/teardown");
+ *          JAIL_MANIFEST manifest = jail_manifest_create(teardown, "/tmp/chroot-abcdef");
+ *          jail_manifest_add_bind(manifest, "/tmp/chroot-abcdef/bin");
+ *          jail_manifest_add_fifo(manifest, "/tmp/stdio.0");
+ *          jail_manifest_close(manifest);
+ *
+ *          // jail の使用後.
+ *          teardown_submit(teardown, "chroot-abcdef");
+ *          teardown_close(teardown);
+ *          @endcode
+ */
+TEARDOWN teardown_open(const char *path);
+
+/**
+ *  破棄キューを閉じる.
+ */
+void teardown_close(TEARDOWN teardown);
+
+/**
+ *  jail のマニフェストを作成する.
+ */
+JAIL_MANIFEST jail_manifest_create(TEARDOWN teardown, const char *mount_point);
+
+/**
+ *  jail に取り付けたバインドをマニフェストに記録する.
+ */
+int jail_manifest_add_bind(JAIL_MANIFEST manifest, const char *path);
+
+/**
+ *  jail で使用する FIFO をマニフェストに記録する.
+ */
+int jail_manifest_add_fifo(JAIL_MANIFEST manifest, const char *path);
+
+/**
+ *  jail の属性をマニフェストに記録する.
+ */
+int jail_manifest_set(JAIL_MANIFEST manifest, const char *key, const char *value);
+
+/**
+ *  マニフェストの名前を取得する.
+ */
+const char *jail_manifest_name(JAIL_MANIFEST manifest);
+
+/**
+ *  マニフェストを閉じる.
+ */
+void jail_manifest_close(JAIL_MANIFEST manifest);
+
+/**
+ *  使用中の jail の属性を走査する.
+ */
+int teardown_visit_jail(TEARDOWN teardown, const char *name, jail_attr_visitor visitor, void *arg);
+
+/**
+ *  jail の破棄を依頼する.
+ */
+int teardown_submit(TEARDOWN teardown, const char *name);
+
+/**
+ *  破棄待ちの jail を全て破棄する.
+ */
+int teardown_run(TEARDOWN teardown);
+
+/**
+ *  破棄キューの統計情報を取得する.
+ */
+int teardown_get_stats(TEARDOWN teardown, struct teardown_stats *stats);
+
+/**
+ *  管理するプロセスが異常終了した jail を回収する.
+ */
+int teardown_reap(TEARDOWN teardown,
+                  const char *prefix,
+                  const char *pool_root,
+                  struct teardown_reap_stats *stats);
+
+/**
+ *  必要であれば, バックグラウンドで jail を回収する.
+ */
+int teardown_reap_async(TEARDOWN teardown,
+                        const char *prefix,
+                        const char *pool_root,
+                        unsigned int interval);
+
+/** @} */
+
+#endif /* __ALCATRAZ_TEARDOWN_H__ */
@@ -0,0 +1,240 @@
+/** @file       template.c
+ *  @brief      jail の rootfs の雛形を提供する.
+ *
+ *  雛形は次の構成で管理する.
+ *  - `<path>/<key>/`           雛形専用の tmpfs. 構築後は読み込み専用になる.
+ *  - `<path>/<key>/lower/`     overlayfs の下位層.
+ *  - `<path>/<key>/complete`   構築が完了したことを示すマーカファイル.
+ *  - `<path>/<key>.lock`       構築処理の排他用ロックファイル.
+ *
+ *  雛形に専用の tmpfs を使用するのは, `/run` などが nodev でマウント
+ *  されていても下位層のデバイスファイルを使用できるようにするためである.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for PATH_MAX */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+
+#include "template.h"
+#include "fsutil.h"
+#include "debug.h"
+
+/**
+ *  雛形管理ディレクトリのアクセス権限.
+ */
+#define TEMPLATE_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  下位層のアクセス権限.
+ */
+#define LOWER_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)
+
+/**
+ *  上位層と作業ディレクトリのアクセス権限.
+ */
+#define UPPER_DIR_PERM (S_IRUSR | S_IWUSR | S_IXUSR)
+
+/**
+ *  雛形専用の tmpfs に雛形を構築する.
+ *
+ *  @param  [in]    dir     雛形のディレクトリ.
+ *  @param  [in]    builder 雛形を構築する関数.
+ *  @param  [in]    arg     @c builder に渡す引数.
+ *  @return 成功時は 0 が返り, 失敗時は -1 が返る.
+ */
+static int build_template(const char *dir, template_builder builder, void *arg)
+{
+    char path[PATH_MAX];
+
+    if ((snprintf(path, sizeof(path), "%s/complete", dir) >= (int)sizeof(path))
+        || (snprintf(path, sizeof(path), "%s/lower", dir) >= (int)sizeof(path))) {
+
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    /* 構築途中で中断された雛形は破棄する. */
+    if (is_mount_point(dir) && (umount2(dir, MNT_DETACH) != 0)) {
+        DEBUG("umount2: %s (%s)", strerror(errno), dir);
+        return -1;
+    }
+    if ((mkdir(dir, TEMPLATE_DIR_PERM) != 0) && (errno != EEXIST)) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), dir);
+        return -1;
+    }
+    if (mount("none", dir, "tmpfs", 0, "mode=700") != 0) {
+        DEBUG("mount: %s (%s)", strerror(errno), dir);
+        return -1;
+    }
+
+    if (mkdir(path, LOWER_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), path);
+        umount2(dir, MNT_DETACH);
+        return -1;
+    }
+    if (builder(arg, path) != 0) {
+        DEBUG("template: failed to build (%s)", path);
+        umount2(dir, MNT_DETACH);
+        return -1;
+    }
+
+    if (snprintf(path, sizeof(path), "%s/complete", dir) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        umount2(dir, MNT_DETACH);
+        return -1;
+    }
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR);
+    if (fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), path);
+        umount2(dir, MNT_DETACH);
+        return -1;
+    }
+    close(fd);
+
+    if (mount("none", dir, "tmpfs", MS_REMOUNT | MS_RDONLY, NULL) != 0) {
+        DEBUG("mount: %s (%s)", strerror(errno), dir);
+        umount2(dir, MNT_DETACH);
+        return -1;
+    }
+    DEBUG("template: built %s", dir);
+
+    return 0;
+}
+
+/**
+ *  @details    @c key に対応する雛形を用意する.
+ *              雛形が無い場合は @c builder で構築し, 既にある場合は
+ *              そのまま使用する.
+ *              同じ雛形を複数のプロセスが同時に構築することはない.
+ *
+ *  @param      [in]    path    雛形のルートディレクトリのパス.
+ *  @param      [in]    key     設定を識別するキー.
+ *  @param      [in]    builder 雛形を構築する関数.
+ *  @param      [in]    arg     @c builder に渡す引数.
+ *  @param      [out]   lower   下位層のパス.
+ *  @param      [in]    length  @c lower のサイズ.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int template_prepare(const char *path,
+                     uint64_t key,
+                     template_builder builder,
+                     void *arg,
+                     char *lower,
+                     size_t length)
+{
+    char dir[PATH_MAX];
+    char file[PATH_MAX + 16];
+
+    if ((path == NULL) || (builder == NULL) || (lower == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (make_directories(path, TEMPLATE_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), path);
+        return -1;
+    }
+    if (snprintf(dir, sizeof(dir), "%s/%016" PRIx64, path, key) >= (int)sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    snprintf(file, sizeof(file), "%s.lock", dir);
+    int lock_fd = open(file, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (lock_fd < 0) {
+        DEBUG("open: %s (%s)", strerror(errno), file);
+        return -1;
+    }
+    if (flock(lock_fd, LOCK_EX) != 0) {
+        DEBUG("flock: %s (%s)", strerror(errno), file);
+        close(lock_fd);
+        return -1;
+    }
+
+    int ret = 0;
+    snprintf(file, sizeof(file), "%s/complete", dir);
+    if (access(file, F_OK) != 0) {
+        ret = build_template(dir, builder, arg);
+    }
+    close(lock_fd);
+
+    if ((ret == 0) && (snprintf(lower, length, "%s/lower", dir) >= (int)length)) {
+        errno = ENAMETOOLONG;
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/**
+ *  @details    tmpfs をマウント済みの @c mount_point に上位層と作業ディレクトリを
+ *              作成し, @c lower を下位層とした overlayfs を重ねてマウントする.
+ *              jail 内での書き込みは全て tmpfs 上の上位層に記録される.
+ *
+ *  @param      [in]    lower       下位層のパス. (複数の場合は上の層から ':' で区切る)
+ *  @param      [in]    mount_point jail のパス.
+ *  @param      [in]    uid         jail の所有者のユーザ ID.
+ *  @param      [in]    gid         jail の所有者のグループ ID.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *  @remarks    jail を解体する際は, overlayfs と tmpfs の 2 つを
+ *              アンマウントする必要がある.
+ */
+int template_mount(const char *lower, const char *mount_point, uid_t uid, gid_t gid)
+{
+    char upper[PATH_MAX], work[PATH_MAX];
+
+    if ((lower == NULL) || (mount_point == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((snprintf(upper, sizeof(upper), "%s/upper", mount_point) >= (int)sizeof(upper))
+        || (snprintf(work, sizeof(work), "%s/work", mount_point) >= (int)sizeof(work))) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if ((mkdir(upper, UPPER_DIR_PERM) != 0) || (chown(upper, uid, gid) != 0)) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), upper);
+        return -1;
+    }
+    if (mkdir(work, UPPER_DIR_PERM) != 0) {
+        DEBUG("mkdir: %s (%s)", strerror(errno), work);
+        return -1;
+    }
+
+    size_t length = strlen(lower) + strlen(upper) + strlen(work) + 64;
+    char *options = malloc(length);
+    if (options == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    snprintf(options, length,
+             "lowerdir=%s,upperdir=%s,workdir=%s",
+             lower, upper, work);
+    int ret = mount("overlay", mount_point, "overlay", 0, options);
+    if (ret != 0) {
+        DEBUG("mount: %s (%s)", strerror(errno), options);
+    }
+    free(options);
+
+    return ret;
+}
@@ -0,0 +1,60 @@
+/** @file       template.h
+ *  @brief      jail の rootfs の雛形を提供する.
+ *
+ *  ディレクトリ, デバイスファイル, バインド先といった rootfs の静的な部分を
+ *  設定毎に一度だけ構築し, overlayfs の読み込み専用の下位層として
+ *  各 jail で共用する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_TEMPLATE_H__
+#define __ALCATRAZ_TEMPLATE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** @defgroup cat_template Template
+ *  jail の rootfs の雛形を提供するモジュール.
+ *  @{
+ */
+
+/**
+ *  雛形を構築する関数の型.
+ *
+ *  @c lower に作成済みの空ディレクトリへ rootfs の静的な部分を構築する.
+ *  成功時は 0, 失敗時は -1 を返すこと.
+ */
+typedef int (*template_builder)(void *arg, const char *lower);
+
+/**
+ *  雛形を用意する.
+ *
+ *  @par    使用例
+ *          @code
+ *          char lower[PATH_MAX];
+ *          template_prepare("/run/alctrz/template", key, builder, arg,
+ *                           lower, sizeof(lower));
+ *          // jail 毎に tmpfs をマウントした後で重ねる.
+ *          template_mount(lower, mount_point, uid, gid);
+ *          @endcode
+ */
+int template_prepare(const char *path,
+                     uint64_t key,
+                     template_builder builder,
+                     void *arg,
+                     char *lower,
+                     size_t length);
+
+/**
+ *  雛形を下位層として jail に overlayfs をマウントする.
+ */
+int template_mount(const char *lower, const char *mount_point, uid_t uid, gid_t gid);
+
+/** @} */
+
+#endif /* __ALCATRAZ_TEMPLATE_H__ */
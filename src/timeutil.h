@@ -0,0 +1,41 @@
+/** @file       timeutil.h
+ *  @brief      時間計測の補助機能を提供する.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_TIMEUTIL_H__
+#define __ALCATRAZ_TIMEUTIL_H__
+
+#include <stdint.h>
+#include <time.h>
+
+/**
+ *  単調増加する時刻をナノ秒で返す.
+ *
+ *  @return 時刻 (ナノ秒) が返る.
+ */
+static inline uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ *  指定の時刻からの経過時間をマイクロ秒で返す.
+ *
+ *  @param  [in]    start   monotonic_ns() で取得した時刻.
+ *  @return 経過時間 (マイクロ秒) が返る.
+ */
+static inline uint64_t elapsed_us(uint64_t start)
+{
+    return (monotonic_ns() - start) / UINT64_C(1000);
+}
+
+#endif /* __ALCATRAZ_TIMEUTIL_H__ */
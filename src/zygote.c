@@ -0,0 +1,986 @@
+/** @file       zygote.c
+ *  @brief      準備済みの jail からプログラムを起動する zygote を提供する.
+ *
+ *  起動要求は, 次の順に送信する.
+ *  1. ヘッダ (struct zygote_request). 標準入力, 標準出力, 標準エラー出力の
+ *     記述子を SCM_RIGHTS で添付する.
+ *  2. コマンドライン引数. 終端文字で区切った文字列を連結したもの.
+ *     引数が無い場合は, zygote の標準のコマンドライン引数で起動する.
+ *  zygote は exec の後に起動結果を, 終了後に終了状態を struct zygote_reply で
+ *  返す. 要求元が接続を閉じた場合は, プログラムに SIGHUP を送る.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* for accept4, pipe2, struct ucred, MSG_CMSG_CLOEXEC */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "zygote.h"
+#include "timeutil.h"
+#include "debug.h"
+
+/**
+ *  起動要求の識別子. ("zygo")
+ */
+#define ZYGOTE_MAGIC UINT32_C(0x7a79676f)
+
+/**
+ *  起動要求に添付する記述子の数.
+ */
+#define ZYGOTE_FDS (3)
+
+/**
+ *  起動要求の受信を待つ時間 (ミリ秒).
+ *  受信を終えないまま超過した接続は閉じる.
+ */
+#define ZYGOTE_RECV_TIMEOUT (1000)
+
+/**
+ *  同時に受信する起動要求の最大数.
+ */
+#define ZYGOTE_PENDING_MAX (16)
+
+/**
+ *  応答の種別: プログラムを起動した.
+ */
+#define ZYGOTE_REPLY_STARTED (1)
+
+/**
+ *  応答の種別: プログラムが終了した.
+ */
+#define ZYGOTE_REPLY_EXITED (2)
+
+/**
+ *  起動要求のヘッダ.
+ */
+struct zygote_request {
+    uint32_t magic;  /**< 識別子. */
+    uint32_t argc;   /**< コマンドライン引数の数. */
+    uint32_t length; /**< コマンドライン引数の長さ. */
+};
+
+/**
+ *  起動要求への応答.
+ */
+struct zygote_reply {
+    uint32_t type;       /**< 応答の種別. */
+    int32_t pid;         /**< プロセス ID. */
+    int32_t error;       /**< 起動に失敗した場合の errno. */
+    int32_t status;      /**< wait(2) の終了状態. */
+    uint64_t launch_us;  /**< 要求の受信から exec までの時間 (マイクロ秒). */
+    uint64_t utime_us;   /**< ユーザ CPU 時間 (マイクロ秒). */
+    uint64_t stime_us;   /**< システム CPU 時間 (マイクロ秒). */
+    uint64_t maxrss_kb;  /**< 最大常駐セットサイズ (KiB). */
+    uint64_t elapsed_us; /**< 要求の受信から終了までの時間 (マイクロ秒). */
+};
+
+/**
+ *  実行中のプログラム.
+ */
+struct zygote_child {
+    pid_t pid;      /**< プロセス ID. */
+    int conn_fd;    /**< 要求元との接続. */
+    bool hung_up;   /**< 要求元が接続を閉じたか. */
+    uint64_t start; /**< 要求を受信した時刻. */
+};
+
+/**
+ *  受信中の起動要求.
+ */
+struct zygote_pending {
+    int conn_fd;                   /**< 要求元との接続. */
+    uint64_t start;                /**< 接続を受け付けた時刻. */
+    struct zygote_request request; /**< 起動要求のヘッダ. */
+    size_t header_length;          /**< 受信したヘッダの長さ. */
+    int fds[ZYGOTE_FDS];           /**< 添付された記述子. */
+    size_t num_fds;                /**< 受信した記述子の数. */
+    char **argv;                   /**< コマンドライン引数. */
+    size_t args_length;            /**< 受信したコマンドライン引数の長さ. */
+};
+
+/**
+ *  zygote の状態.
+ */
+struct zygote {
+    int listen_fd;                 /**< 起動要求を待ち受けるソケット. */
+    int signal_fd;                 /**< SIGCHLD を受け取る signalfd. */
+    uid_t owner;                   /**< 起動を要求できるユーザ. */
+    char * const *default_argv;    /**< 標準のコマンドライン引数. */
+    sigset_t saved_mask;           /**< プログラムに引き継ぐシグナルマスク. */
+    struct zygote_child children[ZYGOTE_RUNS_MAX]; /**< 実行中のプログラム. */
+    size_t num_children;           /**< 実行中のプログラムの数. */
+    struct zygote_pending pending[ZYGOTE_PENDING_MAX]; /**< 受信中の起動要求. */
+    size_t num_pending;            /**< 受信中の起動要求の数. */
+};
+
+/**
+ *  指定の長さを全て送信する.
+ */
+static int send_full(int fd, const void *buf, size_t length)
+{
+    const char *p = (const char *)buf;
+
+    while (length > 0) {
+        ssize_t sent = send(fd, p, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += sent;
+        length -= sent;
+    }
+
+    return 0;
+}
+
+/**
+ *  指定の長さを全て受信する.
+ *
+ *  途中で相手が終了した場合は, EPIPE で失敗する.
+ */
+static int recv_full(int fd, void *buf, size_t length)
+{
+    char *p = (char *)buf;
+
+    while (length > 0) {
+        ssize_t received = recv(fd, p, length, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (received == 0) {
+            errno = EPIPE;
+            return -1;
+        }
+        p += received;
+        length -= received;
+    }
+
+    return 0;
+}
+
+/**
+ *  timeval をマイクロ秒に変換する.
+ */
+static uint64_t timeval_us(const struct timeval *tv)
+{
+    return (uint64_t)tv->tv_sec * UINT64_C(1000000) + (uint64_t)tv->tv_usec;
+}
+
+/**
+ *  起動要求のヘッダと, 添付された記述子を受信する.
+ *
+ *  受信できるデータが無い場合は, EAGAIN で失敗する.
+ *  記述子は, ヘッダの先頭と共に受信する.
+ */
+static int zygote_recv_header(struct zygote_pending *pending)
+{
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * ZYGOTE_FDS)];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {
+        .iov_base = (char *)&pending->request + pending->header_length,
+        .iov_len = sizeof(pending->request) - pending->header_length,
+    };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    ssize_t received;
+
+    do {
+        received = recvmsg(pending->conn_fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    } while ((received < 0) && (errno == EINTR));
+    if (received <= 0) {
+        if (received == 0) {
+            errno = EPIPE;
+        }
+        return -1;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i) {
+                int received_fd;
+                memcpy(&received_fd, CMSG_DATA(cmsg) + sizeof(int) * i, sizeof(int));
+                if (pending->num_fds < ZYGOTE_FDS) {
+                    pending->fds[pending->num_fds++] = received_fd;
+                } else {
+                    close(received_fd);
+                }
+            }
+        }
+    }
+    if ((pending->num_fds != ZYGOTE_FDS) || (msg.msg_flags & MSG_CTRUNC)) {
+        errno = EPROTO;
+        return -1;
+    }
+    pending->header_length += received;
+
+    return 0;
+}
+
+/**
+ *  コマンドライン引数を受信する領域を確保する.
+ *
+ *  @return 成功時は, 引数の数に応じた文字列配列が返る.
+ *          文字列は配列と同じ領域に受信するため, 配列のみを解放する.
+ */
+static char **zygote_alloc_argv(const struct zygote_request *request)
+{
+    if ((request->magic != ZYGOTE_MAGIC)
+        || (request->argc > ZYGOTE_ARGC_MAX)
+        || (request->length > ZYGOTE_ARGS_MAX)) {
+
+        errno = EPROTO;
+        return NULL;
+    }
+
+    size_t table = sizeof(char *) * (request->argc + 1);
+    char **argv = malloc(table + request->length);
+    if (argv == NULL) {
+        return NULL;
+    }
+    argv[0] = (char *)argv + table;
+
+    return argv;
+}
+
+/**
+ *  起動要求のコマンドライン引数を受信する.
+ *
+ *  受信できるデータが無い場合は, EAGAIN で失敗する.
+ */
+static int zygote_recv_args(struct zygote_pending *pending)
+{
+    char *args = pending->argv[0];
+    ssize_t received;
+
+    do {
+        received = recv(pending->conn_fd,
+                        args + pending->args_length,
+                        pending->request.length - pending->args_length,
+                        MSG_DONTWAIT);
+    } while ((received < 0) && (errno == EINTR));
+    if (received <= 0) {
+        if (received == 0) {
+            errno = EPIPE;
+        }
+        return -1;
+    }
+    pending->args_length += received;
+
+    return 0;
+}
+
+/**
+ *  受信したコマンドライン引数を文字列配列に分割する.
+ *
+ *  @return 成功時は, 終端に NULL を持つ文字列配列になる.
+ */
+static int zygote_split_argv(char **argv, const struct zygote_request *request)
+{
+    char *args = argv[0];
+
+    size_t argc = 0;
+    for (size_t offset = 0; offset < request->length; ++argc) {
+        const char *end = memchr(args + offset, '\0', request->length - offset);
+        if ((end == NULL) || (argc >= request->argc)) {
+            errno = EPROTO;
+            return -1;
+        }
+        argv[argc] = args + offset;
+        offset = (end - args) + 1;
+    }
+    if (argc != request->argc) {
+        errno = EPROTO;
+        return -1;
+    }
+    argv[argc] = NULL;
+
+    return 0;
+}
+
+/**
+ *  受信できる分だけ起動要求を受信する.
+ *
+ *  @return 起動要求を全て受信した場合は, 1 が返る.
+ *          受信を継続する場合は, 0 が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ */
+static int zygote_receive(struct zygote_pending *pending)
+{
+    while (pending->header_length < sizeof(pending->request)) {
+        if (zygote_recv_header(pending) != 0) {
+            return (errno == EAGAIN) ? 0 : -1;
+        }
+    }
+    if (pending->argv == NULL) {
+        pending->argv = zygote_alloc_argv(&pending->request);
+        if (pending->argv == NULL) {
+            return -1;
+        }
+    }
+    while (pending->args_length < pending->request.length) {
+        if (zygote_recv_args(pending) != 0) {
+            return (errno == EAGAIN) ? 0 : -1;
+        }
+    }
+    if (zygote_split_argv(pending->argv, &pending->request) != 0) {
+        return -1;
+    }
+
+    return 1;
+}
+
+/**
+ *  受信中の起動要求を破棄する.
+ */
+static void zygote_pending_close(struct zygote_pending *pending)
+{
+    if (pending->conn_fd >= 0) {
+        close(pending->conn_fd);
+    }
+    for (size_t i = 0; i < pending->num_fds; ++i) {
+        close(pending->fds[i]);
+    }
+    free(pending->argv);
+}
+/**
+ *  プログラムを起動する.
+ *
+ *  exec の成否は close-on-exec のパイプで受け取る.
+ *
+ *  @return 成功時は, プロセス ID が返る.
+ *          失敗時は, -1 が返り, errno が適切に設定される.
+ */
+static pid_t zygote_spawn(struct zygote *self, char * const *argv, const int fds[ZYGOTE_FDS])
+{
+    int exec_fds[2];
+    if (pipe2(exec_fds, O_CLOEXEC) != 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        int error = errno;
+        close(exec_fds[0]);
+        close(exec_fds[1]);
+        errno = error;
+        return -1;
+    } else if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &self->saved_mask, NULL);
+        /* zygote が終了した場合は, 残さない. */
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        for (int i = 0; i < ZYGOTE_FDS; ++i) {
+            if (fds[i] == i) {
+                fcntl(i, F_SETFD, 0);
+            } else {
+                dup2(fds[i], i);
+            }
+        }
+        execvp(argv[0], argv);
+        int error = errno;
+        if (write(exec_fds[1], &error, sizeof(error)) < 0) {
+            /* 要求元には, 終了状態のみが伝わる. */
+        }
+        _exit(127);
+    }
+    close(exec_fds[1]);
+
+    int error = 0;
+    ssize_t length;
+    do {
+        length = read(exec_fds[0], &error, sizeof(error));
+    } while ((length < 0) && (errno == EINTR));
+    close(exec_fds[0]);
+    if (length > 0) {
+        /* exec に失敗したプロセスは, 直ちに回収する. */
+        waitpid(pid, NULL, 0);
+        errno = error;
+        return -1;
+    }
+
+    return pid;
+}
+
+/**
+ *  受信した起動要求のプログラムを起動し, 要求元に起動結果を返す.
+ *
+ *  受信中の起動要求は, 接続を除いて破棄する.
+ */
+static void zygote_launch(struct zygote *self, struct zygote_pending *pending)
+{
+    struct zygote_reply reply = {
+        .type = ZYGOTE_REPLY_STARTED,
+        .pid = -1,
+    };
+
+    if (self->num_children >= ZYGOTE_RUNS_MAX) {
+        reply.error = EAGAIN;
+    } else {
+        char * const *run_argv = (pending->request.argc > 0) ? pending->argv : self->default_argv;
+        pid_t pid = zygote_spawn(self, run_argv, pending->fds);
+        if (pid < 0) {
+            reply.error = errno;
+            DEBUG("zygote: %s (%s)", strerror(errno), run_argv[0]);
+        }
+        reply.pid = pid;
+        reply.launch_us = elapsed_us(pending->start);
+    }
+    int conn_fd = pending->conn_fd;
+    pending->conn_fd = -1;
+    zygote_pending_close(pending);
+
+    if (reply.pid < 0) {
+        send_full(conn_fd, &reply, sizeof(reply));
+        close(conn_fd);
+        return;
+    }
+    /* 要求元が居ない場合も, 終了の回収までは接続を保持する. */
+    bool hung_up = (send_full(conn_fd, &reply, sizeof(reply)) != 0);
+    if (hung_up) {
+        kill(reply.pid, SIGHUP);
+    }
+
+    self->children[self->num_children++] = (struct zygote_child){
+        .pid = reply.pid,
+        .conn_fd = conn_fd,
+        .hung_up = hung_up,
+        .start = pending->start,
+    };
+}
+
+/**
+ *  受信中の起動要求を進め, 全て受信した場合はプログラムを起動する.
+ *
+ *  受信は待たないため, 要求元が送信を止めても他の要求を妨げない.
+ *  要求の不備は要求元との接続を閉じるのみで, zygote は終了しない.
+ */
+static void zygote_process(struct zygote *self, size_t index)
+{
+    struct zygote_pending *pending = &self->pending[index];
+
+    int ret = zygote_receive(pending);
+    if (ret == 0) {
+        return;
+    } else if (ret > 0) {
+        zygote_launch(self, pending);
+    } else {
+        int error = errno;
+        DEBUG("zygote: %s (request)", strerror(error));
+        /* ヘッダを受信した後の不備は, 要求元に伝える. */
+        if (pending->header_length == sizeof(pending->request)) {
+            struct zygote_reply reply = {
+                .type = ZYGOTE_REPLY_STARTED,
+                .pid = -1,
+                .error = error,
+            };
+            send_full(pending->conn_fd, &reply, sizeof(reply));
+        }
+        zygote_pending_close(pending);
+    }
+    self->pending[index] = self->pending[--self->num_pending];
+}
+
+/**
+ *  接続を受け付け, 起動要求の受信を始める.
+ */
+static void zygote_accept(struct zygote *self, int conn_fd)
+{
+    struct ucred cred;
+    socklen_t cred_length = sizeof(cred);
+    if (getsockopt(conn_fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_length) != 0) {
+        DEBUG("getsockopt: %s (SO_PEERCRED)", strerror(errno));
+        close(conn_fd);
+        return;
+    }
+    if ((cred.uid != self->owner) && (cred.uid != 0)) {
+        DEBUG("zygote: rejected uid %d", (int)cred.uid);
+        close(conn_fd);
+        return;
+    }
+
+    self->pending[self->num_pending++] = (struct zygote_pending){
+        .conn_fd = conn_fd,
+        .start = monotonic_ns(),
+    };
+    /* 要求元は接続直後に送信するため, 多くの場合はそのまま起動できる. */
+    zygote_process(self, self->num_pending - 1);
+}
+
+/**
+ *  受信を待つ時間を超えた起動要求を破棄する.
+ *
+ *  @return 次の起動要求が期限を迎えるまでの時間 (ミリ秒).
+ *          受信中の起動要求が無い場合は, -1 が返る.
+ */
+static int zygote_expire(struct zygote *self)
+{
+    uint64_t now = monotonic_ns();
+    int timeout = -1;
+
+    for (size_t i = 0; i < self->num_pending;) {
+        uint64_t elapsed_ms = (now - self->pending[i].start) / UINT64_C(1000000);
+        if (elapsed_ms >= ZYGOTE_RECV_TIMEOUT) {
+            DEBUG("zygote: %s (request)", strerror(ETIMEDOUT));
+            zygote_pending_close(&self->pending[i]);
+            self->pending[i] = self->pending[--self->num_pending];
+            continue;
+        }
+        int remaining = (int)(ZYGOTE_RECV_TIMEOUT - elapsed_ms);
+        if ((timeout < 0) || (remaining < timeout)) {
+            timeout = remaining;
+        }
+        ++i;
+    }
+
+    return timeout;
+}
+
+/**
+ *  終了したプログラムを回収し, 要求元に終了状態を返す.
+ */
+static void zygote_reap(struct zygote *self)
+{
+    struct signalfd_siginfo info;
+    while (read(self->signal_fd, &info, sizeof(info)) == sizeof(info)) {
+        /* 複数の SIGCHLD は 1 つにまとめられるため, 回数は使用しない. */
+    }
+
+    int status;
+    struct rusage usage;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        for (size_t i = 0; i < self->num_children; ++i) {
+            struct zygote_child *child = &self->children[i];
+            if (child->pid != pid) {
+                continue;
+            }
+
+            struct zygote_reply reply = {
+                .type = ZYGOTE_REPLY_EXITED,
+                .pid = pid,
+                .error = 0,
+                .status = status,
+                .utime_us = timeval_us(&usage.ru_utime),
+                .stime_us = timeval_us(&usage.ru_stime),
+                .maxrss_kb = (uint64_t)usage.ru_maxrss,
+                .elapsed_us = elapsed_us(child->start),
+            };
+            if (!child->hung_up) {
+                send_full(child->conn_fd, &reply, sizeof(reply));
+            }
+            close(child->conn_fd);
+            self->children[i] = self->children[--self->num_children];
+            break;
+        }
+    }
+}
+
+/**
+ *  要求元が閉じた接続のプログラムに SIGHUP を送る.
+ */
+static void zygote_hang_up(struct zygote *self, pid_t pid)
+{
+    for (size_t i = 0; i < self->num_children; ++i) {
+        struct zygote_child *child = &self->children[i];
+        if (child->pid == pid) {
+            char c;
+            ssize_t received = recv(child->conn_fd, &c, sizeof(c), MSG_DONTWAIT);
+            if ((received > 0) || ((received < 0) && (errno == EAGAIN))) {
+                /* 起動要求の後に送られたデータは読み捨てる. */
+                return;
+            }
+            child->hung_up = true;
+            kill(pid, SIGHUP);
+            return;
+        }
+    }
+}
+
+/**
+ *  起動要求を送信し, 起動結果と終了状態を受信する.
+ */
+static int zygote_exchange(int fd, const struct zygote_request *request, const char *args,
+                           struct zygote_result *result, zygote_started started, void *arg)
+{
+    const int fds[ZYGOTE_FDS] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {
+        .iov_base = (void *)request,
+        .iov_len = sizeof(*request),
+    };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while ((sent < 0) && (errno == EINTR));
+    if ((sent < 0)
+        || (send_full(fd, (const char *)request + sent, sizeof(*request) - sent) != 0)
+        || (send_full(fd, args, request->length) != 0)) {
+
+        return -1;
+    }
+
+    struct zygote_reply reply;
+    if (recv_full(fd, &reply, sizeof(reply)) != 0) {
+        return -1;
+    }
+    if ((reply.type != ZYGOTE_REPLY_STARTED) || (reply.error != 0)) {
+        result->error = (reply.error != 0) ? reply.error : EPROTO;
+        errno = result->error;
+        return -1;
+    }
+    result->pid = reply.pid;
+    result->launch_us = reply.launch_us;
+    if (started != NULL) {
+        started(arg, result);
+    }
+
+    if (recv_full(fd, &reply, sizeof(reply)) != 0) {
+        return -1;
+    }
+    if (reply.type != ZYGOTE_REPLY_EXITED) {
+        errno = EPROTO;
+        return -1;
+    }
+    result->status = reply.status;
+    result->utime_us = reply.utime_us;
+    result->stime_us = reply.stime_us;
+    result->maxrss_kb = reply.maxrss_kb;
+    result->elapsed_us = reply.elapsed_us;
+
+    return 0;
+}
+
+/**
+ *  待ち受けるプロセスが居ないソケットファイルを削除する.
+ *
+ *  ソケット以外のファイルや, 他のユーザが所有するファイルは EEXIST で,
+ *  接続できるソケットは EADDRINUSE で失敗する.
+ */
+static int zygote_unlink_stale(const struct sockaddr_un *addr, uid_t owner)
+{
+    struct stat status;
+    if (lstat(addr->sun_path, &status) != 0) {
+        /* 既に削除されていれば, そのまま作成できる. */
+        return (errno == ENOENT) ? 0 : -1;
+    }
+    if (!S_ISSOCK(status.st_mode)
+        || ((status.st_uid != geteuid()) && (status.st_uid != owner))) {
+
+        errno = EEXIST;
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int ret = connect(fd, (const struct sockaddr *)addr, sizeof(*addr));
+    int error = errno;
+    close(fd);
+    if (ret == 0) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    if (error != ECONNREFUSED) {
+        errno = error;
+        return -1;
+    }
+
+    return unlink(addr->sun_path);
+}
+
+/**
+ *  @details    起動要求を待ち受けるソケットを作成する.
+ *              ソケットファイルは @c owner のみが読み書きできる.
+ *              既存のソケットファイルは, 自身か @c owner が所有し,
+ *              待ち受けるプロセスが居ない場合のみ置き換える.
+ *
+ *  @param      [in]    path    ソケットファイルのパス.
+ *  @param      [in]    owner   起動を要求できるユーザ.
+ *  @return     成功時は, close-on-exec のソケットが返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ */
+int zygote_listen(const char *path, uid_t owner)
+{
+    struct sockaddr_un addr = {
+        .sun_family = AF_UNIX,
+    };
+
+    if (path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    /* 作成した時点から, 他のユーザには接続させない. */
+    mode_t mask = umask(S_IRWXG | S_IRWXO);
+    int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    if ((ret != 0) && (errno == EADDRINUSE) && (zygote_unlink_stale(&addr, owner) == 0)) {
+        ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+    umask(mask);
+    if (ret != 0) {
+        int error = errno;
+        DEBUG("bind: %s (%s)", strerror(error), path);
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    if ((owner != geteuid()) && (chown(path, owner, (gid_t)-1) != 0)) {
+        int error = errno;
+        unlink(path);
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) != 0) {
+        int error = errno;
+        unlink(path);
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ *  @details    起動要求を処理する.
+ *              呼び出し元は, jail に入り実行ユーザになった状態で呼び出す.
+ *              プログラムは呼び出し元の環境変数と作業ディレクトリを引き継ぎ,
+ *              要求元の標準入出力で実行する.
+ *
+ *  @param      [in]    listen_fd       zygote_listen() で作成したソケット.
+ *  @param      [in]    owner           起動を要求できるユーザ. (root は常に許可する)
+ *  @param      [in]    default_argv    引数の無い要求で起動するコマンドライン引数.
+ *  @return     待ち受けを継続できない場合に, -1 が返り, errno が適切に設定される.
+ */
+int zygote_serve(int listen_fd, uid_t owner, char * const *default_argv)
+{
+    struct zygote *self = calloc(1, sizeof(*self));
+    if (self == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    self->listen_fd = listen_fd;
+    self->owner = owner;
+    self->default_argv = default_argv;
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &self->saved_mask);
+    self->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (self->signal_fd < 0) {
+        int error = errno;
+        sigprocmask(SIG_SETMASK, &self->saved_mask, NULL);
+        free(self);
+        errno = error;
+        return -1;
+    }
+
+    struct pollfd pfds[2 + ZYGOTE_RUNS_MAX + ZYGOTE_PENDING_MAX];
+    pid_t pids[ZYGOTE_RUNS_MAX];
+    int ret = 0;
+    while (ret == 0) {
+        int timeout = zygote_expire(self);
+        /* 受信中の起動要求が上限に達した間は, 新たな接続を受け付けない. */
+        short accept_events = (self->num_pending < ZYGOTE_PENDING_MAX) ? POLLIN : 0;
+        pfds[0] = (struct pollfd){.fd = self->signal_fd, .events = POLLIN};
+        pfds[1] = (struct pollfd){.fd = self->listen_fd, .events = accept_events};
+        nfds_t nfds = 2;
+        for (size_t i = 0; i < self->num_children; ++i) {
+            if (!self->children[i].hung_up) {
+                pids[nfds - 2] = self->children[i].pid;
+                pfds[nfds++] = (struct pollfd){.fd = self->children[i].conn_fd, .events = POLLIN};
+            }
+        }
+        nfds_t first_pending = nfds;
+        for (size_t i = 0; i < self->num_pending; ++i) {
+            pfds[nfds++] = (struct pollfd){.fd = self->pending[i].conn_fd, .events = POLLIN};
+        }
+
+        if (poll(pfds, nfds, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            zygote_reap(self);
+        }
+        for (nfds_t i = 2; i < first_pending; ++i) {
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                zygote_hang_up(self, pids[i - 2]);
+            }
+        }
+        /* 処理した起動要求は末尾と入れ替わるため, 末尾から処理する. */
+        for (nfds_t i = nfds; i > first_pending; --i) {
+            if (pfds[i - 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                zygote_process(self, i - 1 - first_pending);
+            }
+        }
+        if (pfds[1].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+            errno = EPIPE;
+            ret = -1;
+        } else if (pfds[1].revents & POLLIN) {
+            int conn_fd = accept4(self->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (conn_fd >= 0) {
+                zygote_accept(self, conn_fd);
+            } else if ((errno != EINTR) && (errno != ECONNABORTED) && (errno != EAGAIN)) {
+                DEBUG("accept4: %s", strerror(errno));
+            }
+        }
+    }
+
+    int error = errno;
+    for (size_t i = 0; i < self->num_pending; ++i) {
+        zygote_pending_close(&self->pending[i]);
+    }
+    for (size_t i = 0; i < self->num_children; ++i) {
+        close(self->children[i].conn_fd);
+    }
+    close(self->signal_fd);
+    sigprocmask(SIG_SETMASK, &self->saved_mask, NULL);
+    free(self);
+    errno = error;
+
+    return ret;
+}
+
+/**
+ *  @details    zygote にプログラムの起動を要求し, 終了を待つ.
+ *              プログラムは, 呼び出し元の標準入力, 標準出力, 標準エラー出力で
+ *              実行する.
+ *
+ *  @param      [in]    path    zygote のソケットファイルのパス.
+ *  @param      [in]    argv    コマンドライン引数. NULL または空の場合は,
+ *                              zygote の標準のコマンドライン引数で起動する.
+ *  @param      [out]   result  起動したプログラムの結果.
+ *  @param      [in]    started 起動時に呼び出す関数. (NULL の場合は呼び出さない)
+ *  @param      [in]    arg     @c started に渡す引数.
+ *  @return     成功時は, 0 が返る.
+ *              失敗時は, -1 が返り, errno が適切に設定される.
+ *              起動に失敗した場合は, @c result の error にも errno が設定される.
+ */
+int zygote_run(const char *path, char * const *argv,
+               struct zygote_result *result, zygote_started started, void *arg)
+{
+    struct sockaddr_un addr = {
+        .sun_family = AF_UNIX,
+    };
+
+    if ((path == NULL) || (result == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    memset(result, 0, sizeof(*result));
+    result->pid = -1;
+
+    struct zygote_request request = {
+        .magic = ZYGOTE_MAGIC,
+        .argc = 0,
+        .length = 0,
+    };
+    for (; (argv != NULL) && (argv[request.argc] != NULL); ++request.argc) {
+        request.length += strlen(argv[request.argc]) + 1;
+    }
+    if ((request.argc > ZYGOTE_ARGC_MAX) || (request.length > ZYGOTE_ARGS_MAX)) {
+        errno = E2BIG;
+        return -1;
+    }
+    char *args = malloc(request.length + 1);
+    if (args == NULL) {
+        return -1;
+    }
+    char *p = args;
+    for (uint32_t i = 0; i < request.argc; ++i) {
+        size_t length = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], length);
+        p += length;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        free(args);
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int error = errno;
+        close(fd);
+        free(args);
+        errno = error;
+        return -1;
+    }
+
+    int ret = zygote_exchange(fd, &request, args, result, started, arg);
+    int error = errno;
+    close(fd);
+    free(args);
+    errno = error;
+
+    return ret;
+}
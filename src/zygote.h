@@ -0,0 +1,93 @@
+/** @file       zygote.h
+ *  @brief      準備済みの jail からプログラムを起動する zygote を提供する.
+ *
+ *  zygote は jail に入り, 実行ユーザになった後で起動要求を待ち受ける.
+ *  起動要求毎に fork(2) と execve(2) のみでプログラムを起動し, 終了状態と
+ *  リソース使用量を要求元に返す.
+ *
+ *  @author     t-kenji <protect.2501@gmail.com>
+ *  @date       2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#ifndef __ALCATRAZ_ZYGOTE_H__
+#define __ALCATRAZ_ZYGOTE_H__
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/** @defgroup cat_zygote Zygote
+ *  準備済みの jail からプログラムを起動するモジュール.
+ *  @{
+ */
+
+/**
+ *  同時に実行できるプログラムの最大数.
+ */
+#define ZYGOTE_RUNS_MAX (64)
+
+/**
+ *  起動要求のコマンドライン引数の最大数.
+ */
+#define ZYGOTE_ARGC_MAX (1024)
+
+/**
+ *  起動要求のコマンドライン引数の最大長 (終端文字を含む合計).
+ */
+#define ZYGOTE_ARGS_MAX (65536)
+
+/**
+ *  起動したプログラムの結果.
+ */
+struct zygote_result {
+    pid_t pid;           /**< プロセス ID. (jail 側) */
+    int error;           /**< 起動に失敗した場合の errno. */
+    uint64_t launch_us;  /**< 要求の受信から exec までの時間 (マイクロ秒). */
+    int status;          /**< wait(2) の終了状態. */
+    uint64_t utime_us;   /**< ユーザ CPU 時間 (マイクロ秒). */
+    uint64_t stime_us;   /**< システム CPU 時間 (マイクロ秒). */
+    uint64_t maxrss_kb;  /**< 最大常駐セットサイズ (KiB). */
+    uint64_t elapsed_us; /**< 要求の受信から終了までの時間 (マイクロ秒). */
+};
+
+/**
+ *  プログラムの起動を通知する関数.
+ */
+typedef void (*zygote_started)(void *arg, const struct zygote_result *result);
+
+/**
+ *  起動要求を待ち受けるソケットを作成する.
+ *
+ *  @par    使用例
+ *          @code
+ *          int fd = zygote_listen("/run/alctrz/zygote.sock", getuid());
+ *          // jail に入り, 実行ユーザになる.
+ *          zygote_serve(fd, getuid(), argv);
+ *          @endcode
+ */
+int zygote_listen(const char *path, uid_t owner);
+
+/**
+ *  起動要求を処理する.
+ */
+int zygote_serve(int listen_fd, uid_t owner, char * const *default_argv);
+
+/**
+ *  zygote にプログラムの起動を要求し, 終了を待つ.
+ *
+ *  @par    使用例
+ *          @code
+ *          char *argv[] = {"/bin/true", NULL};
+ *          struct zygote_result result;
+ *          if (zygote_run("/run/alctrz/zygote.sock", argv, &result, NULL, NULL) == 0) {
+ *              printf("%d\n", WEXITSTATUS(result.status));
+ *          }
+ *          @endcode
+ */
+int zygote_run(const char *path, char * const *argv,
+               struct zygote_result *result, zygote_started started, void *arg);
+
+/** @} */
+
+#endif /* __ALCATRAZ_ZYGOTE_H__ */
@@ -0,0 +1,172 @@
+/** @file   config_test.cpp
+ *  @brief  設定ファイルの読み込みのテスト.
+ *
+ *  @author t-kenji <protect.2501@gmail.com>
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "catch2/catch.hpp"
+
+extern "C" {
+#include "config.h"
+#include "bindtree.h"
+}
+
+namespace {
+
+/**
+ *  設定ファイルの最小の構成.
+ */
+const char *minimal_config =
+    "{\n"
+    "    \"filesystem\": {\"procfs\": true},\n"
+    "    \"stdio\": \"fifo:///tmp/stdio.%d\",\n"
+    "    \"keep_capability\": []\n"
+    "}\n";
+
+/**
+ *  @c text を設定ファイルとして書き出し, プランに変換する.
+ */
+PLAN compile_text(const std::string &text)
+{
+    char path[] = "/tmp/alctrz-config-test-XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, text.data(), text.size()) == (ssize_t)text.size());
+    close(fd);
+
+    PLAN plan = config_compile(path);
+    int error = errno;
+    unlink(path);
+    errno = error;
+
+    return plan;
+}
+
+}
+
+SCENARIO("設定ファイルをプランに変換できる", "[config]") {
+
+    GIVEN("最小の構成の設定ファイル") {
+        PLAN plan = compile_text(minimal_config);
+
+        THEN("変換できる") {
+            REQUIRE(plan != NULL);
+            REQUIRE(plan_flags(plan) == PLAN_KERNELFS_PROCFS);
+            REQUIRE(std::string(plan_stdio(plan)) == "/tmp/stdio.%d");
+            REQUIRE(plan_capabilities(plan) == 0);
+        }
+
+        plan_release(plan);
+    }
+
+    GIVEN("各種の構成を含む設定ファイル") {
+        PLAN plan = compile_text(
+            "{\n"
+            "    \"filesystem\": {\"devtmpfs\": false, \"procfs\": true, \"sysfs\": true},\n"
+            "    \"directory\": [\"/etc\", \"/var\"],\n"
+            "    \"device\": [\n"
+            "        \"/dev/null,char,1,3,0666\",\n"
+            "        {\"pathname\": \"/dev/urandom\", \"type\": \"char\", \"major\": 1, \"minor\": 9, \"perm\": \"0444\"}\n"
+            "    ],\n"
+            "    \"bind\": [\"/usr/bin:/bin\", {\"source\": \"/usr/lib\", \"target\": \"/lib\", \"mode\": \"rw\", \"attr\": [\"nosuid\"]}],\n"
+            "    \"stdio\": \"fifo:///tmp/stdio.%d\",\n"
+            "    \"keep_capability\": [\"CAP_NET_ADMIN\"],\n"
+            "    \"environment\": {\"LANG\": \"C\", \"PATH\": \"/bin\\u003a/usr/bin\"},\n"
+            "    \"jail\": {\"size\": 64, \"nr_inodes\": 1024},\n"
+            "    \"unknown\": {\"nested\": [1, true, null, \"\\\"\"]}\n"
+            "}\n");
+
+        THEN("全ての構成が記録される") {
+            REQUIRE(plan != NULL);
+            REQUIRE(plan_flags(plan) == (PLAN_KERNELFS_PROCFS | PLAN_KERNELFS_SYSFS));
+            REQUIRE(plan_capabilities(plan) != 0);
+
+            size_t count;
+            plan_directories(plan, &count);
+            REQUIRE(count == 2);
+            const struct plan_device *devices = plan_devices(plan, &count);
+            REQUIRE(count == 2);
+            REQUIRE(devices[1].minor == 9);
+
+            const struct plan_bind *binds = plan_binds(plan, &count);
+            REQUIRE(count == 2);
+            REQUIRE(std::string(plan_string(plan, binds[0].source)) == "/usr/bin");
+            REQUIRE(std::string(plan_string(plan, binds[0].target)) == "/bin");
+            REQUIRE(binds[0].attrs == BIND_ATTR_RDONLY);
+            REQUIRE(binds[1].attrs == BIND_ATTR_NOSUID);
+
+            const struct plan_env *env = plan_environment(plan, &count);
+            REQUIRE(count == 2);
+            REQUIRE(std::string(plan_string(plan, env[1].value)) == "/bin:/usr/bin");
+
+            REQUIRE(plan_tmpfs(plan)->size == 64);
+            REQUIRE(plan_tmpfs(plan)->nr_inodes == 1024);
+        }
+
+        plan_release(plan);
+    }
+}
+
+SCENARIO("不正な設定ファイルは変換できない", "[config]") {
+
+    const char *malformed[] = {
+        /* 空のファイル. */
+        "",
+        /* トップレベルがオブジェクトではない. */
+        "[]",
+        /* 区切りの欠落. */
+        "{\"filesystem\": {\"procfs\": true} \"stdio\": \"fifo:///tmp/stdio.%d\", \"keep_capability\": []}",
+        /* 末尾のカンマ. */
+        "{\"filesystem\": {}, \"stdio\": \"fifo:///tmp/stdio.%d\", \"keep_capability\": [],}",
+        /* 閉じていない文字列. */
+        "{\"filesystem\": {}, \"stdio\": \"fifo:///tmp/stdio.%d, \"keep_capability\": []}",
+        /* 不正なエスケープ. */
+        "{\"filesystem\": {}, \"stdio\": \"fifo:///tmp/\\q\", \"keep_capability\": []}",
+        /* 型の誤り. */
+        "{\"filesystem\": [], \"stdio\": \"fifo:///tmp/stdio.%d\", \"keep_capability\": []}",
+        /* 必須の構成の欠落. */
+        "{\"filesystem\": {}, \"keep_capability\": []}",
+        /* 未知の標準入出力のプロトコル. */
+        "{\"filesystem\": {}, \"stdio\": \"file:///tmp/stdio.%d\", \"keep_capability\": []}",
+        /* 未知の capability. */
+        "{\"filesystem\": {}, \"stdio\": \"fifo:///tmp/stdio.%d\", \"keep_capability\": [\"CAP_UNKNOWN\"]}",
+        /* 末尾の余分な値. */
+        "{\"filesystem\": {}, \"stdio\": \"fifo:///tmp/stdio.%d\", \"keep_capability\": []} {}",
+    };
+
+    for (const char *text : malformed) {
+        GIVEN(std::string("設定ファイル: ") + text) {
+            PLAN plan = compile_text(text);
+
+            THEN("変換に失敗する") {
+                REQUIRE(plan == NULL);
+            }
+        }
+    }
+}
+
+SCENARIO("途中で切れた設定ファイルは変換できない", "[config]") {
+
+    GIVEN("最小の構成の設定ファイル") {
+        std::string text(minimal_config);
+
+        THEN("どの位置で切れても変換に失敗する") {
+            /* 末尾の改行と閉じ括弧を除いた全ての長さを試す. */
+            size_t complete = text.rfind('}');
+            for (size_t length = 1; length <= complete; ++length) {
+                INFO("length: " << length);
+                PLAN plan = compile_text(text.substr(0, length));
+                REQUIRE(plan == NULL);
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+/** @file   map_test.cpp
+ *  @brief  Map 構造のテスト.
+ *
+ *  @author t-kenji <protect.2501@gmail.com>
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#include <cerrno>
+#include <cstdio>
+#include <string>
+
+#include "catch2/catch.hpp"
+
+extern "C" {
+#include "collections.h"
+}
+
+SCENARIO("マップの容量を変更できる", "[map]") {
+
+    GIVEN("容量まで要素を追加したマップ") {
+        MAP map = map_init(sizeof(int), 4);
+        REQUIRE(map != NULL);
+        for (int i = 0; i < 4; ++i) {
+            std::string key = "key" + std::to_string(i);
+            REQUIRE(map_put(map, key.c_str(), &i) != NULL);
+        }
+
+        WHEN("要素を追加する") {
+            int value = 4;
+            void *added = map_put(map, "key4", &value);
+
+            THEN("容量を超えるため失敗する") {
+                REQUIRE(added == NULL);
+                REQUIRE(errno == ENOMEM);
+                REQUIRE(map_count(map) == 4);
+            }
+        }
+
+        WHEN("容量を増やしてから要素を追加する") {
+            REQUIRE(map_resize(map, 64) == 0);
+            for (int i = 4; i < 64; ++i) {
+                std::string key = "key" + std::to_string(i);
+                REQUIRE(map_put(map, key.c_str(), &i) != NULL);
+            }
+
+            THEN("全ての要素を取得できる") {
+                REQUIRE(map_count(map) == 64);
+                for (int i = 0; i < 64; ++i) {
+                    std::string key = "key" + std::to_string(i);
+                    int *value = (int *)map_get(map, key.c_str());
+                    REQUIRE(value != NULL);
+                    REQUIRE(*value == i);
+                }
+            }
+        }
+
+        WHEN("要素の数より小さい容量に変更する") {
+            int ret = map_resize(map, 3);
+
+            THEN("失敗し, 要素はそのまま残る") {
+                REQUIRE(ret == -1);
+                REQUIRE(errno == EINVAL);
+                REQUIRE(map_count(map) == 4);
+                for (int i = 0; i < 4; ++i) {
+                    std::string key = "key" + std::to_string(i);
+                    int *value = (int *)map_get(map, key.c_str());
+                    REQUIRE(value != NULL);
+                    REQUIRE(*value == i);
+                }
+            }
+        }
+
+        WHEN("要素を削除してから容量を減らす") {
+            REQUIRE(map_remove(map, "key0") == 0);
+            REQUIRE(map_remove(map, "key1") == 0);
+            REQUIRE(map_resize(map, 2) == 0);
+
+            THEN("残した要素のみ取得できる") {
+                REQUIRE(map_count(map) == 2);
+                REQUIRE(map_get(map, "key0") == NULL);
+                REQUIRE(map_get(map, "key1") == NULL);
+                REQUIRE(*(int *)map_get(map, "key2") == 2);
+                REQUIRE(*(int *)map_get(map, "key3") == 3);
+            }
+        }
+
+        map_release(map);
+    }
+}
@@ -0,0 +1,152 @@
+/** @file   pipeline_test.cpp
+ *  @brief  パイプラインのテスト.
+ *
+ *  @author t-kenji <protect.2501@gmail.com>
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#include <cerrno>
+#include <atomic>
+
+#include "catch2/catch.hpp"
+
+extern "C" {
+#include "pipeline.h"
+}
+
+namespace {
+
+/**
+ *  フェーズの実行を記録する.
+ */
+struct trace {
+    std::atomic<int> clock;
+    int order[PIPELINE_PHASES_MAX];
+};
+
+/**
+ *  フェーズの引数.
+ */
+struct step {
+    struct trace *trace;
+    int id;
+    int error;
+};
+
+int run_step(void *arg)
+{
+    struct step *self = (struct step *)arg;
+
+    self->trace->order[self->id] = ++self->trace->clock;
+    if (self->error != 0) {
+        errno = self->error;
+        return -1;
+    }
+
+    return 0;
+}
+
+int get_state(PIPELINE pipeline, size_t id)
+{
+    struct pipeline_stats stats;
+
+    REQUIRE(pipeline_get_stats(pipeline, id, &stats) == 0);
+
+    return stats.state;
+}
+
+}
+
+SCENARIO("依存関係に従ってフェーズを実行する", "[pipeline]") {
+
+    GIVEN("依存関係を持つフェーズ") {
+        struct trace trace = {};
+        struct step steps[4] = {
+            {&trace, 0, 0},
+            {&trace, 1, 0},
+            {&trace, 2, 0},
+            {&trace, 3, 0},
+        };
+        PIPELINE pipeline = pipeline_init();
+        REQUIRE(pipeline != NULL);
+
+        int a = pipeline_add(pipeline, "a", run_step, &steps[0], 0);
+        int b = pipeline_add(pipeline, "b", run_step, &steps[1], 0);
+        int c = pipeline_add(pipeline, "c", run_step, &steps[2], PIPELINE_DEP(a));
+        int d = pipeline_add(pipeline, "d", run_step, &steps[3], PIPELINE_DEP(b) | PIPELINE_DEP(c));
+        REQUIRE(a == 0);
+        REQUIRE(b == 1);
+        REQUIRE(c == 2);
+        REQUIRE(d == 3);
+        REQUIRE(pipeline_count(pipeline) == 4);
+
+        WHEN("全てのフェーズが成功する") {
+            int ret = pipeline_run(pipeline);
+
+            THEN("依存するフェーズの後に実行される") {
+                REQUIRE(ret == 0);
+                REQUIRE(trace.order[a] < trace.order[c]);
+                REQUIRE(trace.order[b] < trace.order[d]);
+                REQUIRE(trace.order[c] < trace.order[d]);
+                for (int id = a; id <= d; ++id) {
+                    REQUIRE(get_state(pipeline, id) == PIPELINE_PHASE_DONE);
+                }
+            }
+        }
+
+        WHEN("フェーズが失敗する") {
+            steps[2].error = EIO;
+            int ret = pipeline_run(pipeline);
+            int error = errno;
+
+            THEN("依存するフェーズは実行されない") {
+                REQUIRE(ret == -1);
+                REQUIRE(error == EIO);
+                REQUIRE(get_state(pipeline, a) == PIPELINE_PHASE_DONE);
+                REQUIRE(get_state(pipeline, b) == PIPELINE_PHASE_DONE);
+                REQUIRE(get_state(pipeline, c) == PIPELINE_PHASE_FAILED);
+                REQUIRE(get_state(pipeline, d) == PIPELINE_PHASE_SKIPPED);
+                REQUIRE(trace.order[d] == 0);
+            }
+        }
+
+        pipeline_release(pipeline);
+    }
+}
+
+SCENARIO("不正なフェーズは登録できない", "[pipeline]") {
+
+    GIVEN("空のパイプライン") {
+        struct trace trace = {};
+        struct step step = {&trace, 0, 0};
+        PIPELINE pipeline = pipeline_init();
+        REQUIRE(pipeline != NULL);
+
+        WHEN("未登録のフェーズに依存する") {
+            int ret = pipeline_add(pipeline, "a", run_step, &step, PIPELINE_DEP(0));
+
+            THEN("失敗する") {
+                REQUIRE(ret == -1);
+                REQUIRE(errno == EINVAL);
+                REQUIRE(pipeline_count(pipeline) == 0);
+            }
+        }
+
+        WHEN("最大数を超えて登録する") {
+            for (int i = 0; i < PIPELINE_PHASES_MAX; ++i) {
+                REQUIRE(pipeline_add(pipeline, "a", run_step, &step, 0) == i);
+            }
+            int ret = pipeline_add(pipeline, "a", run_step, &step, 0);
+
+            THEN("失敗する") {
+                REQUIRE(ret == -1);
+                REQUIRE(errno == ENOSPC);
+                REQUIRE(pipeline_count(pipeline) == PIPELINE_PHASES_MAX);
+            }
+        }
+
+        pipeline_release(pipeline);
+    }
+}
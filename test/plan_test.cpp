@@ -0,0 +1,203 @@
+/** @file   plan_test.cpp
+ *  @brief  プランのテスト.
+ *
+ *  @author t-kenji <protect.2501@gmail.com>
+ *  @date   2026-10-16 新規作成.
+ *  @copyright  Copyright © 2026 t-kenji
+ *
+ *  This code is licensed under the MIT License.
+ */
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "catch2/catch.hpp"
+
+extern "C" {
+#include "plan.h"
+}
+
+namespace {
+
+/**
+ *  雛形のみを設定したプランを生成する.
+ */
+PLAN build_template_plan(const char *path)
+{
+    PLAN_BUILDER builder = plan_builder_init();
+    REQUIRE(builder != NULL);
+    REQUIRE(plan_builder_set_template(builder, path) == 0);
+    PLAN plan = plan_builder_finish(builder);
+    plan_builder_release(builder);
+
+    return plan;
+}
+
+/**
+ *  tmpfs のメモリポリシーのみを設定したプランを生成する.
+ */
+PLAN build_tmpfs_plan(const char *mpol)
+{
+    PLAN_BUILDER builder = plan_builder_init();
+    REQUIRE(builder != NULL);
+    REQUIRE(plan_builder_set_tmpfs(builder, 0, 0, 0, mpol) == 0);
+    PLAN plan = plan_builder_finish(builder);
+    plan_builder_release(builder);
+
+    return plan;
+}
+
+}
+
+SCENARIO("プランに構成を記録できる", "[plan]") {
+
+    GIVEN("構成を追加したプラン構築器") {
+        PLAN_BUILDER builder = plan_builder_init();
+        REQUIRE(builder != NULL);
+        REQUIRE(plan_builder_set_flags(builder, PLAN_KERNELFS_PROCFS | PLAN_JAIL_SLAVE) == 0);
+        REQUIRE(plan_builder_set_stdio(builder, "/tmp/stdio.%d") == 0);
+        REQUIRE(plan_builder_set_tmpfs(builder, 64, 1024, PLAN_TMPFS_HUGE_WITHIN_SIZE, "interleave:0") == 0);
+        REQUIRE(plan_builder_add_directory(builder, "/etc") == 0);
+        REQUIRE(plan_builder_add_directory(builder, "/var") == 0);
+        REQUIRE(plan_builder_add_device(builder, "/dev/null", S_IFCHR | 0666, 1, 3) == 0);
+        REQUIRE(plan_builder_add_bind(builder, "/usr/bin", "/bin", 0) == 0);
+        REQUIRE(plan_builder_add_environment(builder, "LANG", "C") == 0);
+
+        WHEN("プランを生成する") {
+            PLAN plan = plan_builder_finish(builder);
+
+            THEN("追加した構成を取得できる") {
+                REQUIRE(plan != NULL);
+                REQUIRE(plan_flags(plan) == (PLAN_KERNELFS_PROCFS | PLAN_JAIL_SLAVE));
+                REQUIRE(std::string(plan_stdio(plan)) == "/tmp/stdio.%d");
+
+                const struct plan_tmpfs *tmpfs = plan_tmpfs(plan);
+                REQUIRE(tmpfs->size == 64);
+                REQUIRE(tmpfs->nr_inodes == 1024);
+                REQUIRE(tmpfs->huge == PLAN_TMPFS_HUGE_WITHIN_SIZE);
+                REQUIRE(std::string(plan_string(plan, tmpfs->mpol)) == "interleave:0");
+
+                size_t count;
+                const uint32_t *dirs = plan_directories(plan, &count);
+                REQUIRE(count == 2);
+                REQUIRE(std::string(plan_string(plan, dirs[0])) == "/etc");
+                REQUIRE(std::string(plan_string(plan, dirs[1])) == "/var");
+
+                const struct plan_device *devices = plan_devices(plan, &count);
+                REQUIRE(count == 1);
+                REQUIRE(std::string(plan_string(plan, devices[0].pathname)) == "/dev/null");
+                REQUIRE(devices[0].major == 1);
+                REQUIRE(devices[0].minor == 3);
+
+                const struct plan_bind *binds = plan_binds(plan, &count);
+                REQUIRE(count == 1);
+                REQUIRE(std::string(plan_string(plan, binds[0].source)) == "/usr/bin");
+                REQUIRE(std::string(plan_string(plan, binds[0].target)) == "/bin");
+
+                const struct plan_env *env = plan_environment(plan, &count);
+                REQUIRE(count == 1);
+                REQUIRE(std::string(plan_string(plan, env[0].name)) == "LANG");
+                REQUIRE(std::string(plan_string(plan, env[0].value)) == "C");
+            }
+
+            AND_WHEN("プランファイルに保存して開き直す") {
+                char path[] = "/tmp/alctrz-plan-test-XXXXXX";
+                int fd = mkstemp(path);
+                REQUIRE(fd >= 0);
+                close(fd);
+                REQUIRE(plan_save(plan, path) == 0);
+                PLAN loaded = plan_open(path, NULL);
+                unlink(path);
+
+                THEN("同じ構成を取得できる") {
+                    REQUIRE(loaded != NULL);
+                    REQUIRE(plan_key(loaded) == plan_key(plan));
+                    REQUIRE(plan_flags(loaded) == plan_flags(plan));
+                    REQUIRE(plan_tmpfs(loaded)->nr_inodes == 1024);
+                    size_t count;
+                    plan_binds(loaded, &count);
+                    REQUIRE(count == 1);
+                }
+
+                plan_release(loaded);
+            }
+
+            plan_release(plan);
+        }
+
+        plan_builder_release(builder);
+    }
+}
+
+SCENARIO("プランのキーは構成を区別する", "[plan]") {
+
+    GIVEN("同じ構成のプラン") {
+        PLAN a = build_template_plan("/srv/rootfs");
+        PLAN b = build_template_plan("/srv/rootfs");
+
+        THEN("キーは一致する") {
+            REQUIRE(a != NULL);
+            REQUIRE(b != NULL);
+            REQUIRE(plan_key(a) == plan_key(b));
+        }
+
+        plan_release(a);
+        plan_release(b);
+    }
+
+    GIVEN("雛形と tmpfs のメモリポリシーに同じ文字列を設定したプラン") {
+        PLAN a = build_template_plan("default");
+        PLAN b = build_tmpfs_plan("default");
+
+        THEN("キーは一致しない") {
+            REQUIRE(a != NULL);
+            REQUIRE(b != NULL);
+            REQUIRE(plan_key(a) != plan_key(b));
+        }
+
+        plan_release(a);
+        plan_release(b);
+    }
+
+    GIVEN("tmpfs の構成のみが異なるプラン") {
+        PLAN_BUILDER builder = plan_builder_init();
+        REQUIRE(plan_builder_set_tmpfs(builder, 64, 0, 0, NULL) == 0);
+        PLAN a = plan_builder_finish(builder);
+        plan_builder_release(builder);
+        builder = plan_builder_init();
+        REQUIRE(plan_builder_set_tmpfs(builder, 128, 0, 0, NULL) == 0);
+        PLAN b = plan_builder_finish(builder);
+        plan_builder_release(builder);
+
+        THEN("キーは一致しない") {
+            REQUIRE(a != NULL);
+            REQUIRE(b != NULL);
+            REQUIRE(plan_key(a) != plan_key(b));
+        }
+
+        plan_release(a);
+        plan_release(b);
+    }
+}
+
+SCENARIO("不正な tmpfs の構成は設定できない", "[plan]") {
+
+    GIVEN("プラン構築器") {
+        PLAN_BUILDER builder = plan_builder_init();
+        REQUIRE(builder != NULL);
+
+        WHEN("未知のヒュージページの割り当てを設定する") {
+            int ret = plan_builder_set_tmpfs(builder, 0, 0, PLAN_TMPFS_HUGE_ALWAYS + 1, NULL);
+
+            THEN("失敗する") {
+                REQUIRE(ret == -1);
+                REQUIRE(errno == EINVAL);
+            }
+        }
+
+        plan_builder_release(builder);
+    }
+}
@@ -2,8 +2,19 @@
 
 CXXEXECUTABLE = $(NAME)_utest
 OBJS = main.o \
+       config_test.o \
+       map_test.o \
+       pipeline_test.o \
+       plan_test.o \
+       $(TOP_DIR)/src/capability.o \
+       $(TOP_DIR)/src/collections.o \
+       $(TOP_DIR)/src/config.o \
+       $(TOP_DIR)/src/pipeline.o \
+       $(TOP_DIR)/src/plan.o \
        $(NULL)
 EXTRA_CXXFLAGS += -I$(TOP_DIR)/src
+# plan.h declares accessors named after their structs, which C++ reports as shadowing.
+EXTRA_CXXFLAGS += -Wno-shadow
 EXTRA_CXXFLAGS += $(if $(CATCH2_DIR),-I$(CATCH2_DIR)/single_include)
 
 include $(TOP_DIR)/rules.mk